@@ -12,10 +12,15 @@
 #include <ggl/error.h>
 #include <ggl/object.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 /// Make a call to an AWS IoT MQTT API.
 /// Sends request on topic and waits for response on topic/(accepted|rejected).
 /// Responses will be filtered according to clientToken.
+/// The subscription to topic/+ is kept open for later calls on the same topic,
+/// and concurrent calls are multiplexed on it; use distinct clientTokens for
+/// concurrent calls on one topic.
+/// The response, including its buffers, is copied into alloc.
 GglError ggl_aws_iot_call(
     GglBuffer socket_name,
     GglBuffer topic,
@@ -25,4 +30,15 @@ GglError ggl_aws_iot_call(
     GglObject *result
 );
 
+/// Make a call to an AWS IoT MQTT API, waiting up to timeout_s for a response.
+GglError ggl_aws_iot_call_with_timeout(
+    GglBuffer socket_name,
+    GglBuffer topic,
+    GglObject payload,
+    bool virtual,
+    uint32_t timeout_s,
+    GglArena *alloc,
+    GglObject *result
+);
+
 #endif
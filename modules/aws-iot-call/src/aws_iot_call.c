@@ -9,7 +9,7 @@
 #include <ggl/buffer.h>
 #include <ggl/cleanup.h>
 #include <ggl/core_bus/aws_iot_mqtt.h>
-#include <ggl/core_bus/client.h> // IWYU pragma: keep (cleanup)
+#include <ggl/core_bus/client.h>
 #include <ggl/error.h>
 #include <ggl/json_decode.h>
 #include <ggl/json_encode.h>
@@ -18,12 +18,14 @@
 #include <ggl/object.h>
 #include <ggl/vector.h>
 #include <pthread.h>
+#include <string.h>
 #include <sys/types.h>
 #include <time.h>
 #include <stdbool.h>
 #include <stdint.h>
 
 #define AWS_IOT_MAX_TOPIC_SIZE 256
+#define MAX_SOCKET_NAME_LEN 64
 
 #define IOT_RESPONSE_TIMEOUT_S 30
 
@@ -31,18 +33,92 @@
 #define GGL_MAX_IOT_CORE_API_PAYLOAD_LEN 5000
 #endif
 
+/// Maximum number of API topics with response subscriptions kept open.
+/// Can be configured with `-DGGL_AWS_IOT_CALL_MAX_TOPICS=<N>`.
+#ifndef GGL_AWS_IOT_CALL_MAX_TOPICS
+#define GGL_AWS_IOT_CALL_MAX_TOPICS 8
+#endif
+
+/// Maximum number of concurrent requests waiting for a response.
+/// Can be configured with `-DGGL_AWS_IOT_CALL_MAX_IN_FLIGHT=<N>`.
+#ifndef GGL_AWS_IOT_CALL_MAX_IN_FLIGHT
+#define GGL_AWS_IOT_CALL_MAX_IN_FLIGHT 16
+#endif
+
+/// Memory for decoding a response before it is matched to a request.
+/// Can be configured with `-DGGL_AWS_IOT_CALL_DECODE_MEM_LEN=<N>`.
+#ifndef GGL_AWS_IOT_CALL_DECODE_MEM_LEN
+#define GGL_AWS_IOT_CALL_DECODE_MEM_LEN 16384
+#endif
+
+typedef enum {
+    API_SUB_UNUSED,
+    API_SUB_SUBSCRIBING,
+    API_SUB_ACTIVE,
+} ApiSubState;
+
+/// Open subscription to the responses of one API topic (`<topic>/+`).
+typedef struct {
+    ApiSubState state;
+    /// Incremented whenever the entry is reused; stale callbacks are ignored.
+    uint32_t generation;
+    uint32_t handle;
+    /// Set if the subscription closed while it was being established.
+    bool closed;
+    bool virtual;
+    uint8_t socket_name_mem[MAX_SOCKET_NAME_LEN];
+    size_t socket_name_len;
+    uint8_t topic_mem[AWS_IOT_MAX_TOPIC_SIZE];
+    size_t topic_len;
+    size_t in_flight;
+    uint64_t last_used;
+} ApiSubscription;
+
+/// Request waiting for its response.
 typedef struct {
-    pthread_mutex_t *mtx;
-    pthread_cond_t *cond;
+    bool in_use;
     bool ready;
+    size_t sub_index;
+    /// Generation of the subscription entry when the call was registered.
+    uint32_t sub_generation;
     GglBuffer *client_token;
     GglArena *alloc;
     GglObject *result;
     GglError ret;
-} CallbackCtx;
+} PendingCall;
+
+static pthread_mutex_t mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond;
+static ApiSubscription subs[GGL_AWS_IOT_CALL_MAX_TOPICS];
+static PendingCall calls[GGL_AWS_IOT_CALL_MAX_IN_FLIGHT];
+static uint64_t use_counter = 0;
+
+__attribute__((constructor)) static void init_cond(void) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+static void *sub_ctx(size_t index) {
+    uintptr_t key = ((uintptr_t) subs[index].generation
+                     * GGL_AWS_IOT_CALL_MAX_TOPICS)
+        + index;
+    return (void *) key;
+}
 
-static void cleanup_pthread_cond(pthread_cond_t **cond) {
-    pthread_cond_destroy(*cond);
+/// Returns the subscription for a callback ctx, or NULL if it is stale.
+static ApiSubscription *sub_from_ctx(void *ctx, size_t *index) {
+    uintptr_t key = (uintptr_t) ctx;
+    size_t i = key % GGL_AWS_IOT_CALL_MAX_TOPICS;
+    if (subs[i].generation != key / GGL_AWS_IOT_CALL_MAX_TOPICS) {
+        return NULL;
+    }
+    if (index != NULL) {
+        *index = i;
+    }
+    return &subs[i];
 }
 
 static GglError get_client_token(GglObject payload, GglBuffer **client_token) {
@@ -87,12 +163,36 @@ static bool match_client_token(GglObject payload, GglBuffer *client_token) {
     return ggl_buffer_eq(*client_token, *payload_client_token);
 }
 
+static void complete_call(
+    PendingCall *call, GglBuffer topic, GglObject response, bool decoded
+) {
+    if (ggl_buffer_has_suffix(topic, GGL_STR("/accepted"))) {
+        if (!decoded) {
+            call->ret = GGL_ERR_INVALID;
+        } else {
+            // Response memory is only valid during the callback
+            *call->result = response;
+            call->ret = ggl_arena_claim_obj(call->result, call->alloc);
+            if (call->ret != GGL_ERR_OK) {
+                GGL_LOGE("Insufficient memory to return response.");
+            }
+        }
+    } else {
+        GGL_LOGE(
+            "Received rejected response on %.*s.", (int) topic.len, topic.data
+        );
+        *call->result = response;
+        if (ggl_arena_claim_obj(call->result, call->alloc) != GGL_ERR_OK) {
+            *call->result = GGL_OBJ_NULL;
+        }
+        call->ret = GGL_ERR_REMOTE;
+    }
+    call->ready = true;
+}
+
 static GglError subscription_callback(
     void *ctx, uint32_t handle, GglObject data
 ) {
-    (void) handle;
-    CallbackCtx *call_ctx = ctx;
-
     GglBuffer topic;
     GglBuffer payload = { 0 };
     GglError ret
@@ -101,154 +201,395 @@ static GglError subscription_callback(
         return ret;
     }
 
+    if (!ggl_buffer_has_suffix(topic, GGL_STR("/accepted"))
+        && !ggl_buffer_has_suffix(topic, GGL_STR("/rejected"))) {
+        return GGL_ERR_OK;
+    }
+
+    GGL_MTX_SCOPE_GUARD(&mtx);
+
+    size_t sub_index;
+    ApiSubscription *sub = sub_from_ctx(ctx, &sub_index);
+    if ((sub == NULL) || (sub->state != API_SUB_ACTIVE)
+        || (sub->handle != handle) || (sub->in_flight == 0)) {
+        return GGL_ERR_OK;
+    }
+
+    static uint8_t decode_mem[GGL_AWS_IOT_CALL_DECODE_MEM_LEN];
+    GglArena decode_alloc = ggl_arena_init(GGL_BUF(decode_mem));
+
+    GglObject response;
     bool decoded = true;
-    ret = ggl_json_decode_destructive(
-        payload, call_ctx->alloc, call_ctx->result
-    );
+    ret = ggl_json_decode_destructive(payload, &decode_alloc, &response);
     if (ret != GGL_ERR_OK) {
         GGL_LOGE("Failed to decode response payload.");
-        *(call_ctx->result) = GGL_OBJ_NULL;
+        response = GGL_OBJ_NULL;
         decoded = false;
     }
 
-    if (!match_client_token(*call_ctx->result, call_ctx->client_token)) {
-        // Skip this message
-        return GGL_ERR_OK;
-    }
-
-    if (ggl_buffer_has_suffix(topic, GGL_STR("/accepted"))) {
-        if (!decoded) {
-            return GGL_ERR_INVALID;
+    for (size_t i = 0; i < GGL_AWS_IOT_CALL_MAX_IN_FLIGHT; i++) {
+        PendingCall *call = &calls[i];
+        if (!call->in_use || call->ready || (call->sub_index != sub_index)) {
+            continue;
+        }
+        if (match_client_token(response, call->client_token)) {
+            complete_call(call, topic, response, decoded);
+            pthread_cond_broadcast(&cond);
+            break;
         }
-        call_ctx->ret = GGL_ERR_OK;
-    } else if (ggl_buffer_has_suffix(topic, GGL_STR("/rejected"))) {
-        GGL_LOGE(
-            "Received rejected response: %.*s", (int) payload.len, payload.data
-        );
-        call_ctx->ret = GGL_ERR_REMOTE;
-    } else {
-        return GGL_ERR_INVALID;
     }
 
-    // Err to close subscription
-    return GGL_ERR_EXPECTED;
+    // Keep the subscription open for subsequent requests
+    return GGL_ERR_OK;
 }
 
 static void subscription_close_callback(void *ctx, uint32_t handle) {
-    (void) handle;
-    CallbackCtx *call_ctx = ctx;
+    GGL_MTX_SCOPE_GUARD(&mtx);
 
-    GGL_MTX_SCOPE_GUARD(call_ctx->mtx);
-    call_ctx->ready = true;
-    pthread_cond_signal(call_ctx->cond);
+    size_t sub_index;
+    ApiSubscription *sub = sub_from_ctx(ctx, &sub_index);
+    if (sub == NULL) {
+        return;
+    }
+
+    if (sub->state == API_SUB_SUBSCRIBING) {
+        sub->closed = true;
+        return;
+    }
+    if ((sub->state != API_SUB_ACTIVE) || (sub->handle != handle)) {
+        return;
+    }
+
+    GGL_LOGD(
+        "Response subscription for %.*s closed.",
+        (int) sub->topic_len,
+        sub->topic_mem
+    );
+
+    for (size_t i = 0; i < GGL_AWS_IOT_CALL_MAX_IN_FLIGHT; i++) {
+        PendingCall *call = &calls[i];
+        if (call->in_use && !call->ready && (call->sub_index == sub_index)) {
+            call->ret = GGL_ERR_FAILURE;
+            call->ready = true;
+        }
+    }
+
+    sub->state = API_SUB_UNUSED;
+    sub->generation += 1;
+    pthread_cond_broadcast(&cond);
 }
 
-GglError ggl_aws_iot_call(
+static bool sub_matches(
+    const ApiSubscription *sub,
+    GglBuffer socket_name,
+    GglBuffer topic,
+    bool virtual
+) {
+    return (sub->state != API_SUB_UNUSED) && (sub->virtual == virtual)
+        && ggl_buffer_eq(
+               (GglBuffer) { .data = (uint8_t *) sub->socket_name_mem,
+                             .len = sub->socket_name_len },
+               socket_name
+        )
+        && ggl_buffer_eq(
+               (GglBuffer) { .data = (uint8_t *) sub->topic_mem,
+                             .len = sub->topic_len },
+               topic
+        );
+}
+
+/// Finds or claims the subscription entry for a topic.
+/// Must be called with mtx held. If an idle subscription has to be evicted,
+/// its handle is returned in evicted_handle, to be closed once unlocked.
+static GglError find_sub_slot(
     GglBuffer socket_name,
     GglBuffer topic,
-    GglObject payload,
     bool virtual,
-    GglArena *alloc,
-    GglObject *result
+    size_t *index,
+    bool *claimed,
+    uint32_t *evicted_handle
 ) {
-    static pthread_mutex_t mem_mtx = PTHREAD_MUTEX_INITIALIZER;
-    GGL_MTX_SCOPE_GUARD(&mem_mtx);
+    ApiSubscription *unused = NULL;
+    ApiSubscription *oldest_idle = NULL;
+
+    for (size_t i = 0; i < GGL_AWS_IOT_CALL_MAX_TOPICS; i++) {
+        ApiSubscription *sub = &subs[i];
+        if (sub_matches(sub, socket_name, topic, virtual)) {
+            *index = i;
+            *claimed = false;
+            return GGL_ERR_OK;
+        }
+        if (sub->state == API_SUB_UNUSED) {
+            if (unused == NULL) {
+                unused = sub;
+            }
+        } else if ((sub->state == API_SUB_ACTIVE) && (sub->in_flight == 0)
+                   && ((oldest_idle == NULL)
+                       || (sub->last_used < oldest_idle->last_used))) {
+            oldest_idle = sub;
+        }
+    }
 
-    // TODO: Share memory for topic filter and encode
-    static uint8_t topic_filter_mem[AWS_IOT_MAX_TOPIC_SIZE];
-    static uint8_t json_encode_mem[GGL_MAX_IOT_CORE_API_PAYLOAD_LEN];
+    ApiSubscription *slot = unused;
+    if ((slot == NULL) && (oldest_idle != NULL)) {
+        slot = oldest_idle;
+        *evicted_handle = slot->handle;
+        slot->generation += 1;
+    }
+    if (slot == NULL) {
+        GGL_LOGE("Too many concurrent AWS IoT API topics.");
+        return GGL_ERR_NOMEM;
+    }
 
-    GglByteVec topic_filter = GGL_BYTE_VEC(topic_filter_mem);
+    *slot = (ApiSubscription) {
+        .state = API_SUB_SUBSCRIBING,
+        .generation = slot->generation,
+        .virtual = virtual,
+        .socket_name_len = socket_name.len,
+        .topic_len = topic.len,
+    };
+    memcpy(slot->socket_name_mem, socket_name.data, socket_name.len);
+    memcpy(slot->topic_mem, topic.data, topic.len);
 
-    GglError ret = ggl_byte_vec_append(&topic_filter, topic);
+    *index = (size_t) (slot - subs);
+    *claimed = true;
+    return GGL_ERR_OK;
+}
+
+static GglError subscribe_responses(size_t index) {
+    ApiSubscription *sub = &subs[index];
+    GglBuffer socket_name = { .data = sub->socket_name_mem,
+                              .len = sub->socket_name_len };
+
+    uint8_t topic_filter_mem[AWS_IOT_MAX_TOPIC_SIZE];
+    GglByteVec topic_filter = GGL_BYTE_VEC(topic_filter_mem);
+    GglError ret = ggl_byte_vec_append(
+        &topic_filter,
+        (GglBuffer) { .data = sub->topic_mem, .len = sub->topic_len }
+    );
     ggl_byte_vec_chain_append(&ret, &topic_filter, GGL_STR("/+"));
     if (ret != GGL_ERR_OK) {
         GGL_LOGE("Failed to construct response topic filter.");
         return ret;
     }
 
+    uint32_t sub_handle = 0;
+    ret = ggl_aws_iot_mqtt_subscribe(
+        socket_name,
+        GGL_BUF_LIST(topic_filter.buf),
+        1,
+        sub->virtual,
+        subscription_callback,
+        subscription_close_callback,
+        sub_ctx(index),
+        &sub_handle
+    );
+
+    GGL_MTX_SCOPE_GUARD(&mtx);
+    if ((ret == GGL_ERR_OK) && sub->closed) {
+        ret = GGL_ERR_FAILURE;
+    }
+    if (ret != GGL_ERR_OK) {
+        GGL_LOGE("Response topic subscription failed.");
+        sub->state = API_SUB_UNUSED;
+        sub->generation += 1;
+    } else {
+        sub->state = API_SUB_ACTIVE;
+        sub->handle = sub_handle;
+    }
+    pthread_cond_broadcast(&cond);
+    return ret;
+}
+
+/// Registers a pending call on a subscription, subscribing if needed.
+static GglError register_call(
+    GglBuffer socket_name,
+    GglBuffer topic,
+    bool virtual,
+    const struct timespec *deadline,
+    PendingCall *call_info,
+    size_t *call_index
+) {
+    if ((socket_name.len > MAX_SOCKET_NAME_LEN)
+        || (topic.len > AWS_IOT_MAX_TOPIC_SIZE - 2)) {
+        GGL_LOGE("AWS IoT API socket name or topic too long.");
+        return GGL_ERR_RANGE;
+    }
+
+    while (true) {
+        size_t sub_index = 0;
+        bool claimed = false;
+        uint32_t evicted_handle = 0;
+
+        {
+            GGL_MTX_SCOPE_GUARD(&mtx);
+
+            GglError ret = find_sub_slot(
+                socket_name,
+                topic,
+                virtual,
+                &sub_index,
+                &claimed,
+                &evicted_handle
+            );
+            if (ret != GGL_ERR_OK) {
+                return ret;
+            }
+
+            ApiSubscription *sub = &subs[sub_index];
+            if (sub->state == API_SUB_ACTIVE) {
+                PendingCall *slot = NULL;
+                for (size_t i = 0; i < GGL_AWS_IOT_CALL_MAX_IN_FLIGHT; i++) {
+                    if (!calls[i].in_use) {
+                        slot = &calls[i];
+                        *call_index = i;
+                        break;
+                    }
+                }
+                if (slot == NULL) {
+                    GGL_LOGE("Too many in-flight AWS IoT API requests.");
+                    return GGL_ERR_NOMEM;
+                }
+
+                *slot = *call_info;
+                slot->in_use = true;
+                slot->ready = false;
+                slot->sub_index = sub_index;
+                slot->sub_generation = sub->generation;
+                sub->in_flight += 1;
+                sub->last_used = ++use_counter;
+                return GGL_ERR_OK;
+            }
+
+            if (!claimed) {
+                // Another request is subscribing to this topic; wait for it
+                int cond_ret = pthread_cond_timedwait(&cond, &mtx, deadline);
+                if (cond_ret == ETIMEDOUT) {
+                    GGL_LOGW("Timed out waiting for response subscription.");
+                    return GGL_ERR_FAILURE;
+                }
+                continue;
+            }
+        }
+
+        if (evicted_handle != 0) {
+            ggl_client_sub_close(evicted_handle);
+        }
+
+        GglError ret = subscribe_responses(sub_index);
+        if (ret != GGL_ERR_OK) {
+            return ret;
+        }
+    }
+}
+
+static void unregister_call(size_t call_index) {
+    PendingCall *call = &calls[call_index];
+    ApiSubscription *sub = &subs[call->sub_index];
+    // The entry may have been closed and reused since the call registered
+    if ((sub->generation == call->sub_generation) && (sub->in_flight > 0)) {
+        sub->in_flight -= 1;
+    }
+    *call = (PendingCall) { 0 };
+}
+
+static GglError publish_request(
+    GglBuffer socket_name, GglBuffer topic, GglObject payload
+) {
+    static pthread_mutex_t encode_mtx = PTHREAD_MUTEX_INITIALIZER;
+    GGL_MTX_SCOPE_GUARD(&encode_mtx);
+
+    static uint8_t json_encode_mem[GGL_MAX_IOT_CORE_API_PAYLOAD_LEN];
     GglByteVec payload_vec = GGL_BYTE_VEC(json_encode_mem);
-    ret = ggl_json_encode(payload, ggl_byte_vec_writer(&payload_vec));
+    GglError ret = ggl_json_encode(payload, ggl_byte_vec_writer(&payload_vec));
     if (ret != GGL_ERR_OK) {
         GGL_LOGE("Failed to encode JSON payload.");
         return ret;
     }
 
-    pthread_condattr_t notify_condattr;
-    pthread_condattr_init(&notify_condattr);
-    pthread_condattr_setclock(&notify_condattr, CLOCK_MONOTONIC);
-    pthread_cond_t notify_cond;
-    pthread_cond_init(&notify_cond, &notify_condattr);
-    pthread_condattr_destroy(&notify_condattr);
-    GGL_CLEANUP(cleanup_pthread_cond, &notify_cond);
-    pthread_mutex_t notify_mtx = PTHREAD_MUTEX_INITIALIZER;
+    ret = ggl_aws_iot_mqtt_publish(
+        socket_name, topic, payload_vec.buf, 1, true
+    );
+    if (ret != GGL_ERR_OK) {
+        GGL_LOGE("Failed to publish request.");
+    }
+    return ret;
+}
 
-    CallbackCtx ctx = {
-        .mtx = &notify_mtx,
-        .cond = &notify_cond,
-        .ready = false,
+GglError ggl_aws_iot_call_with_timeout(
+    GglBuffer socket_name,
+    GglBuffer topic,
+    GglObject payload,
+    bool virtual,
+    uint32_t timeout_s,
+    GglArena *alloc,
+    GglObject *result
+) {
+    PendingCall call_info = {
         .client_token = &(GglBuffer) { 0 },
         .alloc = alloc,
         .result = result,
         .ret = GGL_ERR_FAILURE,
     };
 
-    ret = get_client_token(payload, &ctx.client_token);
+    GglError ret = get_client_token(payload, &call_info.client_token);
     if (ret != GGL_ERR_OK) {
         return ret;
     }
 
-    uint32_t sub_handle = 0;
-    ret = ggl_aws_iot_mqtt_subscribe(
-        socket_name,
-        GGL_BUF_LIST(topic_filter.buf),
-        1,
-        virtual,
-        subscription_callback,
-        subscription_close_callback,
-        &ctx,
-        &sub_handle
-    );
-    if (ret != GGL_ERR_OK) {
-        GGL_LOGE("Response topic subscription failed.");
-        return ret;
-    }
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_s;
 
-    ret = ggl_aws_iot_mqtt_publish(
-        socket_name, topic, payload_vec.buf, 1, true
+    size_t call_index = 0;
+    ret = register_call(
+        socket_name, topic, virtual, &deadline, &call_info, &call_index
     );
     if (ret != GGL_ERR_OK) {
-        GGL_LOGE("Response topic subscription failed.");
-        ggl_client_sub_close(sub_handle);
         return ret;
     }
 
-    struct timespec timeout;
-    clock_gettime(CLOCK_MONOTONIC, &timeout);
-    timeout.tv_sec += IOT_RESPONSE_TIMEOUT_S;
+    // Registered before publishing so that a fast response is not missed
+    ret = publish_request(socket_name, topic, payload);
 
-    bool timed_out = false;
+    GGL_MTX_SCOPE_GUARD(&mtx);
+    PendingCall *call = &calls[call_index];
 
-    {
-        // Must be unlocked before closing subscription
-        // (else subscription response may be blocked, and close would deadlock)
-        GGL_MTX_SCOPE_GUARD(&notify_mtx);
+    if (ret != GGL_ERR_OK) {
+        unregister_call(call_index);
+        return ret;
+    }
 
-        while (!ctx.ready) {
-            int cond_ret
-                = pthread_cond_timedwait(&notify_cond, &notify_mtx, &timeout);
-            if ((cond_ret != 0) && (cond_ret != EINTR)) {
-                assert(cond_ret == ETIMEDOUT);
-                GGL_LOGW("Timed out waiting for a response.");
-                timed_out = true;
-                break;
-            }
+    while (!call->ready) {
+        int cond_ret = pthread_cond_timedwait(&cond, &mtx, &deadline);
+        if ((cond_ret != 0) && (cond_ret != EINTR)) {
+            assert(cond_ret == ETIMEDOUT);
+            GGL_LOGW("Timed out waiting for a response.");
+            unregister_call(call_index);
+            return GGL_ERR_FAILURE;
         }
     }
 
-    if (timed_out) {
-        ggl_client_sub_close(sub_handle);
-    }
+    ret = call->ret;
+    unregister_call(call_index);
+    return ret;
+}
 
-    return ctx.ret;
+GglError ggl_aws_iot_call(
+    GglBuffer socket_name,
+    GglBuffer topic,
+    GglObject payload,
+    bool virtual,
+    GglArena *alloc,
+    GglObject *result
+) {
+    return ggl_aws_iot_call_with_timeout(
+        socket_name,
+        topic,
+        payload,
+        virtual,
+        IOT_RESPONSE_TIMEOUT_S,
+        alloc,
+        result
+    );
 }
@@ -47,4 +47,19 @@ GglError ggl_gg_config_subscribe(
     uint32_t *handle
 );
 
+/// Counters for reads served by the gg_config read cache.
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+} GglGgConfigCacheStats;
+
+/// Cache reads of keys under key_path in this process.
+/// Cached values are invalidated by a gg_config subscription on key_path and
+/// by writes and deletes made through this library. If the subscription is
+/// lost, reads go to ggconfigd until it can be re-established.
+GglError ggl_gg_config_cache_enable(GglBufList key_path);
+
+/// Get read cache hit/miss counters.
+void ggl_gg_config_cache_stats(GglGgConfigCacheStats *stats);
+
 #endif
@@ -3,6 +3,7 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "ggl/core_bus/gg_config.h"
+#include "gg_config_cache.h"
 #include <ggl/arena.h>
 #include <ggl/buffer.h>
 #include <ggl/core_bus/client.h>
@@ -34,8 +35,14 @@ GglError ggl_gg_config_read(
         ),
     );
 
+    GgConfigCacheTicket ticket;
+    GglError err = GGL_ERR_OK;
+    if (gg_config_cache_get(key_path, alloc, result, &err, &ticket)) {
+        return err;
+    }
+
     GglError remote_err = GGL_ERR_OK;
-    GglError err = ggl_call(
+    err = ggl_call(
         GGL_STR("gg_config"), GGL_STR("read"), args, &remote_err, alloc, result
     );
 
@@ -43,6 +50,9 @@ GglError ggl_gg_config_read(
         err = remote_err;
     }
 
+    gg_config_cache_put(
+        &ticket, key_path, err, (err == GGL_ERR_OK) ? *result : GGL_OBJ_NULL
+    );
     return err;
 }
 
@@ -120,6 +130,8 @@ GglError ggl_gg_config_delete(GglBufList key_path) {
         err = remote_err;
     }
 
+    // Invalidate even on failure; the delete may have been applied
+    gg_config_cache_invalidate(key_path);
     return err;
 }
 
@@ -183,6 +195,8 @@ GglError ggl_gg_config_write(
         err = remote_err;
     }
 
+    // Invalidate even on failure; the write may have been applied
+    gg_config_cache_invalidate(key_path);
     return err;
 }
 
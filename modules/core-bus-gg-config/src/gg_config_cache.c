@@ -0,0 +1,372 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "gg_config_cache.h"
+#include "ggl/core_bus/gg_config.h"
+#include <ggl/arena.h>
+#include <ggl/buffer.h>
+#include <ggl/cleanup.h>
+#include <ggl/error.h>
+#include <ggl/list.h>
+#include <ggl/log.h>
+#include <ggl/object.h>
+#include <pthread.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// Maximum number of key prefixes that can have caching enabled.
+/// Can be configured with `-DGGL_GG_CONFIG_CACHE_PREFIXES=<N>`.
+#ifndef GGL_GG_CONFIG_CACHE_PREFIXES
+#define GGL_GG_CONFIG_CACHE_PREFIXES 4
+#endif
+
+/// Maximum number of cached reads.
+/// Can be configured with `-DGGL_GG_CONFIG_CACHE_ENTRIES=<N>`.
+#ifndef GGL_GG_CONFIG_CACHE_ENTRIES
+#define GGL_GG_CONFIG_CACHE_ENTRIES 16
+#endif
+
+/// Memory for a cached read's key path and value; larger reads are not
+/// cached.
+/// Can be configured with `-DGGL_GG_CONFIG_CACHE_ENTRY_MEM=<N>`.
+#ifndef GGL_GG_CONFIG_CACHE_ENTRY_MEM
+#define GGL_GG_CONFIG_CACHE_ENTRY_MEM 2048
+#endif
+
+#define PREFIX_MEM_LEN 256
+
+typedef struct {
+    bool used;
+    bool subscribed;
+    bool subscribing;
+    uint32_t handle;
+    // Incremented on every change under the prefix, so that reads which raced
+    // with a change are not cached.
+    uint64_t generation;
+    GglBuffer path[GGL_MAX_OBJECT_DEPTH];
+    size_t path_len;
+    uint8_t mem[PREFIX_MEM_LEN];
+} CachePrefix;
+
+typedef struct {
+    bool valid;
+    size_t prefix;
+    uint64_t last_used;
+    GglBuffer path[GGL_MAX_OBJECT_DEPTH];
+    size_t path_len;
+    GglError err;
+    GglObject value;
+    uint8_t mem[GGL_GG_CONFIG_CACHE_ENTRY_MEM];
+} CacheEntry;
+
+static pthread_mutex_t cache_mtx = PTHREAD_MUTEX_INITIALIZER;
+static CachePrefix prefixes[GGL_GG_CONFIG_CACHE_PREFIXES];
+static CacheEntry entries[GGL_GG_CONFIG_CACHE_ENTRIES];
+static uint64_t use_counter = 0;
+static GglGgConfigCacheStats stats = { 0 };
+
+static bool path_starts_with(
+    const GglBuffer *path, size_t path_len, const GglBuffer *prefix, size_t len
+) {
+    if (len > path_len) {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (!ggl_buffer_eq(path[i], prefix[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// True if one path is equal to or an ancestor of the other.
+static bool paths_overlap(
+    const GglBuffer *a, size_t a_len, const GglBuffer *b, size_t b_len
+) {
+    return (a_len <= b_len) ? path_starts_with(b, b_len, a, a_len)
+                            : path_starts_with(a, a_len, b, b_len);
+}
+
+static bool path_eq(
+    const GglBuffer *a, size_t a_len, const GglBuffer *b, size_t b_len
+) {
+    return (a_len == b_len) && path_starts_with(a, a_len, b, b_len);
+}
+
+static void drop_prefix_entries(size_t prefix) {
+    for (size_t i = 0; i < GGL_GG_CONFIG_CACHE_ENTRIES; i++) {
+        if (entries[i].prefix == prefix) {
+            entries[i].valid = false;
+        }
+    }
+    prefixes[prefix].generation++;
+}
+
+static void invalidate_locked(const GglBuffer *path, size_t path_len) {
+    for (size_t i = 0; i < GGL_GG_CONFIG_CACHE_PREFIXES; i++) {
+        if (prefixes[i].used
+            && paths_overlap(
+                prefixes[i].path, prefixes[i].path_len, path, path_len
+            )) {
+            prefixes[i].generation++;
+        }
+    }
+    for (size_t i = 0; i < GGL_GG_CONFIG_CACHE_ENTRIES; i++) {
+        if (entries[i].valid
+            && paths_overlap(
+                entries[i].path, entries[i].path_len, path, path_len
+            )) {
+            entries[i].valid = false;
+        }
+    }
+}
+
+static GglError on_change(void *ctx, uint32_t handle, GglObject data) {
+    (void) handle;
+    CachePrefix *prefix = ctx;
+    GGL_MTX_SCOPE_GUARD(&cache_mtx);
+
+    // Payload is the key path of the changed value
+    GglBuffer path[GGL_MAX_OBJECT_DEPTH];
+    if ((ggl_obj_type(data) == GGL_TYPE_LIST)
+        && (ggl_list_type_check(ggl_obj_into_list(data), GGL_TYPE_BUF)
+            == GGL_ERR_OK)
+        && (ggl_obj_into_list(data).len <= GGL_MAX_OBJECT_DEPTH)) {
+        GglList list = ggl_obj_into_list(data);
+        for (size_t i = 0; i < list.len; i++) {
+            path[i] = ggl_obj_into_buf(list.items[i]);
+        }
+        invalidate_locked(path, list.len);
+        return GGL_ERR_OK;
+    }
+
+    GGL_LOGD("Unexpected config change notification; dropping cached reads.");
+    drop_prefix_entries((size_t) (prefix - prefixes));
+    return GGL_ERR_OK;
+}
+
+static void on_close(void *ctx, uint32_t handle) {
+    (void) handle;
+    CachePrefix *prefix = ctx;
+    GGL_MTX_SCOPE_GUARD(&cache_mtx);
+
+    // Without notifications, cached reads could go stale
+    GGL_LOGD("Config subscription closed; caching paused until resubscribed.");
+    prefix->subscribed = false;
+    prefix->handle = 0;
+    drop_prefix_entries((size_t) (prefix - prefixes));
+}
+
+// Must be called without cache_mtx held, as notifications take it.
+static GglError subscribe_prefix(size_t index) {
+    CachePrefix *prefix = &prefixes[index];
+    GglBufList path;
+    {
+        GGL_MTX_SCOPE_GUARD(&cache_mtx);
+        if (prefix->subscribed || prefix->subscribing) {
+            return GGL_ERR_OK;
+        }
+        prefix->subscribing = true;
+        // Prefix path is never modified once set
+        path = (GglBufList) { .bufs = prefix->path, .len = prefix->path_len };
+    }
+
+    uint32_t handle = 0;
+    GglError ret
+        = ggl_gg_config_subscribe(path, on_change, on_close, prefix, &handle);
+
+    GGL_MTX_SCOPE_GUARD(&cache_mtx);
+    prefix->subscribing = false;
+    if (ret != GGL_ERR_OK) {
+        GGL_LOGW("Failed to subscribe to config; reads will not be cached.");
+        return ret;
+    }
+    prefix->subscribed = true;
+    prefix->handle = handle;
+    drop_prefix_entries(index);
+    return GGL_ERR_OK;
+}
+
+GglError ggl_gg_config_cache_enable(GglBufList key_path) {
+    if (key_path.len > GGL_MAX_OBJECT_DEPTH) {
+        GGL_LOGE("Key path depth exceeds maximum handled.");
+        return GGL_ERR_UNSUPPORTED;
+    }
+
+    size_t index = GGL_GG_CONFIG_CACHE_PREFIXES;
+    {
+        GGL_MTX_SCOPE_GUARD(&cache_mtx);
+        for (size_t i = 0; i < GGL_GG_CONFIG_CACHE_PREFIXES; i++) {
+            if (prefixes[i].used
+                && path_eq(
+                    prefixes[i].path,
+                    prefixes[i].path_len,
+                    key_path.bufs,
+                    key_path.len
+                )) {
+                return GGL_ERR_OK;
+            }
+            if (!prefixes[i].used && (index == GGL_GG_CONFIG_CACHE_PREFIXES)) {
+                index = i;
+            }
+        }
+        if (index == GGL_GG_CONFIG_CACHE_PREFIXES) {
+            GGL_LOGE("Too many cached config prefixes.");
+            return GGL_ERR_NOMEM;
+        }
+
+        CachePrefix *prefix = &prefixes[index];
+        GglArena arena = ggl_arena_init(GGL_BUF(prefix->mem));
+        for (size_t i = 0; i < key_path.len; i++) {
+            prefix->path[i] = key_path.bufs[i];
+            GglError ret = ggl_arena_claim_buf(&prefix->path[i], &arena);
+            if (ret != GGL_ERR_OK) {
+                GGL_LOGE("Cached config prefix too long.");
+                return GGL_ERR_NOMEM;
+            }
+        }
+        prefix->path_len = key_path.len;
+        prefix->used = true;
+    }
+
+    return subscribe_prefix(index);
+}
+
+void ggl_gg_config_cache_stats(GglGgConfigCacheStats *stats_out) {
+    GGL_MTX_SCOPE_GUARD(&cache_mtx);
+    *stats_out = stats;
+}
+
+bool gg_config_cache_get(
+    GglBufList key_path,
+    GglArena *alloc,
+    GglObject *result,
+    GglError *err,
+    GgConfigCacheTicket *ticket
+) {
+    *ticket = (GgConfigCacheTicket) { .cacheable = false };
+    if (result == NULL) {
+        return false;
+    }
+
+    size_t resubscribe = GGL_GG_CONFIG_CACHE_PREFIXES;
+    {
+        GGL_MTX_SCOPE_GUARD(&cache_mtx);
+        size_t prefix = GGL_GG_CONFIG_CACHE_PREFIXES;
+        for (size_t i = 0; i < GGL_GG_CONFIG_CACHE_PREFIXES; i++) {
+            if (prefixes[i].used
+                && path_starts_with(
+                    key_path.bufs,
+                    key_path.len,
+                    prefixes[i].path,
+                    prefixes[i].path_len
+                )) {
+                prefix = i;
+                break;
+            }
+        }
+        if (prefix == GGL_GG_CONFIG_CACHE_PREFIXES) {
+            return false;
+        }
+        if (!prefixes[prefix].subscribed) {
+            resubscribe = prefix;
+        } else {
+            for (size_t i = 0; i < GGL_GG_CONFIG_CACHE_ENTRIES; i++) {
+                CacheEntry *entry = &entries[i];
+                if (!entry->valid
+                    || !path_eq(
+                        entry->path,
+                        entry->path_len,
+                        key_path.bufs,
+                        key_path.len
+                    )) {
+                    continue;
+                }
+
+                entry->last_used = ++use_counter;
+                stats.hits++;
+                *err = entry->err;
+                if (entry->err == GGL_ERR_OK) {
+                    *result = entry->value;
+                    GglError ret = ggl_arena_claim_obj(result, alloc);
+                    if (ret != GGL_ERR_OK) {
+                        GGL_LOGE(
+                            "Insufficient memory to return response payload."
+                        );
+                        *err = ret;
+                    }
+                }
+                return true;
+            }
+
+            stats.misses++;
+            *ticket = (GgConfigCacheTicket) {
+                .cacheable = true,
+                .prefix = prefix,
+                .generation = prefixes[prefix].generation,
+            };
+            return false;
+        }
+    }
+
+    // Reads are not cached until notifications are flowing again
+    (void) subscribe_prefix(resubscribe);
+    return false;
+}
+
+void gg_config_cache_put(
+    const GgConfigCacheTicket *ticket,
+    GglBufList key_path,
+    GglError err,
+    GglObject value
+) {
+    // Only results which only change along with the config are cached
+    if (!ticket->cacheable
+        || ((err != GGL_ERR_OK) && (err != GGL_ERR_NOENTRY))) {
+        return;
+    }
+
+    GGL_MTX_SCOPE_GUARD(&cache_mtx);
+    CachePrefix *prefix = &prefixes[ticket->prefix];
+    if (!prefix->subscribed || (prefix->generation != ticket->generation)) {
+        return;
+    }
+
+    CacheEntry *entry = &entries[0];
+    for (size_t i = 0; i < GGL_GG_CONFIG_CACHE_ENTRIES; i++) {
+        if (!entries[i].valid) {
+            entry = &entries[i];
+            break;
+        }
+        if (entries[i].last_used < entry->last_used) {
+            entry = &entries[i];
+        }
+    }
+
+    entry->valid = false;
+    GglArena arena = ggl_arena_init(GGL_BUF(entry->mem));
+    for (size_t i = 0; i < key_path.len; i++) {
+        entry->path[i] = key_path.bufs[i];
+        if (ggl_arena_claim_buf(&entry->path[i], &arena) != GGL_ERR_OK) {
+            return;
+        }
+    }
+    entry->path_len = key_path.len;
+    entry->err = err;
+    entry->value = (err == GGL_ERR_OK) ? value : GGL_OBJ_NULL;
+    if (ggl_arena_claim_obj(&entry->value, &arena) != GGL_ERR_OK) {
+        GGL_LOGT("Config value too large to cache.");
+        return;
+    }
+    entry->prefix = ticket->prefix;
+    entry->last_used = ++use_counter;
+    entry->valid = true;
+}
+
+void gg_config_cache_invalidate(GglBufList key_path) {
+    GGL_MTX_SCOPE_GUARD(&cache_mtx);
+    invalidate_locked(key_path.bufs, key_path.len);
+}
@@ -0,0 +1,46 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef GGL_CORE_BUS_GG_CONFIG_CACHE_H
+#define GGL_CORE_BUS_GG_CONFIG_CACHE_H
+
+#include <ggl/arena.h>
+#include <ggl/buffer.h>
+#include <ggl/error.h>
+#include <ggl/object.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// State needed to store the result of a read that missed the cache.
+typedef struct {
+    bool cacheable;
+    size_t prefix;
+    uint64_t generation;
+} GgConfigCacheTicket;
+
+/// Look up a read in the cache.
+/// Returns true on a hit, with the result copied into alloc and the read's
+/// error in err. On a miss, ticket is set for gg_config_cache_put.
+bool gg_config_cache_get(
+    GglBufList key_path,
+    GglArena *alloc,
+    GglObject *result,
+    GglError *err,
+    GgConfigCacheTicket *ticket
+);
+
+/// Store the result of a read that missed the cache, unless the key has
+/// changed since the lookup.
+void gg_config_cache_put(
+    const GgConfigCacheTicket *ticket,
+    GglBufList key_path,
+    GglError err,
+    GglObject value
+);
+
+/// Drop cached reads of a key, its parents and its children.
+void gg_config_cache_invalidate(GglBufList key_path);
+
+#endif
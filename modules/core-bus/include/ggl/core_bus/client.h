@@ -19,6 +19,13 @@
 #define GGL_COREBUS_CLIENT_MAX_SUBSCRIPTIONS 100
 #endif
 
+/// Maximum number of objects in a subscription response or async call
+/// result, counting each list item and map entry.
+/// Can be configured with `-DGGL_COREBUS_CLIENT_MAX_RESPONSE_OBJECTS=<N>`.
+#ifndef GGL_COREBUS_CLIENT_MAX_RESPONSE_OBJECTS
+#define GGL_COREBUS_CLIENT_MAX_RESPONSE_OBJECTS 50
+#endif
+
 /// Send a Core Bus notification (call, but don't wait for response).
 GglError ggl_notify(GglBuffer interface, GglBuffer method, GglMap params);
 
@@ -33,6 +40,31 @@ GglError ggl_call(
     GglObject *result
 );
 
+/// Callback for the result of an asynchronous call.
+/// `err` is GGL_ERR_OK if `result` holds the response. Otherwise it is the
+/// error returned by the server, or a local error if the call failed or was
+/// cancelled. `result` is only valid for the duration of the callback.
+typedef void (*GglCallCallback)(
+    void *ctx, uint32_t handle, GglError err, GglObject result
+);
+
+/// Make a Core Bus call without waiting for the response.
+/// `on_result` is called exactly once, normally from the core bus client
+/// thread. Calls may be cancelled with `ggl_client_sub_close`, in which case
+/// `on_result` is called with GGL_ERR_NOCONN before it returns.
+/// Results are decoded into a fixed buffer; a result with more than
+/// GGL_COREBUS_CLIENT_MAX_RESPONSE_OBJECTS objects is reported as
+/// GGL_ERR_NOMEM. Use `ggl_call` for larger results.
+/// In-flight calls count against GGL_COREBUS_CLIENT_MAX_SUBSCRIPTIONS.
+GglError ggl_call_async(
+    GglBuffer interface,
+    GglBuffer method,
+    GglMap params,
+    GglCallCallback on_result,
+    void *ctx,
+    uint32_t *handle
+);
+
 /// Callback for new data on a subscription.
 typedef GglError (*GglSubscribeCallback)(
     void *ctx, uint32_t handle, GglObject data
@@ -42,6 +74,8 @@ typedef GglError (*GglSubscribeCallback)(
 typedef void (*GglSubscribeCloseCallback)(void *ctx, uint32_t handle);
 
 /// Make an Core Bus subscription to a stream of objects.
+/// A response with more than GGL_COREBUS_CLIENT_MAX_RESPONSE_OBJECTS objects
+/// closes the subscription.
 GglError ggl_subscribe(
     GglBuffer interface,
     GglBuffer method,
@@ -53,7 +87,7 @@ GglError ggl_subscribe(
     uint32_t *handle
 );
 
-/// Close a client subscription handle.
+/// Close a client subscription or async call handle.
 void ggl_client_sub_close(uint32_t handle);
 
 /// Cleanup function for closing client subscription handles.
@@ -13,4 +13,11 @@
 #define GGL_COREBUS_MAX_MSG_LEN 10000
 #endif
 
+/// Maximum size of a core-bus payload.
+/// Payloads that do not fit in a packet are passed in a sealed memfd.
+/// Can be configured with `-DGGL_COREBUS_MAX_MEMFD_LEN=<N>`.
+#ifndef GGL_COREBUS_MAX_MEMFD_LEN
+#define GGL_COREBUS_MAX_MEMFD_LEN (16 * 1024 * 1024)
+#endif
+
 #endif
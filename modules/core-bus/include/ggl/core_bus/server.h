@@ -6,6 +6,7 @@
 #define GGL_COREBUS_SERVER_H
 
 #include <ggl/buffer.h>
+#include <ggl/core_bus/constants.h>
 #include <ggl/error.h>
 #include <ggl/object.h>
 #include <stdbool.h>
@@ -20,6 +21,40 @@
 #define GGL_COREBUS_MAX_CLIENTS 100
 #endif
 
+/// Size of the outbound queue for each core-bus subscription.
+/// Responses that can't be written immediately are queued and sent when the
+/// subscriber is ready.
+/// Can be configured with `-DGGL_COREBUS_SUB_QUEUE_LEN=<N>`.
+#ifndef GGL_COREBUS_SUB_QUEUE_LEN
+#define GGL_COREBUS_SUB_QUEUE_LEN (2 * GGL_COREBUS_MAX_MSG_LEN)
+#endif
+
+/// Maximum number of methods passed to `ggl_listen`.
+/// Can be configured with `-DGGL_COREBUS_MAX_METHODS=<N>`.
+#ifndef GGL_COREBUS_MAX_METHODS
+#define GGL_COREBUS_MAX_METHODS 32
+#endif
+
+/// Action taken when a subscription response does not fit in its queue.
+typedef enum {
+    /// Close the subscription (default)
+    GGL_SUB_OVERFLOW_DISCONNECT,
+    /// Drop queued responses, oldest first, to make room
+    GGL_SUB_OVERFLOW_DROP_OLDEST,
+    /// Drop the new response
+    GGL_SUB_OVERFLOW_DROP_NEWEST,
+} GglSubOverflowPolicy;
+
+/// Counters for subscription response queueing.
+typedef struct {
+    /// Responses that had to be queued
+    uint64_t queued;
+    /// Responses dropped due to a full queue
+    uint64_t dropped;
+    /// Subscriptions closed due to a full queue
+    uint64_t disconnected;
+} GglSubQueueStats;
+
 /// Function that receives client invocations of a method.
 /// For call/notify, the handler must either use the handle to respond and
 /// return GGL_ERR_OK, or return an error without responding. For
@@ -59,8 +94,27 @@ void ggl_sub_accept(
 
 /// Send a response to the client on a subscription.
 /// Subscriptions must be accepted before responding.
+/// Does not block; if the client is not reading, the response is queued and
+/// the subscription's overflow policy applies once the queue is full.
 void ggl_sub_respond(uint32_t handle, GglObject value);
 
+/// Send the same response to multiple subscriptions.
+/// The response is encoded once, and sent as with `ggl_sub_respond`.
+/// A handle listed more than once receives a whole copy per occurrence.
+void ggl_sub_respond_multicast(
+    const uint32_t *handles, size_t handles_len, GglObject value
+);
+
+/// Set what happens when a subscription's outbound queue is full.
+void ggl_sub_set_overflow_policy(uint32_t handle, GglSubOverflowPolicy policy);
+
+/// Get subscription response queueing counters.
+void ggl_sub_queue_stats(GglSubQueueStats *stats);
+
+/// Method handler responding with the subscription queueing counters.
+/// Daemons can add it to their method table to expose the counters.
+GglError ggl_sub_queue_stats_handler(void *ctx, GglMap params, uint32_t handle);
+
 /// Close a server subscription handle.
 void ggl_server_sub_close(uint32_t handle);
 
@@ -4,16 +4,20 @@
 
 #include "ggl/core_bus/client.h"
 #include "client_common.h"
+#include "memfd_payload.h"
 #include "object_serde.h"
 #include "types.h"
+#include <errno.h>
 #include <ggl/arena.h>
+#include <ggl/buffer.h>
 #include <ggl/cleanup.h>
 #include <ggl/error.h>
 #include <ggl/eventstream/decode.h>
 #include <ggl/file.h>
 #include <ggl/log.h>
 #include <ggl/object.h>
-#include <ggl/socket.h>
+#include <poll.h>
+#include <stdbool.h>
 #include <stddef.h>
 
 GglError ggl_notify(GglBuffer interface, GglBuffer method, GglMap params) {
@@ -28,6 +32,23 @@ GglError ggl_notify(GglBuffer interface, GglBuffer method, GglMap params) {
     return GGL_ERR_OK;
 }
 
+/// Block until the response starts arriving.
+/// Waiting here rather than in the read lets calls on other threads use the
+/// shared payload buffer while the server is working.
+static GglError wait_for_response(int conn) {
+    struct pollfd fds[] = { { .fd = conn, .events = POLLIN } };
+    while (true) {
+        int ret = poll(fds, 1, -1);
+        if (ret > 0) {
+            return GGL_ERR_OK;
+        }
+        if ((ret < 0) && (errno != EINTR)) {
+            GGL_LOGE("Failed to poll core bus connection: %d.", errno);
+            return GGL_ERR_FAILURE;
+        }
+    }
+}
+
 GglError ggl_call(
     GglBuffer interface,
     GglBuffer method,
@@ -45,19 +66,37 @@ GglError ggl_call(
     }
     GGL_CLEANUP(cleanup_close, conn);
 
+    GGL_LOGT(
+        "Waiting for response from %.*s.", (int) interface.len, interface.data
+    );
+    ret = wait_for_response(conn);
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
     GGL_MTX_SCOPE_GUARD(&ggl_core_bus_client_payload_array_mtx);
 
     GglBuffer recv_buffer = GGL_BUF(ggl_core_bus_client_payload_array);
     EventStreamMessage msg = { 0 };
-    GGL_LOGT(
-        "Waiting for response from %.*s.", (int) interface.len, interface.data
-    );
+    int memfd = -1;
+    GglCoreBusConnReaderCtx reader_ctx;
     ret = ggl_client_get_response(
-        ggl_socket_reader(&conn), recv_buffer, error, &msg
+        ggl_core_bus_conn_reader(&reader_ctx, conn, &memfd),
+        recv_buffer,
+        error,
+        &msg
     );
+    GGL_CLEANUP(cleanup_close, memfd);
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
+    GglBuffer mapping = { 0 };
+    ret = ggl_core_bus_get_payload(&msg, memfd, &mapping);
     if (ret != GGL_ERR_OK) {
         return ret;
     }
+    GGL_CLEANUP(cleanup_core_bus_mapping, mapping);
 
     if (result != NULL) {
         ret = ggl_deserialize(alloc, msg.payload, result);
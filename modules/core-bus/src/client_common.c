@@ -4,20 +4,20 @@
 
 #include "client_common.h"
 #include "ggl/core_bus/constants.h"
-#include "object_serde.h"
+#include "memfd_payload.h"
 #include "types.h"
 #include <assert.h>
 #include <ggl/buffer.h>
 #include <ggl/cleanup.h>
 #include <ggl/error.h>
 #include <ggl/eventstream/decode.h>
-#include <ggl/eventstream/encode.h>
 #include <ggl/eventstream/types.h>
 #include <ggl/file.h> // IWYU pragma: keep (TODO: remove after file.h refactor)
 #include <ggl/io.h>
 #include <ggl/log.h>
 #include <ggl/object.h>
 #include <ggl/socket.h>
+#include <ggl/socket_fd.h>
 #include <ggl/vector.h>
 #include <pthread.h>
 #include <stddef.h>
@@ -73,16 +73,22 @@ GglError ggl_client_send_message(
     size_t headers_len = sizeof(headers) / sizeof(headers[0]);
 
     GglObject params_obj = ggl_obj_map(params);
-    ret = eventstream_encode(
-        &send_buffer, headers, headers_len, ggl_serialize_reader(&params_obj)
+    int memfd = -1;
+    ret = ggl_core_bus_encode(
+        &send_buffer, headers, headers_len, &params_obj, &memfd
     );
     if (ret != GGL_ERR_OK) {
         return ret;
     }
+    GGL_CLEANUP(cleanup_close, memfd);
 
     GGL_LOGT("Writing data to %.*s.", (int) interface.len, interface.data);
 
-    ret = ggl_socket_write(conn, send_buffer);
+    if (memfd >= 0) {
+        ret = ggl_socket_write_with_fd(conn, send_buffer, memfd);
+    } else {
+        ret = ggl_socket_write(conn, send_buffer);
+    }
     if (ret != GGL_ERR_OK) {
         return ret;
     }
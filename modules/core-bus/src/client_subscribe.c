@@ -5,6 +5,7 @@
 #include "client_common.h"
 #include "ggl/core_bus/client.h"
 #include "ggl/core_bus/constants.h"
+#include "memfd_payload.h"
 #include "object_serde.h"
 #include "types.h"
 #include <assert.h>
@@ -15,9 +16,9 @@
 #include <ggl/eventstream/decode.h>
 #include <ggl/eventstream/types.h>
 #include <ggl/file.h>
+#include <ggl/io.h>
 #include <ggl/log.h>
 #include <ggl/object.h>
-#include <ggl/socket.h>
 #include <ggl/socket_epoll.h>
 #include <ggl/socket_handle.h>
 #include <pthread.h>
@@ -31,9 +32,7 @@
 // When including a .a, the linker only uses .o files that resolve a needed
 // symbol. Since this is a separate .o, that means it will only be included if
 // ggl_subscribe is used by the binary, and the thread is only created in
-// binaries using ggl_subscribe functionality.
-
-#define PAYLOAD_MAX_SUBOBJECTS 50
+// binaries using ggl_subscribe or ggl_call_async functionality.
 
 static_assert(
     GGL_COREBUS_CLIENT_MAX_SUBSCRIPTIONS < UINT16_MAX,
@@ -43,6 +42,8 @@ static_assert(
 typedef struct {
     GglSubscribeCallback on_response;
     GglSubscribeCloseCallback on_close;
+    /// Set for async calls until the result is delivered
+    GglCallCallback on_result;
     void *ctx;
 } SubCallbacks;
 
@@ -123,6 +124,14 @@ static GglError call_close_callback(uint32_t handle, size_t index) {
         callbacks.on_close(callbacks.ctx, handle);
     }
 
+    if (callbacks.on_result != NULL) {
+        GGL_LOGD("Async call closed before receiving a response.");
+
+        callbacks.on_result(
+            callbacks.ctx, handle, GGL_ERR_NOCONN, GGL_OBJ_NULL
+        );
+    }
+
     return GGL_ERR_OK;
 }
 
@@ -146,9 +155,16 @@ static GglError make_subscribe_request(
 
     GglBuffer recv_buffer = GGL_BUF(ggl_core_bus_client_payload_array);
     EventStreamMessage msg = { 0 };
+    int memfd = -1;
+    GglCoreBusConnReaderCtx reader_ctx;
     ret = ggl_client_get_response(
-        ggl_socket_reader(&conn), recv_buffer, error, &msg
+        ggl_core_bus_conn_reader(&reader_ctx, conn, &memfd),
+        recv_buffer,
+        error,
+        &msg
     );
+    // Accept response has no payload
+    GGL_CLEANUP(cleanup_close, memfd);
     if (ret != GGL_ERR_OK) {
         return ret;
     }
@@ -178,6 +194,38 @@ static GglError make_subscribe_request(
     return GGL_ERR_OK;
 }
 
+static GglError register_response_handler(
+    int conn, SubCallbacks callbacks, uint32_t *handle
+) {
+    GGL_LOGT("Registering connection fd with socket pool.");
+    uint32_t sub_handle = 0;
+    GglError ret = ggl_socket_pool_register(&pool, conn, &sub_handle);
+    if (ret != GGL_ERR_OK) {
+        (void) ggl_close(conn);
+        GGL_LOGW("Max subscriptions exceeded.");
+        return ret;
+    }
+
+    GGL_LOGT("Setting response callbacks.");
+    (void) ggl_socket_handle_protected(
+        set_sub_callbacks, &callbacks, &pool, sub_handle
+    );
+
+    ret = ggl_socket_epoll_add(epoll_fd, conn, sub_handle);
+    if (ret != GGL_ERR_OK) {
+        (void) ggl_socket_handle_protected(
+            set_sub_callbacks, &(SubCallbacks) { 0 }, &pool, sub_handle
+        );
+        (void) ggl_socket_handle_close(&pool, sub_handle);
+        return ret;
+    }
+
+    if (handle != NULL) {
+        *handle = sub_handle;
+    }
+    return GGL_ERR_OK;
+}
+
 GglError ggl_subscribe(
     GglBuffer interface,
     GglBuffer method,
@@ -207,50 +255,62 @@ GglError ggl_subscribe(
         return ret;
     }
 
-    GGL_LOGT("Registering subscription fd with socket pool.");
-    uint32_t sub_handle = 0;
-    ret = ggl_socket_pool_register(&pool, conn, &sub_handle);
-    if (ret != GGL_ERR_OK) {
-        (void) ggl_close(conn);
-        GGL_LOGW("Max subscriptions exceeded.");
-        return ret;
-    }
-
-    GGL_LOGT("Setting subscription callbacks.");
-    (void) ggl_socket_handle_protected(
-        set_sub_callbacks,
-        &(SubCallbacks) {
+    ret = register_response_handler(
+        conn,
+        (SubCallbacks) {
             .on_response = on_response,
             .on_close = on_close,
             .ctx = ctx,
         },
-        &pool,
-        sub_handle
+        handle
     );
-
-    ret = ggl_socket_epoll_add(epoll_fd, conn, sub_handle);
     if (ret != GGL_ERR_OK) {
-        (void) ggl_socket_handle_protected(
-            set_sub_callbacks, &(SubCallbacks) { 0 }, &pool, sub_handle
-        );
-        (void) ggl_socket_handle_close(&pool, sub_handle);
         return ret;
     }
 
-    if (handle != NULL) {
-        *handle = sub_handle;
-    }
-
     GGL_LOGT("Subscription success.");
     return GGL_ERR_OK;
 }
 
+GglError ggl_call_async(
+    GglBuffer interface,
+    GglBuffer method,
+    GglMap params,
+    GglCallCallback on_result,
+    void *ctx,
+    uint32_t *handle
+) {
+    if (epoll_fd < 0) {
+        GGL_LOGE("Subscription epoll not initialized.");
+        return GGL_ERR_FATAL;
+    }
+
+    if (on_result == NULL) {
+        GGL_LOGE("Async call requires a result callback.");
+        return GGL_ERR_INVALID;
+    }
+
+    int conn = -1;
+    GglError ret = ggl_client_send_message(
+        interface, GGL_CORE_BUS_CALL, method, params, &conn
+    );
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
+    // Response is read on the subscription thread
+    return register_response_handler(
+        conn, (SubCallbacks) { .on_result = on_result, .ctx = ctx }, handle
+    );
+}
+
 void ggl_client_sub_close(uint32_t handle) {
     (void) ggl_socket_handle_close(&pool, handle);
 }
 
 typedef struct {
     uint32_t handle;
+    GglError err;
     GglObject data;
     GglError ret;
 } OnResponseCallbackArgs;
@@ -258,6 +318,23 @@ typedef struct {
 static void call_on_response_callback(void *ctx, size_t index) {
     OnResponseCallbackArgs *args = ctx;
     args->ret = GGL_ERR_OK;
+    if (sub_callbacks[index].on_result != NULL) {
+        GGL_LOGT("Calling async call result callback.");
+
+        GglCallCallback on_result = sub_callbacks[index].on_result;
+        // Calls have a single response; don't report the close as an error
+        sub_callbacks[index].on_result = NULL;
+        on_result(
+            sub_callbacks[index].ctx, args->handle, args->err, args->data
+        );
+        (void) ggl_socket_handle_close(&pool, args->handle);
+        return;
+    }
+    if (args->err != GGL_ERR_OK) {
+        // Subscription error responses are handled by closing
+        args->ret = args->err;
+        return;
+    }
     if (sub_callbacks[index].on_response != NULL) {
         GGL_LOGT("Calling subscription response callback.");
 
@@ -272,6 +349,28 @@ static void call_on_response_callback(void *ctx, size_t index) {
     }
 }
 
+typedef struct {
+    uint32_t handle;
+    int *memfd;
+} SubReaderCtx;
+
+static GglError sub_reader_fn(void *ctx, GglBuffer *buf) {
+    SubReaderCtx *args = ctx;
+    return ggl_socket_handle_read_with_fd(
+        &pool, args->handle, *buf, args->memfd
+    );
+}
+
+/// Report a failed response to an async call. Subscriptions are closed by
+/// the caller instead.
+static void deliver_error(uint32_t handle, GglError err) {
+    OnResponseCallbackArgs args
+        = { .handle = handle, .err = err, .data = GGL_OBJ_NULL };
+    (void) ggl_socket_handle_protected(
+        call_on_response_callback, &args, &pool, handle
+    );
+}
+
 static GglError get_subscription_response(uint32_t handle) {
     GGL_LOGD("Handling incoming subscription response.");
 
@@ -284,29 +383,50 @@ static GglError get_subscription_response(uint32_t handle) {
 
     GglBuffer recv_buffer = GGL_BUF(sub_resp_payload_array);
     EventStreamMessage msg = { 0 };
-    GglSocketHandleReaderCtx reader_ctx;
+    int memfd = -1;
+    SubReaderCtx reader_ctx = { .handle = handle, .memfd = &memfd };
+    GglError remote_err = GGL_ERR_OK;
     GglError ret = ggl_client_get_response(
-        ggl_socket_handle_reader(&reader_ctx, &pool, handle),
+        (GglReader) { .read = sub_reader_fn, .ctx = &reader_ctx },
         recv_buffer,
-        NULL,
+        &remote_err,
         &msg
     );
+    GGL_CLEANUP(cleanup_close, memfd);
+    if (ret == GGL_ERR_REMOTE) {
+        // Deliver the server's error to async calls
+        deliver_error(handle, remote_err);
+        return ret;
+    }
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
+    GglBuffer mapping = { 0 };
+    ret = ggl_core_bus_get_payload(&msg, memfd, &mapping);
     if (ret != GGL_ERR_OK) {
+        deliver_error(handle, ret);
         return ret;
     }
+    GGL_CLEANUP(cleanup_core_bus_mapping, mapping);
 
-    static uint8_t obj_decode_mem[PAYLOAD_MAX_SUBOBJECTS * sizeof(GglObject)];
+    static uint8_t obj_decode_mem
+        [GGL_COREBUS_CLIENT_MAX_RESPONSE_OBJECTS * sizeof(GglObject)];
     GglArena alloc = ggl_arena_init(GGL_BUF(obj_decode_mem));
 
     GglObject result;
     ret = ggl_deserialize(&alloc, msg.payload, &result);
     if (ret != GGL_ERR_OK) {
         GGL_LOGE("Failed to decode subscription response payload.");
+        // Async calls get the decode error, e.g. NOMEM for large results,
+        // rather than the NOCONN reported on close.
+        deliver_error(handle, ret);
         return ret;
     }
 
     // User callback must not run during/after a subscription close
-    OnResponseCallbackArgs args = { .handle = handle, .data = result };
+    OnResponseCallbackArgs args
+        = { .handle = handle, .err = GGL_ERR_OK, .data = result };
     ret = ggl_socket_handle_protected(
         call_on_response_callback, &args, &pool, handle
     );
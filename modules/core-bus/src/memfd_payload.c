@@ -0,0 +1,227 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "memfd_payload.h"
+#include "ggl/core_bus/constants.h"
+#include "object_serde.h"
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <ggl/buffer.h>
+#include <ggl/cleanup.h>
+#include <ggl/error.h>
+#include <ggl/eventstream/decode.h>
+#include <ggl/eventstream/encode.h>
+#include <ggl/eventstream/types.h>
+#include <ggl/io.h>
+#include <ggl/log.h>
+#include <ggl/object.h>
+#include <ggl/socket_fd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+static_assert(
+    GGL_COREBUS_MAX_MEMFD_LEN <= INT32_MAX,
+    "Max memfd payload length must fit in int32 header."
+);
+
+#define REQUIRED_SEALS (F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE)
+
+static GglError payload_to_memfd(GglObject *payload, int *memfd, size_t *len) {
+    int fd = memfd_create("ggl-core-bus", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) {
+        GGL_LOGE("Failed to create memfd for payload: %d.", errno);
+        return GGL_ERR_FAILURE;
+    }
+    GGL_CLEANUP_ID(fd_cleanup, cleanup_close, fd);
+
+    // Sparse; only pages written by the serializer are allocated
+    if (ftruncate(fd, GGL_COREBUS_MAX_MEMFD_LEN) != 0) {
+        GGL_LOGE("Failed to size payload memfd: %d.", errno);
+        return GGL_ERR_FAILURE;
+    }
+
+    void *mem = mmap(
+        NULL,
+        GGL_COREBUS_MAX_MEMFD_LEN,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED,
+        fd,
+        0
+    );
+    if (mem == MAP_FAILED) {
+        GGL_LOGE("Failed to map payload memfd: %d.", errno);
+        return GGL_ERR_NOMEM;
+    }
+
+    GglBuffer buf = { .data = mem, .len = GGL_COREBUS_MAX_MEMFD_LEN };
+    GglError ret = ggl_serialize(*payload, &buf);
+    (void) munmap(mem, GGL_COREBUS_MAX_MEMFD_LEN);
+    if (ret != GGL_ERR_OK) {
+        GGL_LOGE("Payload exceeds max core-bus payload size.");
+        return ret;
+    }
+
+    if (ftruncate(fd, (off_t) buf.len) != 0) {
+        GGL_LOGE("Failed to size payload memfd: %d.", errno);
+        return GGL_ERR_FAILURE;
+    }
+
+    // Receiver relies on the contents and size not changing while mapped
+    if (fcntl(fd, F_ADD_SEALS, REQUIRED_SEALS | F_SEAL_SEAL) != 0) {
+        GGL_LOGE("Failed to seal payload memfd: %d.", errno);
+        return GGL_ERR_FAILURE;
+    }
+
+    // NOLINTNEXTLINE(clang-analyzer-deadcode.DeadStores) false positive
+    fd_cleanup = -1;
+    *memfd = fd;
+    *len = buf.len;
+    return GGL_ERR_OK;
+}
+
+GglError ggl_core_bus_encode(
+    GglBuffer *send_buffer,
+    const EventStreamHeader *headers,
+    size_t headers_len,
+    GglObject *payload,
+    int *memfd
+) {
+    assert(headers_len < GGL_CORE_BUS_MAX_HEADERS);
+    *memfd = -1;
+
+    GglBuffer buffer = *send_buffer;
+    GglError ret = eventstream_encode(
+        &buffer,
+        headers,
+        headers_len,
+        (payload == NULL) ? GGL_NULL_READER : ggl_serialize_reader(payload)
+    );
+    if ((ret != GGL_ERR_NOMEM) || (payload == NULL)) {
+        *send_buffer = buffer;
+        return ret;
+    }
+
+    GGL_LOGD("Payload too large for packet; passing in memfd.");
+
+    int fd = -1;
+    size_t len = 0;
+    ret = payload_to_memfd(payload, &fd, &len);
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+    GGL_CLEANUP_ID(fd_cleanup, cleanup_close, fd);
+
+    EventStreamHeader memfd_headers[GGL_CORE_BUS_MAX_HEADERS];
+    for (size_t i = 0; i < headers_len; i++) {
+        memfd_headers[i] = headers[i];
+    }
+    memfd_headers[headers_len] = (EventStreamHeader) {
+        GGL_STR("memfd"),
+        { EVENTSTREAM_INT32, .int32 = (int32_t) len },
+    };
+
+    ret = eventstream_encode(
+        send_buffer, memfd_headers, headers_len + 1, GGL_NULL_READER
+    );
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
+    // NOLINTNEXTLINE(clang-analyzer-deadcode.DeadStores) false positive
+    fd_cleanup = -1;
+    *memfd = fd;
+    return GGL_ERR_OK;
+}
+
+static GglError get_memfd_len(
+    const EventStreamMessage *msg, bool *set, size_t *len
+) {
+    *set = false;
+    EventStreamHeaderIter iter = msg->headers;
+    EventStreamHeader header;
+
+    while (eventstream_header_next(&iter, &header) == GGL_ERR_OK) {
+        if (ggl_buffer_eq(header.name, GGL_STR("memfd"))) {
+            if ((header.value.type != EVENTSTREAM_INT32)
+                || (header.value.int32 <= 0)
+                || (header.value.int32 > GGL_COREBUS_MAX_MEMFD_LEN)) {
+                GGL_LOGE("Invalid memfd header.");
+                return GGL_ERR_PARSE;
+            }
+            *set = true;
+            *len = (size_t) header.value.int32;
+        }
+    }
+    return GGL_ERR_OK;
+}
+
+GglError ggl_core_bus_get_payload(
+    EventStreamMessage *msg, int memfd, GglBuffer *mapping
+) {
+    *mapping = (GglBuffer) { 0 };
+
+    bool memfd_set = false;
+    size_t len = 0;
+    GglError ret = get_memfd_len(msg, &memfd_set, &len);
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+    if (!memfd_set) {
+        return GGL_ERR_OK;
+    }
+
+    if ((memfd < 0) || (msg->payload.len != 0)) {
+        GGL_LOGE("Packet with memfd header is malformed.");
+        return GGL_ERR_PARSE;
+    }
+
+    // Sender must not be able to modify or truncate the data while in use
+    int seals = fcntl(memfd, F_GET_SEALS);
+    if ((seals < 0) || ((seals & REQUIRED_SEALS) != REQUIRED_SEALS)) {
+        GGL_LOGE("Received payload fd is not a sealed memfd.");
+        return GGL_ERR_INVALID;
+    }
+
+    struct stat st;
+    if ((fstat(memfd, &st) != 0) || (st.st_size < 0)
+        || ((size_t) st.st_size < len)) {
+        GGL_LOGE("Received payload memfd is smaller than indicated.");
+        return GGL_ERR_PARSE;
+    }
+
+    void *mem = mmap(NULL, len, PROT_READ, MAP_PRIVATE, memfd, 0);
+    if (mem == MAP_FAILED) {
+        GGL_LOGE("Failed to map received payload memfd: %d.", errno);
+        return GGL_ERR_NOMEM;
+    }
+
+    *mapping = (GglBuffer) { .data = mem, .len = len };
+    msg->payload = *mapping;
+    return GGL_ERR_OK;
+}
+
+void cleanup_core_bus_mapping(GglBuffer *mapping) {
+    if (mapping->data != NULL) {
+        (void) munmap(mapping->data, mapping->len);
+    }
+}
+
+static GglError conn_reader_fn(void *ctx, GglBuffer *buf) {
+    GglCoreBusConnReaderCtx *args = ctx;
+    return ggl_socket_read_with_fd(args->conn, *buf, args->memfd);
+}
+
+GglReader ggl_core_bus_conn_reader(
+    GglCoreBusConnReaderCtx *ctx, int conn, int *memfd
+) {
+    ctx->conn = conn;
+    ctx->memfd = memfd;
+    return (GglReader) { .read = conn_reader_fn, .ctx = ctx };
+}
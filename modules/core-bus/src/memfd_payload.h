@@ -0,0 +1,61 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CORE_BUS_MEMFD_PAYLOAD_H
+#define CORE_BUS_MEMFD_PAYLOAD_H
+
+//! Passing of payloads too large for a core-bus packet.
+//!
+//! Large payloads are serialized into a sealed memfd which is sent with the
+//! packet using SCM_RIGHTS. The packet has an empty payload and a `memfd`
+//! header with the payload length. The receiver maps the memfd read-only and
+//! decodes the payload in place.
+
+#include <ggl/buffer.h>
+#include <ggl/error.h>
+#include <ggl/eventstream/decode.h>
+#include <ggl/eventstream/types.h>
+#include <ggl/io.h>
+#include <ggl/object.h>
+#include <stddef.h>
+
+/// Max headers accepted by `ggl_core_bus_encode`.
+#define GGL_CORE_BUS_MAX_HEADERS 4
+
+/// Encode a packet into `send_buffer`.
+/// If the payload does not fit, it is moved into a memfd which is returned in
+/// `memfd` and must be sent with the packet; otherwise `memfd` is set to -1.
+GglError ggl_core_bus_encode(
+    GglBuffer *send_buffer,
+    const EventStreamHeader *headers,
+    size_t headers_len,
+    GglObject *payload,
+    int *memfd
+);
+
+/// Resolve the payload of a received packet.
+/// `memfd` is the fd received with the packet, or -1.
+/// If the payload was passed in a memfd, it is mapped read-only, and
+/// `msg->payload` and `mapping` are set to the mapping. The mapping must be
+/// released with `cleanup_core_bus_mapping` once the payload (and any object
+/// decoded from it) is no longer used. Otherwise `mapping` is zeroed.
+GglError ggl_core_bus_get_payload(
+    EventStreamMessage *msg, int memfd, GglBuffer *mapping
+);
+
+/// Unmap a mapping returned by `ggl_core_bus_get_payload`, if any.
+void cleanup_core_bus_mapping(GglBuffer *mapping);
+
+typedef struct {
+    int conn;
+    int *memfd;
+} GglCoreBusConnReaderCtx;
+
+/// Reader for a core-bus connection which receives passed memfds.
+/// `memfd` should be initialized to -1 and is owned by the caller.
+GglReader ggl_core_bus_conn_reader(
+    GglCoreBusConnReaderCtx *ctx, int conn, int *memfd
+);
+
+#endif
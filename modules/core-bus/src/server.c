@@ -4,16 +4,20 @@
 
 #include "ggl/core_bus/server.h"
 #include "ggl/core_bus/constants.h"
+#include "memfd_payload.h"
 #include "object_serde.h"
+#include "sub_queue.h"
 #include "types.h"
 #include <assert.h>
 #include <ggl/arena.h>
 #include <ggl/buffer.h>
 #include <ggl/cleanup.h>
+#include <ggl/dispatch_table.h>
 #include <ggl/error.h>
 #include <ggl/eventstream/decode.h>
 #include <ggl/eventstream/encode.h>
 #include <ggl/eventstream/types.h>
+#include <ggl/file.h>
 #include <ggl/io.h>
 #include <ggl/log.h>
 #include <ggl/object.h>
@@ -31,7 +35,7 @@
 
 typedef struct {
     GglRpcMethodDesc *handlers;
-    size_t handlers_len;
+    GglDispatchTable methods;
 } InterfaceCtx;
 
 typedef struct {
@@ -47,6 +51,7 @@ static SubCleanupCallback subscription_cleanup[GGL_COREBUS_MAX_CLIENTS];
 
 static GglError reset_client_state(uint32_t handle, size_t index);
 static GglError close_subscription(uint32_t handle, size_t index);
+static GglError drain_subscription(uint32_t handle);
 
 static int32_t client_fds[GGL_COREBUS_MAX_CLIENTS];
 static uint16_t client_generations[GGL_COREBUS_MAX_CLIENTS];
@@ -57,6 +62,7 @@ static GglSocketPool pool = {
     .generations = client_generations,
     .on_register = reset_client_state,
     .on_release = close_subscription,
+    .on_writable = drain_subscription,
 };
 
 __attribute__((constructor)) static void init_client_pool(void) {
@@ -81,6 +87,7 @@ static GglError reset_client_state(uint32_t handle, size_t index) {
     client_request_types[index] = GGL_CORE_BUS_CALL;
     subscription_cleanup[index].fn = NULL;
     subscription_cleanup[index].ctx = NULL;
+    sub_queue_reset(index);
     return GGL_ERR_OK;
 }
 
@@ -88,9 +95,62 @@ static GglError close_subscription(uint32_t handle, size_t index) {
     if (subscription_cleanup[index].fn != NULL) {
         subscription_cleanup[index].fn(subscription_cleanup[index].ctx, handle);
     }
+    sub_queue_reset(index);
     return GGL_ERR_OK;
 }
 
+typedef struct {
+    uint32_t handle;
+    GglBuffer packet;
+    int memfd;
+    GglError ret;
+} SubSendCtx;
+
+static void sub_send(void *ctx, size_t index) {
+    SubSendCtx *args = ctx;
+    bool watch = false;
+    args->ret = sub_queue_send(
+        index, client_fds[index], args->packet, args->memfd, &watch
+    );
+    if ((args->ret == GGL_ERR_OK) && watch) {
+        args->ret = ggl_socket_server_watch_writable(&pool, args->handle, true);
+    }
+}
+
+static void sub_drain(void *ctx, size_t index) {
+    SubSendCtx *args = ctx;
+    if (sub_queue_is_empty(index)) {
+        return;
+    }
+    bool empty = false;
+    args->ret = sub_queue_drain(index, client_fds[index], &empty);
+    if ((args->ret == GGL_ERR_OK) && empty) {
+        args->ret
+            = ggl_socket_server_watch_writable(&pool, args->handle, false);
+    }
+}
+
+static GglError drain_subscription(uint32_t handle) {
+    SubSendCtx ctx = { .handle = handle, .ret = GGL_ERR_OK };
+    GglError ret = ggl_socket_handle_protected(sub_drain, &ctx, &pool, handle);
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+    return ctx.ret;
+}
+
+/// Send a subscription response without blocking, queueing if needed.
+static GglError send_sub_packet(uint32_t handle, GglBuffer packet, int memfd) {
+    SubSendCtx ctx = {
+        .handle = handle, .packet = packet, .memfd = memfd, .ret = GGL_ERR_OK
+    };
+    GglError ret = ggl_socket_handle_protected(sub_send, &ctx, &pool, handle);
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+    return ctx.ret;
+}
+
 static void set_request_type(void *ctx, size_t index) {
     GglCoreBusRequestType *type = ctx;
     client_request_types[index] = *type;
@@ -173,7 +233,10 @@ static GglError client_ready(void *ctx, uint32_t handle) {
     GglBuffer prelude_buf = ggl_buffer_substr(recv_buffer, 0, 12);
     assert(prelude_buf.len == 12);
 
-    GglError ret = ggl_socket_handle_read(&pool, handle, prelude_buf);
+    int memfd = -1;
+    GglError ret
+        = ggl_socket_handle_read_with_fd(&pool, handle, prelude_buf, &memfd);
+    GGL_CLEANUP(cleanup_close, memfd);
     if (ret != GGL_ERR_OK) {
         return ret;
     }
@@ -194,7 +257,14 @@ static GglError client_ready(void *ctx, uint32_t handle) {
     GglBuffer data_section
         = ggl_buffer_substr(recv_buffer, 0, prelude.data_len);
 
-    ret = ggl_socket_handle_read(&pool, handle, data_section);
+    // Peer attaches any memfd to the start of the packet
+    int unexpected_fd = -1;
+    ret = ggl_socket_handle_read_with_fd(
+        &pool, handle, data_section, &unexpected_fd
+    );
+    if (unexpected_fd >= 0) {
+        (void) ggl_close(unexpected_fd);
+    }
     if (ret != GGL_ERR_OK) {
         return ret;
     }
@@ -207,6 +277,14 @@ static GglError client_ready(void *ctx, uint32_t handle) {
         return GGL_ERR_OK;
     }
 
+    GglBuffer mapping = { 0 };
+    ret = ggl_core_bus_get_payload(&msg, memfd, &mapping);
+    if (ret != GGL_ERR_OK) {
+        send_err_response(handle, ret);
+        return GGL_ERR_OK;
+    }
+    GGL_CLEANUP(cleanup_core_bus_mapping, mapping);
+
     GglBuffer method = { 0 };
     bool method_set = false;
     GglCoreBusRequestType type = GGL_CORE_BUS_CALL;
@@ -287,35 +365,41 @@ static GglError client_ready(void *ctx, uint32_t handle) {
         "Dispatching request for method %.*s.", (int) method.len, method.data
     );
 
-    for (size_t i = 0; i < interface->handlers_len; i++) {
-        GglRpcMethodDesc *handler = &interface->handlers[i];
-        if (ggl_buffer_eq(method, handler->name)) {
-            if (handler->is_subscription != (type == GGL_CORE_BUS_SUBSCRIBE)) {
-                GGL_LOGE("Request type is unsupported for method.");
-                send_err_response(handle, GGL_ERR_INVALID);
-                return GGL_ERR_OK;
-            }
+    GglDispatchEntry *entry
+        = ggl_dispatch_table_lookup(&interface->methods, method);
+    if (entry == NULL) {
+        GGL_LOGW("No handler for method %.*s.", (int) method.len, method.data);
+        send_err_response(handle, GGL_ERR_NOENTRY);
+        return GGL_ERR_OK;
+    }
 
-            set_current_handle(handle);
+    GGL_LOGT(
+        "Method %.*s has been called %lu times.",
+        (int) method.len,
+        method.data,
+        (unsigned long) entry->calls
+    );
 
-            ret = handler->handler(handler->ctx, params, handle);
+    GglRpcMethodDesc *handler = &interface->handlers[entry->value];
+    if (handler->is_subscription != (type == GGL_CORE_BUS_SUBSCRIBE)) {
+        GGL_LOGE("Request type is unsupported for method.");
+        send_err_response(handle, GGL_ERR_INVALID);
+        return GGL_ERR_OK;
+    }
 
-            // Handler must either error, or succeed after calling ggl_respond
-            // or ggl_sub_accept. Both of those clear current_handle
-            assert(get_current_handle() == ((ret == GGL_ERR_OK) ? 0 : handle));
+    set_current_handle(handle);
 
-            if (ret != GGL_ERR_OK) {
-                send_err_response(handle, ret);
-                clear_current_handle();
-            }
+    ret = handler->handler(handler->ctx, params, handle);
 
-            return GGL_ERR_OK;
-        }
-    }
+    // Handler must either error, or succeed after calling ggl_respond
+    // or ggl_sub_accept. Both of those clear current_handle
+    assert(get_current_handle() == ((ret == GGL_ERR_OK) ? 0 : handle));
 
-    GGL_LOGW("No handler for method %.*s.", (int) method.len, method.data);
+    if (ret != GGL_ERR_OK) {
+        send_err_response(handle, ret);
+        clear_current_handle();
+    }
 
-    send_err_response(handle, GGL_ERR_NOENTRY);
     return GGL_ERR_OK;
 }
 
@@ -342,7 +426,29 @@ GglError ggl_listen(
         socket_path.buf.data
     );
 
-    InterfaceCtx ctx = { .handlers = handlers, .handlers_len = handlers_len };
+    if (handlers_len > GGL_COREBUS_MAX_METHODS) {
+        GGL_LOGE("Too many methods for core bus interface.");
+        return GGL_ERR_RANGE;
+    }
+
+    GglDispatchEntry method_slots[2 * GGL_COREBUS_MAX_METHODS];
+    InterfaceCtx ctx = { .handlers = handlers };
+    ret = ggl_dispatch_table_init(
+        &ctx.methods,
+        method_slots,
+        sizeof(method_slots) / sizeof(method_slots[0])
+    );
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+    for (size_t i = 0; i < handlers_len; i++) {
+        ret = ggl_dispatch_table_insert(
+            &ctx.methods, handlers[i].name, (uint32_t) i
+        );
+        if (ret != GGL_ERR_OK) {
+            return ret;
+        }
+    }
 
     return ggl_socket_server_listen(
         &interface, socket_path.buf, 0660, &pool, client_ready, &ctx
@@ -376,14 +482,14 @@ void ggl_respond(uint32_t handle, GglObject value) {
 
     GglBuffer send_buffer = GGL_BUF(encode_array);
 
-    ret = eventstream_encode(
-        &send_buffer, NULL, 0, ggl_serialize_reader(&value)
-    );
+    int memfd = -1;
+    ret = ggl_core_bus_encode(&send_buffer, NULL, 0, &value, &memfd);
     if (ret != GGL_ERR_OK) {
         return;
     }
+    GGL_CLEANUP(cleanup_close, memfd);
 
-    ret = ggl_socket_handle_write(&pool, handle, send_buffer);
+    ret = ggl_socket_handle_write_with_fd(&pool, handle, send_buffer, memfd);
     if (ret != GGL_ERR_OK) {
         return;
     }
@@ -461,14 +567,14 @@ void ggl_sub_respond(uint32_t handle, GglObject value) {
 
     GglBuffer send_buffer = GGL_BUF(encode_array);
 
-    ret = eventstream_encode(
-        &send_buffer, NULL, 0, ggl_serialize_reader(&value)
-    );
+    int memfd = -1;
+    ret = ggl_core_bus_encode(&send_buffer, NULL, 0, &value, &memfd);
     if (ret != GGL_ERR_OK) {
         return;
     }
+    GGL_CLEANUP(cleanup_close, memfd);
 
-    ret = ggl_socket_handle_write(&pool, handle, send_buffer);
+    ret = send_sub_packet(handle, send_buffer, memfd);
     if (ret != GGL_ERR_OK) {
         return;
     }
@@ -480,6 +586,81 @@ void ggl_sub_respond(uint32_t handle, GglObject value) {
     GGL_LOGT("Sent response to %d.", handle);
 }
 
+void ggl_sub_respond_multicast(
+    const uint32_t *handles, size_t handles_len, GglObject value
+) {
+    GGL_LOGT("Responding to %zu subscriptions.", handles_len);
+
+    for (size_t i = 0; i < handles_len; i++) {
+        wait_while_current_handle(handles[i]);
+    }
+
+    GGL_MTX_SCOPE_GUARD(&encode_array_mtx);
+
+    GglBuffer send_buffer = GGL_BUF(encode_array);
+
+    int memfd = -1;
+    GglError ret = ggl_core_bus_encode(&send_buffer, NULL, 0, &value, &memfd);
+    if (ret != GGL_ERR_OK) {
+        for (size_t i = 0; i < handles_len; i++) {
+            (void) ggl_socket_handle_close(&pool, handles[i]);
+        }
+        return;
+    }
+    GGL_CLEANUP(cleanup_close, memfd);
+
+    for (size_t i = 0; i < handles_len; i++) {
+        ret = send_sub_packet(handles[i], send_buffer, memfd);
+        if (ret != GGL_ERR_OK) {
+            (void) ggl_socket_handle_close(&pool, handles[i]);
+        }
+    }
+
+    GGL_LOGT("Sent response to %zu subscriptions.", handles_len);
+}
+
+typedef struct {
+    GglSubOverflowPolicy policy;
+} SetPolicyCtx;
+
+static void set_overflow_policy(void *ctx, size_t index) {
+    SetPolicyCtx *args = ctx;
+    sub_queue_set_policy(index, args->policy);
+}
+
+void ggl_sub_set_overflow_policy(uint32_t handle, GglSubOverflowPolicy policy) {
+    (void) ggl_socket_handle_protected(
+        set_overflow_policy, &(SetPolicyCtx) { .policy = policy }, &pool, handle
+    );
+}
+
+void ggl_sub_queue_stats(GglSubQueueStats *stats) {
+    sub_queue_stats(stats);
+}
+
+GglError ggl_sub_queue_stats_handler(
+    void *ctx, GglMap params, uint32_t handle
+) {
+    (void) ctx;
+    (void) params;
+
+    GglSubQueueStats stats;
+    ggl_sub_queue_stats(&stats);
+
+    ggl_respond(
+        handle,
+        ggl_obj_map(GGL_MAP(
+            ggl_kv(GGL_STR("queued"), ggl_obj_i64((int64_t) stats.queued)),
+            ggl_kv(GGL_STR("dropped"), ggl_obj_i64((int64_t) stats.dropped)),
+            ggl_kv(
+                GGL_STR("disconnected"),
+                ggl_obj_i64((int64_t) stats.disconnected)
+            )
+        ))
+    );
+    return GGL_ERR_OK;
+}
+
 void ggl_server_sub_close(uint32_t handle) {
     (void) ggl_socket_handle_close(&pool, handle);
 }
@@ -0,0 +1,211 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "sub_queue.h"
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <ggl/buffer.h>
+#include <ggl/core_bus/constants.h>
+#include <ggl/core_bus/server.h>
+#include <ggl/error.h>
+#include <ggl/file.h>
+#include <ggl/log.h>
+#include <ggl/socket_fd.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// Header preceding each queued packet.
+typedef struct {
+    uint32_t len;
+    /// Bytes already written; the head packet may be partially written.
+    uint32_t sent;
+    /// memfd to pass with the packet; -1 if none or already passed.
+    int32_t fd;
+} QueuedPacket;
+
+static_assert(
+    GGL_COREBUS_SUB_QUEUE_LEN >= GGL_COREBUS_MAX_MSG_LEN + sizeof(QueuedPacket),
+    "Subscription queue must fit a max size packet."
+);
+
+static uint8_t queue_mem[GGL_COREBUS_MAX_CLIENTS][GGL_COREBUS_SUB_QUEUE_LEN];
+static size_t queue_len[GGL_COREBUS_MAX_CLIENTS];
+static GglSubOverflowPolicy queue_policy[GGL_COREBUS_MAX_CLIENTS];
+
+static _Atomic(uint64_t) queued_count = 0;
+static _Atomic(uint64_t) dropped_count = 0;
+static _Atomic(uint64_t) disconnected_count = 0;
+
+static QueuedPacket read_header(size_t index, size_t offset) {
+    QueuedPacket header;
+    memcpy(&header, &queue_mem[index][offset], sizeof(header));
+    return header;
+}
+
+static void write_header(size_t index, size_t offset, QueuedPacket header) {
+    memcpy(&queue_mem[index][offset], &header, sizeof(header));
+}
+
+static size_t record_len(QueuedPacket header) {
+    return sizeof(QueuedPacket) + header.len;
+}
+
+static void remove_record(size_t index, size_t offset) {
+    QueuedPacket header = read_header(index, offset);
+    if (header.fd >= 0) {
+        (void) ggl_close(header.fd);
+    }
+    size_t len = record_len(header);
+    memmove(
+        &queue_mem[index][offset],
+        &queue_mem[index][offset + len],
+        queue_len[index] - offset - len
+    );
+    queue_len[index] -= len;
+}
+
+static bool fits(size_t index, GglBuffer packet) {
+    return GGL_COREBUS_SUB_QUEUE_LEN - queue_len[index]
+        >= sizeof(QueuedPacket) + packet.len;
+}
+
+static GglError push(size_t index, GglBuffer packet, size_t sent, int memfd) {
+    assert(fits(index, packet));
+
+    int fd = -1;
+    if (memfd >= 0) {
+        fd = fcntl(memfd, F_DUPFD_CLOEXEC, 0);
+        if (fd < 0) {
+            GGL_LOGE("Failed to dup payload memfd: %d.", errno);
+            return GGL_ERR_FAILURE;
+        }
+    }
+
+    QueuedPacket header
+        = { .len = (uint32_t) packet.len, .sent = (uint32_t) sent, .fd = fd };
+    write_header(index, queue_len[index], header);
+    memcpy(
+        &queue_mem[index][queue_len[index] + sizeof(QueuedPacket)],
+        packet.data,
+        packet.len
+    );
+    queue_len[index] += record_len(header);
+    atomic_fetch_add_explicit(&queued_count, 1, memory_order_relaxed);
+    return GGL_ERR_OK;
+}
+
+/// Drop unsent packets, oldest first, until packet fits.
+static void drop_oldest(size_t index, GglBuffer packet) {
+    size_t offset = 0;
+    // A partially written packet must be completed to keep framing intact
+    if ((queue_len[index] > 0) && (read_header(index, 0).sent > 0)) {
+        offset = record_len(read_header(index, 0));
+    }
+    while (!fits(index, packet) && (offset < queue_len[index])) {
+        remove_record(index, offset);
+        atomic_fetch_add_explicit(&dropped_count, 1, memory_order_relaxed);
+    }
+}
+
+void sub_queue_reset(size_t index) {
+    while (queue_len[index] > 0) {
+        remove_record(index, 0);
+    }
+    queue_policy[index] = GGL_SUB_OVERFLOW_DISCONNECT;
+}
+
+void sub_queue_set_policy(size_t index, GglSubOverflowPolicy policy) {
+    queue_policy[index] = policy;
+}
+
+GglError sub_queue_send(
+    size_t index, int sock, GglBuffer packet, int memfd, bool *watch
+) {
+    *watch = false;
+
+    if (queue_len[index] == 0) {
+        GglBuffer rest = packet;
+        int fd = memfd;
+        GglError ret = ggl_socket_try_write_with_fd(sock, &rest, &fd);
+        if ((ret != GGL_ERR_OK) || (rest.len == 0)) {
+            return ret;
+        }
+
+        *watch = true;
+        return push(index, packet, packet.len - rest.len, fd);
+    }
+
+    if (!fits(index, packet)) {
+        switch (queue_policy[index]) {
+        case GGL_SUB_OVERFLOW_DROP_OLDEST:
+            drop_oldest(index, packet);
+            if (fits(index, packet)) {
+                break;
+            }
+            // fall through
+        case GGL_SUB_OVERFLOW_DROP_NEWEST:
+            GGL_LOGD("Subscription queue full; dropping response.");
+            atomic_fetch_add_explicit(&dropped_count, 1, memory_order_relaxed);
+            return GGL_ERR_OK;
+        case GGL_SUB_OVERFLOW_DISCONNECT:
+        default:
+            GGL_LOGW("Subscription queue full; closing subscription.");
+            atomic_fetch_add_explicit(
+                &disconnected_count, 1, memory_order_relaxed
+            );
+            return GGL_ERR_NOMEM;
+        }
+    }
+
+    return push(index, packet, 0, memfd);
+}
+
+bool sub_queue_is_empty(size_t index) {
+    return queue_len[index] == 0;
+}
+
+GglError sub_queue_drain(size_t index, int sock, bool *empty) {
+    *empty = false;
+
+    while (queue_len[index] > 0) {
+        QueuedPacket header = read_header(index, 0);
+        uint8_t *data = &queue_mem[index][sizeof(QueuedPacket)];
+        GglBuffer rest = { .data = &data[header.sent],
+                           .len = header.len - header.sent };
+
+        int fd = header.fd;
+        GglError ret = ggl_socket_try_write_with_fd(sock, &rest, &fd);
+        if ((fd < 0) && (header.fd >= 0)) {
+            // Passed with the written data
+            (void) ggl_close(header.fd);
+            header.fd = -1;
+        }
+        header.sent = header.len - (uint32_t) rest.len;
+        write_header(index, 0, header);
+        if (ret != GGL_ERR_OK) {
+            return ret;
+        }
+        if (rest.len > 0) {
+            return GGL_ERR_OK;
+        }
+
+        remove_record(index, 0);
+    }
+
+    *empty = true;
+    return GGL_ERR_OK;
+}
+
+void sub_queue_stats(GglSubQueueStats *stats) {
+    *stats = (GglSubQueueStats) {
+        .queued = atomic_load_explicit(&queued_count, memory_order_relaxed),
+        .dropped = atomic_load_explicit(&dropped_count, memory_order_relaxed),
+        .disconnected
+        = atomic_load_explicit(&disconnected_count, memory_order_relaxed),
+    };
+}
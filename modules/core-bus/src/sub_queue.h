@@ -0,0 +1,44 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CORE_BUS_SUB_QUEUE_H
+#define CORE_BUS_SUB_QUEUE_H
+
+//! Outbound queues for core-bus server subscriptions.
+//!
+//! Indexed by socket pool index. Callers must hold the pool lock for the
+//! index (i.e. call from a `ggl_socket_handle_protected` action).
+
+#include <ggl/buffer.h>
+#include <ggl/core_bus/server.h>
+#include <ggl/error.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/// Discard queued data and reset the policy.
+void sub_queue_reset(size_t index);
+
+/// Set the overflow policy for an index.
+void sub_queue_set_policy(size_t index, GglSubOverflowPolicy policy);
+
+/// Write a packet to `sock` without blocking, queueing what can't be written.
+/// `memfd` is the fd to pass with the packet, or -1.
+/// `watch` is set if the socket must be watched for writability.
+/// Returns an error if the subscription should be closed.
+GglError sub_queue_send(
+    size_t index, int sock, GglBuffer packet, int memfd, bool *watch
+);
+
+/// Check if nothing is queued.
+bool sub_queue_is_empty(size_t index);
+
+/// Write queued data to `sock` without blocking.
+/// `empty` is set if the queue was fully written.
+/// Returns an error if the subscription should be closed.
+GglError sub_queue_drain(size_t index, int sock, bool *empty);
+
+/// Get queueing counters.
+void sub_queue_stats(GglSubQueueStats *stats);
+
+#endif
@@ -52,6 +52,11 @@ GglError run_gg_fleet_statusd(void) {
         return ret;
     }
 
+    ret = fleet_status_service_init(thing_name);
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
     ret = ggl_aws_iot_mqtt_connection_status(
         GGL_STR("aws_iot_mqtt"),
         connection_status_callback,
@@ -91,17 +96,8 @@ static GglError connection_status_callback(
     }
 
     if (connected) {
-        GGL_LOGD(
-            "Sending %.*s fleet status update.",
-            (int) connection_trigger.len,
-            connection_trigger.data
-        );
-        ret = publish_fleet_status_update(
-            thing_name, connection_trigger, GGL_MAP()
-        );
-        if (ret != GGL_ERR_OK) {
-            GGL_LOGE("Failed to publish fleet status update.");
-        }
+        // Publishing would make core bus calls from the subscription thread
+        request_fleet_status_update(connection_trigger);
         connection_trigger = GGL_STR("RECONNECT");
     }
 
@@ -3,11 +3,12 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "fleet_status_service.h"
-#include <assert.h>
+#include <errno.h>
 #include <ggl/arena.h>
 #include <ggl/buffer.h>
 #include <ggl/cleanup.h>
 #include <ggl/core_bus/aws_iot_mqtt.h>
+#include <ggl/core_bus/client.h>
 #include <ggl/core_bus/gg_config.h>
 #include <ggl/core_bus/gg_healthd.h>
 #include <ggl/error.h>
@@ -24,6 +25,7 @@
 #include <sys/types.h>
 #include <time.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #define TOPIC_PREFIX "$aws/things/"
@@ -36,6 +38,21 @@
 
 #define PAYLOAD_BUFFER_LEN 5000
 
+#define MAX_VERSION_LEN 64
+#define MAX_STATUS_LEN 16
+
+/// Memory for each cached component's fleet configuration ARN list.
+/// Can be configured with `-DGGL_FLEET_STATUS_ARN_MEM_LEN=<N>`.
+#ifndef GGL_FLEET_STATUS_ARN_MEM_LEN
+#define GGL_FLEET_STATUS_ARN_MEM_LEN 1024
+#endif
+
+/// Time to wait for further changes before sending a change report.
+/// Can be configured with `-DGGL_FLEET_STATUS_COALESCE_MS=<N>`.
+#ifndef GGL_FLEET_STATUS_COALESCE_MS
+#define GGL_FLEET_STATUS_COALESCE_MS 2000
+#endif
+
 static const GglBuffer ARCHITECTURE =
 #if defined(__x86_64__)
     GGL_STR("amd64");
@@ -50,20 +67,285 @@ static const GglBuffer ARCHITECTURE =
     { 0 };
 #endif
 
-// TODO: Split this function up
-// NOLINTNEXTLINE(readability-function-cognitive-complexity)
-GglError publish_fleet_status_update(
-    GglBuffer thing_name, GglBuffer trigger, GglMap deployment_info
-) {
-    static pthread_mutex_t mtx = PTHREAD_MUTEX_INITIALIZER;
-    GGL_MTX_SCOPE_GUARD(&mtx);
+typedef struct {
+    uint8_t name_mem[GGL_COMPONENT_NAME_MAX_LEN];
+    size_t name_len;
+    uint8_t version_mem[MAX_VERSION_LEN];
+    size_t version_len;
+    uint8_t status_mem[MAX_STATUS_LEN];
+    size_t status_len;
+    uint8_t arn_mem[GGL_FLEET_STATUS_ARN_MEM_LEN];
+    GglObject arns;
+    /// Version and configArn match the config.
+    bool config_valid;
+    /// Status is kept up to date by the gghealthd subscription.
+    bool status_valid;
+    /// Differs from what was last reported.
+    bool changed;
+    bool seen;
+} CachedComponent;
 
-    bool device_healthy = true;
+// Entries are only added or removed with report_mtx held; subscription
+// callbacks only update fields of existing entries, with cache_mtx held.
+static pthread_mutex_t report_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t cache_mtx = PTHREAD_MUTEX_INITIALIZER;
+static CachedComponent cache[GGL_MAX_GENERIC_COMPONENTS];
+static size_t cache_len = 0;
+static bool services_dirty = true;
+static bool components_removed = false;
+static bool complete_reported = false;
+/// Single gghealthd subscription to the lifecycle of all components, so that
+/// gghealthd holds one subscription slot however many are deployed.
+static uint32_t health_handle = 0;
+
+static int64_t sequence = 0;
+static bool sequence_loaded = false;
+
+static GglBuffer report_thing_name = { 0 };
+
+// Status reads issued together by fetch_statuses; results are indexed like
+// the cache, which does not change while report_mtx is held.
+static pthread_mutex_t status_fetch_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t status_fetch_cond = PTHREAD_COND_INITIALIZER;
+static size_t status_fetch_pending = 0;
+static GglError status_fetch_results[GGL_MAX_GENERIC_COMPONENTS];
+
+static pthread_mutex_t pending_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pending_cond;
+static bool pending_change = false;
+static GglBuffer pending_trigger = { 0 };
+
+static GglBuffer entry_name(const CachedComponent *entry) {
+    return (GglBuffer) { .data = (uint8_t *) entry->name_mem,
+                         .len = entry->name_len };
+}
+
+static GglBuffer entry_version(const CachedComponent *entry) {
+    return (GglBuffer) { .data = (uint8_t *) entry->version_mem,
+                         .len = entry->version_len };
+}
+
+static GglBuffer entry_status(const CachedComponent *entry) {
+    return (GglBuffer) { .data = (uint8_t *) entry->status_mem,
+                         .len = entry->status_len };
+}
+
+static bool is_ignored_component(GglBuffer component) {
+    // ignore core components for now, gghealthd does not support
+    // getting their health yet
+    GglBufList ignored_components = GGL_BUF_LIST(
+        GGL_STR("aws.greengrass.NucleusLite"),
+        GGL_STR("aws.greengrass.fleet_provisioning"),
+        GGL_STR("DeploymentService"),
+        GGL_STR("FleetStatusService"),
+        GGL_STR("main"),
+        GGL_STR("TelemetryAgent"),
+        GGL_STR("UpdateSystemPolicyService")
+    );
+    GGL_BUF_LIST_FOREACH (ignored_component, ignored_components) {
+        if (ggl_buffer_eq(*ignored_component, component)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool is_complete_trigger(GglBuffer trigger) {
+    return ggl_buffer_eq(trigger, GGL_STR("NUCLEUS_LAUNCH"))
+        || ggl_buffer_eq(trigger, GGL_STR("RECONNECT"))
+        || ggl_buffer_eq(trigger, GGL_STR("NETWORK_RECONFIGURE"))
+        || ggl_buffer_eq(trigger, GGL_STR("CADENCE"));
+}
+
+static CachedComponent *find_entry(GglBuffer component) {
+    for (size_t i = 0; i < cache_len; i++) {
+        if (ggl_buffer_eq(entry_name(&cache[i]), component)) {
+            return &cache[i];
+        }
+    }
+    return NULL;
+}
+
+static bool arn_lists_eq(GglObject a, GglObject b) {
+    if ((ggl_obj_type(a) != GGL_TYPE_LIST)
+        || (ggl_obj_type(b) != GGL_TYPE_LIST)) {
+        return false;
+    }
+    GglList list_a = ggl_obj_into_list(a);
+    GglList list_b = ggl_obj_into_list(b);
+    if (list_a.len != list_b.len) {
+        return false;
+    }
+    for (size_t i = 0; i < list_a.len; i++) {
+        if ((ggl_obj_type(list_a.items[i]) != GGL_TYPE_BUF)
+            || (ggl_obj_type(list_b.items[i]) != GGL_TYPE_BUF)
+            || !ggl_buffer_eq(
+                ggl_obj_into_buf(list_a.items[i]),
+                ggl_obj_into_buf(list_b.items[i])
+            )) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool set_status(CachedComponent *entry, GglBuffer status) {
+    if (ggl_buffer_eq(entry_status(entry), status)) {
+        return false;
+    }
+    if (status.len > MAX_STATUS_LEN) {
+        GGL_LOGE("Unexpected lifecycle state length.");
+        return false;
+    }
+    memcpy(entry->status_mem, status.data, status.len);
+    entry->status_len = status.len;
+    entry->changed = true;
+    return true;
+}
+
+static void schedule_change_report(void) {
+    GGL_MTX_SCOPE_GUARD(&pending_mtx);
+    pending_change = true;
+    pthread_cond_signal(&pending_cond);
+}
+
+void request_fleet_status_update(GglBuffer trigger) {
+    GGL_MTX_SCOPE_GUARD(&pending_mtx);
+    pending_trigger = trigger;
+    pthread_cond_signal(&pending_cond);
+}
+
+static GglError health_callback(void *ctx, uint32_t handle, GglObject data) {
+    (void) ctx;
+
+    if (ggl_obj_type(data) != GGL_TYPE_MAP) {
+        return GGL_ERR_INVALID;
+    }
+    GglObject *component_obj;
+    GglObject *status_obj;
+    GglError ret = ggl_map_validate(
+        ggl_obj_into_map(data),
+        GGL_MAP_SCHEMA(
+            { GGL_STR("component_name"),
+              GGL_REQUIRED,
+              GGL_TYPE_BUF,
+              &component_obj },
+            { GGL_STR("lifecycle_state"),
+              GGL_REQUIRED,
+              GGL_TYPE_BUF,
+              &status_obj },
+        )
+    );
+    if (ret != GGL_ERR_OK) {
+        GGL_LOGE("Invalid lifecycle update from gghealthd.");
+        return GGL_ERR_OK;
+    }
+
+    bool changed = false;
+    {
+        GGL_MTX_SCOPE_GUARD(&cache_mtx);
+        CachedComponent *entry = find_entry(ggl_obj_into_buf(*component_obj));
+        if ((entry == NULL) || (health_handle != handle)) {
+            return GGL_ERR_OK;
+        }
+        changed = set_status(entry, ggl_obj_into_buf(*status_obj));
+    }
+
+    if (changed) {
+        schedule_change_report();
+    }
+    return GGL_ERR_OK;
+}
+
+static void health_close_callback(void *ctx, uint32_t handle) {
+    (void) ctx;
+    GGL_MTX_SCOPE_GUARD(&cache_mtx);
+    if (health_handle != handle) {
+        return;
+    }
+    GGL_LOGW("Lost lifecycle subscription; polling component status.");
+    health_handle = 0;
+    for (size_t i = 0; i < cache_len; i++) {
+        cache[i].status_valid = false;
+    }
+}
+
+static GglError config_callback(void *ctx, uint32_t handle, GglObject data) {
+    (void) ctx;
+    (void) handle;
 
-    GglBuffer component_info_mem = GGL_BUF((uint8_t[PAYLOAD_BUFFER_LEN - 128]
-    ) { 0 }); // The size of the payload buffer minus some bytes we will need
-              // for boilerplate contents, is the max we can send
-    GglArena alloc = ggl_arena_init(component_info_mem);
+    // Data is the key path that changed
+    if (ggl_obj_type(data) != GGL_TYPE_LIST) {
+        return GGL_ERR_OK;
+    }
+    GglList key_path = ggl_obj_into_list(data);
+    if ((key_path.len < 2) || (ggl_obj_type(key_path.items[1]) != GGL_TYPE_BUF)
+    ) {
+        GGL_MTX_SCOPE_GUARD(&cache_mtx);
+        services_dirty = true;
+        return GGL_ERR_OK;
+    }
+    GglBuffer component = ggl_obj_into_buf(key_path.items[1]);
+    if (is_ignored_component(component)) {
+        return GGL_ERR_OK;
+    }
+
+    {
+        GGL_MTX_SCOPE_GUARD(&cache_mtx);
+        CachedComponent *entry = find_entry(component);
+        if (entry == NULL) {
+            services_dirty = true;
+        } else {
+            if ((key_path.len > 2)
+                && (ggl_obj_type(key_path.items[2]) == GGL_TYPE_BUF)) {
+                GglBuffer key = ggl_obj_into_buf(key_path.items[2]);
+                if (!ggl_buffer_eq(key, GGL_STR("version"))
+                    && !ggl_buffer_eq(key, GGL_STR("configArn"))) {
+                    return GGL_ERR_OK;
+                }
+            }
+            entry->config_valid = false;
+        }
+    }
+
+    schedule_change_report();
+    return GGL_ERR_OK;
+}
+
+static void config_close_callback(void *ctx, uint32_t handle) {
+    (void) ctx;
+    (void) handle;
+    GGL_LOGW("Lost config subscription; full reports will re-read config.");
+    GGL_MTX_SCOPE_GUARD(&cache_mtx);
+    for (size_t i = 0; i < cache_len; i++) {
+        cache[i].config_valid = false;
+    }
+    services_dirty = true;
+}
+
+static void invalidate_cache(void) {
+    GGL_MTX_SCOPE_GUARD(&cache_mtx);
+    for (size_t i = 0; i < cache_len; i++) {
+        cache[i].config_valid = false;
+        if (health_handle == 0) {
+            cache[i].status_valid = false;
+        }
+    }
+    services_dirty = true;
+}
+
+/// Syncs cached entries with the services list. Requires report_mtx.
+static GglError refresh_component_list(void) {
+    {
+        GGL_MTX_SCOPE_GUARD(&cache_mtx);
+        if (!services_dirty) {
+            return GGL_ERR_OK;
+        }
+        services_dirty = false;
+    }
+
+    static uint8_t list_mem[PAYLOAD_BUFFER_LEN];
+    GglArena alloc = ggl_arena_init(GGL_BUF(list_mem));
 
     // retrieve running components from services config
     GglList components;
@@ -75,85 +357,216 @@ GglError publish_fleet_status_update(
             "Unable to retrieve list of components from config with error %s",
             ggl_strerror(ret)
         );
+        GGL_MTX_SCOPE_GUARD(&cache_mtx);
+        services_dirty = true;
         return ret;
     }
 
-    // get status for each running component
-    GglKV component_infos[GGL_MAX_GENERIC_COMPONENTS][5];
-    GglObjVec component_statuses
-        = GGL_OBJ_VEC((GglObject[GGL_MAX_GENERIC_COMPONENTS]) { 0 });
-    size_t component_count = 0;
-    GGL_LIST_FOREACH (component_obj, components) {
-        if (ggl_obj_type(*component_obj) != GGL_TYPE_BUF) {
-            GGL_LOGE(
-                "Incorrect type of component key received. Expected buffer. "
-                "Cannot publish fleet status update for this entry."
-            );
-            continue;
+    {
+        GGL_MTX_SCOPE_GUARD(&cache_mtx);
+
+        for (size_t i = 0; i < cache_len; i++) {
+            cache[i].seen = false;
         }
-        GglBuffer component = ggl_obj_into_buf(*component_obj);
 
-        // ignore core components for now, gghealthd does not support
-        // getting their health yet
-        GglBufList ignored_components = GGL_BUF_LIST(
-            GGL_STR("aws.greengrass.NucleusLite"),
-            GGL_STR("aws.greengrass.fleet_provisioning"),
-            GGL_STR("DeploymentService"),
-            GGL_STR("FleetStatusService"),
-            GGL_STR("main"),
-            GGL_STR("TelemetryAgent"),
-            GGL_STR("UpdateSystemPolicyService")
-        );
-        bool ignore_component = false;
-        GGL_BUF_LIST_FOREACH (ignored_component, ignored_components) {
-            if (ggl_buffer_eq(*ignored_component, component)) {
-                ignore_component = true;
-                break;
+        GGL_LIST_FOREACH (component_obj, components) {
+            if (ggl_obj_type(*component_obj) != GGL_TYPE_BUF) {
+                GGL_LOGE(
+                    "Incorrect type of component key received. Expected "
+                    "buffer. Cannot publish fleet status update for this entry."
+                );
+                continue;
+            }
+            GglBuffer component = ggl_obj_into_buf(*component_obj);
+            if (is_ignored_component(component)) {
+                continue;
             }
+
+            CachedComponent *entry = find_entry(component);
+            if (entry == NULL) {
+                if ((cache_len >= GGL_MAX_GENERIC_COMPONENTS)
+                    || (component.len > GGL_COMPONENT_NAME_MAX_LEN)) {
+                    GGL_LOGE(
+                        "Cannot track status of %.*s.",
+                        (int) component.len,
+                        component.data
+                    );
+                    continue;
+                }
+                entry = &cache[cache_len];
+                cache_len += 1;
+                *entry = (CachedComponent) { .name_len = component.len,
+                                             .changed = true };
+                memcpy(entry->name_mem, component.data, component.len);
+            }
+            entry->seen = true;
         }
-        if (ignore_component) {
-            continue;
+
+        size_t kept = 0;
+        for (size_t i = 0; i < cache_len; i++) {
+            if (!cache[i].seen) {
+                components_removed = true;
+                continue;
+            }
+            if (kept != i) {
+                cache[kept] = cache[i];
+            }
+            kept += 1;
+        }
+        cache_len = kept;
+    }
+
+    return GGL_ERR_OK;
+}
+
+/// Subscribes to lifecycle updates of all components, if not already
+/// subscribed. Requires report_mtx.
+static void subscribe_health(void) {
+    {
+        GGL_MTX_SCOPE_GUARD(&cache_mtx);
+        if (health_handle != 0) {
+            return;
         }
+    }
+
+    // Must not hold cache_mtx; callbacks may already be running
+    uint32_t handle = 0;
+    GglError ret = ggl_subscribe(
+        GGL_STR("gg_health"),
+        GGL_STR("subscribe_to_lifecycle_updates"),
+        GGL_MAP(),
+        health_callback,
+        health_close_callback,
+        NULL,
+        NULL,
+        &handle
+    );
+    if (ret != GGL_ERR_OK) {
+        GGL_LOGD("Polling component status; subscription failed.");
+        return;
+    }
+
+    GGL_MTX_SCOPE_GUARD(&cache_mtx);
+    health_handle = handle;
+}
+
+static void status_result_callback(
+    void *ctx, uint32_t handle, GglError err, GglObject result
+) {
+    (void) handle;
+    size_t index = (size_t) (uintptr_t) ctx;
+
+    GglObject *status_obj = NULL;
+    if (err == GGL_ERR_OK) {
+        err = (ggl_obj_type(result) == GGL_TYPE_MAP)
+            ? ggl_map_validate(
+                  ggl_obj_into_map(result),
+                  GGL_MAP_SCHEMA({ GGL_STR("lifecycle_state"),
+                                   GGL_REQUIRED,
+                                   GGL_TYPE_BUF,
+                                   &status_obj })
+              )
+            : GGL_ERR_INVALID;
+    }
+    if (err == GGL_ERR_OK) {
+        GGL_MTX_SCOPE_GUARD(&cache_mtx);
+        (void) set_status(&cache[index], ggl_obj_into_buf(*status_obj));
+        // Later changes are delivered by the subscription
+        cache[index].status_valid = health_handle != 0;
+    }
+
+    GGL_MTX_SCOPE_GUARD(&status_fetch_mtx);
+    status_fetch_results[index] = err;
+    status_fetch_pending -= 1;
+    pthread_cond_signal(&status_fetch_cond);
+}
+
+/// Reads the status of all entries without a valid status from gghealthd,
+/// with the calls in flight together rather than one round trip each.
+/// Entries whose call could not be sent are read by refresh_entry instead.
+/// Requires report_mtx.
+static void fetch_statuses(size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        GglBuffer component;
+        {
+            GGL_MTX_SCOPE_GUARD(&cache_mtx);
+            if (cache[i].status_valid) {
+                status_fetch_results[i] = GGL_ERR_OK;
+                continue;
+            }
+            component = entry_name(&cache[i]);
+        }
+
+        {
+            GGL_MTX_SCOPE_GUARD(&status_fetch_mtx);
+            status_fetch_results[i] = GGL_ERR_RETRY;
+            status_fetch_pending += 1;
+        }
+        // Reading the status also makes gghealthd track the component, so
+        // later changes reach the subscription
+        uint32_t handle = 0;
+        GglError ret = ggl_call_async(
+            GGL_STR("gg_health"),
+            GGL_STR("get_status"),
+            GGL_MAP(ggl_kv(GGL_STR("component_name"), ggl_obj_buf(component))
+            ),
+            status_result_callback,
+            (void *) (uintptr_t) i,
+            &handle
+        );
+        if (ret != GGL_ERR_OK) {
+            GGL_MTX_SCOPE_GUARD(&status_fetch_mtx);
+            status_fetch_pending -= 1;
+        }
+    }
+
+    GGL_MTX_SCOPE_GUARD(&status_fetch_mtx);
+    while (status_fetch_pending > 0) {
+        pthread_cond_wait(&status_fetch_cond, &status_fetch_mtx);
+    }
+}
+
+/// Re-reads stale cached data for an entry. Requires report_mtx, and
+/// fetch_statuses to have been called.
+static GglError refresh_entry(size_t index) {
+    bool config_valid;
+    bool subscribed;
+    GglBuffer component;
+    {
+        GGL_MTX_SCOPE_GUARD(&cache_mtx);
+        config_valid = cache[index].config_valid;
+        subscribed = health_handle != 0;
+        component = entry_name(&cache[index]);
+    }
+    GglError fetch_ret;
+    {
+        GGL_MTX_SCOPE_GUARD(&status_fetch_mtx);
+        fetch_ret = status_fetch_results[index];
+    }
+
+    if (!config_valid) {
+        uint8_t config_mem[MAX_VERSION_LEN + GGL_FLEET_STATUS_ARN_MEM_LEN];
+        GglArena alloc = ggl_arena_init(GGL_BUF(config_mem));
 
         // retrieve component version from config
         GglBuffer version_resp;
-        ret = ggl_gg_config_read_str(
+        GglError ret = ggl_gg_config_read_str(
             GGL_BUF_LIST(GGL_STR("services"), component, GGL_STR("version")),
             &alloc,
             &version_resp
         );
-        if (ret != GGL_ERR_OK) {
-            GGL_LOGE(
-                "Unable to retrieve version of %.*s with error %s. Cannot "
-                "publish fleet "
-                "status update for this component.",
-                (int) component.len,
-                component.data,
-                ggl_strerror(ret)
-            );
-            continue;
+        if ((ret == GGL_ERR_OK) && (version_resp.len > MAX_VERSION_LEN)) {
+            ret = GGL_ERR_RANGE;
         }
-
-        // retrieve component health status
-        uint8_t component_health_arr[NAME_MAX];
-        GglBuffer component_health = GGL_BUF(component_health_arr);
-        ret = ggl_gghealthd_retrieve_component_status(
-            component, &alloc, &component_health
-        );
         if (ret != GGL_ERR_OK) {
             GGL_LOGE(
-                "Failed to retrieve health status for %.*s with error %s. "
-                "Cannot publish fleet status update for this component.",
+                "Unable to retrieve version of %.*s with error %s. Cannot "
+                "publish fleet status update for this component.",
                 (int) component.len,
                 component.data,
                 ggl_strerror(ret)
             );
-            continue;
-        }
-
-        // if a component is broken, mark the device as unhealthy
-        if (ggl_buffer_eq(component_health, GGL_STR("BROKEN"))) {
-            device_healthy = false;
+            return ret;
         }
 
         // retrieve fleet config arn list from config
@@ -166,14 +579,13 @@ GglError publish_fleet_status_update(
         if (ret != GGL_ERR_OK) {
             GGL_LOGE(
                 "Unable to retrieve fleet configuration arn list for component "
-                "%.*s from "
-                "config with error %s. Cannot publish fleet status update for "
-                "this component.",
+                "%.*s from config with error %s. Cannot publish fleet status "
+                "update for this component.",
                 (int) component.len,
                 component.data,
                 ggl_strerror(ret)
             );
-            continue;
+            return ret;
         }
         if (ggl_obj_type(arn_list) != GGL_TYPE_LIST) {
             GGL_LOGE(
@@ -183,58 +595,286 @@ GglError publish_fleet_status_update(
                 (int) component.len,
                 component.data
             );
-            continue;
+            return GGL_ERR_INVALID;
         }
 
-        // building component info to be in line with the cloud's expected pojo
-        // format
-        GglMap component_info = GGL_MAP(
-            ggl_kv(GGL_STR("componentName"), ggl_obj_buf(component)),
-            ggl_kv(GGL_STR("version"), ggl_obj_buf(version_resp)),
-            ggl_kv(GGL_STR("fleetConfigArns"), arn_list),
-            ggl_kv(GGL_STR("isRoot"), ggl_obj_bool(true)),
-            ggl_kv(GGL_STR("status"), ggl_obj_buf(component_health))
+        GGL_MTX_SCOPE_GUARD(&cache_mtx);
+        CachedComponent *entry = &cache[index];
+        if (!ggl_buffer_eq(entry_version(entry), version_resp)
+            || !arn_lists_eq(entry->arns, arn_list)) {
+            memcpy(entry->version_mem, version_resp.data, version_resp.len);
+            entry->version_len = version_resp.len;
+            GglArena arn_alloc = ggl_arena_init(GGL_BUF(entry->arn_mem));
+            ret = ggl_arena_claim_obj(&arn_list, &arn_alloc);
+            if (ret != GGL_ERR_OK) {
+                GGL_LOGE(
+                    "Fleet configuration arn list of %.*s too large.",
+                    (int) component.len,
+                    component.data
+                );
+                entry->arns = GGL_OBJ_NULL;
+                return ret;
+            }
+            entry->arns = arn_list;
+            entry->changed = true;
+        }
+        entry->config_valid = true;
+    }
+
+    if (fetch_ret == GGL_ERR_RETRY) {
+        // The async read could not be sent; retrieve the status directly
+        uint8_t component_health_arr[NAME_MAX];
+        GglArena alloc = ggl_arena_init(GGL_BUF(component_health_arr));
+        GglBuffer component_health;
+        fetch_ret = ggl_gghealthd_retrieve_component_status(
+            component, &alloc, &component_health
+        );
+        if (fetch_ret == GGL_ERR_OK) {
+            GGL_MTX_SCOPE_GUARD(&cache_mtx);
+            (void) set_status(&cache[index], component_health);
+            // Later changes are delivered by the subscription
+            cache[index].status_valid = subscribed;
+        }
+    }
+    if (fetch_ret != GGL_ERR_OK) {
+        GGL_LOGE(
+            "Failed to retrieve health status for %.*s with error %s. "
+            "Cannot publish fleet status update for this component.",
+            (int) component.len,
+            component.data,
+            ggl_strerror(fetch_ret)
         );
+        return fetch_ret;
+    }
+
+    return GGL_ERR_OK;
+}
 
-        memcpy(
-            component_infos[component_count],
-            component_info.pairs,
-            sizeof(component_infos[component_count])
+static GglObject component_info_obj(const CachedComponent *entry, GglKV *kvs) {
+    // building component info to be in line with the cloud's expected pojo
+    // format
+    GglMap component_info = GGL_MAP(
+        ggl_kv(GGL_STR("componentName"), ggl_obj_buf(entry_name(entry))),
+        ggl_kv(GGL_STR("version"), ggl_obj_buf(entry_version(entry))),
+        ggl_kv(GGL_STR("fleetConfigArns"), entry->arns),
+        ggl_kv(GGL_STR("isRoot"), ggl_obj_bool(true)),
+        ggl_kv(GGL_STR("status"), ggl_obj_buf(entry_status(entry)))
+    );
+    memcpy(kvs, component_info.pairs, sizeof(GglKV) * component_info.len);
+    component_info.pairs = kvs;
+    return ggl_obj_map(component_info);
+}
+
+typedef struct {
+    GglBuffer thing_name;
+    GglBuffer trigger;
+    GglBuffer message_type;
+    GglBuffer overall_device_status;
+    GglMap deployment_info;
+    int64_t sequence;
+    int64_t timestamp;
+} ReportHeader;
+
+static GglError encode_report(
+    const ReportHeader *header,
+    GglList components,
+    int64_t chunk_id,
+    int64_t total_chunks,
+    GglByteVec *payload
+) {
+    GglMap payload_map = GGL_MAP(
+        ggl_kv(GGL_STR("ggcVersion"), ggl_obj_buf(GGL_STR(GGL_VERSION))),
+        ggl_kv(GGL_STR("platform"), ggl_obj_buf(GGL_STR("linux"))),
+        ggl_kv(GGL_STR("architecture"), ggl_obj_buf(ARCHITECTURE)),
+        ggl_kv(GGL_STR("runtime"), ggl_obj_buf(GGL_STR("aws_nucleus_lite"))),
+        ggl_kv(GGL_STR("thing"), ggl_obj_buf(header->thing_name)),
+        ggl_kv(GGL_STR("sequenceNumber"), ggl_obj_i64(header->sequence)),
+        ggl_kv(GGL_STR("timestamp"), ggl_obj_i64(header->timestamp)),
+        ggl_kv(GGL_STR("messageType"), ggl_obj_buf(header->message_type)),
+        ggl_kv(GGL_STR("trigger"), ggl_obj_buf(header->trigger)),
+        ggl_kv(
+            GGL_STR("overallDeviceStatus"),
+            ggl_obj_buf(header->overall_device_status)
+        ),
+        ggl_kv(GGL_STR("components"), ggl_obj_list(components)),
+        ggl_kv(
+            GGL_STR("deploymentInformation"),
+            ggl_obj_map(header->deployment_info)
+        ),
+        ggl_kv(
+            GGL_STR("chunkInfo"),
+            ggl_obj_map(GGL_MAP(
+                ggl_kv(GGL_STR("chunkId"), ggl_obj_i64(chunk_id)),
+                ggl_kv(GGL_STR("totalChunks"), ggl_obj_i64(total_chunks))
+            ))
+        )
+    );
+    // Single message reports are sent without chunk info
+    if (total_chunks == 1) {
+        payload_map.len -= 1;
+    }
+
+    payload->buf.len = 0;
+    return ggl_json_encode(
+        ggl_obj_map(payload_map), ggl_byte_vec_writer(payload)
+    );
+}
+
+static GglError next_sequence_number(int64_t *next) {
+    if (!sequence_loaded) {
+        // check for a persisted sequence number
+        uint8_t sequence_mem[16];
+        GglArena alloc = ggl_arena_init(GGL_BUF(sequence_mem));
+        GglObject sequence_obj;
+        GglError ret = ggl_gg_config_read(
+            GGL_BUF_LIST(
+                GGL_STR("services"),
+                GGL_STR("FleetStatusService"),
+                GGL_STR("sequenceNumber")
+            ),
+            &alloc,
+            &sequence_obj
         );
-        component_info.pairs = component_infos[component_count];
+        if ((ret == GGL_ERR_OK)
+            && (ggl_obj_type(sequence_obj) == GGL_TYPE_I64)) {
+            sequence = ggl_obj_into_i64(sequence_obj);
+        }
+        sequence_loaded = true;
+    }
+
+    // set the current sequence number in the config
+    GglError ret = ggl_gg_config_write(
+        GGL_BUF_LIST(
+            GGL_STR("services"),
+            GGL_STR("FleetStatusService"),
+            GGL_STR("sequenceNumber")
+        ),
+        ggl_obj_i64(sequence + 1),
+        &(int64_t) { 0 }
+    );
+    if (ret != GGL_ERR_OK) {
+        GGL_LOGE("Failed to write sequence number to configuration.");
+        return ret;
+    }
+    sequence += 1;
+    *next = sequence;
+    return GGL_ERR_OK;
+}
 
-        // store component info
-        ret = ggl_obj_vec_push(
-            &component_statuses, ggl_obj_map(component_info)
+/// Splits selected components into chunks that fit in a payload.
+/// Requires cache_mtx.
+static GglError plan_chunks(
+    const ReportHeader *header,
+    const size_t *selected,
+    size_t selected_count,
+    size_t *chunk_ends,
+    size_t *chunk_count
+) {
+    static uint8_t scratch_mem[PAYLOAD_BUFFER_LEN];
+    GglByteVec scratch = GGL_BYTE_VEC(scratch_mem);
+
+    // Worst case size of the header, with chunk info
+    GglError ret = encode_report(
+        header, GGL_LIST(), INT32_MAX, INT32_MAX, &scratch
+    );
+    if (ret != GGL_ERR_OK) {
+        GGL_LOGE("Fleet status report header does not fit in a message.");
+        return ret;
+    }
+    size_t base_len = scratch.buf.len;
+
+    size_t count = 0;
+    size_t chunk_len = base_len;
+    for (size_t i = 0; i < selected_count; i++) {
+        GglKV kvs[5];
+        GglObject info = component_info_obj(&cache[selected[i]], kvs);
+        scratch.buf.len = 0;
+        ret = ggl_json_encode(info, ggl_byte_vec_writer(&scratch));
+        // Includes separating comma
+        size_t info_len = scratch.buf.len + 1;
+        if ((ret != GGL_ERR_OK) || (base_len + info_len > PAYLOAD_BUFFER_LEN)) {
+            GGL_LOGE("Component status too large to report.");
+            return GGL_ERR_NOMEM;
+        }
+        if ((chunk_len + info_len > PAYLOAD_BUFFER_LEN) && (i > 0)) {
+            chunk_ends[count] = i;
+            count += 1;
+            chunk_len = base_len;
+        }
+        chunk_len += info_len;
+    }
+    chunk_ends[count] = selected_count;
+    *chunk_count = count + 1;
+    return GGL_ERR_OK;
+}
+
+static GglError publish_report(
+    const ReportHeader *header,
+    const size_t *selected,
+    size_t selected_count,
+    GglBuffer topic
+) {
+    static size_t chunk_ends[GGL_MAX_GENERIC_COMPONENTS + 1];
+    static GglKV component_infos[GGL_MAX_GENERIC_COMPONENTS][5];
+    static GglObject component_objs[GGL_MAX_GENERIC_COMPONENTS];
+    static uint8_t payload_buf[PAYLOAD_BUFFER_LEN];
+
+    size_t chunk_count = 0;
+    {
+        GGL_MTX_SCOPE_GUARD(&cache_mtx);
+        GglError ret = plan_chunks(
+            header, selected, selected_count, chunk_ends, &chunk_count
         );
         if (ret != GGL_ERR_OK) {
-            GGL_LOGE(
-                "Failed to add component info for %.*s to component list with "
-                "error %s. Cannot publish fleet status update for this "
-                "component.",
-                (int) component.len,
-                component.data,
-                ggl_strerror(ret)
+            return ret;
+        }
+    }
+
+    size_t start = 0;
+    for (size_t chunk = 0; chunk < chunk_count; chunk++) {
+        size_t end = chunk_ends[chunk];
+        GglByteVec payload = GGL_BYTE_VEC(payload_buf);
+
+        {
+            GGL_MTX_SCOPE_GUARD(&cache_mtx);
+            for (size_t i = start; i < end; i++) {
+                component_objs[i - start] = component_info_obj(
+                    &cache[selected[i]], component_infos[i - start]
+                );
+            }
+            GglError ret = encode_report(
+                header,
+                (GglList) { .items = component_objs, .len = end - start },
+                (int64_t) chunk + 1,
+                (int64_t) chunk_count,
+                &payload
             );
-            continue;
+            if (ret != GGL_ERR_OK) {
+                return ret;
+            }
         }
 
-        component_count++;
+        GglError ret = ggl_aws_iot_mqtt_publish(
+            GGL_STR("aws_iot_mqtt"), topic, payload.buf, 0, false
+        );
+        if (ret != GGL_ERR_OK) {
+            return ret;
+        }
+        start = end;
     }
-    assert(component_count == component_statuses.list.len);
 
-    GglBuffer overall_device_status;
-    if (device_healthy) {
-        overall_device_status = GGL_STR("HEALTHY");
-    } else {
-        overall_device_status = GGL_STR("UNHEALTHY");
+    if (chunk_count > 1) {
+        GGL_LOGD("Published update in %zu messages.", chunk_count);
     }
+    return GGL_ERR_OK;
+}
 
-    int64_t timestamp;
-    struct timespec now;
-    clock_gettime(CLOCK_REALTIME, &now);
-    timestamp = (int64_t) now.tv_sec * 1000 + now.tv_nsec / 1000000;
-
+static GglError publish_fleet_status_update_locked(
+    GglBuffer thing_name,
+    GglBuffer trigger,
+    GglMap deployment_info,
+    bool skip_if_unchanged
+) {
     // build topic name
     if (thing_name.len > MAX_THING_NAME_LEN) {
         GGL_LOGE("Thing name too long.");
@@ -243,76 +883,204 @@ GglError publish_fleet_status_update(
 
     static uint8_t topic_buf[TOPIC_BUFFER_LEN];
     GglByteVec topic_vec = GGL_BYTE_VEC(topic_buf);
-    ret = ggl_byte_vec_append(&topic_vec, GGL_STR(TOPIC_PREFIX));
+    GglError ret = ggl_byte_vec_append(&topic_vec, GGL_STR(TOPIC_PREFIX));
     ggl_byte_vec_chain_append(&ret, &topic_vec, thing_name);
     ggl_byte_vec_chain_append(&ret, &topic_vec, GGL_STR(TOPIC_SUFFIX));
     if (ret != GGL_ERR_OK) {
         return ret;
     }
 
-    // check for a persisted sequence number
-    GglObject sequence_obj;
-    ret = ggl_gg_config_read(
-        GGL_BUF_LIST(
-            GGL_STR("services"),
-            GGL_STR("FleetStatusService"),
-            GGL_STR("sequenceNumber")
-        ),
-        &alloc,
-        &sequence_obj
-    );
-    int64_t sequence = 1;
-    if ((ret == GGL_ERR_OK) && (ggl_obj_type(sequence_obj) == GGL_TYPE_I64)) {
-        // if sequence number found, increment it
-        sequence = ggl_obj_into_i64(sequence_obj) + 1;
+    bool complete = is_complete_trigger(trigger);
+    if (complete) {
+        // Periodic and connection reports resync the whole cache
+        invalidate_cache();
     }
-    // set the current sequence number in the config
-    ret = ggl_gg_config_write(
-        GGL_BUF_LIST(
-            GGL_STR("services"),
-            GGL_STR("FleetStatusService"),
-            GGL_STR("sequenceNumber")
-        ),
-        ggl_obj_i64(sequence),
-        &(int64_t) { 0 }
-    );
+
+    ret = refresh_component_list();
     if (ret != GGL_ERR_OK) {
-        GGL_LOGE("Failed to write sequence number to configuration.");
         return ret;
     }
+    // Before statuses are read, so that no later change is missed
+    subscribe_health();
 
-    GglObject payload_obj = ggl_obj_map(GGL_MAP(
-        ggl_kv(GGL_STR("ggcVersion"), ggl_obj_buf(GGL_STR(GGL_VERSION))),
-        ggl_kv(GGL_STR("platform"), ggl_obj_buf(GGL_STR("linux"))),
-        ggl_kv(GGL_STR("architecture"), ggl_obj_buf(ARCHITECTURE)),
-        ggl_kv(GGL_STR("runtime"), ggl_obj_buf(GGL_STR("aws_nucleus_lite"))),
-        ggl_kv(GGL_STR("thing"), ggl_obj_buf(thing_name)),
-        ggl_kv(GGL_STR("sequenceNumber"), ggl_obj_i64(sequence)),
-        ggl_kv(GGL_STR("timestamp"), ggl_obj_i64(timestamp)),
-        ggl_kv(GGL_STR("messageType"), ggl_obj_buf(GGL_STR("COMPLETE"))),
-        ggl_kv(GGL_STR("trigger"), ggl_obj_buf(trigger)),
-        ggl_kv(
-            GGL_STR("overallDeviceStatus"), ggl_obj_buf(overall_device_status)
-        ),
-        ggl_kv(GGL_STR("components"), ggl_obj_list(component_statuses.list)),
-        ggl_kv(GGL_STR("deploymentInformation"), ggl_obj_map(deployment_info))
-    ));
+    static size_t selected[GGL_MAX_GENERIC_COMPONENTS];
+    size_t selected_count = 0;
+    bool device_healthy = true;
 
-    // build payload
-    static uint8_t payload_buf[PAYLOAD_BUFFER_LEN];
-    GglByteVec payload = GGL_BYTE_VEC(payload_buf);
-    ret = ggl_json_encode(payload_obj, ggl_byte_vec_writer(&payload));
+    size_t count;
+    {
+        GGL_MTX_SCOPE_GUARD(&cache_mtx);
+        count = cache_len;
+        complete = complete || !complete_reported || components_removed;
+    }
+
+    fetch_statuses(count);
+    for (size_t i = 0; i < count; i++) {
+        if (refresh_entry(i) != GGL_ERR_OK) {
+            continue;
+        }
+
+        GGL_MTX_SCOPE_GUARD(&cache_mtx);
+        CachedComponent *entry = &cache[i];
+        // if a component is broken, mark the device as unhealthy
+        if (ggl_buffer_eq(entry_status(entry), GGL_STR("BROKEN"))) {
+            device_healthy = false;
+        }
+        if (complete || entry->changed) {
+            selected[selected_count] = i;
+            selected_count += 1;
+        }
+    }
+
+    if (!complete && skip_if_unchanged && (selected_count == 0)) {
+        GGL_LOGD("No component status changes to report.");
+        return GGL_ERR_OK;
+    }
+
+    int64_t sequence_number;
+    ret = next_sequence_number(&sequence_number);
     if (ret != GGL_ERR_OK) {
         return ret;
     }
 
-    ret = ggl_aws_iot_mqtt_publish(
-        GGL_STR("aws_iot_mqtt"), topic_vec.buf, payload.buf, 0, false
-    );
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    ReportHeader header = {
+        .thing_name = thing_name,
+        .trigger = trigger,
+        .message_type = complete ? GGL_STR("COMPLETE") : GGL_STR("PARTIAL"),
+        .overall_device_status
+        = device_healthy ? GGL_STR("HEALTHY") : GGL_STR("UNHEALTHY"),
+        .deployment_info = deployment_info,
+        .sequence = sequence_number,
+        .timestamp = (int64_t) now.tv_sec * 1000 + now.tv_nsec / 1000000,
+    };
+
+    ret = publish_report(&header, selected, selected_count, topic_vec.buf);
     if (ret != GGL_ERR_OK) {
         return ret;
     }
 
-    GGL_LOGI("Published update.");
+    {
+        GGL_MTX_SCOPE_GUARD(&cache_mtx);
+        for (size_t i = 0; i < selected_count; i++) {
+            cache[selected[i]].changed = false;
+        }
+        if (complete) {
+            complete_reported = true;
+            components_removed = false;
+        }
+    }
+
+    GGL_LOGI("Published %s update.", complete ? "complete" : "partial");
+    return GGL_ERR_OK;
+}
+
+GglError publish_fleet_status_update(
+    GglBuffer thing_name, GglBuffer trigger, GglMap deployment_info
+) {
+    GGL_MTX_SCOPE_GUARD(&report_mtx);
+    return publish_fleet_status_update_locked(
+        thing_name, trigger, deployment_info, false
+    );
+}
+
+static void *fleet_status_report_thread(void *ctx) {
+    (void) ctx;
+
+    while (true) {
+        GglBuffer trigger = { 0 };
+        bool change = false;
+        {
+            GGL_MTX_SCOPE_GUARD(&pending_mtx);
+            while (!pending_change && (pending_trigger.len == 0)) {
+                pthread_cond_wait(&pending_cond, &pending_mtx);
+            }
+
+            if (pending_trigger.len == 0) {
+                // Collect bursts of changes into one report
+                struct timespec deadline;
+                clock_gettime(CLOCK_MONOTONIC, &deadline);
+                deadline.tv_sec += GGL_FLEET_STATUS_COALESCE_MS / 1000;
+                deadline.tv_nsec
+                    += (long) (GGL_FLEET_STATUS_COALESCE_MS % 1000) * 1000000;
+                if (deadline.tv_nsec >= 1000000000) {
+                    deadline.tv_sec += 1;
+                    deadline.tv_nsec -= 1000000000;
+                }
+                while (pending_trigger.len == 0) {
+                    int ret = pthread_cond_timedwait(
+                        &pending_cond, &pending_mtx, &deadline
+                    );
+                    if (ret == ETIMEDOUT) {
+                        break;
+                    }
+                }
+            }
+
+            trigger = pending_trigger;
+            change = pending_change;
+            pending_trigger = (GglBuffer) { 0 };
+            pending_change = false;
+        }
+
+        if (trigger.len == 0) {
+            trigger = GGL_STR("COMPONENT_STATUS_CHANGE");
+            GGL_MTX_SCOPE_GUARD(&cache_mtx);
+            for (size_t i = 0; i < cache_len; i++) {
+                if (cache[i].changed
+                    && ggl_buffer_eq(entry_status(&cache[i]), GGL_STR("BROKEN"))
+                ) {
+                    trigger = GGL_STR("BROKEN_COMPONENT");
+                    break;
+                }
+            }
+        }
+
+        GGL_LOGD(
+            "Sending %.*s fleet status update.", (int) trigger.len, trigger.data
+        );
+        GGL_MTX_SCOPE_GUARD(&report_mtx);
+        GglError ret = publish_fleet_status_update_locked(
+            report_thing_name, trigger, GGL_MAP(), change
+        );
+        if (ret != GGL_ERR_OK) {
+            GGL_LOGE("Failed to publish fleet status update.");
+        }
+    }
+
+    return NULL;
+}
+
+GglError fleet_status_service_init(GglBuffer thing_name) {
+    report_thing_name = thing_name;
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&pending_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    GglError ret = ggl_gg_config_subscribe(
+        GGL_BUF_LIST(GGL_STR("services")),
+        config_callback,
+        config_close_callback,
+        NULL,
+        NULL
+    );
+    if (ret != GGL_ERR_OK) {
+        // Full reports still re-read all config
+        GGL_LOGW("Failed to subscribe to services config changes.");
+    }
+
+    pthread_t ptid;
+    int sys_ret = pthread_create(&ptid, NULL, fleet_status_report_thread, NULL);
+    if (sys_ret != 0) {
+        GGL_LOGE("Failed to create fleet status report thread: %d.", sys_ret);
+        return GGL_ERR_FATAL;
+    }
+    pthread_detach(ptid);
+
     return GGL_ERR_OK;
 }
@@ -11,8 +11,18 @@
 
 #define MAX_THING_NAME_LEN 128
 
+/// Starts tracking component status and the coalescing report thread.
+GglError fleet_status_service_init(GglBuffer thing_name);
+
+/// Publishes a fleet status report.
+/// Connection and periodic triggers send a complete report; others only
+/// report components that changed since the last report.
 GglError publish_fleet_status_update(
     GglBuffer thing_name, GglBuffer trigger, GglMap deployment_info
 );
 
+/// Queues a report to be sent from the report thread.
+/// Safe to call from core bus subscription callbacks.
+void request_fleet_status_update(GglBuffer trigger);
+
 #endif // GG_FLEET_STATUSD_FLEET_STATUS_SERVICE_H
@@ -9,6 +9,7 @@
 #include <ggl/error.h>
 #include <ggl/object.h>
 #include <ggl/vector.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 // TODO: we could save this static memory by having json decoding done as we
@@ -25,6 +26,25 @@ GglError ggconfig_get_value_from_key(GglList *key_path, GglObject *value);
 GglError ggconfig_list_subkeys(GglList *key_path, GglList *subkeys);
 GglError ggconfig_get_key_notification(GglList *key_path, uint32_t handle);
 GglError ggconfig_open(void);
+
+/// Group subsequent writes into a single transaction until
+/// ggconfig_end_batch. Writes inside the batch are rolled back individually on
+/// failure; ggconfig_end_batch commits or discards the whole batch.
+GglError ggconfig_begin_batch(void);
+GglError ggconfig_end_batch(bool commit);
+
+/// Recorded state of an imported config file, used to skip unchanged files.
+typedef struct {
+    int64_t size;
+    int64_t mtime;
+    uint64_t hash;
+} GgconfigImportState;
+
+/// Returns GGL_ERR_NOENTRY if the file has not been imported.
+GglError ggconfig_get_import_state(GglBuffer path, GgconfigImportState *state);
+GglError ggconfig_set_import_state(
+    GglBuffer path, const GgconfigImportState *state
+);
 GglError ggconfig_close(void);
 
 void ggconfigd_start_server(void);
@@ -15,25 +15,62 @@
 #include <ggl/object.h>
 #include <ggl/vector.h>
 #include <ggl/yaml_decode.h>
+#include <limits.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <stdalign.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
-static GglError ggconfig_load_file_fd(int fd) {
-    static uint8_t file_mem[8192];
-    GglBuffer config_file = GGL_BUF(file_mem);
+// Arena bytes per byte of config file: a map entry plus alignment padding
+#define DECODE_BYTES_PER_FILE_BYTE (sizeof(GglKV) + alignof(GglKV))
 
-    GglError ret = ggl_file_read(fd, &config_file);
-    if (ret != GGL_ERR_OK) {
-        GGL_LOGE("Failed to read config file.");
-        return GGL_ERR_FAILURE;
+static uint64_t hash_file(GglBuffer content) {
+    // FNV-1a; only used to detect changed files
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < content.len; i++) {
+        hash ^= content.data[i];
+        hash *= 1099511628211ULL;
     }
+    return hash;
+}
 
-    static uint8_t decode_mem[500 * sizeof(GglObject)];
-    GglArena alloc = ggl_arena_init(GGL_BUF(decode_mem));
+static void cleanup_munmap(GglBuffer *mapping) {
+    if (mapping->len > 0) {
+        (void) munmap(mapping->data, mapping->len);
+    }
+}
+
+static GglError merge_config_file(GglBuffer config_file) {
+    // Every map entry and list item takes at least one byte of the file, so
+    // this fits any file without aliases; decoding fails if aliases expand
+    // past it. Pages the decoder does not touch are not committed.
+    if (config_file.len >= UINT32_MAX / DECODE_BYTES_PER_FILE_BYTE) {
+        GGL_LOGE("Config file too large.");
+        return GGL_ERR_NOMEM;
+    }
+    size_t decode_len = (config_file.len + 1) * DECODE_BYTES_PER_FILE_BYTE;
+    void *decode_mem = mmap(
+        NULL,
+        decode_len,
+        PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+        -1,
+        0
+    );
+    if (decode_mem == MAP_FAILED) {
+        GGL_LOGE("Failed to allocate memory to decode config file.");
+        return GGL_ERR_NOMEM;
+    }
+    GglBuffer decode_buf = { .data = decode_mem, .len = decode_len };
+    GGL_CLEANUP(cleanup_munmap, decode_buf);
+    GglArena alloc = ggl_arena_init(decode_buf);
 
     GglObject config_obj;
-    ret = ggl_yaml_decode_destructive(config_file, &alloc, &config_obj);
+    GglError ret
+        = ggl_yaml_decode_destructive(config_file, &alloc, &config_obj);
     if (ret != GGL_ERR_OK) {
         GGL_LOGE("Failed to parse config file.");
         return GGL_ERR_FAILURE;
@@ -47,18 +84,78 @@ static GglError ggconfig_load_file_fd(int fd) {
     );
 
     if (ggl_obj_type(config_obj) == GGL_TYPE_MAP) {
-        ret = ggconfig_process_map(&key_path, ggl_obj_into_map(config_obj), 2);
-        if (ret != GGL_ERR_OK) {
-            return ret;
-        }
-    } else {
-        ret = ggconfig_process_nonmap(&key_path, config_obj, 2);
-        if (ret != GGL_ERR_OK) {
-            return ret;
+        return ggconfig_process_map(
+            &key_path, ggl_obj_into_map(config_obj), 2
+        );
+    }
+    return ggconfig_process_nonmap(&key_path, config_obj, 2);
+}
+
+static GglError ggconfig_load_file_fd(int fd, GglBuffer path) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        GGL_LOGE("Failed to stat config file.");
+        return GGL_ERR_FAILURE;
+    }
+
+    GgconfigImportState state = {
+        .size = st.st_size,
+        .mtime = (int64_t) st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec,
+    };
+
+    GgconfigImportState prev_state;
+    GglError ret = ggconfig_get_import_state(path, &prev_state);
+    bool imported = ret == GGL_ERR_OK;
+    if (imported && (prev_state.size == state.size)
+        && (prev_state.mtime == state.mtime)) {
+        GGL_LOGD(
+            "Config file %.*s unchanged, skipping.", (int) path.len, path.data
+        );
+        return GGL_ERR_OK;
+    }
+
+    // Mapped privately as decoding modifies the buffer
+    GglBuffer config_file = { 0 };
+    if (st.st_size > 0) {
+        void *mapping = mmap(
+            NULL,
+            (size_t) st.st_size,
+            PROT_READ | PROT_WRITE,
+            MAP_PRIVATE,
+            fd,
+            0
+        );
+        if (mapping == MAP_FAILED) {
+            GGL_LOGE("Failed to read config file.");
+            return GGL_ERR_FAILURE;
         }
+        config_file = (GglBuffer) { .data = mapping,
+                                    .len = (size_t) st.st_size };
+    }
+    GGL_CLEANUP(cleanup_munmap, config_file);
+
+    state.hash = hash_file(config_file);
+    if (imported && (prev_state.size == state.size)
+        && (prev_state.hash == state.hash)) {
+        GGL_LOGD(
+            "Config file %.*s content unchanged, skipping.",
+            (int) path.len,
+            path.data
+        );
+        return ggconfig_set_import_state(path, &state);
     }
 
-    return GGL_ERR_OK;
+    // Merge the whole file in one transaction instead of one per value
+    ret = ggconfig_begin_batch();
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+    ret = merge_config_file(config_file);
+    if (ret == GGL_ERR_OK) {
+        ret = ggconfig_set_import_state(path, &state);
+    }
+    GglError end_ret = ggconfig_end_batch(ret == GGL_ERR_OK);
+    return (ret != GGL_ERR_OK) ? ret : end_ret;
 }
 
 GglError ggconfig_load_file(GglBuffer path) {
@@ -71,7 +168,7 @@ GglError ggconfig_load_file(GglBuffer path) {
     }
     GGL_CLEANUP(cleanup_close, fd);
 
-    return ggconfig_load_file_fd(fd);
+    return ggconfig_load_file_fd(fd, path);
 }
 
 GglError ggconfig_load_dir(GglBuffer path) {
@@ -93,6 +190,7 @@ GglError ggconfig_load_dir(GglBuffer path) {
     }
     GGL_CLEANUP(cleanup_closedir, dir);
 
+    GglError first_error = GGL_ERR_OK;
     while (true) {
         // Directory stream is not shared between threads.
         // NOLINTNEXTLINE(concurrency-mt-unsafe)
@@ -113,14 +211,38 @@ GglError ggconfig_load_dir(GglBuffer path) {
                 &fd
             );
             if (ret != GGL_ERR_OK) {
-                GGL_LOGW("Failed to open config file.");
-                break;
+                GGL_LOGW("Failed to open config file %s.", entry->d_name);
+                first_error = (first_error == GGL_ERR_OK) ? ret : first_error;
+                continue;
             }
             GGL_CLEANUP(cleanup_close, fd);
 
-            (void) ggconfig_load_file_fd(fd);
+            // Import state is keyed by the file's full path
+            static uint8_t file_path_mem[PATH_MAX];
+            GglByteVec file_path = GGL_BYTE_VEC(file_path_mem);
+            ret = ggl_byte_vec_append(&file_path, path);
+            ggl_byte_vec_chain_push(&ret, &file_path, '/');
+            ggl_byte_vec_chain_append(
+                &ret, &file_path, ggl_buffer_from_null_term(entry->d_name)
+            );
+            if (ret != GGL_ERR_OK) {
+                GGL_LOGW("Config file path too long.");
+                first_error = (first_error == GGL_ERR_OK) ? ret : first_error;
+                continue;
+            }
+
+            ret = ggconfig_load_file_fd(fd, file_path.buf);
+            if (ret != GGL_ERR_OK) {
+                // Keep importing the remaining files
+                GGL_LOGE(
+                    "Failed to import config file %s: %s.",
+                    entry->d_name,
+                    ggl_strerror(ret)
+                );
+                first_error = (first_error == GGL_ERR_OK) ? ret : first_error;
+            }
         }
     }
 
-    return GGL_ERR_OK;
+    return first_error;
 }
@@ -39,6 +39,10 @@ static bool config_initialized = false;
 static sqlite3 *config_database;
 static const char *config_database_name = "config.db";
 
+/// True while a batch (e.g. a config file import) is open. Writes inside a
+/// batch use savepoints so that the whole batch commits as one transaction.
+static bool batch_active = false;
+
 static void sqlite_logger(void *ctx, int err_code, const char *str) {
     (void) ctx;
     (void) err_code;
@@ -124,6 +128,19 @@ GglError ggconfig_open(void) {
             sqlite3_free(err_message);
             return_err = GGL_ERR_FAILURE;
         }
+        // Also applies to databases created before import tracking existed
+        rc = sqlite3_exec(
+            config_database,
+            GGL_SQL_CREATE_IMPORT_TABLE,
+            NULL,
+            NULL,
+            &err_message
+        );
+        if (rc) {
+            GGL_LOGE("Failed to create import table %s", err_message);
+            sqlite3_free(err_message);
+            return_err = GGL_ERR_FAILURE;
+        }
         config_initialized = true;
     } else {
         return_err = GGL_ERR_OK;
@@ -131,6 +148,140 @@ GglError ggconfig_open(void) {
     return return_err;
 }
 
+static void transaction_begin(void) {
+    sqlite3_exec(
+        config_database,
+        batch_active ? "SAVEPOINT write" : "BEGIN TRANSACTION",
+        NULL,
+        NULL,
+        NULL
+    );
+}
+
+static void transaction_end(void) {
+    sqlite3_exec(
+        config_database,
+        batch_active ? "RELEASE write" : "END TRANSACTION",
+        NULL,
+        NULL,
+        NULL
+    );
+}
+
+static void transaction_rollback(void) {
+    sqlite3_exec(
+        config_database,
+        batch_active ? "ROLLBACK TO write; RELEASE write" : "ROLLBACK",
+        NULL,
+        NULL,
+        NULL
+    );
+}
+
+GglError ggconfig_begin_batch(void) {
+    assert(!batch_active);
+    int rc = sqlite3_exec(
+        config_database, "BEGIN TRANSACTION", NULL, NULL, NULL
+    );
+    if (rc != SQLITE_OK) {
+        GGL_LOGE(
+            "Failed to begin transaction: %s", sqlite3_errmsg(config_database)
+        );
+        return GGL_ERR_FAILURE;
+    }
+    batch_active = true;
+    return GGL_ERR_OK;
+}
+
+GglError ggconfig_end_batch(bool commit) {
+    assert(batch_active);
+    batch_active = false;
+    int rc = sqlite3_exec(
+        config_database,
+        commit ? "END TRANSACTION" : "ROLLBACK",
+        NULL,
+        NULL,
+        NULL
+    );
+    if (rc != SQLITE_OK) {
+        GGL_LOGE(
+            "Failed to end transaction: %s", sqlite3_errmsg(config_database)
+        );
+        (void) sqlite3_exec(config_database, "ROLLBACK", NULL, NULL, NULL);
+        return GGL_ERR_FAILURE;
+    }
+    return GGL_ERR_OK;
+}
+
+GglError ggconfig_get_import_state(
+    GglBuffer path, GgconfigImportState *state
+) {
+    sqlite3_stmt *stmt;
+    int rc = sqlite3_prepare_v2(
+        config_database, GGL_SQL_GET_IMPORT_STATE, -1, &stmt, NULL
+    );
+    if (rc != SQLITE_OK) {
+        GGL_LOGE(
+            "Failed to prepare import state query: %s",
+            sqlite3_errmsg(config_database)
+        );
+        return GGL_ERR_FAILURE;
+    }
+    GGL_CLEANUP(cleanup_sqlite3_finalize, stmt);
+    sqlite3_bind_text(
+        stmt, 1, (char *) path.data, (int) path.len, SQLITE_STATIC
+    );
+
+    rc = sqlite3_step(stmt);
+    if (rc == SQLITE_DONE) {
+        return GGL_ERR_NOENTRY;
+    }
+    if (rc != SQLITE_ROW) {
+        GGL_LOGE(
+            "Failed to read import state: %s", sqlite3_errmsg(config_database)
+        );
+        return GGL_ERR_FAILURE;
+    }
+    *state = (GgconfigImportState) {
+        .size = sqlite3_column_int64(stmt, 0),
+        .mtime = sqlite3_column_int64(stmt, 1),
+        .hash = (uint64_t) sqlite3_column_int64(stmt, 2),
+    };
+    return GGL_ERR_OK;
+}
+
+GglError ggconfig_set_import_state(
+    GglBuffer path, const GgconfigImportState *state
+) {
+    sqlite3_stmt *stmt;
+    int rc = sqlite3_prepare_v2(
+        config_database, GGL_SQL_SET_IMPORT_STATE, -1, &stmt, NULL
+    );
+    if (rc != SQLITE_OK) {
+        GGL_LOGE(
+            "Failed to prepare import state update: %s",
+            sqlite3_errmsg(config_database)
+        );
+        return GGL_ERR_FAILURE;
+    }
+    GGL_CLEANUP(cleanup_sqlite3_finalize, stmt);
+    sqlite3_bind_text(
+        stmt, 1, (char *) path.data, (int) path.len, SQLITE_STATIC
+    );
+    sqlite3_bind_int64(stmt, 2, state->size);
+    sqlite3_bind_int64(stmt, 3, state->mtime);
+    sqlite3_bind_int64(stmt, 4, (int64_t) state->hash);
+
+    rc = sqlite3_step(stmt);
+    if (rc != SQLITE_DONE) {
+        GGL_LOGE(
+            "Failed to record import state: %s", sqlite3_errmsg(config_database)
+        );
+        return GGL_ERR_FAILURE;
+    }
+    return GGL_ERR_OK;
+}
+
 GglError ggconfig_close(void) {
     sqlite3_close(config_database);
     config_initialized = false;
@@ -620,6 +771,9 @@ static GglError notify_single_key(
         notify_key_id,
         print_key_path(changed_key_path)
     );
+    // Notification is encoded once for all subscribers
+    static uint32_t handles[GGL_COREBUS_MAX_CLIENTS];
+    size_t handles_len = 0;
     do {
         rc = sqlite3_step(stmt);
         switch (rc) {
@@ -629,7 +783,14 @@ static GglError notify_single_key(
         case SQLITE_ROW: {
             uint32_t handle = (uint32_t) sqlite3_column_int64(stmt, 0);
             GGL_LOGT("Sending to %u", handle);
-            ggl_sub_respond(handle, ggl_obj_list(*changed_key_path));
+            if (handles_len == GGL_COREBUS_MAX_CLIENTS) {
+                ggl_sub_respond_multicast(
+                    handles, handles_len, ggl_obj_list(*changed_key_path)
+                );
+                handles_len = 0;
+            }
+            handles[handles_len] = handle;
+            handles_len += 1;
         } break;
         default:
             GGL_LOGE(
@@ -639,11 +800,17 @@ static GglError notify_single_key(
                 notify_key_id,
                 sqlite3_errmsg(config_database)
             );
+            ggl_sub_respond_multicast(
+                handles, handles_len, ggl_obj_list(*changed_key_path)
+            );
             return GGL_ERR_FAILURE;
             break;
         }
     } while (rc == SQLITE_ROW);
 
+    ggl_sub_respond_multicast(
+        handles, handles_len, ggl_obj_list(*changed_key_path)
+    );
     return GGL_ERR_OK;
 }
 
@@ -667,7 +834,7 @@ GglError ggconfig_write_empty_map(GglList *key_path) {
         return GGL_ERR_FAILURE;
     }
 
-    sqlite3_exec(config_database, "BEGIN TRANSACTION", NULL, NULL, NULL);
+    transaction_begin();
     GGL_LOGT(
         "Starting transaction to write an empty map to key %s",
         print_key_path(key_path)
@@ -682,10 +849,10 @@ GglError ggconfig_write_empty_map(GglList *key_path) {
         ids.list.len = 0; // Reset the ids vector to be populated fresh
         err = create_key_path(key_path, &ids);
         if (err != GGL_ERR_OK) {
-            sqlite3_exec(config_database, "ROLLBACK", NULL, NULL, NULL);
+            transaction_rollback();
             return err;
         }
-        sqlite3_exec(config_database, "END TRANSACTION", NULL, NULL, NULL);
+        transaction_end();
         return GGL_ERR_OK;
     }
     if (err != GGL_ERR_OK) {
@@ -694,7 +861,7 @@ GglError ggconfig_write_empty_map(GglList *key_path) {
             print_key_path(key_path),
             ggl_strerror(err)
         );
-        sqlite3_exec(config_database, "ROLLBACK", NULL, NULL, NULL);
+        transaction_rollback();
         return err;
     }
 
@@ -703,7 +870,7 @@ GglError ggconfig_write_empty_map(GglList *key_path) {
     bool value_is_present;
     err = value_is_present_for_key(last_key_id, &value_is_present);
     if (err != GGL_ERR_OK) {
-        sqlite3_exec(config_database, "ROLLBACK", NULL, NULL, NULL);
+        transaction_rollback();
         return err;
     }
     if (value_is_present) {
@@ -713,11 +880,11 @@ GglError ggconfig_write_empty_map(GglList *key_path) {
             print_key_path(key_path),
             last_key_id
         );
-        sqlite3_exec(config_database, "ROLLBACK", NULL, NULL, NULL);
+        transaction_rollback();
         return GGL_ERR_FAILURE;
     }
 
-    sqlite3_exec(config_database, "END TRANSACTION", NULL, NULL, NULL);
+    transaction_end();
     return GGL_ERR_OK;
 }
 
@@ -729,7 +896,7 @@ GglError ggconfig_write_value_at_key(
         return GGL_ERR_FAILURE;
     }
 
-    sqlite3_exec(config_database, "BEGIN TRANSACTION", NULL, NULL, NULL);
+    transaction_begin();
     GGL_LOGT(
         "starting transaction to insert/update key: %s",
         print_key_path(key_path)
@@ -744,17 +911,17 @@ GglError ggconfig_write_value_at_key(
         ids.list.len = 0; // Reset the ids vector to be populated fresh
         err = create_key_path(key_path, &ids);
         if (err != GGL_ERR_OK) {
-            sqlite3_exec(config_database, "ROLLBACK", NULL, NULL, NULL);
+            transaction_rollback();
             return err;
         }
 
         last_key_id = ggl_obj_into_i64(ids.list.items[ids.list.len - 1]);
         err = value_insert(last_key_id, value, timestamp);
         if (err != GGL_ERR_OK) {
-            sqlite3_exec(config_database, "ROLLBACK", NULL, NULL, NULL);
+            transaction_rollback();
             return err;
         }
-        sqlite3_exec(config_database, "END TRANSACTION", NULL, NULL, NULL);
+        transaction_end();
         err = notify_nested_key(key_path, ids);
         if (err != GGL_ERR_OK) {
             GGL_LOGE(
@@ -772,7 +939,7 @@ GglError ggconfig_write_value_at_key(
             print_key_path(key_path),
             ggl_strerror(err)
         );
-        sqlite3_exec(config_database, "ROLLBACK", NULL, NULL, NULL);
+        transaction_rollback();
         return err;
     }
     last_key_id = ggl_obj_into_i64(ids.list.items[ids.list.len - 1]);
@@ -786,7 +953,7 @@ GglError ggconfig_write_value_at_key(
             last_key_id,
             ggl_strerror(err)
         );
-        sqlite3_exec(config_database, "ROLLBACK", NULL, NULL, NULL);
+        transaction_rollback();
         return err;
     }
     if (child_is_present) {
@@ -797,14 +964,14 @@ GglError ggconfig_write_value_at_key(
             print_key_path(key_path),
             last_key_id
         );
-        sqlite3_exec(config_database, "ROLLBACK", NULL, NULL, NULL);
+        transaction_rollback();
         return GGL_ERR_FAILURE;
     }
 
     bool value_is_present;
     err = value_is_present_for_key(last_key_id, &value_is_present);
     if (err != GGL_ERR_OK) {
-        sqlite3_exec(config_database, "ROLLBACK", NULL, NULL, NULL);
+        transaction_rollback();
         return err;
     }
     if (!value_is_present) {
@@ -814,7 +981,7 @@ GglError ggconfig_write_value_at_key(
             print_key_path(key_path),
             last_key_id
         );
-        sqlite3_exec(config_database, "ROLLBACK", NULL, NULL, NULL);
+        transaction_rollback();
         return GGL_ERR_FAILURE;
     }
 
@@ -828,7 +995,7 @@ GglError ggconfig_write_value_at_key(
             last_key_id,
             ggl_strerror(err)
         );
-        sqlite3_exec(config_database, "ROLLBACK", NULL, NULL, NULL);
+        transaction_rollback();
         return err;
     }
     if (existing_timestamp > timestamp) {
@@ -839,7 +1006,7 @@ GglError ggconfig_write_value_at_key(
             existing_timestamp,
             timestamp
         );
-        sqlite3_exec(config_database, "END TRANSACTION", NULL, NULL, NULL);
+        transaction_end();
         return GGL_ERR_OK;
     }
 
@@ -852,10 +1019,10 @@ GglError ggconfig_write_value_at_key(
             last_key_id,
             ggl_strerror(err)
         );
-        sqlite3_exec(config_database, "ROLLBACK", NULL, NULL, NULL);
+        transaction_rollback();
         return err;
     }
-    sqlite3_exec(config_database, "END TRANSACTION", NULL, NULL, NULL);
+    transaction_end();
 
     err = notify_nested_key(key_path, ids);
     if (err != GGL_ERR_OK) {
@@ -1035,7 +1202,7 @@ GglError ggconfig_get_value_from_key(GglList *key_path, GglObject *value) {
     static uint8_t key_value_memory[GGL_COREBUS_MAX_MSG_LEN];
     GglArena alloc = ggl_arena_init(GGL_BUF(key_value_memory));
 
-    sqlite3_exec(config_database, "BEGIN TRANSACTION", NULL, NULL, NULL);
+    transaction_begin();
     GGL_LOGT("Starting transaction to read key: %s", print_key_path(key_path));
 
     GglObject ids_array[GGL_MAX_OBJECT_DEPTH];
@@ -1043,16 +1210,16 @@ GglError ggconfig_get_value_from_key(GglList *key_path, GglObject *value) {
                       .capacity = GGL_MAX_OBJECT_DEPTH };
     GglError err = get_key_ids(key_path, &ids);
     if (err == GGL_ERR_NOENTRY) {
-        sqlite3_exec(config_database, "END TRANSACTION", NULL, NULL, NULL);
+        transaction_end();
         return GGL_ERR_NOENTRY;
     }
     if (err != GGL_ERR_OK) {
-        sqlite3_exec(config_database, "END TRANSACTION", NULL, NULL, NULL);
+        transaction_end();
         return err;
     }
     int64_t key_id = ggl_obj_into_i64(ids.list.items[ids.list.len - 1]);
     err = read_key_recursive(key_id, value, &alloc);
-    sqlite3_exec(config_database, "END TRANSACTION", NULL, NULL, NULL);
+    transaction_end();
     return err;
 }
 
@@ -1116,7 +1283,7 @@ GglError ggconfig_list_subkeys(GglList *key_path, GglList *subkeys) {
         return GGL_ERR_FAILURE;
     }
 
-    sqlite3_exec(config_database, "BEGIN TRANSACTION", NULL, NULL, NULL);
+    transaction_begin();
     GGL_LOGT(
         "Starting transaction to read subkeys for key: %s",
         print_key_path(key_path)
@@ -1127,11 +1294,11 @@ GglError ggconfig_list_subkeys(GglList *key_path, GglList *subkeys) {
                       .capacity = GGL_MAX_OBJECT_DEPTH };
     GglError err = get_key_ids(key_path, &ids);
     if (err == GGL_ERR_NOENTRY) {
-        sqlite3_exec(config_database, "END TRANSACTION", NULL, NULL, NULL);
+        transaction_end();
         return GGL_ERR_NOENTRY;
     }
     if (err != GGL_ERR_OK) {
-        sqlite3_exec(config_database, "END TRANSACTION", NULL, NULL, NULL);
+        transaction_end();
         return err;
     }
     int64_t key_id = ggl_obj_into_i64(ids.list.items[ids.list.len - 1]);
@@ -1139,7 +1306,7 @@ GglError ggconfig_list_subkeys(GglList *key_path, GglList *subkeys) {
     bool value_is_present;
     err = value_is_present_for_key(key_id, &value_is_present);
     if (err != GGL_ERR_OK) {
-        sqlite3_exec(config_database, "END TRANSACTION", NULL, NULL, NULL);
+        transaction_end();
         return err;
     }
     if (value_is_present) {
@@ -1148,7 +1315,7 @@ GglError ggconfig_list_subkeys(GglList *key_path, GglList *subkeys) {
             "listed.",
             print_key_path(key_path)
         );
-        sqlite3_exec(config_database, "END TRANSACTION", NULL, NULL, NULL);
+        transaction_end();
         return GGL_ERR_INVALID;
     }
 
@@ -1162,11 +1329,11 @@ GglError ggconfig_list_subkeys(GglList *key_path, GglList *subkeys) {
     GglArena alloc = ggl_arena_init(GGL_BUF(key_buffers_memory));
     err = get_children(key_id, &children_ids, &alloc);
     if (err != GGL_ERR_OK) {
-        sqlite3_exec(config_database, "END TRANSACTION", NULL, NULL, NULL);
+        transaction_end();
         return err;
     }
 
-    sqlite3_exec(config_database, "END TRANSACTION", NULL, NULL, NULL);
+    transaction_end();
     subkeys->items = children_ids.list.items;
     subkeys->len = children_ids.list.len;
     return GGL_ERR_OK;
@@ -1296,7 +1463,7 @@ GglError ggconfig_delete_key(GglList *key_path) {
         return GGL_ERR_FAILURE;
     }
 
-    sqlite3_exec(config_database, "BEGIN TRANSACTION", NULL, NULL, NULL);
+    transaction_begin();
     GGL_LOGT("Starting transaction to delete key %s", print_key_path(key_path));
 
     GglObject ids_array[GGL_MAX_OBJECT_DEPTH];
@@ -1304,14 +1471,14 @@ GglError ggconfig_delete_key(GglList *key_path) {
                       .capacity = GGL_MAX_OBJECT_DEPTH };
     GglError err = get_key_ids(key_path, &ids);
     if (err == GGL_ERR_NOENTRY) {
-        sqlite3_exec(config_database, "END TRANSACTION", NULL, NULL, NULL);
+        transaction_end();
         GGL_LOGT(
             "Key %s does not exist, nothing to do", print_key_path(key_path)
         );
         return GGL_ERR_OK;
     }
     if (err != GGL_ERR_OK) {
-        sqlite3_exec(config_database, "ROLLBACK", NULL, NULL, NULL);
+        transaction_rollback();
         return err;
     }
     int64_t key_id = ggl_obj_into_i64(ids.list.items[ids.list.len - 1]);
@@ -1326,10 +1493,28 @@ GglError ggconfig_delete_key(GglList *key_path) {
             .capacity = MAX_CONFIG_DESCENDANTS_PER_COMPONENT };
     err = get_descendants(key_id, &descendant_ids);
     if (err != GGL_ERR_OK) {
-        sqlite3_exec(config_database, "ROLLBACK", NULL, NULL, NULL);
+        transaction_rollback();
         return err;
     }
 
+    // Notify before the subscriptions on deleted keys are removed. Subscribers
+    // can only read the config after this request completes, so they see the
+    // result of the delete.
+    err = notify_nested_key(key_path, ids);
+    for (size_t i = 0; (err == GGL_ERR_OK) && (i < descendant_ids.list.len);
+         i++) {
+        int64_t descendant_id = ggl_obj_into_i64(descendant_ids.list.items[i]);
+        if (descendant_id != key_id) {
+            err = notify_single_key(descendant_id, key_path);
+        }
+    }
+    if (err != GGL_ERR_OK) {
+        GGL_LOGW(
+            "Failed to notify subscribers of deletion of %s.",
+            print_key_path(key_path)
+        );
+    }
+
     for (size_t i = 0; i < descendant_ids.list.len; i++) {
         int64_t descendant_id = ggl_obj_into_i64(descendant_ids.list.items[i]);
         err = delete_subscribers(descendant_id);
@@ -1346,22 +1531,22 @@ GglError ggconfig_delete_key(GglList *key_path) {
         }
         err = delete_value(descendant_id);
         if (err != GGL_ERR_OK) {
-            sqlite3_exec(config_database, "ROLLBACK", NULL, NULL, NULL);
+            transaction_rollback();
             return err;
         }
         err = delete_relations(descendant_id);
         if (err != GGL_ERR_OK) {
-            sqlite3_exec(config_database, "ROLLBACK", NULL, NULL, NULL);
+            transaction_rollback();
             return err;
         }
         err = delete_key(descendant_id);
         if (err != GGL_ERR_OK) {
-            sqlite3_exec(config_database, "ROLLBACK", NULL, NULL, NULL);
+            transaction_rollback();
             return err;
         }
     }
 
-    sqlite3_exec(config_database, "END TRANSACTION", NULL, NULL, NULL);
+    transaction_end();
     return GGL_ERR_OK;
 }
 
@@ -1373,7 +1558,7 @@ GglError ggconfig_get_key_notification(GglList *key_path, uint32_t handle) {
         return GGL_ERR_FAILURE;
     }
 
-    sqlite3_exec(config_database, "BEGIN TRANSACTION", NULL, NULL, NULL);
+    transaction_begin();
     GGL_LOGT(
         "Starting transaction to subscribe to key %s", print_key_path(key_path)
     );
@@ -1385,11 +1570,11 @@ GglError ggconfig_get_key_notification(GglList *key_path, uint32_t handle) {
                       .capacity = GGL_MAX_OBJECT_DEPTH };
     GglError err = get_key_ids(key_path, &ids);
     if (err == GGL_ERR_NOENTRY) {
-        sqlite3_exec(config_database, "ROLLBACK", NULL, NULL, NULL);
+        transaction_rollback();
         return GGL_ERR_NOENTRY;
     }
     if (err != GGL_ERR_OK) {
-        sqlite3_exec(config_database, "ROLLBACK", NULL, NULL, NULL);
+        transaction_rollback();
         return err;
     }
     int64_t key_id = ggl_obj_into_i64(ids.list.items[ids.list.len - 1]);
@@ -1404,7 +1589,7 @@ GglError ggconfig_get_key_notification(GglList *key_path, uint32_t handle) {
     sqlite3_bind_int64(stmt, 1, key_id);
     sqlite3_bind_int64(stmt, 2, handle);
     int rc = sqlite3_step(stmt);
-    sqlite3_exec(config_database, "END TRANSACTION", NULL, NULL, NULL);
+    transaction_end();
     if (SQLITE_DONE != rc) {
         GGL_LOGE("%d %s", rc, sqlite3_errmsg(config_database));
     } else {
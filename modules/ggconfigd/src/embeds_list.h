@@ -28,6 +28,9 @@
     EMBED_FILE(sql/delete_relations.sql, GGL_SQL_DELETE_RELATIONS) \
     EMBED_FILE(sql/delete_subscribers.sql, GGL_SQL_DELETE_SUBSCRIBERS) \
     EMBED_FILE(sql/delete_value.sql, GGL_SQL_DELETE_VALUE) \
-    EMBED_FILE(sql/get_descendants.sql, GGL_SQL_GET_DESCENDANTS)
+    EMBED_FILE(sql/get_descendants.sql, GGL_SQL_GET_DESCENDANTS) \
+    EMBED_FILE(sql/create_import_table.sql, GGL_SQL_CREATE_IMPORT_TABLE) \
+    EMBED_FILE(sql/get_import_state.sql, GGL_SQL_GET_IMPORT_STATE) \
+    EMBED_FILE(sql/set_import_state.sql, GGL_SQL_SET_IMPORT_STATE)
 
 #endif
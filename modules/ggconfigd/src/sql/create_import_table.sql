@@ -0,0 +1,6 @@
+CREATE TABLE IF NOT EXISTS importTable (
+  'path' TEXT PRIMARY KEY NOT NULL,
+  'size' INT NOT NULL,
+  'mtime' INT NOT NULL,
+  'hash' INT NOT NULL
+)
@@ -0,0 +1,8 @@
+SELECT
+  size,
+  mtime,
+  hash
+FROM
+  importTable
+WHERE
+  path = ?;
@@ -0,0 +1,4 @@
+INSERT OR REPLACE INTO
+  importTable (path, size, mtime, hash)
+VALUES
+  (?, ?, ?, ?);
@@ -10,17 +10,83 @@
 #include <ggl/buffer.h>
 #include <ggl/cleanup.h>
 #include <ggl/core_bus/gg_config.h>
+#include <ggl/docker_artifact_cleanup.h>
 #include <ggl/error.h>
 #include <ggl/file.h>
 #include <ggl/log.h>
+#include <ggl/nucleus/constants.h>
+#include <ggl/object.h>
+#include <ggl/recipe.h>
 #include <ggl/semver.h>
+#include <ggl/vector.h>
 #include <limits.h>
+#include <pthread.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
 #include <stdbool.h>
 #include <stdint.h>
 
 #define MAX_PATH_LENGTH 128
 
+/// Maximum number of recipe files tracked by the in-memory index.
+/// Can be configured with `-DGGL_COMPONENT_STORE_MAX_RECIPES=<N>`.
+#ifndef GGL_COMPONENT_STORE_MAX_RECIPES
+#define GGL_COMPONENT_STORE_MAX_RECIPES 256
+#endif
+
+/// Number of parsed recipes kept in memory.
+/// Can be configured with `-DGGL_COMPONENT_STORE_RECIPE_CACHE_SLOTS=<N>`.
+#ifndef GGL_COMPONENT_STORE_RECIPE_CACHE_SLOTS
+#define GGL_COMPONENT_STORE_RECIPE_CACHE_SLOTS 4
+#endif
+
+#define MAX_VERSION_LEN 64
+
+static const GglBuffer RECIPE_EXTENSIONS[]
+    = { GGL_STR("json"), GGL_STR("yaml"), GGL_STR("yml") };
+
+#define RECIPE_EXTENSION_COUNT \
+    (sizeof(RECIPE_EXTENSIONS) / sizeof(RECIPE_EXTENSIONS[0]))
+
+typedef struct {
+    uint8_t name[GGL_COMPONENT_NAME_MAX_LEN];
+    uint8_t version[MAX_VERSION_LEN];
+    uint8_t name_len;
+    uint8_t version_len;
+    uint8_t extension;
+    struct timespec mtime;
+} ComponentStoreEntry;
+
+typedef struct {
+    uint8_t name[GGL_COMPONENT_NAME_MAX_LEN];
+    uint8_t version[MAX_VERSION_LEN];
+    uint8_t name_len;
+    uint8_t version_len;
+    bool valid;
+    uint64_t last_used;
+    struct timespec mtime;
+    off_t size;
+    GglObject recipe;
+    uint8_t mem[GGL_COMPONENT_RECIPE_MAX_LEN];
+} RecipeCacheSlot;
+
+static pthread_mutex_t store_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+// Entries are sorted by component name, then by version in descending order,
+// so the first in-range entry for a component is its newest usable version.
+static ComponentStoreEntry index_entries[GGL_COMPONENT_STORE_MAX_RECIPES];
+static size_t index_len = 0;
+static bool index_valid = false;
+// Set when the recipe directory holds recipes the index cannot represent;
+// lookups scan the directory until it changes.
+static bool index_incomplete = false;
+static struct timespec index_dir_mtime;
+
+static RecipeCacheSlot recipe_cache[GGL_COMPONENT_STORE_RECIPE_CACHE_SLOTS];
+static uint64_t recipe_cache_clock = 0;
+
 static GglBuffer root_path = GGL_STR("/var/lib/greengrass");
 
 static GglError update_root_path(void) {
@@ -74,6 +140,57 @@ GglError get_recipe_dir_fd(int *recipe_fd) {
     return GGL_ERR_OK;
 }
 
+// recipe file names follow this format:
+// <component_name>-<version>.<extension>
+static GglError split_recipe_file_name(
+    GglBuffer file_name,
+    GglBuffer *component_name,
+    GglBuffer *version,
+    GglBuffer *extension
+) {
+    // Split the last "-" character to retrieve the component name
+    GglBuffer recipe_component = GGL_STR("");
+    GglBuffer rest = GGL_STR("");
+    for (size_t i = file_name.len; i > 0; --i) {
+        if (file_name.data[i - 1] == '-') {
+            recipe_component = ggl_buffer_substr(file_name, 0, i - 1);
+            rest = ggl_buffer_substr(file_name, i, SIZE_MAX);
+            GGL_LOGT(
+                "Split entry on '-': component: %.*s rest: %.*s",
+                (int) recipe_component.len,
+                recipe_component.data,
+                (int) rest.len,
+                rest.data
+            );
+            break;
+        }
+    }
+    if (rest.len == 0) {
+        return GGL_ERR_PARSE;
+    }
+
+    // Trim the file extension off the rest. This is the component version.
+    GglBuffer recipe_version = GGL_STR("");
+    GglBuffer recipe_extension = GGL_STR("");
+    for (size_t i = rest.len; i > 0; i--) {
+        if (rest.data[i - 1] == '.') {
+            recipe_version = ggl_buffer_substr(rest, 0, i - 1);
+            recipe_extension = ggl_buffer_substr(rest, i, SIZE_MAX);
+            GGL_LOGT(
+                "Found version: %.*s",
+                (int) recipe_version.len,
+                recipe_version.data
+            );
+            break;
+        }
+    }
+
+    *component_name = recipe_component;
+    *version = recipe_version;
+    *extension = recipe_extension;
+    return GGL_ERR_OK;
+}
+
 GglError iterate_over_components(
     DIR *dir,
     GglBuffer *component_name_buffer,
@@ -87,26 +204,13 @@ GglError iterate_over_components(
         GGL_LOGT(
             "Found directory entry %.*s", (int) entry_buf.len, entry_buf.data
         );
-        // recipe file names follow this format:
-        // <component_name>-<version>.<extension>
-        // Split the last "-" character to retrieve the component name
         GglBuffer recipe_component;
-        GglBuffer rest = GGL_STR("");
-        for (size_t i = entry_buf.len; i > 0; --i) {
-            if (entry_buf.data[i - 1] == '-') {
-                recipe_component = ggl_buffer_substr(entry_buf, 0, i - 1);
-                rest = ggl_buffer_substr(entry_buf, i, SIZE_MAX);
-                GGL_LOGT(
-                    "Split entry on '-': component: %.*s rest: %.*s",
-                    (int) recipe_component.len,
-                    recipe_component.data,
-                    (int) rest.len,
-                    rest.data
-                );
-                break;
-            }
-        }
-        if (rest.len == 0) {
+        GglBuffer recipe_version;
+        GglBuffer recipe_extension;
+        GglError ret = split_recipe_file_name(
+            entry_buf, &recipe_component, &recipe_version, &recipe_extension
+        );
+        if (ret != GGL_ERR_OK) {
             GGL_LOGD(
                 "Recipe file name formatted incorrectly. Continuing to next "
                 "file."
@@ -114,20 +218,6 @@ GglError iterate_over_components(
             continue;
         }
 
-        // Trim the file extension off the rest. This is the component version.
-        GglBuffer recipe_version = GGL_STR("");
-        for (size_t i = rest.len; i > 0; i--) {
-            if (rest.data[i - 1] == '.') {
-                recipe_version = ggl_buffer_substr(rest, 0, i - 1);
-                GGL_LOGT(
-                    "Found version: %.*s",
-                    (int) recipe_version.len,
-                    recipe_version.data
-                );
-                break;
-            }
-        }
-
         assert(recipe_component.len < NAME_MAX);
         assert(recipe_version.len < NAME_MAX);
         // Copy out component name and version.
@@ -147,21 +237,309 @@ GglError iterate_over_components(
     return GGL_ERR_NOENTRY;
 }
 
-GglError find_available_component(
-    GglBuffer component_name, GglBuffer requirement, GglBuffer *version
+static GglBuffer entry_name(const ComponentStoreEntry *entry) {
+    return (GglBuffer) { .data = (uint8_t *) entry->name,
+                         .len = entry->name_len };
+}
+
+static GglBuffer entry_version(const ComponentStoreEntry *entry) {
+    return (GglBuffer) { .data = (uint8_t *) entry->version,
+                         .len = entry->version_len };
+}
+
+static int compare_names(GglBuffer lhs, GglBuffer rhs) {
+    size_t min_len = (lhs.len < rhs.len) ? lhs.len : rhs.len;
+    int cmp = memcmp(lhs.data, rhs.data, min_len);
+    if (cmp != 0) {
+        return cmp;
+    }
+    if (lhs.len == rhs.len) {
+        return 0;
+    }
+    return (lhs.len < rhs.len) ? -1 : 1;
+}
+
+static int compare_entry(
+    const ComponentStoreEntry *entry, GglBuffer name, GglBuffer version
 ) {
-    GGL_LOGT(
-        "Searching for component %.*s",
-        (int) component_name.len,
-        component_name.data
+    int cmp = compare_names(entry_name(entry), name);
+    if (cmp != 0) {
+        return cmp;
+    }
+    // Newer versions sort first.
+    return ggl_semver_compare(version, entry_version(entry));
+}
+
+/// Index of the first entry for the component, or where it would be inserted.
+static size_t index_lower_bound(GglBuffer name) {
+    size_t low = 0;
+    size_t high = index_len;
+    while (low < high) {
+        size_t mid = low + ((high - low) / 2);
+        if (compare_names(entry_name(&index_entries[mid]), name) < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static GglError index_insert(
+    GglBuffer name,
+    GglBuffer version,
+    uint8_t extension,
+    struct timespec mtime
+) {
+    if ((name.len > sizeof(index_entries[0].name))
+        || (version.len > sizeof(index_entries[0].version))) {
+        GGL_LOGW(
+            "Recipe %.*s-%.*s exceeds component store index limits.",
+            (int) name.len,
+            name.data,
+            (int) version.len,
+            version.data
+        );
+        return GGL_ERR_RANGE;
+    }
+
+    size_t pos = index_lower_bound(name);
+    while (pos < index_len) {
+        int cmp = compare_entry(&index_entries[pos], name, version);
+        if (cmp == 0) {
+            // Same recipe with a different extension or a rewritten file.
+            index_entries[pos].extension = extension;
+            index_entries[pos].mtime = mtime;
+            return GGL_ERR_OK;
+        }
+        if (cmp > 0) {
+            break;
+        }
+        pos++;
+    }
+
+    if (index_len >= GGL_COMPONENT_STORE_MAX_RECIPES) {
+        GGL_LOGE("Component store index is full.");
+        return GGL_ERR_NOMEM;
+    }
+
+    memmove(
+        &index_entries[pos + 1],
+        &index_entries[pos],
+        (index_len - pos) * sizeof(index_entries[0])
     );
+    index_len++;
+
+    ComponentStoreEntry *entry = &index_entries[pos];
+    memcpy(entry->name, name.data, name.len);
+    entry->name_len = (uint8_t) name.len;
+    memcpy(entry->version, version.data, version.len);
+    entry->version_len = (uint8_t) version.len;
+    entry->extension = extension;
+    entry->mtime = mtime;
+    return GGL_ERR_OK;
+}
+
+static void index_remove(GglBuffer name, GglBuffer version) {
+    for (size_t pos = index_lower_bound(name); pos < index_len; pos++) {
+        if (!ggl_buffer_eq(entry_name(&index_entries[pos]), name)) {
+            return;
+        }
+        if (ggl_buffer_eq(entry_version(&index_entries[pos]), version)) {
+            memmove(
+                &index_entries[pos],
+                &index_entries[pos + 1],
+                (index_len - pos - 1) * sizeof(index_entries[0])
+            );
+            index_len--;
+            return;
+        }
+    }
+}
+
+static bool extension_index(GglBuffer extension, uint8_t *out) {
+    for (uint8_t i = 0; i < RECIPE_EXTENSION_COUNT; i++) {
+        if (ggl_buffer_eq(extension, RECIPE_EXTENSIONS[i])) {
+            *out = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool timespec_eq(struct timespec lhs, struct timespec rhs) {
+    return (lhs.tv_sec == rhs.tv_sec) && (lhs.tv_nsec == rhs.tv_nsec);
+}
+
+static GglError recipe_file_path(
+    GglBuffer name, GglBuffer version, GglBuffer extension, GglByteVec *path
+) {
+    GglError ret = ggl_byte_vec_append(path, name);
+    ggl_byte_vec_chain_push(&ret, path, '-');
+    ggl_byte_vec_chain_append(&ret, path, version);
+    ggl_byte_vec_chain_push(&ret, path, '.');
+    ggl_byte_vec_chain_append(&ret, path, extension);
+    ggl_byte_vec_chain_push(&ret, path, '\0');
+    return ret;
+}
+
+/// Find which recipe file exists for the component version, if any.
+static GglError stat_recipe_file(
+    int recipe_dir_fd,
+    GglBuffer name,
+    GglBuffer version,
+    uint8_t *extension,
+    struct stat *info
+) {
+    for (uint8_t i = 0; i < RECIPE_EXTENSION_COUNT; i++) {
+        uint8_t path_mem[NAME_MAX + 1];
+        GglByteVec path = GGL_BYTE_VEC(path_mem);
+        GglError ret
+            = recipe_file_path(name, version, RECIPE_EXTENSIONS[i], &path);
+        if (ret != GGL_ERR_OK) {
+            return ret;
+        }
+        if (fstatat(recipe_dir_fd, (char *) path.buf.data, info, 0) == 0) {
+            *extension = i;
+            return GGL_ERR_OK;
+        }
+    }
+    return GGL_ERR_NOENTRY;
+}
+
+static GglError index_rebuild(int recipe_dir_fd, struct timespec dir_mtime) {
+    GGL_LOGD("Rebuilding component store index.");
+
+    int dir_fd = dup(recipe_dir_fd);
+    if (dir_fd < 0) {
+        GGL_LOGE("Failed to duplicate recipe directory fd.");
+        return GGL_ERR_FAILURE;
+    }
+    DIR *dir = fdopendir(dir_fd);
+    if (dir == NULL) {
+        GGL_LOGE("Failed to open recipe directory.");
+        (void) ggl_close(dir_fd);
+        return GGL_ERR_FAILURE;
+    }
+    GGL_CLEANUP(cleanup_closedir, dir);
+
+    index_len = 0;
+    index_valid = false;
+    index_incomplete = false;
+
+    struct dirent *entry;
+    // NOLINTNEXTLINE(concurrency-mt-unsafe)
+    while ((entry = readdir(dir)) != NULL) {
+        GglBuffer name;
+        GglBuffer version;
+        GglBuffer extension;
+        GglError ret = split_recipe_file_name(
+            ggl_buffer_from_null_term(entry->d_name),
+            &name,
+            &version,
+            &extension
+        );
+        if (ret != GGL_ERR_OK) {
+            continue;
+        }
+
+        uint8_t extension_idx;
+        if (!extension_index(extension, &extension_idx)) {
+            continue;
+        }
+
+        struct stat info;
+        if (fstatat(recipe_dir_fd, entry->d_name, &info, 0) != 0) {
+            continue;
+        }
+
+        ret = index_insert(name, version, extension_idx, info.st_mtim);
+        if (ret != GGL_ERR_OK) {
+            GGL_LOGW(
+                "Component store index cannot hold all recipes, falling back "
+                "to directory scans."
+            );
+            index_len = 0;
+            index_incomplete = true;
+            index_dir_mtime = dir_mtime;
+            return ret;
+        }
+    }
+
+    index_dir_mtime = dir_mtime;
+    index_valid = true;
+    GGL_LOGD("Component store index holds %zu recipes.", index_len);
+    return GGL_ERR_OK;
+}
+
+/// Make sure the index reflects the recipe directory, rebuilding it if the
+/// directory was modified outside of the component store.
+static GglError index_sync(void) {
     int recipe_dir_fd;
     GglError ret = get_recipe_dir_fd(&recipe_dir_fd);
     if (ret != GGL_ERR_OK) {
         return ret;
     }
+    GGL_CLEANUP(cleanup_close, recipe_dir_fd);
 
-    // iterate through recipes in the directory
+    struct stat info;
+    if (fstat(recipe_dir_fd, &info) != 0) {
+        GGL_LOGE("Failed to stat recipe directory.");
+        return GGL_ERR_FAILURE;
+    }
+
+    if ((index_valid || index_incomplete)
+        && timespec_eq(info.st_mtim, index_dir_mtime)) {
+        return index_valid ? GGL_ERR_OK : GGL_ERR_NOMEM;
+    }
+
+    return index_rebuild(recipe_dir_fd, info.st_mtim);
+}
+
+/// Apply a change made by this process to the index without a full rescan.
+static void index_update(GglBuffer component_name, GglBuffer version) {
+    if (!index_valid) {
+        return;
+    }
+
+    int recipe_dir_fd;
+    GglError ret = get_recipe_dir_fd(&recipe_dir_fd);
+    if (ret != GGL_ERR_OK) {
+        index_valid = false;
+        return;
+    }
+    GGL_CLEANUP(cleanup_close, recipe_dir_fd);
+
+    uint8_t extension = 0;
+    struct stat info;
+    ret = stat_recipe_file(
+        recipe_dir_fd, component_name, version, &extension, &info
+    );
+    if (ret == GGL_ERR_OK) {
+        ret = index_insert(component_name, version, extension, info.st_mtim);
+    } else if (ret == GGL_ERR_NOENTRY) {
+        index_remove(component_name, version);
+        ret = GGL_ERR_OK;
+    }
+
+    struct stat dir_info;
+    if ((ret != GGL_ERR_OK) || (fstat(recipe_dir_fd, &dir_info) != 0)) {
+        index_valid = false;
+        return;
+    }
+    index_dir_mtime = dir_info.st_mtim;
+}
+
+/// Find the newest in-range version by reading the recipe directory.
+/// Used when the index cannot represent the store.
+static GglError scan_available_component(
+    GglBuffer component_name, GglBuffer requirement, GglBuffer *version
+) {
+    int recipe_dir_fd;
+    GglError ret = get_recipe_dir_fd(&recipe_dir_fd);
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
     DIR *dir = fdopendir(recipe_dir_fd);
     if (dir == NULL) {
         GGL_LOGE("Failed to open recipe directory.");
@@ -171,33 +549,274 @@ GglError find_available_component(
     GGL_CLEANUP(cleanup_closedir, dir);
 
     struct dirent *entry = NULL;
-    uint8_t component_name_array[NAME_MAX];
-    GglBuffer component_name_buffer
-        = { .data = component_name_array, .len = 0 };
+    uint8_t name_mem[NAME_MAX];
+    GglBuffer name_buf = { .data = name_mem, .len = 0 };
+    uint8_t version_mem[NAME_MAX];
+    GglBuffer version_buf = { .data = version_mem, .len = 0 };
+    bool found = false;
 
-    uint8_t version_array[NAME_MAX];
-    GglBuffer version_buffer = { .data = version_array, .len = 0 };
+    while (iterate_over_components(dir, &name_buf, &version_buf, &entry)
+           == GGL_ERR_OK) {
+        if (!ggl_buffer_eq(component_name, name_buf)
+            || !is_in_range(version_buf, requirement)) {
+            continue;
+        }
+        if (found && (ggl_semver_compare(version_buf, *version) <= 0)) {
+            continue;
+        }
+        assert(version_buf.len <= NAME_MAX);
+        memcpy(version->data, version_buf.data, version_buf.len);
+        version->len = version_buf.len;
+        found = true;
+    }
 
-    do {
-        ret = iterate_over_components(
-            dir, &component_name_buffer, &version_buffer, &entry
-        );
+    return found ? GGL_ERR_OK : GGL_ERR_NOENTRY;
+}
 
-        if (ret != GGL_ERR_OK) {
-            return ret;
-        }
+GglError find_available_component(
+    GglBuffer component_name, GglBuffer requirement, GglBuffer *version
+) {
+    GGL_LOGT(
+        "Searching for component %.*s",
+        (int) component_name.len,
+        component_name.data
+    );
 
-        assert(entry != NULL);
+    GGL_MTX_SCOPE_GUARD(&store_mtx);
+
+    GglError ret = index_sync();
+    if (index_incomplete) {
+        return scan_available_component(component_name, requirement, version);
+    }
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
 
-        if (ggl_buffer_eq(component_name, component_name_buffer)
-            && is_in_range(version_buffer, requirement)) {
-            assert(version_buffer.len <= NAME_MAX);
-            memcpy(version->data, version_buffer.data, version_buffer.len);
-            version->len = version_buffer.len;
+    for (size_t pos = index_lower_bound(component_name); pos < index_len;
+         pos++) {
+        const ComponentStoreEntry *entry = &index_entries[pos];
+        if (!ggl_buffer_eq(entry_name(entry), component_name)) {
+            break;
+        }
+        if (is_in_range(entry_version(entry), requirement)) {
+            assert(entry->version_len <= NAME_MAX);
+            memcpy(version->data, entry->version, entry->version_len);
+            version->len = entry->version_len;
             return GGL_ERR_OK;
         }
-    } while (true);
+    }
 
     // component meeting version requirements not found
     return GGL_ERR_NOENTRY;
 }
+
+void component_store_recipe_saved(
+    GglBuffer component_name, GglBuffer version
+) {
+    GGL_MTX_SCOPE_GUARD(&store_mtx);
+    index_update(component_name, version);
+}
+
+void component_store_recipe_removed(
+    GglBuffer component_name, GglBuffer version
+) {
+    GGL_MTX_SCOPE_GUARD(&store_mtx);
+    index_update(component_name, version);
+
+    for (size_t i = 0; i < GGL_COMPONENT_STORE_RECIPE_CACHE_SLOTS; i++) {
+        RecipeCacheSlot *slot = &recipe_cache[i];
+        if (slot->valid
+            && ggl_buffer_eq(
+                (GglBuffer) { .data = slot->name, .len = slot->name_len },
+                component_name
+            )
+            && ggl_buffer_eq(
+                (GglBuffer) { .data = slot->version,
+                              .len = slot->version_len },
+                version
+            )) {
+            slot->valid = false;
+        }
+    }
+}
+
+void component_store_invalidate(void) {
+    GGL_MTX_SCOPE_GUARD(&store_mtx);
+    index_valid = false;
+    index_incomplete = false;
+    for (size_t i = 0; i < GGL_COMPONENT_STORE_RECIPE_CACHE_SLOTS; i++) {
+        recipe_cache[i].valid = false;
+    }
+}
+
+static RecipeCacheSlot *recipe_cache_find(
+    GglBuffer component_name, GglBuffer version
+) {
+    for (size_t i = 0; i < GGL_COMPONENT_STORE_RECIPE_CACHE_SLOTS; i++) {
+        RecipeCacheSlot *slot = &recipe_cache[i];
+        if (slot->valid
+            && ggl_buffer_eq(
+                (GglBuffer) { .data = slot->name, .len = slot->name_len },
+                component_name
+            )
+            && ggl_buffer_eq(
+                (GglBuffer) { .data = slot->version,
+                              .len = slot->version_len },
+                version
+            )) {
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+static RecipeCacheSlot *recipe_cache_victim(void) {
+    RecipeCacheSlot *victim = &recipe_cache[0];
+    for (size_t i = 0; i < GGL_COMPONENT_STORE_RECIPE_CACHE_SLOTS; i++) {
+        RecipeCacheSlot *slot = &recipe_cache[i];
+        if (!slot->valid) {
+            return slot;
+        }
+        if (slot->last_used < victim->last_used) {
+            victim = slot;
+        }
+    }
+    return victim;
+}
+
+GglError component_store_get_recipe(
+    int root_path_fd,
+    GglBuffer component_name,
+    GglBuffer version,
+    GglArena *arena,
+    GglObject *recipe
+) {
+    if ((component_name.len > GGL_COMPONENT_NAME_MAX_LEN)
+        || (version.len > MAX_VERSION_LEN)) {
+        return ggl_recipe_get_from_file(
+            root_path_fd, component_name, version, arena, recipe
+        );
+    }
+
+    GGL_MTX_SCOPE_GUARD(&store_mtx);
+
+    int recipe_dir_fd;
+    GglError ret = ggl_dir_openat(
+        root_path_fd, GGL_STR("packages/recipes"), O_PATH, false, &recipe_dir_fd
+    );
+    if (ret != GGL_ERR_OK) {
+        GGL_LOGE("Failed to open recipe dir.");
+        return ret;
+    }
+    GGL_CLEANUP(cleanup_close, recipe_dir_fd);
+
+    uint8_t extension = 0;
+    struct stat info;
+    ret = stat_recipe_file(
+        recipe_dir_fd, component_name, version, &extension, &info
+    );
+    if (ret != GGL_ERR_OK) {
+        // Let the recipe loader report the missing file.
+        return ggl_recipe_get_from_file(
+            root_path_fd, component_name, version, arena, recipe
+        );
+    }
+
+    RecipeCacheSlot *slot = recipe_cache_find(component_name, version);
+    if ((slot != NULL) && timespec_eq(slot->mtime, info.st_mtim)
+        && (slot->size == info.st_size)) {
+        GGL_LOGT(
+            "Recipe cache hit for %.*s-%.*s.",
+            (int) component_name.len,
+            component_name.data,
+            (int) version.len,
+            version.data
+        );
+        slot->last_used = ++recipe_cache_clock;
+        *recipe = slot->recipe;
+        return ggl_arena_claim_obj(recipe, arena);
+    }
+
+    if (slot == NULL) {
+        slot = recipe_cache_victim();
+    }
+    slot->valid = false;
+
+    GglArena slot_alloc = ggl_arena_init(GGL_BUF(slot->mem));
+    ret = ggl_recipe_get_from_file(
+        root_path_fd, component_name, version, &slot_alloc, &slot->recipe
+    );
+    if (ret == GGL_ERR_NOMEM) {
+        // Recipe does not fit in a cache slot; decode it uncached.
+        return ggl_recipe_get_from_file(
+            root_path_fd, component_name, version, arena, recipe
+        );
+    }
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
+    memcpy(slot->name, component_name.data, component_name.len);
+    slot->name_len = (uint8_t) component_name.len;
+    memcpy(slot->version, version.data, version.len);
+    slot->version_len = (uint8_t) version.len;
+    slot->mtime = info.st_mtim;
+    slot->size = info.st_size;
+    slot->last_used = ++recipe_cache_clock;
+    slot->valid = true;
+
+    *recipe = slot->recipe;
+    return ggl_arena_claim_obj(recipe, arena);
+}
+
+static void update_references_from_dir(int root_path_fd, int dir_fd) {
+    DIR *dir = fdopendir(dir_fd);
+    if (dir == NULL) {
+        GGL_LOGE("Failed to open recipe directory.");
+        (void) ggl_close(dir_fd);
+        return;
+    }
+    GGL_CLEANUP(cleanup_closedir, dir);
+
+    uint8_t name_mem[NAME_MAX];
+    uint8_t version_mem[NAME_MAX];
+    while (true) {
+        GglBuffer component_name = GGL_BUF(name_mem);
+        GglBuffer version = GGL_BUF(version_mem);
+        struct dirent *entry = NULL;
+        GglError ret
+            = iterate_over_components(dir, &component_name, &version, &entry);
+        if ((ret != GGL_ERR_OK) || (entry == NULL)) {
+            break;
+        }
+        ggl_docker_references_update(root_path_fd, component_name, version);
+    }
+}
+
+void component_store_update_docker_references(
+    int root_path_fd, GglBuffer recipe_dir_path
+) {
+    int dir_fd = -1;
+    GglError ret = ggl_dir_open(recipe_dir_path, O_RDONLY, false, &dir_fd);
+    if (ret != GGL_ERR_OK) {
+        GGL_LOGE("Failed to open recipe directory.");
+        return;
+    }
+    update_references_from_dir(root_path_fd, dir_fd);
+}
+
+void component_store_load_docker_references(int root_path_fd) {
+    if (ggl_docker_references_load(root_path_fd) == GGL_ERR_OK) {
+        return;
+    }
+
+    GGL_LOGI("Indexing docker images used by stored recipes.");
+    int dir_fd = -1;
+    GglError ret = ggl_dir_openat(
+        root_path_fd, GGL_STR("packages/recipes"), O_RDONLY, false, &dir_fd
+    );
+    if (ret == GGL_ERR_OK) {
+        update_references_from_dir(root_path_fd, dir_fd);
+    }
+    ggl_docker_references_rebuilt(root_path_fd);
+}
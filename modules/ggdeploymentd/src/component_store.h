@@ -6,8 +6,10 @@
 #define GGDEPLOYMENTD_COMPONENT_STORE_H
 
 #include <dirent.h>
+#include <ggl/arena.h>
 #include <ggl/buffer.h>
 #include <ggl/error.h>
+#include <ggl/object.h>
 
 GglError get_recipe_dir_fd(int *recipe_fd);
 
@@ -18,8 +20,41 @@ GglError iterate_over_components(
     struct dirent **entry
 );
 
+/// Find the newest locally stored version of a component that satisfies the
+/// requirement. Served from an in-memory index of the recipe directory.
 GglError find_available_component(
     GglBuffer component_name, GglBuffer requirement, GglBuffer *version
 );
 
+/// Update the index after a recipe file was written by ggdeploymentd.
+void component_store_recipe_saved(GglBuffer component_name, GglBuffer version);
+
+/// Update the index after a recipe file was deleted by ggdeploymentd.
+void component_store_recipe_removed(
+    GglBuffer component_name, GglBuffer version
+);
+
+/// Drop the index and recipe cache, e.g. after bulk-copying recipes.
+void component_store_invalidate(void);
+
+/// Record the docker images used by every recipe named in a recipe directory,
+/// reading the recipes from the component store.
+void component_store_update_docker_references(
+    int root_path_fd, GglBuffer recipe_dir_path
+);
+
+/// Load the docker image reference index, rebuilding it from the component
+/// store if it is missing.
+void component_store_load_docker_references(int root_path_fd);
+
+/// Load a recipe, reusing a previously parsed copy if the file is unchanged.
+/// Same contract as `ggl_recipe_get_from_file`.
+GglError component_store_get_recipe(
+    int root_path_fd,
+    GglBuffer component_name,
+    GglBuffer version,
+    GglArena *arena,
+    GglObject *recipe
+);
+
 #endif
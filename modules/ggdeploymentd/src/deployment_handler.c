@@ -6,6 +6,7 @@
 #include "bootstrap_manager.h"
 #include "component_config.h"
 #include "component_manager.h"
+#include "component_store.h"
 #include "deployment_model.h"
 #include "deployment_queue.h"
 #include "iot_jobs_listener.h"
@@ -24,6 +25,7 @@
 #include <ggl/core_bus/gg_healthd.h>
 #include <ggl/core_bus/sub_response.h>
 #include <ggl/digest.h>
+#include <ggl/docker_artifact_cleanup.h>
 #include <ggl/docker_client.h>
 #include <ggl/error.h>
 #include <ggl/file.h>
@@ -55,6 +57,10 @@
 #define MAX_DECODE_BUF_LEN 4096
 #define DEPLOYMENT_TARGET_NAME_MAX_CHARS 128
 #define MAX_DEPLOYMENT_TARGETS 100
+// Max components sent in one resolveComponentCandidates request
+#define MAX_CLOUD_RESOLVE_BATCH 8
+// Max docker images of a component pulled in one batch
+#define MAX_DOCKER_PULL_BATCH 8
 
 static struct DeploymentConfiguration {
     char data_endpoint[128];
@@ -664,6 +670,40 @@ static GglError unarchive_artifact(
     return ggl_zip_unarchive(component_store_fd, zip_file, output_dir_fd, mode);
 }
 
+/// Pull the queued docker images together, so the daemon can download them
+/// in parallel, then empty the queue.
+static GglError pull_docker_images(GglBufVec *images, GglByteVec *names) {
+    if (images->buf_list.len == 0) {
+        return GGL_ERR_OK;
+    }
+    GglError err = ggl_docker_pull_many(images->buf_list);
+    images->buf_list.len = 0;
+    names->buf.len = 0;
+    return err;
+}
+
+static GglError queue_docker_pull(
+    GglBufVec *images, GglByteVec *names, GglBuffer image
+) {
+    if ((images->buf_list.len == images->capacity)
+        || (ggl_byte_vec_remaining_capacity(*names).len < image.len)) {
+        GglError err = pull_docker_images(images, names);
+        if (err != GGL_ERR_OK) {
+            return err;
+        }
+    }
+
+    // Copied, as the image name is parsed into a per-artifact buffer
+    GglBuffer copy = ggl_byte_vec_remaining_capacity(*names);
+    GglError err = ggl_byte_vec_append(names, image);
+    if (err != GGL_ERR_OK) {
+        GGL_LOGE("Docker image name too long.");
+        return err;
+    }
+    copy.len = image.len;
+    return ggl_buf_vec_push(images, copy);
+}
+
 // NOLINTNEXTLINE(readability-function-cognitive-complexity)
 static GglError get_recipe_artifacts(
     GglBuffer component_arn,
@@ -680,6 +720,11 @@ static GglError get_recipe_artifacts(
         return error;
     }
 
+    static uint8_t docker_names_mem[MAX_DECODE_BUF_LEN];
+    GglByteVec docker_names = GGL_BYTE_VEC(docker_names_mem);
+    GglBuffer docker_images_mem[MAX_DOCKER_PULL_BATCH];
+    GglBufVec docker_images = GGL_BUF_VEC(docker_images_mem);
+
     bool ecr_logged_in = false;
     for (size_t i = 0; i < artifacts.len; ++i) {
         uint8_t decode_buffer[MAX_DECODE_BUF_LEN];
@@ -756,7 +801,7 @@ static GglError get_recipe_artifacts(
                 }
             }
 
-            err = ggl_docker_pull(docker_uri);
+            err = queue_docker_pull(&docker_images, &docker_names, docker_uri);
             if (err != GGL_ERR_OK) {
                 return GGL_ERR_FAILURE;
             }
@@ -861,6 +906,11 @@ static GglError get_recipe_artifacts(
             }
         }
     }
+
+    GglError err = pull_docker_images(&docker_images, &docker_names);
+    if (err != GGL_ERR_OK) {
+        return GGL_ERR_FAILURE;
+    }
     return GGL_ERR_OK;
 }
 
@@ -960,11 +1010,12 @@ static GglError get_device_thing_groups(GglBuffer *response) {
 }
 
 static GglError generate_resolve_component_candidates_body(
-    GglBuffer component_name,
-    GglBuffer component_requirements,
-    GglByteVec *body_vec,
-    GglArena *alloc
+    GglMap components, GglByteVec *body_vec, GglArena *alloc
 ) {
+    if ((components.len == 0) || (components.len > MAX_CLOUD_RESOLVE_BATCH)) {
+        return GGL_ERR_RANGE;
+    }
+
     GglObject architecture_detail_read_value;
     GglError ret = ggl_gg_config_read(
         GGL_BUF_LIST(
@@ -1010,19 +1061,28 @@ static GglError generate_resolve_component_candidates_body(
         ggl_kv(GGL_STR("attributes"), ggl_obj_map(platform_attributes))
     );
 
-    GglMap version_requirements_map = GGL_MAP(
-        ggl_kv(GGL_STR("requirements"), ggl_obj_buf(component_requirements))
-    );
-
-    GglMap component_map = GGL_MAP(
-        ggl_kv(GGL_STR("componentName"), ggl_obj_buf(component_name)),
-        ggl_kv(
+    GglKV version_requirements_kvs[MAX_CLOUD_RESOLVE_BATCH];
+    GglKV component_kvs[MAX_CLOUD_RESOLVE_BATCH][2];
+    GglObject candidates[MAX_CLOUD_RESOLVE_BATCH];
+    for (size_t i = 0; i < components.len; i++) {
+        GglKV *component = &components.pairs[i];
+        version_requirements_kvs[i] = ggl_kv(
+            GGL_STR("requirements"), *ggl_kv_val(component)
+        );
+        component_kvs[i][0] = ggl_kv(
+            GGL_STR("componentName"), ggl_obj_buf(ggl_kv_key(*component))
+        );
+        component_kvs[i][1] = ggl_kv(
             GGL_STR("versionRequirements"),
-            ggl_obj_map(version_requirements_map)
-        )
-    );
+            ggl_obj_map((GglMap) { .pairs = &version_requirements_kvs[i],
+                                   .len = 1 })
+        );
+        candidates[i] = ggl_obj_map((GglMap) { .pairs = component_kvs[i],
+                                               .len = 2 });
+    }
 
-    GglList candidates_list = GGL_LIST(ggl_obj_map(component_map));
+    GglList candidates_list
+        = (GglList) { .items = candidates, .len = components.len };
 
     GglMap request_body = GGL_MAP(
         ggl_kv(GGL_STR("componentCandidates"), ggl_obj_list(candidates_list)),
@@ -1044,17 +1104,17 @@ static GglError generate_resolve_component_candidates_body(
     return GGL_ERR_OK;
 }
 
+/// Resolve a batch of components (name -> version requirements) with a single
+/// resolveComponentCandidates call.
 static GglError resolve_component_with_cloud(
-    GglBuffer component_name,
-    GglBuffer version_requirements,
-    GglBuffer *response
+    GglMap components, GglBuffer *response
 ) {
-    static char resolve_candidates_body_buf[2048];
+    static char resolve_candidates_body_buf[MAX_CLOUD_RESOLVE_BATCH * 1024];
     GglByteVec body_vec = GGL_BYTE_VEC(resolve_candidates_body_buf);
     static uint8_t rcc_body_config_read_mem[128];
     GglArena rcc_alloc = ggl_arena_init(GGL_BUF(rcc_body_config_read_mem));
     GglError ret = generate_resolve_component_candidates_body(
-        component_name, version_requirements, &body_vec, &rcc_alloc
+        components, &body_vec, &rcc_alloc
     );
     if (ret != GGL_ERR_OK) {
         GGL_LOGE("Failed to generate body for resolveComponentCandidates call");
@@ -1134,14 +1194,19 @@ static GglError resolve_component_with_cloud(
     return GGL_ERR_OK;
 }
 
+/// Saves the recipe of every component in a resolveComponentCandidates
+/// response and records the resolved versions in cloud_resolved.
 static GglError parse_dataplane_response_and_save_recipe(
     GglBuffer dataplane_response,
     GglDeploymentHandlerThreadArgs *args,
-    GglBuffer *cloud_version
+    GglKVVec *cloud_resolved,
+    GglArena *cloud_resolved_alloc
 ) {
     GglObject json_candidates_response_obj;
     // TODO: Figure out a better size. This response can be big.
-    uint8_t candidates_response_mem[100 * sizeof(GglObject)];
+    static uint8_t
+        candidates_response_mem[MAX_CLOUD_RESOLVE_BATCH * 100
+                                * sizeof(GglObject)];
     GglArena alloc = ggl_arena_init(GGL_BUF(candidates_response_mem));
     GglError ret = ggl_json_decode_destructive(
         dataplane_response, &alloc, &json_candidates_response_obj
@@ -1172,19 +1237,9 @@ static GglError parse_dataplane_response_and_save_recipe(
         return ret;
     }
 
-    bool first_component = true;
     GGL_LIST_FOREACH (
         resolved_version, ggl_obj_into_list(*resolved_component_versions)
     ) {
-        if (!first_component) {
-            GGL_LOGE(
-                "resolveComponentCandidates returned information for more than "
-                "one component."
-            );
-            return GGL_ERR_INVALID;
-        }
-        first_component = false;
-
         if (ggl_obj_type(*resolved_version) != GGL_TYPE_MAP) {
             GGL_LOGE("Resolved version is not of type map.");
             return ret;
@@ -1229,14 +1284,29 @@ static GglError parse_dataplane_response_and_save_recipe(
             = ggl_obj_into_buf(*cloud_component_version_obj);
         GglBuffer recipe_file_content = ggl_obj_into_buf(*recipe_obj);
 
-        assert(cloud_component_version.len <= NAME_MAX);
-
-        memcpy(
-            cloud_version->data,
-            cloud_component_version.data,
-            cloud_component_version.len
-        );
-        cloud_version->len = cloud_component_version.len;
+        GglBuffer resolved_name = cloud_component_name;
+        GglBuffer resolved_version_buf = cloud_component_version;
+        ret = ggl_arena_claim_buf(&resolved_version_buf, cloud_resolved_alloc);
+        GglObject *existing_version;
+        if (ret != GGL_ERR_OK) {
+            // Handled below
+        } else if (ggl_map_get(
+                       cloud_resolved->map, resolved_name, &existing_version
+                   )) {
+            *existing_version = ggl_obj_buf(resolved_version_buf);
+        } else {
+            ret = ggl_arena_claim_buf(&resolved_name, cloud_resolved_alloc);
+            if (ret == GGL_ERR_OK) {
+                ret = ggl_kv_vec_push(
+                    cloud_resolved,
+                    ggl_kv(resolved_name, ggl_obj_buf(resolved_version_buf))
+                );
+            }
+        }
+        if (ret != GGL_ERR_OK) {
+            GGL_LOGE("Failed to record cloud resolved component version.");
+            return ret;
+        }
 
         if (vendor_guidance_obj != NULL) {
             if (ggl_buffer_eq(
@@ -1327,6 +1397,12 @@ static GglError parse_dataplane_response_and_save_recipe(
         }
 
         GGL_LOGD("Saved recipe under the name %s", recipe_name_vec.buf.data);
+        component_store_recipe_saved(
+            cloud_component_name, cloud_component_version
+        );
+        ggl_docker_references_update(
+            args->root_path_fd, cloud_component_name, cloud_component_version
+        );
 
         ret = ggl_gg_config_write(
             GGL_BUF_LIST(GGL_STR("services"), cloud_component_name, ),
@@ -1400,6 +1476,87 @@ static GglError add_thing_groups_list_to_config(GglObject *thing_groups_list) {
     return GGL_ERR_OK;
 }
 
+/// Resolves the first component in `pending` with the cloud. The remaining
+/// components of the same dependency level that cannot be resolved locally are
+/// resolved in the same request, and their recipes saved.
+static GglError resolve_pending_with_cloud(
+    GglMap pending,
+    GglDeploymentHandlerThreadArgs *args,
+    GglKVVec *cloud_resolved,
+    GglArena *cloud_resolved_alloc
+) {
+    assert(pending.len > 0);
+
+    GglKVVec batch = GGL_KV_VEC((GglKV[MAX_CLOUD_RESOLVE_BATCH]) { 0 });
+    GglError ret = ggl_kv_vec_push(&batch, pending.pairs[0]);
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
+    for (size_t i = 1;
+         (i < pending.len) && (batch.map.len < MAX_CLOUD_RESOLVE_BATCH);
+         i++) {
+        GglKV *candidate = &pending.pairs[i];
+        GglObject *cached_version;
+        if (ggl_map_get(
+                cloud_resolved->map, ggl_kv_key(*candidate), &cached_version
+            )) {
+            continue;
+        }
+
+        uint8_t local_version_arr[NAME_MAX];
+        GglBuffer local_version = GGL_BUF(local_version_arr);
+        if (resolve_component_version(
+                ggl_kv_key(*candidate),
+                ggl_obj_into_buf(*ggl_kv_val(candidate)),
+                &local_version
+            )) {
+            continue;
+        }
+
+        ret = ggl_kv_vec_push(&batch, *candidate);
+        if (ret != GGL_ERR_OK) {
+            return ret;
+        }
+    }
+
+    GGL_LOGD(
+        "Resolving %zu component(s) with the cloud in one request.",
+        batch.map.len
+    );
+
+    static uint8_t resolve_component_candidates_response_buf[32768] = { 0 };
+    GglBuffer response = GGL_BUF(resolve_component_candidates_response_buf);
+
+    ret = resolve_component_with_cloud(batch.map, &response);
+    if ((ret != GGL_ERR_OK) && (batch.map.len > 1)) {
+        GGL_LOGW(
+            "Batched cloud resolution failed, retrying for %.*s alone.",
+            (int) ggl_kv_key(pending.pairs[0]).len,
+            ggl_kv_key(pending.pairs[0]).data
+        );
+        batch.map.len = 1;
+        response = GGL_BUF(resolve_component_candidates_response_buf);
+        ret = resolve_component_with_cloud(batch.map, &response);
+    }
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
+    if (ggl_buffer_eq(response, GGL_STR("{}"))) {
+        GGL_LOGI(
+            "Cloud version resolution failed for component %.*s.",
+            (int) ggl_kv_key(pending.pairs[0]).len,
+            ggl_kv_key(pending.pairs[0]).data
+        );
+        return GGL_ERR_FAILURE;
+    }
+
+    return parse_dataplane_response_and_save_recipe(
+        response, args, cloud_resolved, cloud_resolved_alloc
+    );
+}
+
 static GglError resolve_dependencies(
     GglMap root_components,
     GglBuffer thing_group_name,
@@ -1416,6 +1573,12 @@ static GglError resolve_dependencies(
     GglArena version_requirements_alloc
         = ggl_arena_init(GGL_BUF(version_requirements_mem));
 
+    // Versions resolved by the cloud during this deployment, including
+    // components resolved ahead of time as part of a batch.
+    GglKVVec cloud_resolved = GGL_KV_VEC((GglKV[64]) { 0 });
+    static uint8_t cloud_resolved_mem[8192] = { 0 };
+    GglArena cloud_resolved_alloc = ggl_arena_init(GGL_BUF(cloud_resolved_mem));
+
     // Root components from current deployment
     GGL_MAP_FOREACH (pair, root_components) {
         if (ggl_obj_type(*ggl_kv_val(pair)) != GGL_TYPE_MAP) {
@@ -1827,45 +1990,62 @@ static GglError resolve_dependencies(
         // it in this map.
         uint8_t resolved_version_arr[NAME_MAX];
         GglBuffer resolved_version = GGL_BUF(resolved_version_arr);
-        bool found_local_candidate = resolve_component_version(
-            ggl_kv_key(*pair), pair_val, &resolved_version
-        );
+
+        // A component already resolved by an earlier batched cloud request
+        // had no local candidate at that time.
+        GglObject *cloud_version = NULL;
+        bool found_cached_candidate = false;
+        if (ggl_map_get(
+                cloud_resolved.map, ggl_kv_key(*pair), &cloud_version
+            )) {
+            found_cached_candidate
+                = is_in_range(ggl_obj_into_buf(*cloud_version), pair_val);
+        }
+
+        bool found_local_candidate = found_cached_candidate;
+        if (!found_local_candidate) {
+            found_local_candidate = resolve_component_version(
+                ggl_kv_key(*pair), pair_val, &resolved_version
+            );
+        }
 
         if (!found_local_candidate) {
             // Resolve with cloud and download recipe
-            static uint8_t resolve_component_candidates_response_buf[16384]
-                = { 0 };
-            GglBuffer resolve_component_candidates_response
-                = GGL_BUF(resolve_component_candidates_response_buf);
-
-            ret = resolve_component_with_cloud(
-                ggl_kv_key(*pair),
-                pair_val,
-                &resolve_component_candidates_response
+            size_t pair_index
+                = (size_t) (pair - components_to_resolve.map.pairs);
+            ret = resolve_pending_with_cloud(
+                (GglMap) { .pairs = pair,
+                           .len = components_to_resolve.map.len - pair_index },
+                args,
+                &cloud_resolved,
+                &cloud_resolved_alloc
             );
             if (ret != GGL_ERR_OK) {
                 return ret;
             }
 
-            bool is_empty_response = ggl_buffer_eq(
-                resolve_component_candidates_response, GGL_STR("{}")
-            );
-
-            if (is_empty_response) {
-                GGL_LOGI(
-                    "Cloud version resolution failed for component %.*s.",
+            if (!ggl_map_get(
+                    cloud_resolved.map, ggl_kv_key(*pair), &cloud_version
+                )) {
+                GGL_LOGE(
+                    "resolveComponentCandidates response did not include "
+                    "component %.*s.",
                     (int) ggl_kv_key(*pair).len,
-                    pair_val.data
+                    ggl_kv_key(*pair).data
                 );
                 return GGL_ERR_FAILURE;
             }
+        }
 
-            ret = parse_dataplane_response_and_save_recipe(
-                resolve_component_candidates_response, args, &resolved_version
+        if (!found_local_candidate || found_cached_candidate) {
+            GglBuffer cloud_version_buf = ggl_obj_into_buf(*cloud_version);
+            assert(cloud_version_buf.len <= NAME_MAX);
+            memcpy(
+                resolved_version.data,
+                cloud_version_buf.data,
+                cloud_version_buf.len
             );
-            if (ret != GGL_ERR_OK) {
-                return ret;
-            }
+            resolved_version.len = cloud_version_buf.len;
         }
 
         // Add resolved component to list of resolved components
@@ -1894,7 +2074,7 @@ static GglError resolve_dependencies(
         GglObject recipe_obj;
         static uint8_t recipe_mem[GGL_COMPONENT_RECIPE_MAX_LEN] = { 0 };
         GglArena recipe_alloc = ggl_arena_init(GGL_BUF(recipe_mem));
-        ret = ggl_recipe_get_from_file(
+        ret = component_store_get_recipe(
             args->root_path_fd,
             ggl_kv_key(*pair),
             resolved_version,
@@ -2430,10 +2610,15 @@ static void handle_deployment(
         GglError ret = merge_dir_to(
             deployment->recipe_directory_path, "packages/recipes/"
         );
+        // Recipes may have been overwritten in place; rescan on next lookup.
+        component_store_invalidate();
         if (ret != GGL_ERR_OK) {
             GGL_LOGE("Failed to copy recipes.");
             return;
         }
+        component_store_update_docker_references(
+            root_path_fd, deployment->recipe_directory_path
+        );
     }
 
     if (deployment->artifacts_directory_path.len != 0) {
@@ -2516,6 +2701,8 @@ static void handle_deployment(
     // list of {component name -> component version} for all new components in
     // the deployment
     GglKVVec components_to_deploy = GGL_KV_VEC((GglKV[64]) { 0 });
+    // whether any unit file was written, requiring a daemon-reload
+    bool units_changed = false;
 
     GGL_MAP_FOREACH (pair, resolved_components_kv_vec.map) {
         GglBuffer pair_val = ggl_obj_into_buf(*ggl_kv_val(pair));
@@ -2596,7 +2783,7 @@ static void handle_deployment(
         GglObject recipe_obj;
         static uint8_t recipe_mem[GGL_COMPONENT_RECIPE_MAX_LEN] = { 0 };
         GglArena alloc = ggl_arena_init(GGL_BUF(recipe_mem));
-        ret = ggl_recipe_get_from_file(
+        ret = component_store_get_recipe(
             args->root_path_fd, ggl_kv_key(*pair), pair_val, &alloc, &recipe_obj
         );
         if (ret != GGL_ERR_OK) {
@@ -2874,6 +3061,9 @@ static void handle_deployment(
         if (err != GGL_ERR_OK) {
             return;
         }
+        if (phases.units_changed) {
+            units_changed = true;
+        }
 
         if (!ggl_buffer_eq(
                 ggl_obj_into_buf(*component_name), ggl_kv_key(*pair)
@@ -2939,9 +3129,18 @@ static void handle_deployment(
                 );
             }
 
-            // Skip redeploying components in a RUNNING state
-            if (ggl_buffer_eq(component_status, GGL_STR("RUNNING"))
-                || ggl_buffer_eq(component_status, GGL_STR("FINISHED"))) {
+            // Skip redeploying components in a RUNNING state, unless their
+            // run unit changed and they must restart to pick it up
+            if (phases.restart_needed) {
+                GGL_LOGI(
+                    "Unit file for %.*s changed. Restarting component.",
+                    (int) ggl_kv_key(*pair).len,
+                    ggl_kv_key(*pair).data
+                );
+            }
+            if (!phases.restart_needed
+                && (ggl_buffer_eq(component_status, GGL_STR("RUNNING"))
+                    || ggl_buffer_eq(component_status, GGL_STR("FINISHED")))) {
                 GGL_LOGD(
                     "Component %.*s is already running. Will not redeploy.",
                     (int) ggl_kv_key(*pair).len,
@@ -3308,30 +3507,39 @@ static void handle_deployment(
             }
         }
 
-        // run daemon-reload command once all the files are linked
-        static uint8_t reload_command_buf[PATH_MAX];
-        GglByteVec reload_command_vec = GGL_BYTE_VEC(reload_command_buf);
-        ret = ggl_byte_vec_append(
-            &reload_command_vec, GGL_STR("systemctl daemon-reload\0")
-        );
-        if (ret != GGL_ERR_OK) {
-            GGL_LOGE("Failed to create systemctl daemon-reload command.");
-            return;
-        }
-        // NOLINTNEXTLINE(concurrency-mt-unsafe)
-        int system_ret = system((char *) reload_command_vec.buf.data);
-        if (WIFEXITED(system_ret)) {
-            if (WEXITSTATUS(system_ret) != 0) {
-                GGL_LOGE("systemctl daemon-reload failed");
+        // run daemon-reload command once all the files are linked, unless
+        // every unit file was already up to date
+        if (units_changed) {
+            static uint8_t reload_command_buf[PATH_MAX];
+            GglByteVec reload_command_vec = GGL_BYTE_VEC(reload_command_buf);
+            ret = ggl_byte_vec_append(
+                &reload_command_vec, GGL_STR("systemctl daemon-reload\0")
+            );
+            if (ret != GGL_ERR_OK) {
+                GGL_LOGE("Failed to create systemctl daemon-reload command.");
+                return;
+            }
+            // NOLINTNEXTLINE(concurrency-mt-unsafe)
+            int system_ret = system((char *) reload_command_vec.buf.data);
+            if (WIFEXITED(system_ret)) {
+                if (WEXITSTATUS(system_ret) != 0) {
+                    GGL_LOGE("systemctl daemon-reload failed");
+                    return;
+                }
+                GGL_LOGI(
+                    "systemctl daemon-reload exited with child status %d\n",
+                    WEXITSTATUS(system_ret)
+                );
+            } else {
+                GGL_LOGE("systemctl daemon-reload did not exit normally");
+                return;
+            }
+            ret = clear_unit_reload_pending(root_path_fd);
+            if (ret != GGL_ERR_OK) {
                 return;
             }
-            GGL_LOGI(
-                "systemctl daemon-reload exited with child status %d\n",
-                WEXITSTATUS(system_ret)
-            );
         } else {
-            GGL_LOGE("systemctl daemon-reload did not exit normally");
-            return;
+            GGL_LOGD("No unit files changed; skipping daemon-reload.");
         }
     }
 
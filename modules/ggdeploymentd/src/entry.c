@@ -3,6 +3,7 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "bus_server.h"
+#include "component_store.h"
 #include "deployment_handler.h"
 #include "ggdeploymentd.h"
 #include "iot_jobs_listener.h"
@@ -61,6 +62,8 @@ GglError run_ggdeploymentd(const char *bin_path) {
         return GGL_ERR_FAILURE;
     }
 
+    component_store_load_docker_references(root_path_fd);
+
     GglDeploymentHandlerThreadArgs args = { .root_path_fd = root_path_fd,
                                             .root_path = root_path,
                                             .bin_path = bin_path };
@@ -218,7 +218,7 @@ static GglError update_job(
             )
         ));
 
-        static uint8_t response_scratch[512];
+        static uint8_t response_scratch[1024];
         GglArena call_alloc = ggl_arena_init(GGL_BUF(response_scratch));
         GglObject result = { 0 };
         ret = ggl_aws_iot_call(
@@ -337,7 +337,7 @@ static GglError describe_next_job(void *ctx) {
         )
     ));
 
-    static uint8_t response_scratch[4096];
+    static uint8_t response_scratch[8192];
     GglArena call_alloc = ggl_arena_init(GGL_BUF(response_scratch));
     GglObject job_description;
     ret = ggl_aws_iot_call(
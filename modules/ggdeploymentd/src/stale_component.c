@@ -176,6 +176,8 @@ static GglError delete_component_recipe(
             root_path->capacity - INDEX_BEFORE_FILE_EXTENTION
         );
     }
+    component_store_recipe_removed(component_name, version_number);
+
     // We should reset the index regardless of the error code in case caller
     // does not exit.
     root_path->buf.len = INDEX_BEFORE_ADDITION;
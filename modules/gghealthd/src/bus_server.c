@@ -178,6 +178,14 @@ static GglError subscribe_to_lifecycle_completion(
     return GGL_ERR_OK;
 }
 
+static GglError subscribe_to_lifecycle_updates(
+    void *ctx, GglMap params, uint32_t handle
+) {
+    (void) ctx;
+    (void) params;
+    return gghealthd_register_lifecycle_broadcast(handle);
+}
+
 static GglError restart_component(void *ctx, GglMap params, uint32_t handle) {
     (void) ctx;
     GglObject *component_name_obj;
@@ -224,6 +232,10 @@ GglError run_gghealthd(void) {
             { GGL_STR("subscribe_to_lifecycle_completion"),
               true,
               subscribe_to_lifecycle_completion,
+              NULL },
+            { GGL_STR("subscribe_to_lifecycle_updates"),
+              true,
+              subscribe_to_lifecycle_updates,
               NULL } };
     static const size_t HANDLERS_LEN = sizeof(handlers) / sizeof(handlers[0]);
 
@@ -4,20 +4,20 @@
 
 #include "health.h"
 #include "bus_client.h"
+#include "lifecycle_table.h"
 #include "sd_bus.h"
 #include "subscriptions.h"
+#include "unit_notify.h"
 #include <assert.h>
 #include <ggl/arena.h>
 #include <ggl/buffer.h>
 #include <ggl/cleanup.h>
 #include <ggl/error.h>
-#include <ggl/exec.h>
 #include <ggl/list.h>
 #include <ggl/log.h>
 #include <ggl/map.h>
 #include <ggl/nucleus/constants.h>
 #include <ggl/object.h>
-#include <ggl/vector.h>
 #include <systemd/sd-bus.h>
 #include <systemd/sd-daemon.h>
 #include <stdbool.h>
@@ -52,37 +52,19 @@ GglError gghealthd_get_status(GglBuffer component_name, GglBuffer *status) {
         return err;
     }
 
-    // only relay lifecycle state for configured components
-    err = verify_component_exists(component_name);
-    if (err != GGL_ERR_OK) {
-        return err;
-    }
-
-    uint8_t qualified_name[SERVICE_NAME_MAX_LEN + 1] = { 0 };
-    err = get_service_name(component_name, &GGL_BUF(qualified_name));
-    if (err != GGL_ERR_OK) {
-        return GGL_ERR_FAILURE;
-    }
-
-    sd_bus_message *reply = NULL;
-    const char *unit_path = NULL;
-    err = get_unit_path(bus, (char *) qualified_name, &reply, &unit_path);
-    if (err != GGL_ERR_OK) {
-        return GGL_ERR_FAILURE;
-    }
-    GGL_CLEANUP(sd_bus_message_unrefp, reply);
-    return get_lifecycle_state(bus, unit_path, status);
+    process_health_events();
+    return lifecycle_table_get(bus, component_name, status);
 }
 
 GglError gghealthd_update_status(GglBuffer component_name, GglBuffer status) {
     const GglMap STATUS_MAP = GGL_MAP(
         ggl_kv(GGL_STR("NEW"), GGL_OBJ_NULL),
         ggl_kv(GGL_STR("INSTALLED"), GGL_OBJ_NULL),
-        ggl_kv(GGL_STR("STARTING"), ggl_obj_buf(GGL_STR("--reloading"))),
-        ggl_kv(GGL_STR("RUNNING"), ggl_obj_buf(GGL_STR("--ready"))),
+        ggl_kv(GGL_STR("STARTING"), ggl_obj_buf(GGL_STR("RELOADING=1"))),
+        ggl_kv(GGL_STR("RUNNING"), ggl_obj_buf(GGL_STR("READY=1"))),
         ggl_kv(GGL_STR("ERRORED"), GGL_OBJ_NULL),
         ggl_kv(GGL_STR("BROKEN"), GGL_OBJ_NULL),
-        ggl_kv(GGL_STR("STOPPING"), ggl_obj_buf(GGL_STR("--stopping"))),
+        ggl_kv(GGL_STR("STOPPING"), ggl_obj_buf(GGL_STR("STOPPING=1"))),
         ggl_kv(GGL_STR("FINISHED"), GGL_OBJ_NULL)
     );
 
@@ -116,22 +98,12 @@ GglError gghealthd_update_status(GglBuffer component_name, GglBuffer status) {
         return GGL_ERR_OK;
     }
 
-    GglByteVec cgroup = GGL_BYTE_VEC((uint8_t[128]) { 0 });
-    ggl_byte_vec_chain_append(&err, &cgroup, GGL_STR("pids:/system.slice/"));
-    ggl_byte_vec_chain_append(&err, &cgroup, qualified_name_buf);
-    ggl_byte_vec_chain_push(&err, &cgroup, '\0');
-    if (err != GGL_ERR_OK) {
-        return GGL_ERR_FAILURE;
-    }
-
-    const char *argv[] = { "cgexec",
-                           "-g",
-                           (char *) cgroup.buf.data,
-                           "--",
-                           "systemd-notify",
-                           (char *) ggl_obj_into_buf(*status_obj).data,
-                           NULL };
-    err = ggl_exec_command(argv);
+    // Map values are string literals, so they are null-terminated.
+    err = notify_unit_state(
+        bus,
+        (char *) qualified_name,
+        (char *) ggl_obj_into_buf(*status_obj).data
+    );
     if (err != GGL_ERR_OK) {
         GGL_LOGE("Failed to notify status");
     }
@@ -0,0 +1,200 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "lifecycle_table.h"
+#include "bus_client.h"
+#include "sd_bus.h"
+#include <assert.h>
+#include <ggl/buffer.h>
+#include <ggl/cleanup.h>
+#include <ggl/dispatch_table.h>
+#include <ggl/error.h>
+#include <ggl/log.h>
+#include <ggl/nucleus/constants.h>
+#include <string.h>
+#include <systemd/sd-bus.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// Number of units whose lifecycle state can be tracked. Must be a power of
+/// two. Units beyond this are queried from systemd on every request.
+/// Can be configured with `-DGGHEALTHD_MAX_TRACKED_UNITS=<N>`.
+#ifndef GGHEALTHD_MAX_TRACKED_UNITS
+#define GGHEALTHD_MAX_TRACKED_UNITS 256
+#endif
+
+static_assert(
+    (GGHEALTHD_MAX_TRACKED_UNITS & (GGHEALTHD_MAX_TRACKED_UNITS - 1)) == 0,
+    "GGHEALTHD_MAX_TRACKED_UNITS must be a power of two."
+);
+
+typedef enum {
+    ENTRY_EMPTY,
+    ENTRY_USED,
+    ENTRY_REMOVED,
+} EntryState;
+
+typedef struct {
+    EntryState used;
+    uint8_t name[GGL_COMPONENT_NAME_MAX_LEN];
+    size_t name_len;
+    /// Always points to a static string
+    GglBuffer state;
+} LifecycleEntry;
+
+static LifecycleEntry table[GGHEALTHD_MAX_TRACKED_UNITS];
+
+static GglBuffer entry_name(LifecycleEntry *entry) {
+    return (GglBuffer) { .data = entry->name, .len = entry->name_len };
+}
+
+static LifecycleEntry *find_entry(GglBuffer component_name) {
+    uint32_t index = ggl_dispatch_hash(component_name);
+    for (size_t i = 0; i < GGHEALTHD_MAX_TRACKED_UNITS; i++) {
+        LifecycleEntry *entry
+            = &table[(index + i) & (GGHEALTHD_MAX_TRACKED_UNITS - 1)];
+        if (entry->used == ENTRY_EMPTY) {
+            return NULL;
+        }
+        if ((entry->used == ENTRY_USED)
+            && ggl_buffer_eq(entry_name(entry), component_name)) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static LifecycleEntry *insert_entry(GglBuffer component_name) {
+    assert(component_name.len <= GGL_COMPONENT_NAME_MAX_LEN);
+    uint32_t index = ggl_dispatch_hash(component_name);
+    for (size_t i = 0; i < GGHEALTHD_MAX_TRACKED_UNITS; i++) {
+        LifecycleEntry *entry
+            = &table[(index + i) & (GGHEALTHD_MAX_TRACKED_UNITS - 1)];
+        if (entry->used != ENTRY_USED) {
+            entry->used = ENTRY_USED;
+            memcpy(entry->name, component_name.data, component_name.len);
+            entry->name_len = component_name.len;
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static GglError query_state(
+    sd_bus *bus, GglBuffer component_name, GglBuffer *state
+) {
+    uint8_t qualified_name[SERVICE_NAME_MAX_LEN + 1] = { 0 };
+    GglError err = get_service_name(component_name, &GGL_BUF(qualified_name));
+    if (err != GGL_ERR_OK) {
+        return GGL_ERR_FAILURE;
+    }
+
+    sd_bus_message *reply = NULL;
+    const char *unit_path = NULL;
+    err = get_unit_path(bus, (char *) qualified_name, &reply, &unit_path);
+    if (err != GGL_ERR_OK) {
+        return GGL_ERR_FAILURE;
+    }
+    GGL_CLEANUP(sd_bus_message_unrefp, reply);
+    return get_lifecycle_state(bus, unit_path, state);
+}
+
+static GglError lookup_state(
+    sd_bus *bus,
+    GglBuffer component_name,
+    GglBuffer *state,
+    LifecycleEntry **entry_out
+) {
+    LifecycleEntry *entry = find_entry(component_name);
+    if (entry != NULL) {
+        *state = entry->state;
+        *entry_out = entry;
+        return GGL_ERR_OK;
+    }
+
+    // only relay lifecycle state for configured components
+    GglError err = verify_component_exists(component_name);
+    if (err != GGL_ERR_OK) {
+        return err;
+    }
+
+    err = query_state(bus, component_name, state);
+    if (err != GGL_ERR_OK) {
+        return err;
+    }
+
+    entry = insert_entry(component_name);
+    if (entry != NULL) {
+        entry->state = *state;
+    }
+    *entry_out = entry;
+    return GGL_ERR_OK;
+}
+
+GglError lifecycle_table_get(
+    sd_bus *bus, GglBuffer component_name, GglBuffer *state
+) {
+    LifecycleEntry *entry = NULL;
+    GglError err = lookup_state(bus, component_name, state, &entry);
+    if ((err == GGL_ERR_OK) && (entry == NULL)) {
+        GGL_LOGW("Lifecycle table full; not caching state.");
+    }
+    return err;
+}
+
+GglError lifecycle_table_track(
+    sd_bus *bus, GglBuffer component_name, GglBuffer *state
+) {
+    LifecycleEntry *entry = NULL;
+    GglError err = lookup_state(bus, component_name, state, &entry);
+    if ((err == GGL_ERR_OK) && (entry == NULL)) {
+        GGL_LOGE("Lifecycle table full; unable to track component state.");
+        return GGL_ERR_NOMEM;
+    }
+    return err;
+}
+
+bool lifecycle_table_refresh(
+    sd_bus *bus, GglBuffer *component_name, GglBuffer *state
+) {
+    LifecycleEntry *entry = find_entry(*component_name);
+    if (entry == NULL) {
+        return false;
+    }
+
+    GglBuffer new_state;
+    GglError err = verify_component_exists(*component_name);
+    if (err == GGL_ERR_OK) {
+        err = query_state(bus, *component_name, &new_state);
+    }
+    if (err != GGL_ERR_OK) {
+        // Re-query on next use
+        GGL_LOGD(
+            "Dropping lifecycle state of %.*s.",
+            (int) component_name->len,
+            component_name->data
+        );
+        entry->used = ENTRY_REMOVED;
+        return false;
+    }
+
+    *component_name = entry_name(entry);
+    *state = new_state;
+    entry->state = new_state;
+    return true;
+}
+
+bool lifecycle_table_component_from_unit(
+    const char *unit_name, GglBuffer *component_name
+) {
+    GglBuffer name = ggl_buffer_from_null_term((char *) unit_name);
+    if (!ggl_buffer_remove_prefix(&name, GGL_STR(SERVICE_PREFIX))
+        || !ggl_buffer_remove_suffix(&name, GGL_STR(SERVICE_SUFFIX))
+        || (name.len > GGL_COMPONENT_NAME_MAX_LEN)) {
+        return false;
+    }
+    *component_name = name;
+    return true;
+}
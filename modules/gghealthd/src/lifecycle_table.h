@@ -0,0 +1,45 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef GGHEALTHD_LIFECYCLE_TABLE_H
+#define GGHEALTHD_LIFECYCLE_TABLE_H
+
+#include <ggl/buffer.h>
+#include <ggl/error.h>
+#include <systemd/sd-bus.h>
+#include <stdbool.h>
+
+/// In-memory table of component lifecycle states.
+/// Entries are filled on first query and then kept up to date from systemd
+/// unit signals, so that queries are answered without D-Bus round trips.
+/// Only used from the gghealthd server thread.
+
+/// Get a component's lifecycle state, querying systemd on first use.
+GglError lifecycle_table_get(
+    sd_bus *bus, GglBuffer component_name, GglBuffer *state
+);
+
+/// Get a component's lifecycle state and keep it tracked, so that unit
+/// signals for it are reported by lifecycle_table_refresh.
+/// Returns GGL_ERR_NOMEM if the table is full.
+GglError lifecycle_table_track(
+    sd_bus *bus, GglBuffer component_name, GglBuffer *state
+);
+
+/// Re-read the state of a tracked component after a unit signal.
+/// Returns true if the component is tracked, whether or not its state
+/// changed, as a quick restart may return to the same state before the
+/// signals are handled.
+/// On success, component_name is set to the table's copy of the name.
+bool lifecycle_table_refresh(
+    sd_bus *bus, GglBuffer *component_name, GglBuffer *state
+);
+
+/// Get the component name for a ggl unit name or object path.
+/// Returns false if the unit is not a ggl service.
+bool lifecycle_table_component_from_unit(
+    const char *unit_name, GglBuffer *component_name
+);
+
+#endif
@@ -0,0 +1,212 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "subscription_table.h"
+#include <assert.h>
+#include <ggl/buffer.h>
+#include <ggl/core_bus/server.h>
+#include <ggl/dispatch_table.h>
+#include <ggl/nucleus/constants.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// Maximum number of concurrent lifecycle subscriptions.
+/// Can be configured with `-DGGHEALTHD_MAX_SUBSCRIPTIONS=<N>`.
+#ifndef GGHEALTHD_MAX_SUBSCRIPTIONS
+#define GGHEALTHD_MAX_SUBSCRIPTIONS GGL_COREBUS_MAX_CLIENTS
+#endif
+
+/// Size of the table of subscribed components. Must be a power of two and
+/// greater than GGHEALTHD_MAX_SUBSCRIPTIONS.
+/// Can be configured with `-DGGHEALTHD_SUBSCRIPTION_INDEX_SIZE=<N>`.
+#ifndef GGHEALTHD_SUBSCRIPTION_INDEX_SIZE
+#define GGHEALTHD_SUBSCRIPTION_INDEX_SIZE 256
+#endif
+
+static_assert(
+    (GGHEALTHD_SUBSCRIPTION_INDEX_SIZE
+     & (GGHEALTHD_SUBSCRIPTION_INDEX_SIZE - 1))
+        == 0,
+    "GGHEALTHD_SUBSCRIPTION_INDEX_SIZE must be a power of two."
+);
+// Leaves at least one empty slot, which ends every probe sequence
+static_assert(
+    GGHEALTHD_SUBSCRIPTION_INDEX_SIZE > GGHEALTHD_MAX_SUBSCRIPTIONS,
+    "GGHEALTHD_SUBSCRIPTION_INDEX_SIZE too small."
+);
+static_assert(
+    GGHEALTHD_MAX_SUBSCRIPTIONS < INT32_MAX, "Too many subscriptions."
+);
+
+#define INDEX_MASK (GGHEALTHD_SUBSCRIPTION_INDEX_SIZE - 1U)
+#define NO_INDEX (-1)
+
+/// Subscribed component; heads a list of its subscriptions.
+typedef struct {
+    bool used;
+    uint8_t name[GGL_COMPONENT_NAME_MAX_LEN];
+    size_t name_len;
+    int32_t first;
+} SubscribedComponent;
+
+/// Subscription; unused subscriptions form a free list through `next`.
+typedef struct {
+    uint32_t handle;
+    int32_t component;
+    int32_t prev;
+    int32_t next;
+} Subscription;
+
+static SubscribedComponent components[GGHEALTHD_SUBSCRIPTION_INDEX_SIZE];
+static size_t component_count = 0;
+static Subscription subscriptions[GGHEALTHD_MAX_SUBSCRIPTIONS];
+static int32_t free_subscriptions = NO_INDEX;
+static bool subscriptions_initialized = false;
+
+static GglBuffer component_name_buf(SubscribedComponent *component) {
+    return (GglBuffer) { .data = component->name,
+                         .len = component->name_len };
+}
+
+static size_t home_slot(GglBuffer component_name) {
+    return ggl_dispatch_hash(component_name) & INDEX_MASK;
+}
+
+/// Find a component's slot, or the empty slot where it would be inserted.
+static size_t find_slot(GglBuffer component_name) {
+    size_t slot = home_slot(component_name);
+    while (components[slot].used
+           && !ggl_buffer_eq(
+               component_name_buf(&components[slot]), component_name
+           )) {
+        slot = (slot + 1U) & INDEX_MASK;
+    }
+    return slot;
+}
+
+static void set_component(size_t slot, SubscribedComponent *component) {
+    components[slot] = *component;
+    for (int32_t i = component->first; i != NO_INDEX;
+         i = subscriptions[i].next) {
+        subscriptions[i].component = (int32_t) slot;
+    }
+}
+
+/// Backward-shift deletion: moves later entries of the probe sequence into
+/// the freed slot, so that no tombstones are needed and lookups of absent
+/// names stop at the first empty slot.
+static void remove_component(size_t slot) {
+    size_t hole = slot;
+    for (size_t i = (slot + 1U) & INDEX_MASK; components[i].used;
+         i = (i + 1U) & INDEX_MASK) {
+        size_t home = home_slot(component_name_buf(&components[i]));
+        // The entry may move back unless its home lies after the hole
+        if (((i - home) & INDEX_MASK) >= ((i - hole) & INDEX_MASK)) {
+            set_component(hole, &components[i]);
+            hole = i;
+        }
+    }
+    components[hole].used = false;
+    component_count -= 1;
+}
+
+static void init_subscriptions(void) {
+    for (int32_t i = 0; i < GGHEALTHD_MAX_SUBSCRIPTIONS; i++) {
+        subscriptions[i] = (Subscription) { .handle = 0,
+                                            .component = NO_INDEX,
+                                            .prev = NO_INDEX,
+                                            .next = i + 1 };
+    }
+    subscriptions[GGHEALTHD_MAX_SUBSCRIPTIONS - 1].next = NO_INDEX;
+    free_subscriptions = 0;
+    subscriptions_initialized = true;
+}
+
+void *subscription_table_add(GglBuffer component_name, uint32_t handle) {
+    if (!subscriptions_initialized) {
+        init_subscriptions();
+    }
+    if (free_subscriptions == NO_INDEX) {
+        return NULL;
+    }
+    assert(component_name.len <= GGL_COMPONENT_NAME_MAX_LEN);
+
+    size_t slot = find_slot(component_name);
+    SubscribedComponent *component = &components[slot];
+    if (!component->used) {
+        *component = (SubscribedComponent) { .used = true,
+                                             .name_len = component_name.len,
+                                             .first = NO_INDEX };
+        memcpy(component->name, component_name.data, component_name.len);
+        component_count += 1;
+    }
+
+    int32_t index = free_subscriptions;
+    Subscription *sub = &subscriptions[index];
+    free_subscriptions = sub->next;
+
+    *sub = (Subscription) { .handle = handle,
+                            .component = (int32_t) slot,
+                            .prev = NO_INDEX,
+                            .next = component->first };
+    if (component->first != NO_INDEX) {
+        subscriptions[component->first].prev = index;
+    }
+    component->first = index;
+    return sub;
+}
+
+bool subscription_table_remove(void *ctx, uint32_t handle) {
+    Subscription *sub = ctx;
+    if ((sub == NULL) || (sub->handle != handle)
+        || (sub->component == NO_INDEX)) {
+        return false;
+    }
+    int32_t index = (int32_t) (sub - subscriptions);
+    size_t slot = (size_t) sub->component;
+    SubscribedComponent *component = &components[slot];
+
+    if (sub->prev != NO_INDEX) {
+        subscriptions[sub->prev].next = sub->next;
+    } else {
+        component->first = sub->next;
+    }
+    if (sub->next != NO_INDEX) {
+        subscriptions[sub->next].prev = sub->prev;
+    }
+
+    *sub = (Subscription) { .handle = 0,
+                            .component = NO_INDEX,
+                            .prev = NO_INDEX,
+                            .next = free_subscriptions };
+    free_subscriptions = index;
+
+    if (component->first == NO_INDEX) {
+        remove_component(slot);
+    }
+    return true;
+}
+
+void subscription_table_foreach(
+    GglBuffer component_name,
+    void (*fn)(uint32_t handle, void *ctx),
+    void *ctx
+) {
+    size_t slot = find_slot(component_name);
+    if (!components[slot].used) {
+        return;
+    }
+    int32_t index = components[slot].first;
+    while (index != NO_INDEX) {
+        int32_t next = subscriptions[index].next;
+        fn(subscriptions[index].handle, ctx);
+        index = next;
+    }
+}
+
+size_t subscription_table_component_count(void) {
+    return component_count;
+}
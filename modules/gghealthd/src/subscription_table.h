@@ -0,0 +1,35 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef GGHEALTHD_SUBSCRIPTION_TABLE_H
+#define GGHEALTHD_SUBSCRIPTION_TABLE_H
+
+#include <ggl/buffer.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// Lifecycle subscriptions indexed by component name.
+/// Only used from the gghealthd server thread.
+
+/// Add a subscription for a component.
+/// Returns a context for removing the subscription, or NULL if full.
+void *subscription_table_add(GglBuffer component_name, uint32_t handle);
+
+/// Remove the subscription added with ctx.
+/// Returns false if it was already removed.
+bool subscription_table_remove(void *ctx, uint32_t handle);
+
+/// Call fn for each subscription to a component.
+/// fn may remove the subscription it is called for.
+void subscription_table_foreach(
+    GglBuffer component_name,
+    void (*fn)(uint32_t handle, void *ctx),
+    void *ctx
+);
+
+/// Number of components with at least one subscription.
+size_t subscription_table_component_count(void);
+
+#endif
@@ -3,9 +3,9 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "subscriptions.h"
+#include "lifecycle_table.h"
 #include "sd_bus.h"
-#include <assert.h>
-#include <errno.h>
+#include "subscription_table.h"
 #include <ggl/buffer.h>
 #include <ggl/cleanup.h>
 #include <ggl/core_bus/server.h>
@@ -13,157 +13,158 @@
 #include <ggl/file.h> // IWYU pragma: keep (TODO: remove after file.h refactor)
 #include <ggl/log.h>
 #include <ggl/map.h>
-#include <ggl/nucleus/constants.h>
 #include <ggl/object.h>
 #include <ggl/socket_server.h>
 #include <ggl/utils.h>
 #include <inttypes.h>
-#include <string.h>
 #include <systemd/sd-bus.h>
 #include <systemd/sd-event.h>
 #include <stdbool.h>
-#include <stddef.h>
 #include <stdint.h>
 
-#ifndef GGHEALTHD_MAX_SUBSCRIPIONS
-#define GGHEALTHD_MAX_SUBSCRIPTIONS 10
-#endif
+#define UNIT_PATH_PREFIX "/org/freedesktop/systemd1/unit"
 
-// SoA subscription layout
-static sd_bus_slot *slots[GGHEALTHD_MAX_SUBSCRIPTIONS];
-static uint32_t handles[GGHEALTHD_MAX_SUBSCRIPTIONS];
-static size_t component_names_len[GGHEALTHD_MAX_SUBSCRIPTIONS];
-static uint8_t component_names[GGHEALTHD_MAX_SUBSCRIPTIONS]
-                              [GGL_COMPONENT_NAME_MAX_LEN];
+/// Subscription table key for broadcast subscriptions; never a component
+/// name, as those are validated against the config.
+#define ALL_COMPONENTS GGL_STR("")
 
 static sd_bus *global_bus;
+static sd_bus_slot *properties_slot;
+static sd_bus_slot *job_removed_slot;
 
-static GglBuffer component_name_buf(int index) {
-    assert((index >= 0) && (index < GGHEALTHD_MAX_SUBSCRIPTIONS));
-    return ggl_buffer_substr(
-        GGL_BUF(component_names[index]), 0, component_names_len[index]
-    );
+// Event loop thread functions //
+
+static void respond_subscriber(uint32_t handle, void *ctx) {
+    GglObject *response = ctx;
+    ggl_sub_respond(handle, *response);
 }
 
-// Event loop thread functions //
+// RUNNING, FINISHED, BROKEN,  terminal states
+static bool is_terminal_state(GglBuffer status) {
+    return ggl_buffer_eq(GGL_STR("BROKEN"), status)
+        || ggl_buffer_eq(GGL_STR("FINISHED"), status)
+        || ggl_buffer_eq(GGL_STR("RUNNING"), status);
+}
 
-static int properties_changed_handler(
-    sd_bus_message *m, void *user_data, sd_bus_error *ret_error
-) {
-    // index = &slots[index] - &slots[0]
-    ptrdiff_t index = ((sd_bus_slot **) user_data) - &slots[0];
-    if ((index < 0) || (index >= GGHEALTHD_MAX_SUBSCRIPTIONS)) {
-        GGL_LOGE("Bogus index retrieved.");
-        sd_bus_error_set_errno(ret_error, -EINVAL);
-        return -1;
-    }
-    if (slots[index] == NULL) {
-        GGL_LOGD("Signal received after unref.");
-        return -1;
+// Every terminal signal is reported, even if the cached state is unchanged,
+// as a restart may pass through other states before its signals are handled.
+static void notify_subscribers(GglBuffer component_name, GglBuffer status) {
+    if (!is_terminal_state(status)) {
+        GGL_LOGD("Signalled for non-terminal state. ");
+        return;
     }
-    uint32_t handle = handles[index];
-    if (handle == 0) {
-        GGL_LOGD("Signal received after handle closed.");
-        return -1;
+
+    GGL_LOGI(
+        "%.*s finished their lifecycle (status=%.*s)",
+        (int) component_name.len,
+        component_name.data,
+        (int) status.len,
+        status.data
+    );
+    GglObject response = ggl_obj_map(GGL_MAP(
+        ggl_kv(GGL_STR("component_name"), ggl_obj_buf(component_name)),
+        ggl_kv(GGL_STR("lifecycle_state"), ggl_obj_buf(status))
+    ));
+    // A failed response closes the subscription, unlinking it.
+    subscription_table_foreach(component_name, respond_subscriber, &response);
+    subscription_table_foreach(ALL_COMPONENTS, respond_subscriber, &response);
+}
+
+static void unit_changed(const char *unit_name) {
+    GglBuffer component_name;
+    if (!lifecycle_table_component_from_unit(unit_name, &component_name)) {
+        return;
     }
 
-    GglBuffer component_name = component_name_buf((int) index);
-    sd_bus *bus = sd_bus_message_get_bus(m);
-    if (bus == NULL) {
-        GGL_LOGW("No bus connection?");
+    GglBuffer status = GGL_STR("");
+    if (!lifecycle_table_refresh(global_bus, &component_name, &status)) {
+        return;
     }
+    notify_subscribers(component_name, status);
+}
+
+static int properties_changed_handler(
+    sd_bus_message *m, void *user_data, sd_bus_error *ret_error
+) {
+    (void) user_data;
+    (void) ret_error;
 
     const char *unit_path = sd_bus_message_get_path(m);
     if (unit_path == NULL) {
         GGL_LOGD("Message has no path. Skipping signal.");
         return 0;
     }
-    GGL_LOGD("Properties changed for %s", unit_path);
 
-    GglBuffer status = GGL_STR("");
-    GglError ret = get_lifecycle_state(bus, unit_path, &status);
-    if (ret != GGL_ERR_OK) {
-        return -1;
-    }
-
-    // RUNNING, FINISHED, BROKEN,  terminal states
-    if (ggl_buffer_eq(GGL_STR("BROKEN"), status)
-        || ggl_buffer_eq(GGL_STR("FINISHED"), status)
-        || ggl_buffer_eq(GGL_STR("RUNNING"), status)) {
-        GGL_LOGI(
-            "%.*s finished their lifecycle (status=%.*s)",
-            (int) component_name.len,
-            component_name.data,
-            (int) status.len,
-            status.data
-        );
-        ggl_sub_respond(
-            handle,
-            ggl_obj_map(GGL_MAP(
-                ggl_kv(GGL_STR("component_name"), ggl_obj_buf(component_name)),
-                ggl_kv(GGL_STR("lifecycle_state"), ggl_obj_buf(status))
-            ))
-        );
-    } else {
-        GGL_LOGD("Signalled for non-terminal state. ");
+    char *unit_name = NULL;
+    int sd_err = sd_bus_path_decode(unit_path, UNIT_PATH_PREFIX, &unit_name);
+    GGL_CLEANUP(cleanup_free, unit_name);
+    if (sd_err <= 0) {
+        return 0;
     }
-
+    GGL_LOGT("Properties changed for %s", unit_name);
+    unit_changed(unit_name);
     return 0;
 }
 
-static GglError register_dbus_signal(int index) {
-    GGL_LOGD("Event loop thread enabling signal for %d.", index);
-    uint8_t qualified_name_bytes[SERVICE_NAME_MAX_LEN + 1];
-    GglBuffer qualified_name = GGL_BUF(qualified_name_bytes);
-    GglBuffer component_name = component_name_buf(index);
-    GglError ret = get_service_name(component_name, &qualified_name);
-    if (ret != GGL_ERR_OK) {
-        return ret;
-    }
+// JobRemoved covers state changes that do not change unit properties, e.g. a
+// failed start of an already failed unit.
+static int job_removed_handler(
+    sd_bus_message *m, void *user_data, sd_bus_error *ret_error
+) {
+    (void) user_data;
+    (void) ret_error;
 
-    sd_bus_message *reply = NULL;
-    const char *unit_path = NULL;
-    ret = get_unit_path(
-        global_bus, (const char *) qualified_name.data, &reply, &unit_path
-    );
-    GGL_CLEANUP(sd_bus_message_unrefp, reply);
-    if (ret != GGL_ERR_OK) {
-        return ret;
+    uint32_t id = 0;
+    const char *job_path = NULL;
+    const char *unit_name = NULL;
+    const char *result = NULL;
+    int sd_err
+        = sd_bus_message_read(m, "uoss", &id, &job_path, &unit_name, &result);
+    if (sd_err < 0) {
+        GGL_LOGD("Malformed JobRemoved signal (errno=%d).", -sd_err);
+        return 0;
     }
+    GGL_LOGT("Job removed for %s (result=%s)", unit_name, result);
+    unit_changed(unit_name);
+    return 0;
+}
 
-    sd_bus_slot *slot = NULL;
-    int sd_err = sd_bus_match_signal(
+// A single match for all units, so that the number of signal matches on the
+// bus does not grow with the number of components or subscribers.
+static GglError register_dbus_signals(void) {
+    int sd_err = sd_bus_add_match(
         global_bus,
-        &slot,
-        NULL,
-        unit_path,
-        "org.freedesktop.DBus.Properties",
-        "PropertiesChanged",
+        &properties_slot,
+        "type='signal',"
+        "sender='" DEFAULT_DESTINATION "',"
+        "interface='org.freedesktop.DBus.Properties',"
+        "member='PropertiesChanged',"
+        "path_namespace='" UNIT_PATH_PREFIX "'",
         properties_changed_handler,
-        &slots[index]
+        NULL
     );
     if (sd_err < 0) {
-        GGL_LOGE(
-            "Failed to match signal (unit=%s) (errno=%d)", unit_path, -sd_err
-        );
+        GGL_LOGE("Failed to match unit signals (errno=%d)", -sd_err);
         return translate_dbus_call_error(sd_err);
     }
-    slots[index] = slot;
-    GGL_LOGD("Accepting subscription.");
-    ggl_sub_accept(
-        handles[index], gghealthd_unregister_lifecycle_subscription, NULL
+
+    sd_err = sd_bus_match_signal(
+        global_bus,
+        &job_removed_slot,
+        DEFAULT_DESTINATION,
+        DEFAULT_PATH,
+        MANAGER_INTERFACE,
+        "JobRemoved",
+        job_removed_handler,
+        NULL
     );
+    if (sd_err < 0) {
+        GGL_LOGE("Failed to match job signals (errno=%d)", -sd_err);
+        return translate_dbus_call_error(sd_err);
+    }
     return GGL_ERR_OK;
 }
 
-static void unregister_dbus_signal(int index) {
-    GGL_LOGD("Event loop thread disabling signal for %d.", index);
-    sd_bus_slot_unref(slots[index]);
-    slots[index] = NULL;
-    handles[index] = 0;
-    component_names_len[index] = 0;
-}
-
 static sd_event *sd_event_ctx;
 
 static void event_handle_callback(void) {
@@ -173,6 +174,12 @@ static void event_handle_callback(void) {
     GGL_LOGD("Event loop returned %d.", ret);
 }
 
+void process_health_events(void) {
+    if (sd_event_ctx != NULL) {
+        event_handle_callback();
+    }
+}
+
 void init_health_events(void) {
     while (true) {
         GglError ret = open_bus(&global_bus);
@@ -183,6 +190,10 @@ void init_health_events(void) {
         (void) ggl_sleep(1);
     }
 
+    while (register_dbus_signals() != GGL_ERR_OK) {
+        (void) ggl_sleep(1);
+    }
+
     do {
         sd_bus_error error = SD_BUS_ERROR_NULL;
         int sd_ret = sd_bus_call_method(
@@ -243,34 +254,55 @@ GglError gghealthd_register_lifecycle_subscription(
         handle
     );
 
-    // find first free slot
+    // Validates the component and starts tracking its state; without
+    // tracking, the subscriber would never be notified
+    GglBuffer status;
+    GglError ret = lifecycle_table_track(global_bus, component_name, &status);
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
+    void *sub = subscription_table_add(component_name, handle);
+    if (sub == NULL) {
+        GGL_LOGE("Unable to find open subscription slot.");
+        return GGL_ERR_NOMEM;
+    }
 
-    int index = 0;
-    for (; index < GGHEALTHD_MAX_SUBSCRIPTIONS; ++index) {
-        if (handles[index] == 0) {
-            break;
-        }
+    GGL_LOGD("Accepting subscription.");
+    ggl_sub_accept(handle, gghealthd_unregister_lifecycle_subscription, sub);
+
+    // The component may have finished its lifecycle before subscribing
+    if (is_terminal_state(status)) {
+        ggl_sub_respond(
+            handle,
+            ggl_obj_map(GGL_MAP(
+                ggl_kv(GGL_STR("component_name"), ggl_obj_buf(component_name)),
+                ggl_kv(GGL_STR("lifecycle_state"), ggl_obj_buf(status))
+            ))
+        );
     }
-    if (index == GGHEALTHD_MAX_SUBSCRIPTIONS) {
+    return GGL_ERR_OK;
+}
+
+GglError gghealthd_register_lifecycle_broadcast(uint32_t handle) {
+    GGL_LOGT(
+        "Registering watch on all components (handle=%" PRIu32 ")", handle
+    );
+
+    void *sub = subscription_table_add(ALL_COMPONENTS, handle);
+    if (sub == NULL) {
         GGL_LOGE("Unable to find open subscription slot.");
         return GGL_ERR_NOMEM;
     }
 
-    GGL_LOGT("Initializing subscription (index=%d).", index);
-    memcpy(component_names[index], component_name.data, component_name.len);
-    component_names_len[index] = component_name.len;
-    handles[index] = handle;
-    GglError ret = register_dbus_signal(index);
-    return ret;
+    GGL_LOGD("Accepting broadcast subscription.");
+    ggl_sub_accept(handle, gghealthd_unregister_lifecycle_subscription, sub);
+    return GGL_ERR_OK;
 }
 
 void gghealthd_unregister_lifecycle_subscription(void *ctx, uint32_t handle) {
     GGL_LOGT("Unregistering %" PRIu32, handle);
-    (void) ctx;
-    for (int index = 0; index < GGHEALTHD_MAX_SUBSCRIPTIONS; ++index) {
-        if (handles[index] == handle) {
-            GGL_LOGT("Found handle (index=%d).", index);
-            unregister_dbus_signal(index);
-        }
+    if (!subscription_table_remove(ctx, handle)) {
+        GGL_LOGD("Subscription already released.");
     }
 }
@@ -13,8 +13,16 @@ GglError gghealthd_register_lifecycle_subscription(
     GglBuffer component_name, uint32_t handle
 );
 
+/// Subscribe to lifecycle updates of every component gghealthd tracks.
+/// A component is tracked once its status has been read or subscribed to.
+GglError gghealthd_register_lifecycle_broadcast(uint32_t handle);
+
 void gghealthd_unregister_lifecycle_subscription(void *ctx, uint32_t handle);
 
 void init_health_events(void);
 
+/// Dispatch pending systemd signals. Method calls on the shared bus may queue
+/// signals without waking the event loop.
+void process_health_events(void);
+
 #endif
@@ -0,0 +1,365 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "unit_notify.h"
+#include "sd_bus.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <ggl/cleanup.h>
+#include <ggl/error.h>
+#include <ggl/exec.h>
+#include <ggl/log.h>
+#include <limits.h>
+#include <linux/magic.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/statfs.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <systemd/sd-bus.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdnoreturn.h>
+
+/// Time to wait for systemd to process a notification sent from the unit's
+/// cgroup before the sending process exits.
+#define NOTIFY_BARRIER_TIMEOUT_MS 5000
+
+static GglError get_notify_address(
+    struct sockaddr_un *addr, socklen_t *addr_len
+) {
+    const char *path = getenv("NOTIFY_SOCKET");
+    if ((path == NULL) || (path[0] == '\0')) {
+        path = "/run/systemd/notify";
+    }
+
+    size_t path_len = strlen(path);
+    if ((path[0] != '/') && (path[0] != '@')) {
+        GGL_LOGE("Unsupported NOTIFY_SOCKET address %s.", path);
+        return GGL_ERR_CONFIG;
+    }
+    if (path_len >= sizeof(addr->sun_path)) {
+        GGL_LOGE("NOTIFY_SOCKET path too long.");
+        return GGL_ERR_CONFIG;
+    }
+
+    *addr = (struct sockaddr_un) { .sun_family = AF_UNIX };
+    memcpy(addr->sun_path, path, path_len);
+    if (path[0] == '@') {
+        // abstract namespace socket; not null terminated
+        addr->sun_path[0] = '\0';
+        *addr_len = (socklen_t) (offsetof(struct sockaddr_un, sun_path)
+                                 + path_len);
+    } else {
+        *addr_len = (socklen_t) (offsetof(struct sockaddr_un, sun_path)
+                                 + path_len + 1);
+    }
+    return GGL_ERR_OK;
+}
+
+// Only uses async-signal-safe functions; called in forked child.
+static int send_datagram(
+    int fd,
+    const struct sockaddr_un *addr,
+    socklen_t addr_len,
+    const char *msg,
+    const struct ucred *cred,
+    int pass_fd
+) {
+    struct iovec iov = { .iov_base = (void *) msg, .iov_len = strlen(msg) };
+    union {
+        struct cmsghdr align;
+        uint8_t buf[CMSG_SPACE(sizeof(struct ucred)) + CMSG_SPACE(sizeof(int))];
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    struct msghdr hdr = {
+        .msg_name = (void *) addr,
+        .msg_namelen = addr_len,
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control.buf,
+        .msg_controllen = sizeof(control.buf),
+    };
+
+    // CMSG_FIRSTHDR is NULL unless msg_controllen covers a header, so the
+    // length is set to what was used only after filling the buffer.
+    size_t control_len = 0;
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr);
+    if (cred != NULL) {
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_CREDENTIALS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(struct ucred));
+        memcpy(CMSG_DATA(cmsg), cred, sizeof(struct ucred));
+        control_len += CMSG_SPACE(sizeof(struct ucred));
+        cmsg = (struct cmsghdr *) &control.buf[control_len];
+    }
+    if (pass_fd >= 0) {
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &pass_fd, sizeof(int));
+        control_len += CMSG_SPACE(sizeof(int));
+    }
+    hdr.msg_controllen = control_len;
+    if (control_len == 0) {
+        hdr.msg_control = NULL;
+    }
+
+    return (int) sendmsg(fd, &hdr, MSG_NOSIGNAL);
+}
+
+static GglError get_unit_properties(
+    sd_bus *bus, const char *unit_path, uint32_t *main_pid, char **cgroup
+) {
+    sd_bus_error error = SD_BUS_ERROR_NULL;
+    GGL_CLEANUP(sd_bus_error_free, error);
+    int ret = sd_bus_get_property_trivial(
+        bus,
+        DEFAULT_DESTINATION,
+        unit_path,
+        SERVICE_INTERFACE,
+        "MainPID",
+        &error,
+        'u',
+        main_pid
+    );
+    if (ret < 0) {
+        GGL_LOGE("Unable to retrieve D-Bus MainPID property (errno=%d)", -ret);
+        return translate_dbus_call_error(ret);
+    }
+
+    ret = sd_bus_get_property_string(
+        bus,
+        DEFAULT_DESTINATION,
+        unit_path,
+        SERVICE_INTERFACE,
+        "ControlGroup",
+        &error,
+        cgroup
+    );
+    if (ret < 0) {
+        GGL_LOGE(
+            "Unable to retrieve D-Bus ControlGroup property (errno=%d)", -ret
+        );
+        return translate_dbus_call_error(ret);
+    }
+    return GGL_ERR_OK;
+}
+
+// Only uses async-signal-safe functions; called in forked child.
+static bool join_cgroup(char cgroup_procs[2][PATH_MAX]) {
+    for (size_t i = 0; i < 2; i++) {
+        int fd = open(cgroup_procs[i], O_WRONLY | O_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+        ssize_t written = write(fd, "0", 1);
+        (void) close(fd);
+        if (written == 1) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Only uses async-signal-safe functions; called in forked child.
+noreturn static void send_from_child(
+    int fd,
+    const struct sockaddr_un *addr,
+    socklen_t addr_len,
+    const char *state,
+    int barrier[2]
+) {
+    if (send_datagram(fd, addr, addr_len, state, NULL, -1) < 0) {
+        _exit(1);
+    }
+    if (send_datagram(fd, addr, addr_len, "BARRIER=1", NULL, barrier[1]) < 0) {
+        _exit(1);
+    }
+    (void) close(barrier[1]);
+    struct pollfd pfd = { .fd = barrier[0], .events = POLLIN };
+    (void) poll(&pfd, 1, NOTIFY_BARRIER_TIMEOUT_MS);
+    _exit(0);
+}
+
+// Creates the child directly in the unit's cgroup v2 directory, either at
+// the root of a unified hierarchy or under "unified" in a hybrid one.
+static GglError fork_into_cgroup_v2(const char *cgroup, pid_t *pid) {
+    static const char *const MOUNTS[] = { "/sys/fs/cgroup",
+                                          "/sys/fs/cgroup/unified" };
+    for (size_t i = 0; i < sizeof(MOUNTS) / sizeof(MOUNTS[0]); i++) {
+        char path[PATH_MAX];
+        int len = snprintf(path, sizeof(path), "%s%s", MOUNTS[i], cgroup);
+        if ((len < 0) || ((size_t) len >= sizeof(path))) {
+            return GGL_ERR_RANGE;
+        }
+        int dir_fd = open(path, O_PATH | O_DIRECTORY | O_CLOEXEC);
+        if (dir_fd < 0) {
+            continue;
+        }
+        // e.g. the tmpfs holding cgroup v1 hierarchies
+        struct statfs fs;
+        if ((fstatfs(dir_fd, &fs) != 0) || (fs.f_type != CGROUP2_SUPER_MAGIC)) {
+            (void) close(dir_fd);
+            continue;
+        }
+        GglError ret = ggl_exec_fork_in_cgroup(dir_fd, pid);
+        if ((ret == GGL_ERR_OK) && (*pid == 0)) {
+            return GGL_ERR_OK;
+        }
+        (void) close(dir_fd);
+        return ret;
+    }
+    return GGL_ERR_NOENTRY;
+}
+
+// Forks and moves the child into the unit's cgroup, for cgroup v1 hosts and
+// kernels without CLONE_INTO_CGROUP.
+static GglError fork_and_join_cgroup(const char *cgroup, pid_t *pid) {
+    char cgroup_procs[2][PATH_MAX];
+    int len = snprintf(
+        cgroup_procs[0], PATH_MAX, "/sys/fs/cgroup%s/cgroup.procs", cgroup
+    );
+    if ((len < 0) || (len >= PATH_MAX)) {
+        return GGL_ERR_RANGE;
+    }
+    // cgroup v1 systemd hierarchy
+    len = snprintf(
+        cgroup_procs[1],
+        PATH_MAX,
+        "/sys/fs/cgroup/systemd%s/cgroup.procs",
+        cgroup
+    );
+    if ((len < 0) || (len >= PATH_MAX)) {
+        return GGL_ERR_RANGE;
+    }
+
+    pid_t child = fork();
+    if (child == 0) {
+        if (!join_cgroup(cgroup_procs)) {
+            _exit(1);
+        }
+    } else if (child < 0) {
+        GGL_LOGE("Failed to fork notify process (errno=%d).", errno);
+        return GGL_ERR_FAILURE;
+    }
+    *pid = child;
+    return GGL_ERR_OK;
+}
+
+// Used when the main PID can't be attributed directly (requires
+// CAP_SYS_ADMIN). A child created in the unit's cgroup, which systemd
+// accepts with NotifyAccess=all, sends the notification with its own
+// credentials. The child waits on a barrier so it is still alive while
+// systemd looks up its cgroup.
+static GglError notify_from_cgroup(
+    int fd,
+    const struct sockaddr_un *addr,
+    socklen_t addr_len,
+    const char *cgroup,
+    const char *state
+) {
+    int barrier[2];
+    if (pipe2(barrier, O_CLOEXEC) != 0) {
+        GGL_LOGE("Failed to create notify barrier pipe (errno=%d).", errno);
+        return GGL_ERR_FAILURE;
+    }
+
+    pid_t pid = -1;
+    GglError err = fork_into_cgroup_v2(cgroup, &pid);
+    if (err != GGL_ERR_OK) {
+        GGL_LOGT("Unable to spawn into cgroup v2 directory; joining instead.");
+        err = fork_and_join_cgroup(cgroup, &pid);
+    }
+    if ((err == GGL_ERR_OK) && (pid == 0)) {
+        send_from_child(fd, addr, addr_len, state, barrier);
+    }
+
+    (void) close(barrier[0]);
+    (void) close(barrier[1]);
+    if (err != GGL_ERR_OK) {
+        return err;
+    }
+
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            GGL_LOGE("Failed to wait for notify process (errno=%d).", errno);
+            return GGL_ERR_FAILURE;
+        }
+    }
+    if (!WIFEXITED(status) || (WEXITSTATUS(status) != 0)) {
+        GGL_LOGE("Failed to send notification from %s.", cgroup);
+        return GGL_ERR_FAILURE;
+    }
+    return GGL_ERR_OK;
+}
+
+GglError notify_pid_state(pid_t pid, const char *cgroup, const char *state) {
+    struct sockaddr_un addr;
+    socklen_t addr_len;
+    GglError err = get_notify_address(&addr, &addr_len);
+    if (err != GGL_ERR_OK) {
+        return err;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        GGL_LOGE("Failed to create notify socket (errno=%d).", errno);
+        return GGL_ERR_FAILURE;
+    }
+    GGL_CLEANUP(cleanup_close, fd);
+
+    if (pid != 0) {
+        struct ucred cred = { .pid = pid, .uid = getuid(), .gid = getgid() };
+        if (send_datagram(fd, &addr, addr_len, state, &cred, -1) >= 0) {
+            return GGL_ERR_OK;
+        }
+        if (errno != EPERM) {
+            GGL_LOGE("Failed to send notification (errno=%d).", errno);
+            return GGL_ERR_FAILURE;
+        }
+        GGL_LOGT("Not permitted to send as main PID; joining cgroup.");
+    }
+
+    if ((cgroup == NULL) || (cgroup[0] == '\0')) {
+        GGL_LOGE("No control group to send the notification from.");
+        return GGL_ERR_FAILURE;
+    }
+    return notify_from_cgroup(fd, &addr, addr_len, cgroup, state);
+}
+
+GglError notify_unit_state(
+    sd_bus *bus, const char *qualified_name, const char *state
+) {
+    sd_bus_message *reply = NULL;
+    const char *unit_path = NULL;
+    GglError err = get_unit_path(bus, qualified_name, &reply, &unit_path);
+    GGL_CLEANUP(sd_bus_message_unrefp, reply);
+    if (err != GGL_ERR_OK) {
+        return err;
+    }
+
+    uint32_t main_pid = 0;
+    char *cgroup = NULL;
+    err = get_unit_properties(bus, unit_path, &main_pid, &cgroup);
+    GGL_CLEANUP(cleanup_free, cgroup);
+    if (err != GGL_ERR_OK) {
+        return err;
+    }
+
+    if ((main_pid == 0) && ((cgroup == NULL) || (cgroup[0] == '\0'))) {
+        GGL_LOGE("%s has no main process or control group.", qualified_name);
+        return GGL_ERR_FAILURE;
+    }
+    return notify_pid_state((pid_t) main_pid, cgroup, state);
+}
@@ -0,0 +1,26 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef GGHEALTHD_UNIT_NOTIFY_H
+#define GGHEALTHD_UNIT_NOTIFY_H
+
+#include <ggl/attr.h>
+#include <ggl/error.h>
+#include <sys/types.h>
+#include <systemd/sd-bus.h>
+
+/// Send a sd_notify state (e.g. "READY=1") on behalf of a unit.
+/// Equivalent to running `systemd-notify` inside the unit's cgroup.
+NONNULL(1, 2, 3)
+GglError notify_unit_state(
+    sd_bus *bus, const char *qualified_name, const char *state
+);
+
+/// Send a sd_notify state attributed to pid through NOTIFY_SOCKET.
+/// If that is not permitted, or pid is 0, the state is sent from a process
+/// moved into cgroup instead. cgroup may be NULL.
+NONNULL(3)
+GglError notify_pid_state(pid_t pid, const char *cgroup, const char *state);
+
+#endif
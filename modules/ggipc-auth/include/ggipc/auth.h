@@ -14,8 +14,24 @@
 #include <ggl/error.h>
 #include <sys/types.h>
 
+/// Number of cgroups whose component is cached.
+/// Must be a power of two.
+/// Can be configured with `-DGGL_IPC_AUTH_CACHE_LEN=<N>`.
+#ifndef GGL_IPC_AUTH_CACHE_LEN
+#define GGL_IPC_AUTH_CACHE_LEN 64
+#endif
+
 /// Authenticate a client by checking if its pid is associated with its claimed
 /// component name.
 GglError ggl_ipc_auth_validate_name(pid_t pid, GglBuffer component_name);
 
+/// Authenticate a client as with `ggl_ipc_auth_validate_name`, using a pidfd
+/// for the same process to look up its cgroup.
+/// The component for the process's cgroup is cached, so reconnecting
+/// processes skip the systemd unit lookup. Falls back to an uncached lookup
+/// if the kernel cannot report a pidfd's cgroup or `pidfd` is -1.
+GglError ggl_ipc_auth_validate_name_pidfd(
+    pid_t pid, int pidfd, GglBuffer component_name
+);
+
 #endif
@@ -3,14 +3,46 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "ggipc/auth.h"
+#include "identity_cache.h"
+#include <errno.h>
 #include <ggl/buffer.h>
 #include <ggl/cleanup.h>
 #include <ggl/error.h>
 #include <ggl/log.h>
+#include <ggl/nucleus/constants.h>
 #include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
 #include <systemd/sd-login.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
-GglError ggl_ipc_auth_validate_name(pid_t pid, GglBuffer component_name) {
+// PIDFD_GET_INFO is available from Linux 6.13; defined here as libc headers
+// may not have it yet.
+typedef struct {
+    uint64_t mask;
+    uint64_t cgroupid;
+    uint32_t pid;
+    uint32_t tgid;
+    uint32_t ppid;
+    uint32_t ruid;
+    uint32_t rgid;
+    uint32_t euid;
+    uint32_t egid;
+    uint32_t suid;
+    uint32_t sgid;
+    uint32_t fsuid;
+    uint32_t fsgid;
+    uint32_t spare0[1];
+} PidfdInfo;
+
+#define PIDFD_GET_INFO_IOCTL _IOWR(0xFF, 11, PidfdInfo)
+#define PIDFD_INFO_CGROUPID_FLAG (1U << 2)
+
+static GglError unit_component_name(pid_t pid, GglBuffer *component_name) {
     char *unit_name = NULL;
     int error = sd_pid_get_unit(pid, &unit_name);
     GGL_CLEANUP(cleanup_free, unit_name);
@@ -40,6 +72,16 @@ GglError ggl_ipc_auth_validate_name(pid_t pid, GglBuffer component_name) {
         return GGL_ERR_FAILURE;
     }
 
+    if (name.len > component_name->len) {
+        GGL_LOGE("Service for pid %d (%s) name too long.", pid, unit_name);
+        return GGL_ERR_FAILURE;
+    }
+    memcpy(component_name->data, name.data, name.len);
+    component_name->len = name.len;
+    return GGL_ERR_OK;
+}
+
+static GglError check_name(GglBuffer name, GglBuffer component_name) {
     if (!ggl_buffer_eq(name, component_name)) {
         GGL_LOGE(
             "Client claims to be %.*s, found to be %.*s instead.",
@@ -53,3 +95,66 @@ GglError ggl_ipc_auth_validate_name(pid_t pid, GglBuffer component_name) {
 
     return GGL_ERR_OK;
 }
+
+GglError ggl_ipc_auth_validate_name(pid_t pid, GglBuffer component_name) {
+    uint8_t name_mem[GGL_COMPONENT_NAME_MAX_LEN];
+    GglBuffer name = GGL_BUF(name_mem);
+    GglError ret = unit_component_name(pid, &name);
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
+    return check_name(name, component_name);
+}
+
+static bool pidfd_cgroup_id(int pidfd, uint64_t *cgroup_id) {
+    PidfdInfo info = { .mask = PIDFD_INFO_CGROUPID_FLAG };
+    if (ioctl(pidfd, PIDFD_GET_INFO_IOCTL, &info) != 0) {
+        GGL_LOGT("Failed to get pidfd info: %d.", errno);
+        return false;
+    }
+    if (((info.mask & PIDFD_INFO_CGROUPID_FLAG) == 0)
+        || (info.cgroupid == 0)) {
+        return false;
+    }
+    *cgroup_id = info.cgroupid;
+    return true;
+}
+
+GglError ggl_ipc_auth_validate_name_pidfd(
+    pid_t pid, int pidfd, GglBuffer component_name
+) {
+    if (pidfd < 0) {
+        return ggl_ipc_auth_validate_name(pid, component_name);
+    }
+
+    uint8_t name_mem[GGL_COMPONENT_NAME_MAX_LEN];
+    GglBuffer name = GGL_BUF(name_mem);
+
+    uint64_t cgroup_id = 0;
+    bool cacheable = pidfd_cgroup_id(pidfd, &cgroup_id);
+    if (cacheable && identity_cache_get(cgroup_id, &name)) {
+        GGL_LOGT("Found cached component for pid %d.", pid);
+        return check_name(name, component_name);
+    }
+
+    GglError ret = unit_component_name(pid, &name);
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
+    // If the client exited, its pid may have been reused before the lookup
+    if (syscall(SYS_pidfd_send_signal, pidfd, 0, NULL, 0) != 0) {
+        GGL_LOGE("Client pid %d exited during authentication.", pid);
+        return GGL_ERR_FAILURE;
+    }
+
+    // Only cache if the process did not move cgroups during the lookup
+    uint64_t cgroup_id_after = 0;
+    if (cacheable && pidfd_cgroup_id(pidfd, &cgroup_id_after)
+        && (cgroup_id_after == cgroup_id)) {
+        identity_cache_put(cgroup_id, name);
+    }
+
+    return check_name(name, component_name);
+}
@@ -0,0 +1,71 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "identity_cache.h"
+#include "ggipc/auth.h"
+#include <assert.h>
+#include <ggl/buffer.h>
+#include <ggl/cleanup.h>
+#include <ggl/nucleus/constants.h>
+#include <pthread.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+static_assert(
+    (GGL_IPC_AUTH_CACHE_LEN & (GGL_IPC_AUTH_CACHE_LEN - 1)) == 0,
+    "GGL_IPC_AUTH_CACHE_LEN must be a power of two."
+);
+static_assert(
+    GGL_COMPONENT_NAME_MAX_LEN <= UINT8_MAX,
+    "Cached name length must fit in name_len."
+);
+
+// Direct-mapped: a colliding cgroup replaces the previous entry.
+// cgroup IDs are never reused while the system is up, so an entry cannot be
+// matched by a different unit after its unit stops; it is only ever replaced.
+typedef struct {
+    /// 0 if the entry is empty; no cgroup has ID 0.
+    uint64_t cgroup_id;
+    uint8_t name_len;
+    uint8_t name[GGL_COMPONENT_NAME_MAX_LEN];
+} CacheEntry;
+
+static pthread_mutex_t cache_mtx = PTHREAD_MUTEX_INITIALIZER;
+static CacheEntry cache[GGL_IPC_AUTH_CACHE_LEN];
+
+static CacheEntry *entry_for(uint64_t cgroup_id) {
+    // Fibonacci hashing; IDs are sequential so low bits alone would cluster
+    uint64_t hash = cgroup_id * 11400714819323198485U;
+    return &cache[(hash >> 32) & (GGL_IPC_AUTH_CACHE_LEN - 1)];
+}
+
+bool identity_cache_get(uint64_t cgroup_id, GglBuffer *name) {
+    assert(cgroup_id != 0);
+    assert(name->len >= GGL_COMPONENT_NAME_MAX_LEN);
+
+    GGL_MTX_SCOPE_GUARD(&cache_mtx);
+
+    CacheEntry *entry = entry_for(cgroup_id);
+    if (entry->cgroup_id != cgroup_id) {
+        return false;
+    }
+    memcpy(name->data, entry->name, entry->name_len);
+    name->len = entry->name_len;
+    return true;
+}
+
+void identity_cache_put(uint64_t cgroup_id, GglBuffer name) {
+    assert(cgroup_id != 0);
+    if (name.len > GGL_COMPONENT_NAME_MAX_LEN) {
+        return;
+    }
+
+    GGL_MTX_SCOPE_GUARD(&cache_mtx);
+
+    CacheEntry *entry = entry_for(cgroup_id);
+    entry->cgroup_id = cgroup_id;
+    memcpy(entry->name, name.data, name.len);
+    entry->name_len = (uint8_t) name.len;
+}
@@ -0,0 +1,20 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef GGL_IPC_AUTH_IDENTITY_CACHE_H
+#define GGL_IPC_AUTH_IDENTITY_CACHE_H
+
+#include <ggl/buffer.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/// Look up the component a cgroup belongs to.
+/// On a hit, the name is copied into `name`, which must have capacity for
+/// GGL_COMPONENT_NAME_MAX_LEN bytes.
+bool identity_cache_get(uint64_t cgroup_id, GglBuffer *name);
+
+/// Record the component a cgroup belongs to.
+void identity_cache_put(uint64_t cgroup_id, GglBuffer name);
+
+#endif
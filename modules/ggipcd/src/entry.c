@@ -4,6 +4,8 @@
 
 #include "ggipcd.h"
 #include "ipc_components.h"
+#include "ipc_dispatch.h"
+#include "ipc_rate_limit.h"
 #include "ipc_server.h"
 #include <assert.h>
 #include <ggl/arena.h>
@@ -51,7 +53,22 @@ GglError run_ggipcd(GglIpcArgs *args) {
         socket_path = path_vec.buf;
     }
 
-    GglError err = ggl_ipc_start_component_server();
+    // Authorization reads component accessControl policy on every request
+    GglError err = ggl_gg_config_cache_enable(
+        GGL_BUF_LIST(GGL_STR("services"))
+    );
+    if (err != GGL_ERR_OK) {
+        GGL_LOGW("Failed to enable config cache; continuing without it.");
+    }
+
+    ggl_ipc_rate_limit_init();
+
+    err = ggl_ipc_dispatch_init();
+    if (err != GGL_ERR_OK) {
+        return err;
+    }
+
+    err = ggl_ipc_start_component_server();
 
     if (err != GGL_ERR_OK) {
         GGL_LOGE("Failed to start ggl_ipc_component_server.");
@@ -3,11 +3,13 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "ipc_components.h"
+#include "ipc_rate_limit.h"
 #include <assert.h>
 #include <ggl/base64.h>
 #include <ggl/buffer.h>
 #include <ggl/cleanup.h>
 #include <ggl/core_bus/server.h>
+#include <ggl/dispatch_table.h>
 #include <ggl/error.h>
 #include <ggl/flags.h>
 #include <ggl/ipc/limits.h>
@@ -44,6 +46,29 @@ static uint8_t component_name_lengths[GGL_MAX_GENERIC_COMPONENTS];
 
 static GglComponentHandle registered_components = 0;
 
+/// Slots in each open-addressing index of registered components.
+/// Kept at most half full so probe sequences stay short.
+#define INDEX_SLOTS (2 * GGL_MAX_GENERIC_COMPONENTS)
+
+// Component handles by svcuid and by name; 0 marks an empty slot
+static GglComponentHandle svcuid_index[INDEX_SLOTS];
+static GglComponentHandle name_index[INDEX_SLOTS];
+
+static size_t svcuid_slot(GglSvcuid svcuid) {
+    // svcuids are random, so their bytes are already uniformly distributed
+    uint64_t hash;
+    memcpy(&hash, svcuid.val, sizeof(hash));
+    return (size_t) (hash % INDEX_SLOTS);
+}
+
+static size_t name_slot(GglBuffer name) {
+    return ggl_dispatch_hash(name) % INDEX_SLOTS;
+}
+
+static size_t next_slot(size_t slot) {
+    return (slot + 1) % INDEX_SLOTS;
+}
+
 GglError ggl_ipc_svcuid_from_str(GglBuffer svcuid, GglSvcuid *out) {
     if (svcuid.len != GGL_IPC_SVCUID_STR_LEN) {
         return GGL_ERR_INVALID;
@@ -116,11 +141,42 @@ static GglError verify_svcuid(void *ctx, GglMap params, uint32_t handle) {
     return GGL_ERR_OK;
 }
 
+static GglError get_rate_limit_stats(
+    void *ctx, GglMap params, uint32_t handle
+) {
+    (void) ctx;
+    (void) params;
+
+    GglKV pairs[GGL_IPC_RATE_CLASS_COUNT];
+    GglKV counters[GGL_IPC_RATE_CLASS_COUNT][2];
+    for (size_t i = 0; i < GGL_IPC_RATE_CLASS_COUNT; i++) {
+        GglIpcRateLimitStats stats;
+        ggl_ipc_rate_limit_stats((GglIpcRateClass) i, &stats);
+        counters[i][0]
+            = ggl_kv(GGL_STR("allowed"), ggl_obj_i64((int64_t) stats.allowed));
+        counters[i][1] = ggl_kv(
+            GGL_STR("throttled"), ggl_obj_i64((int64_t) stats.throttled)
+        );
+        pairs[i] = ggl_kv(
+            ggl_ipc_rate_class_name((GglIpcRateClass) i),
+            ggl_obj_map((GglMap) { .pairs = counters[i], .len = 2 })
+        );
+    }
+
+    ggl_respond(
+        handle,
+        ggl_obj_map((GglMap) { .pairs = pairs,
+                               .len = GGL_IPC_RATE_CLASS_COUNT })
+    );
+    return GGL_ERR_OK;
+}
+
 static void *ggl_ipc_component_server(void *args) {
     (void) args;
 
     GglRpcMethodDesc handlers[] = {
         { GGL_STR("verify_svcuid"), false, verify_svcuid, NULL },
+        { GGL_STR("get_rate_limit_stats"), false, get_rate_limit_stats, NULL },
     };
     size_t handlers_len = sizeof(handlers) / sizeof(handlers[0]);
 
@@ -161,9 +217,9 @@ GglError ggl_ipc_components_get_handle(
 ) {
     GGL_MTX_SCOPE_GUARD(&ggl_ipc_component_registered_components_mtx);
 
-    // Match decoded SVCUID and return match
-
-    for (GglComponentHandle i = 1; i <= registered_components; i++) {
+    for (size_t slot = svcuid_slot(svcuid); svcuid_index[slot] != 0;
+         slot = next_slot(slot)) {
+        GglComponentHandle i = svcuid_index[slot];
         if (memcmp(svcuid.val, get_svcuid(i).val, sizeof(svcuid.val)) == 0) {
             if (component_handle != NULL) {
                 *component_handle = i;
@@ -184,7 +240,9 @@ GglError ggl_ipc_components_register(
 ) {
     GGL_MTX_SCOPE_GUARD(&ggl_ipc_component_registered_components_mtx);
 
-    for (GglComponentHandle i = 1; i <= registered_components; i++) {
+    size_t name_pos = name_slot(component_name);
+    for (; name_index[name_pos] != 0; name_pos = next_slot(name_pos)) {
+        GglComponentHandle i = name_index[name_pos];
         if (ggl_buffer_eq(component_name, ggl_ipc_components_get_name(i))) {
             *component_handle = i;
             *svcuid = get_svcuid(i);
@@ -218,5 +276,12 @@ GglError ggl_ipc_components_register(
     }
     *svcuid = get_svcuid(*component_handle);
 
+    name_index[name_pos] = *component_handle;
+    size_t svcuid_pos = svcuid_slot(*svcuid);
+    while (svcuid_index[svcuid_pos] != 0) {
+        svcuid_pos = next_slot(svcuid_pos);
+    }
+    svcuid_index[svcuid_pos] = *component_handle;
+
     return GGL_ERR_OK;
 }
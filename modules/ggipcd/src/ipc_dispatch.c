@@ -3,14 +3,18 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "ipc_dispatch.h"
+#include "ipc_components.h"
 #include "ipc_error.h"
+#include "ipc_rate_limit.h"
 #include "ipc_server.h"
 #include "ipc_service.h"
 #include <ggl/arena.h>
 #include <ggl/buffer.h>
+#include <ggl/dispatch_table.h>
 #include <ggl/error.h>
 #include <ggl/log.h>
 #include <ggl/object.h>
+#include <ggl/rate_limit.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -23,69 +27,121 @@ static const GglIpcService *const SERVICE_TABLE[]
 static const size_t SERVICE_COUNT
     = sizeof(SERVICE_TABLE) / sizeof(SERVICE_TABLE[0]);
 
+/// Must be at least twice the total number of IPC operations.
+#define OPERATION_TABLE_SLOTS 64
+
+static GglDispatchEntry operation_slots[OPERATION_TABLE_SLOTS];
+static GglDispatchTable operation_table;
+
+GglError ggl_ipc_dispatch_init(void) {
+    GglError ret = ggl_dispatch_table_init(
+        &operation_table, operation_slots, OPERATION_TABLE_SLOTS
+    );
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
+    for (size_t i = 0; i < SERVICE_COUNT; i++) {
+        const GglIpcService *service = SERVICE_TABLE[i];
+        for (size_t j = 0; j < service->operation_count; j++) {
+            GglBuffer name = service->operations[j].name;
+            // Rate limit class, service index, and operation index
+            uint32_t value = ((uint32_t) ggl_ipc_rate_class(name) << 16)
+                | (uint32_t) (i << 8) | (uint32_t) j;
+            ret = ggl_dispatch_table_insert(&operation_table, name, value);
+            if (ret != GGL_ERR_OK) {
+                GGL_LOGE("Failed to build IPC operation table.");
+                return ret;
+            }
+        }
+    }
+
+    return GGL_ERR_OK;
+}
+
 GglError ggl_ipc_handle_operation(
     GglBuffer operation,
     GglMap args,
+    const GglBuffer *binary_payload,
     uint32_t handle,
     int32_t stream_id,
     GglIpcError *ipc_error
 ) {
-    for (size_t i = 0; i < SERVICE_COUNT; i++) {
-        const GglIpcService *service = SERVICE_TABLE[i];
-        GGL_LOGT(
-            "Matching against service: %.*s.",
-            (int) service->name.len,
-            service->name.data
+    GglDispatchEntry *entry
+        = ggl_dispatch_table_lookup(&operation_table, operation);
+    if (entry == NULL) {
+        GGL_LOGW(
+            "Unhandled operation requested: %.*s.",
+            (int) operation.len,
+            operation.data
         );
+        return GGL_ERR_NOENTRY;
+    }
 
-        for (size_t j = 0; j < service->operation_count; j++) {
-            const GglIpcOperation *service_op = &service->operations[j];
-
-            GGL_LOGT(
-                "Matching against operation: %.*s.",
-                (int) service_op->name.len,
-                service_op->name.data
-            );
-
-            if (ggl_buffer_eq(operation, service_op->name)) {
-                GglIpcOperationInfo info = {
-                    .service = service->name,
-                    .operation = operation,
-                };
-                GglError ret
-                    = ggl_ipc_get_component_name(handle, &info.component);
-                if (ret != GGL_ERR_OK) {
-                    GGL_LOGE(
-                        "Failed component name lookup for IPC operation %.*s",
-                        (int) operation.len,
-                        operation.data
-                    );
-                    return ret;
-                }
-
-                GGL_LOGI(
-                    "Received IPC operation %.*s from component %.*s.",
-                    (int) operation.len,
-                    operation.data,
-                    (int) info.component.len,
-                    info.component.data
-                );
-                static uint8_t resp_mem
-                    [sizeof(GglObject[GGL_MAX_OBJECT_SUBOBJECTS])
-                     + GGL_IPC_MAX_MSG_LEN];
-                GglArena alloc = ggl_arena_init(GGL_BUF(resp_mem));
-
-                return service_op->handler(
-                    &info, args, handle, stream_id, ipc_error, &alloc
-                );
-            }
-        }
+    const GglIpcService *service
+        = SERVICE_TABLE[(entry->value >> 8) & UINT8_MAX];
+    const GglIpcOperation *service_op
+        = &service->operations[entry->value & UINT8_MAX];
+    GglIpcRateClass rate_class = (GglIpcRateClass) (entry->value >> 16);
+
+    if ((binary_payload != NULL) && !service_op->accepts_binary_payload) {
+        GGL_LOGE(
+            "Operation %.*s does not support binary payloads.",
+            (int) operation.len,
+            operation.data
+        );
+        *ipc_error = (GglIpcError) {
+            .error_code = GGL_IPC_ERR_INVALID_ARGUMENTS,
+            .message = GGL_STR("Operation does not support binary payloads."),
+        };
+        return GGL_ERR_INVALID;
+    }
+
+    GglComponentHandle component_handle = 0;
+    GglError ret = ggl_ipc_get_component_handle(handle, &component_handle);
+    if (ret != GGL_ERR_OK) {
+        GGL_LOGE(
+            "Failed component lookup for IPC operation %.*s",
+            (int) operation.len,
+            operation.data
+        );
+        return ret;
     }
 
-    GGL_LOGW(
-        "Unhandled operation requested: %.*s.",
+    // Checked before the handler so a flooding component's requests never
+    // reach the daemons they would load
+    ret = ggl_ipc_rate_limit_check(
+        component_handle, rate_class, ggl_rate_limit_now_ns(), ipc_error
+    );
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
+    GglIpcOperationInfo info = {
+        .component = ggl_ipc_components_get_name(component_handle),
+        .service = service->name,
+        .operation = operation,
+        .binary_payload = binary_payload,
+    };
+
+    GGL_LOGI(
+        "Received IPC operation %.*s from component %.*s.",
         (int) operation.len,
-        operation.data
+        operation.data,
+        (int) info.component.len,
+        info.component.data
+    );
+    GGL_LOGT(
+        "IPC operation %.*s has been called %lu times.",
+        (int) operation.len,
+        operation.data,
+        (unsigned long) entry->calls
+    );
+    static uint8_t resp_mem
+        [sizeof(GglObject[GGL_MAX_OBJECT_SUBOBJECTS]) + GGL_IPC_MAX_MSG_LEN];
+    GglArena alloc = ggl_arena_init(GGL_BUF(resp_mem));
+
+    return service_op->handler(
+        &info, args, handle, stream_id, ipc_error, &alloc
     );
-    return GGL_ERR_NOENTRY;
 }
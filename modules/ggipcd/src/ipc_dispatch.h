@@ -11,9 +11,17 @@
 #include <ggl/object.h>
 #include <stdint.h>
 
+/// Build the operation lookup table. Must be called before handling
+/// operations.
+GglError ggl_ipc_dispatch_init(void);
+
+/// Run the handler for an IPC operation.
+/// binary_payload is the raw payload section if the client sent one, else
+/// NULL.
 GglError ggl_ipc_handle_operation(
     GglBuffer operation,
     GglMap args,
+    const GglBuffer *binary_payload,
     uint32_t handle,
     int32_t stream_id,
     GglIpcError *ipc_error
@@ -0,0 +1,234 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "ipc_rate_limit.h"
+#include "ipc_components.h"
+#include "ipc_error.h"
+#include <assert.h>
+#include <ggl/arena.h>
+#include <ggl/buffer.h>
+#include <ggl/core_bus/gg_config.h>
+#include <ggl/error.h>
+#include <ggl/flags.h>
+#include <ggl/log.h>
+#include <ggl/map.h>
+#include <ggl/nucleus/constants.h>
+#include <ggl/object.h>
+#include <ggl/rate_limit.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+static const GglBuffer RATE_CLASS_NAMES[GGL_IPC_RATE_CLASS_COUNT] = {
+    [GGL_IPC_RATE_CLASS_PUBLISH_TO_TOPIC] = GGL_STR("publishToTopic"),
+    [GGL_IPC_RATE_CLASS_PUBLISH_TO_IOT_CORE] = GGL_STR("publishToIoTCore"),
+    [GGL_IPC_RATE_CLASS_UPDATE_CONFIGURATION] = GGL_STR("updateConfiguration"),
+};
+
+static const GglBuffer RATE_CLASS_OPERATIONS[GGL_IPC_RATE_CLASS_COUNT] = {
+    [GGL_IPC_RATE_CLASS_PUBLISH_TO_TOPIC]
+    = GGL_STR("aws.greengrass#PublishToTopic"),
+    [GGL_IPC_RATE_CLASS_PUBLISH_TO_IOT_CORE]
+    = GGL_STR("aws.greengrass#PublishToIoTCore"),
+    [GGL_IPC_RATE_CLASS_UPDATE_CONFIGURATION]
+    = GGL_STR("aws.greengrass#UpdateConfiguration"),
+};
+
+static GglRateLimit limits[GGL_IPC_RATE_CLASS_COUNT];
+
+// Indexed by component handle - 1
+static GglTokenBucket buckets[GGL_MAX_GENERIC_COMPONENTS]
+                             [GGL_IPC_RATE_CLASS_COUNT];
+// Whether the component's last request in the class was throttled; used to
+// log once per throttling episode
+static bool throttling[GGL_MAX_GENERIC_COMPONENTS][GGL_IPC_RATE_CLASS_COUNT];
+
+static _Atomic(uint64_t) allowed_count[GGL_IPC_RATE_CLASS_COUNT];
+static _Atomic(uint64_t) throttled_count[GGL_IPC_RATE_CLASS_COUNT];
+
+static GglError read_limit_value(GglObject *obj, uint32_t *out) {
+    int64_t value;
+    if (ggl_obj_type(*obj) == GGL_TYPE_I64) {
+        value = ggl_obj_into_i64(*obj);
+    } else if (ggl_obj_type(*obj) == GGL_TYPE_BUF) {
+        GglError ret = ggl_str_to_int64(ggl_obj_into_buf(*obj), &value);
+        if (ret != GGL_ERR_OK) {
+            return ret;
+        }
+    } else {
+        return GGL_ERR_INVALID;
+    }
+
+    if ((value < 0) || (value > UINT32_MAX)) {
+        return GGL_ERR_RANGE;
+    }
+    *out = (uint32_t) value;
+    return GGL_ERR_OK;
+}
+
+static GglError load_limit(GglIpcRateClass rate_class) {
+    uint8_t config_mem[256];
+    GglArena alloc = ggl_arena_init(GGL_BUF(config_mem));
+    GglObject config;
+
+    GglError ret = ggl_gg_config_read(
+        GGL_BUF_LIST(
+            GGL_STR("services"),
+            GGL_STR("aws.greengrass.NucleusLite"),
+            GGL_STR("configuration"),
+            GGL_STR("ipcRateLimits"),
+            RATE_CLASS_NAMES[rate_class]
+        ),
+        &alloc,
+        &config
+    );
+    if (ret == GGL_ERR_NOENTRY) {
+        return GGL_ERR_OK;
+    }
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+    if (ggl_obj_type(config) != GGL_TYPE_MAP) {
+        return GGL_ERR_CONFIG;
+    }
+
+    GglObject *rate_obj;
+    GglObject *burst_obj;
+    ret = ggl_map_validate(
+        ggl_obj_into_map(config),
+        GGL_MAP_SCHEMA(
+            { GGL_STR("ratePerSecond"),
+              GGL_REQUIRED,
+              GGL_TYPE_NULL,
+              &rate_obj },
+            { GGL_STR("burst"), GGL_OPTIONAL, GGL_TYPE_NULL, &burst_obj },
+        )
+    );
+    if (ret != GGL_ERR_OK) {
+        return GGL_ERR_CONFIG;
+    }
+
+    GglRateLimit limit = { 0 };
+    ret = read_limit_value(rate_obj, &limit.rate);
+    if (ret != GGL_ERR_OK) {
+        return GGL_ERR_CONFIG;
+    }
+    // Default to allowing one second's worth of requests at once
+    limit.burst = limit.rate;
+    if (burst_obj != NULL) {
+        ret = read_limit_value(burst_obj, &limit.burst);
+        if (ret != GGL_ERR_OK) {
+            return GGL_ERR_CONFIG;
+        }
+    }
+
+    ggl_ipc_rate_limit_set(rate_class, limit);
+    GGL_LOGI(
+        "Limiting IPC %.*s to %u/s with burst of %u per component.",
+        (int) RATE_CLASS_NAMES[rate_class].len,
+        RATE_CLASS_NAMES[rate_class].data,
+        limit.rate,
+        limit.burst
+    );
+    return GGL_ERR_OK;
+}
+
+void ggl_ipc_rate_limit_init(void) {
+    for (size_t i = 0; i < GGL_IPC_RATE_CLASS_COUNT; i++) {
+        GglError ret = load_limit((GglIpcRateClass) i);
+        if (ret != GGL_ERR_OK) {
+            // A limit is a safeguard; failing to load one must not take
+            // IPC down for every component
+            GGL_LOGW(
+                "Failed to load ipcRateLimits configuration for %.*s; not "
+                "limiting it.",
+                (int) RATE_CLASS_NAMES[i].len,
+                RATE_CLASS_NAMES[i].data
+            );
+        }
+    }
+}
+
+void ggl_ipc_rate_limit_set(GglIpcRateClass rate_class, GglRateLimit limit) {
+    assert(rate_class < GGL_IPC_RATE_CLASS_COUNT);
+    limits[rate_class] = limit;
+}
+
+GglIpcRateClass ggl_ipc_rate_class(GglBuffer operation) {
+    for (size_t i = 0; i < GGL_IPC_RATE_CLASS_COUNT; i++) {
+        if (ggl_buffer_eq(operation, RATE_CLASS_OPERATIONS[i])) {
+            return (GglIpcRateClass) i;
+        }
+    }
+    return GGL_IPC_RATE_CLASS_NONE;
+}
+
+GglBuffer ggl_ipc_rate_class_name(GglIpcRateClass rate_class) {
+    assert(rate_class < GGL_IPC_RATE_CLASS_COUNT);
+    return RATE_CLASS_NAMES[rate_class];
+}
+
+GglError ggl_ipc_rate_limit_check(
+    GglComponentHandle component_handle,
+    GglIpcRateClass rate_class,
+    uint64_t now_ns,
+    GglIpcError *ipc_error
+) {
+    if ((rate_class >= GGL_IPC_RATE_CLASS_COUNT)
+        || (limits[rate_class].rate == 0)) {
+        return GGL_ERR_OK;
+    }
+
+    assert(component_handle != 0);
+    assert(component_handle <= GGL_MAX_GENERIC_COMPONENTS);
+    size_t index = component_handle - 1U;
+
+    bool allowed = ggl_token_bucket_take(
+        &buckets[index][rate_class], limits[rate_class], now_ns
+    );
+
+    if (allowed) {
+        atomic_fetch_add_explicit(
+            &allowed_count[rate_class], 1, memory_order_relaxed
+        );
+    } else {
+        atomic_fetch_add_explicit(
+            &throttled_count[rate_class], 1, memory_order_relaxed
+        );
+        if (!throttling[index][rate_class]) {
+            GglBuffer name = ggl_ipc_components_get_name(component_handle);
+            GGL_LOGW(
+                "Throttling IPC %.*s requests from %.*s.",
+                (int) RATE_CLASS_NAMES[rate_class].len,
+                RATE_CLASS_NAMES[rate_class].data,
+                (int) name.len,
+                name.data
+            );
+        }
+    }
+    throttling[index][rate_class] = !allowed;
+
+    if (!allowed) {
+        *ipc_error = (GglIpcError) {
+            .error_code = GGL_IPC_ERR_SERVICE_ERROR,
+            .message = GGL_STR("IPC request rate limit exceeded."),
+        };
+        return GGL_ERR_BUSY;
+    }
+    return GGL_ERR_OK;
+}
+
+void ggl_ipc_rate_limit_stats(
+    GglIpcRateClass rate_class, GglIpcRateLimitStats *stats
+) {
+    assert(rate_class < GGL_IPC_RATE_CLASS_COUNT);
+    *stats = (GglIpcRateLimitStats) {
+        .allowed = atomic_load_explicit(
+            &allowed_count[rate_class], memory_order_relaxed
+        ),
+        .throttled = atomic_load_explicit(
+            &throttled_count[rate_class], memory_order_relaxed
+        ),
+    };
+}
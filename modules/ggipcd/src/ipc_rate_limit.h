@@ -0,0 +1,66 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef GGL_IPC_RATE_LIMIT_H
+#define GGL_IPC_RATE_LIMIT_H
+
+//! Per-component IPC rate limits
+//!
+//! Operations that load other daemons are grouped into classes, each with a
+//! token bucket per component. Limits are read from the nucleus
+//! `ipcRateLimits` configuration; classes without a configured limit are not
+//! limited.
+
+#include "ipc_components.h"
+#include "ipc_error.h"
+#include <ggl/buffer.h>
+#include <ggl/error.h>
+#include <ggl/rate_limit.h>
+#include <stdint.h>
+
+typedef enum {
+    GGL_IPC_RATE_CLASS_PUBLISH_TO_TOPIC,
+    GGL_IPC_RATE_CLASS_PUBLISH_TO_IOT_CORE,
+    GGL_IPC_RATE_CLASS_UPDATE_CONFIGURATION,
+    GGL_IPC_RATE_CLASS_COUNT,
+    /// Operations that are never limited
+    GGL_IPC_RATE_CLASS_NONE = GGL_IPC_RATE_CLASS_COUNT,
+} GglIpcRateClass;
+
+/// Counters for a rate limit class, summed over all components.
+typedef struct {
+    uint64_t allowed;
+    uint64_t throttled;
+} GglIpcRateLimitStats;
+
+/// Load rate limits from config.
+/// Classes whose config cannot be read or is invalid are left unlimited.
+void ggl_ipc_rate_limit_init(void);
+
+/// Set the per-component limit for a class. A rate of 0 disables it.
+void ggl_ipc_rate_limit_set(GglIpcRateClass rate_class, GglRateLimit limit);
+
+/// Get the rate limit class of an operation.
+GglIpcRateClass ggl_ipc_rate_class(GglBuffer operation);
+
+/// Get the config key naming a rate limit class.
+GglBuffer ggl_ipc_rate_class_name(GglIpcRateClass rate_class);
+
+/// Take a token for an operation by a component at monotonic time `now_ns`.
+/// Returns GGL_ERR_BUSY and sets ipc_error if the component has exceeded the
+/// class's limit.
+/// Must only be called from the IPC server thread.
+GglError ggl_ipc_rate_limit_check(
+    GglComponentHandle component_handle,
+    GglIpcRateClass rate_class,
+    uint64_t now_ns,
+    GglIpcError *ipc_error
+);
+
+/// Get counters for a rate limit class.
+void ggl_ipc_rate_limit_stats(
+    GglIpcRateClass rate_class, GglIpcRateLimitStats *stats
+);
+
+#endif
@@ -44,10 +44,14 @@ static_assert(
     GGL_IPC_MAX_MSG_LEN >= 16, "Minimum EventStream packet size is 16."
 );
 
+static const GglBuffer BINARY_PAYLOAD_HEADER = GGL_STR("ggl-binary-payload");
+static const GglBuffer BINARY_LENGTH_HEADER = GGL_STR("ggl-binary-length");
+
 static uint8_t resp_array[GGL_IPC_MAX_MSG_LEN];
 static pthread_mutex_t resp_array_mtx = PTHREAD_MUTEX_INITIALIZER;
 
 static GglComponentHandle client_components[GGL_IPC_MAX_CLIENTS];
+static bool client_binary_payload[GGL_IPC_MAX_CLIENTS];
 
 static GglError reset_client_state(uint32_t handle, size_t index);
 static GglError release_client_subscriptions(uint32_t handle, size_t index);
@@ -67,6 +71,7 @@ __attribute__((constructor)) static void init_client_pool(void) {
 static GglError reset_client_state(uint32_t handle, size_t index) {
     (void) handle;
     client_components[index] = 0;
+    client_binary_payload[index] = false;
     return GGL_ERR_OK;
 }
 
@@ -99,15 +104,23 @@ static GglError deserialize_payload(
     return GGL_ERR_OK;
 }
 
-static void set_conn_component(void *ctx, size_t index) {
-    GglComponentHandle *component_handle = ctx;
-    assert(*component_handle != 0);
+typedef struct {
+    GglComponentHandle component_handle;
+    bool binary_payload;
+} ConnState;
+
+static void set_conn_state(void *ctx, size_t index) {
+    ConnState *state = ctx;
+    assert(state->component_handle != 0);
 
-    client_components[index] = *component_handle;
+    client_components[index] = state->component_handle;
+    client_binary_payload[index] = state->binary_payload;
 }
 
 static GglError validate_conn_msg(
-    EventStreamMessage *msg, EventStreamCommonHeaders common_headers
+    EventStreamMessage *msg,
+    EventStreamCommonHeaders common_headers,
+    bool *binary_payload
 ) {
     if (common_headers.message_type != EVENTSTREAM_CONNECT) {
         GGL_LOGE("Client initial message not of type connect.");
@@ -135,13 +148,18 @@ static GglError validate_conn_msg(
                 GGL_LOGE("Client protocol version not 0.1.0.");
                 return GGL_ERR_INVALID;
             }
+        } else if (ggl_buffer_eq(header.name, BINARY_PAYLOAD_HEADER)) {
+            *binary_payload = (header.value.type == EVENTSTREAM_INT32)
+                && (header.value.int32 == 1);
         }
     }
 
     return GGL_ERR_OK;
 }
 
-static GglError send_conn_resp(uint32_t handle, GglSvcuid *svcuid) {
+static GglError send_conn_resp(
+    uint32_t handle, GglSvcuid *svcuid, bool binary_payload
+) {
     GGL_MTX_SCOPE_GUARD(&resp_array_mtx);
     GglBuffer resp_buffer = GGL_BUF(resp_array);
 
@@ -158,18 +176,27 @@ static GglError send_conn_resp(uint32_t handle, GglSvcuid *svcuid) {
         }
     }
 
+    EventStreamHeader resp_headers[] = {
+        { GGL_STR(":message-type"),
+          { EVENTSTREAM_INT32, .int32 = EVENTSTREAM_CONNECT_ACK } },
+        { GGL_STR(":message-flags"),
+          { EVENTSTREAM_INT32, .int32 = EVENTSTREAM_CONNECTION_ACCEPTED } },
+        { GGL_STR(":stream-id"), { EVENTSTREAM_INT32, .int32 = 0 } },
+        { GGL_STR("svcuid"), { EVENTSTREAM_STRING, .string = svcuid_str } },
+        { BINARY_PAYLOAD_HEADER, { EVENTSTREAM_INT32, .int32 = 1 } },
+    };
+    size_t resp_headers_len = 3;
+    if (svcuid != NULL) {
+        resp_headers_len += 1;
+    } else {
+        resp_headers[3] = resp_headers[4];
+    }
+    if (binary_payload) {
+        resp_headers_len += 1;
+    }
+
     GglError ret = eventstream_encode(
-        &resp_buffer,
-        (EventStreamHeader[]) {
-            { GGL_STR(":message-type"),
-              { EVENTSTREAM_INT32, .int32 = EVENTSTREAM_CONNECT_ACK } },
-            { GGL_STR(":message-flags"),
-              { EVENTSTREAM_INT32, .int32 = EVENTSTREAM_CONNECTION_ACCEPTED } },
-            { GGL_STR(":stream-id"), { EVENTSTREAM_INT32, .int32 = 0 } },
-            { GGL_STR("svcuid"), { EVENTSTREAM_STRING, .string = svcuid_str } },
-        },
-        (svcuid != NULL) ? 4 : 3,
-        GGL_NULL_READER
+        &resp_buffer, resp_headers, resp_headers_len, GGL_NULL_READER
     );
     if (ret != GGL_ERR_OK) {
         return ret;
@@ -186,7 +213,8 @@ static GglError handle_conn_init(
 ) {
     GGL_LOGD("Handling connect for %d.", handle);
 
-    GglError ret = validate_conn_msg(msg, common_headers);
+    bool binary_payload = false;
+    GglError ret = validate_conn_msg(msg, common_headers, &binary_payload);
     if (ret != GGL_ERR_OK) {
         return ret;
     }
@@ -266,7 +294,15 @@ static GglError handle_conn_init(
             return ret;
         }
 
-        ret = ggl_ipc_auth_validate_name(pid, component_name);
+        int pidfd = -1;
+        ret = ggl_socket_handle_get_peer_pidfd(&pool, handle, &pidfd);
+        if ((ret != GGL_ERR_OK) && (ret != GGL_ERR_UNSUPPORTED)) {
+            GGL_LOGE("Failed to get pidfd of client %d.", handle);
+            return ret;
+        }
+        GGL_CLEANUP(cleanup_close, pidfd);
+
+        ret = ggl_ipc_auth_validate_name_pidfd(pid, pidfd, component_name);
         if (ret != GGL_ERR_OK) {
             GGL_LOGE(
                 "Client %d failed to authenticate as %.*s.",
@@ -293,13 +329,23 @@ static GglError handle_conn_init(
     GGL_LOGT("Setting %d as connected.", handle);
 
     ret = ggl_socket_handle_protected(
-        set_conn_component, &component_handle, &pool, handle
+        set_conn_state,
+        &(ConnState) { .component_handle = component_handle,
+                       .binary_payload = binary_payload },
+        &pool,
+        handle
     );
     if (ret != GGL_ERR_OK) {
         return ret;
     }
 
-    ret = send_conn_resp(handle, (auth_token_obj == NULL) ? &svcuid : NULL);
+    if (binary_payload) {
+        GGL_LOGD("Client %d uses binary payloads.", handle);
+    }
+
+    ret = send_conn_resp(
+        handle, (auth_token_obj == NULL) ? &svcuid : NULL, binary_payload
+    );
     if (ret != GGL_ERR_OK) {
         return ret;
     }
@@ -365,6 +411,9 @@ static GglError handle_stream_operation(
     }
 
     GglBuffer operation = { 0 };
+    GglBuffer json_payload = msg->payload;
+    GglBuffer binary = { 0 };
+    bool has_binary = false;
 
     {
         bool operation_set = false;
@@ -379,6 +428,18 @@ static GglError handle_stream_operation(
                 }
                 operation = header.value.string;
                 operation_set = true;
+            } else if (ggl_buffer_eq(header.name, BINARY_LENGTH_HEADER)) {
+                if ((header.value.type != EVENTSTREAM_INT32)
+                    || (header.value.int32 < 0)
+                    || ((uint32_t) header.value.int32 > msg->payload.len)) {
+                    GGL_LOGE("Invalid binary payload length header.");
+                    return GGL_ERR_INVALID;
+                }
+                size_t json_len
+                    = msg->payload.len - (uint32_t) header.value.int32;
+                json_payload = ggl_buffer_substr(msg->payload, 0, json_len);
+                binary = ggl_buffer_substr(msg->payload, json_len, SIZE_MAX);
+                has_binary = true;
             }
         }
 
@@ -388,14 +449,24 @@ static GglError handle_stream_operation(
         }
     }
 
+    if (has_binary && !ggl_ipc_binary_payload_enabled(handle)) {
+        GGL_LOGE("Client sent binary payload without negotiating it.");
+        return GGL_ERR_INVALID;
+    }
+
     GglMap payload_data = { 0 };
-    GglError ret = deserialize_payload(msg->payload, &payload_data, alloc);
+    GglError ret = deserialize_payload(json_payload, &payload_data, alloc);
     if (ret != GGL_ERR_OK) {
         return ret;
     }
 
     return ggl_ipc_handle_operation(
-        operation, payload_data, handle, common_headers.stream_id, ipc_error
+        operation,
+        payload_data,
+        has_binary ? &binary : NULL,
+        handle,
+        common_headers.stream_id,
+        ipc_error
     );
 }
 
@@ -447,13 +518,32 @@ static void get_conn_component(void *ctx, size_t index) {
     *handle = client_components[index];
 }
 
+static void get_conn_binary_payload(void *ctx, size_t index) {
+    bool *binary_payload = ctx;
+    *binary_payload = client_binary_payload[index];
+}
+
+bool ggl_ipc_binary_payload_enabled(uint32_t handle) {
+    bool binary_payload = false;
+    (void) ggl_socket_handle_protected(
+        get_conn_binary_payload, &binary_payload, &pool, handle
+    );
+    return binary_payload;
+}
+
+GglError ggl_ipc_get_component_handle(
+    uint32_t handle, GglComponentHandle *component_handle
+) {
+    return ggl_socket_handle_protected(
+        get_conn_component, component_handle, &pool, handle
+    );
+}
+
 GglError ggl_ipc_get_component_name(
     uint32_t handle, GglBuffer *component_name
 ) {
     GglComponentHandle component_handle = { 0 };
-    GglError ret = ggl_socket_handle_protected(
-        get_conn_component, &component_handle, &pool, handle
-    );
+    GglError ret = ggl_ipc_get_component_handle(handle, &component_handle);
     if (ret != GGL_ERR_OK) {
         return ret;
     }
@@ -539,11 +629,35 @@ GglError ggl_ipc_listen(const GglBuffer *socket_name, GglBuffer socket_path) {
     );
 }
 
-GglError ggl_ipc_response_send(
+typedef struct {
+    GglObject *json;
+    GglBuffer binary;
+} BinaryPayloadReaderCtx;
+
+// Writes the JSON document followed by the raw binary section
+static GglError binary_payload_read(void *ctx, GglBuffer *buf) {
+    BinaryPayloadReaderCtx *args = ctx;
+
+    GglBuffer json_buf = *buf;
+    GglError ret = ggl_reader_call(ggl_json_reader(args->json), &json_buf);
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
+    if (buf->len - json_buf.len < args->binary.len) {
+        return GGL_ERR_NOMEM;
+    }
+    memcpy(&buf->data[json_buf.len], args->binary.data, args->binary.len);
+    buf->len = json_buf.len + args->binary.len;
+    return GGL_ERR_OK;
+}
+
+static GglError response_send(
     uint32_t handle,
     int32_t stream_id,
     GglBuffer service_model_type,
-    GglMap response
+    GglMap response,
+    const GglBuffer *binary
 ) {
     GGL_LOGD("Responding to operation on stream %d for %d.", stream_id, handle);
 
@@ -560,16 +674,33 @@ GglError ggl_ipc_response_send(
           { EVENTSTREAM_STRING, .string = GGL_STR("application/json") } },
         { GGL_STR("service-model-type"),
           { EVENTSTREAM_STRING, .string = service_model_type } },
+        { 0 },
     };
-    size_t resp_headers_len = sizeof(resp_headers) / sizeof(resp_headers[0]);
+    size_t resp_headers_len = 4;
 
-    if (service_model_type.len == 0) {
-        resp_headers_len -= 1;
+    if (service_model_type.len != 0) {
+        resp_headers_len += 1;
+    }
+    if (binary != NULL) {
+        resp_headers[resp_headers_len]
+            = (EventStreamHeader) { BINARY_LENGTH_HEADER,
+                                    { EVENTSTREAM_INT32,
+                                      .int32 = (int32_t) binary->len } };
+        resp_headers_len += 1;
     }
 
     GglObject resp_obj = ggl_obj_map(response);
+    BinaryPayloadReaderCtx reader_ctx = {
+        .json = &resp_obj,
+        .binary = (binary != NULL) ? *binary : (GglBuffer) { 0 },
+    };
     GglError ret = eventstream_encode(
-        &resp_buffer, resp_headers, resp_headers_len, ggl_json_reader(&resp_obj)
+        &resp_buffer,
+        resp_headers,
+        resp_headers_len,
+        (binary != NULL)
+            ? (GglReader) { .read = binary_payload_read, .ctx = &reader_ctx }
+            : ggl_json_reader(&resp_obj)
     );
     if (ret != GGL_ERR_OK) {
         return ret;
@@ -577,3 +708,26 @@ GglError ggl_ipc_response_send(
 
     return ggl_socket_handle_write(&pool, handle, resp_buffer);
 }
+
+GglError ggl_ipc_response_send(
+    uint32_t handle,
+    int32_t stream_id,
+    GglBuffer service_model_type,
+    GglMap response
+) {
+    return response_send(
+        handle, stream_id, service_model_type, response, NULL
+    );
+}
+
+GglError ggl_ipc_response_send_binary(
+    uint32_t handle,
+    int32_t stream_id,
+    GglBuffer service_model_type,
+    GglMap response,
+    GglBuffer binary
+) {
+    return response_send(
+        handle, stream_id, service_model_type, response, &binary
+    );
+}
@@ -5,9 +5,11 @@
 #ifndef GGL_IPC_SERVER_H
 #define GGL_IPC_SERVER_H
 
+#include "ipc_components.h"
 #include <ggl/buffer.h>
 #include <ggl/error.h>
 #include <ggl/object.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /// Maximum size of eventstream packet.
@@ -27,6 +29,30 @@ GglError ggl_ipc_response_send(
     GglMap response
 );
 
+/// Send an EventStream packet to an IPC client with a raw binary section.
+/// Clients opt in by sending the `ggl-binary-payload` header (int32 1) on
+/// CONNECT; the CONNECT_ACK echoes it if accepted. Messages in either
+/// direction may then carry a `ggl-binary-length` header (int32 N), in which
+/// case the last N bytes of the payload are raw data and the rest is the JSON
+/// document. This avoids base64 encoding binary messages.
+/// Must only be used if `ggl_ipc_binary_payload_enabled` is true for handle.
+GglError ggl_ipc_response_send_binary(
+    uint32_t handle,
+    int32_t stream_id,
+    GglBuffer service_model_type,
+    GglMap response,
+    GglBuffer binary
+);
+
+/// Check whether a client negotiated binary payloads.
+bool ggl_ipc_binary_payload_enabled(uint32_t handle);
+
+/// Get the component handle associated with a client.
+/// component_handle is an out parameter only.
+GglError ggl_ipc_get_component_handle(
+    uint32_t handle, GglComponentHandle *component_handle
+);
+
 /// Get the component name associated with a client.
 /// component_name is an out parameter only.
 GglError ggl_ipc_get_component_name(uint32_t handle, GglBuffer *component_name);
@@ -10,12 +10,16 @@
 #include <ggl/buffer.h>
 #include <ggl/error.h>
 #include <ggl/object.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 typedef struct {
     GglBuffer component;
     GglBuffer service;
     GglBuffer operation;
+    /// Raw payload sent after the JSON args, or NULL if none.
+    /// Only sent by clients that negotiated binary payloads.
+    const GglBuffer *binary_payload;
 } GglIpcOperationInfo;
 
 typedef GglError GglIpcOperationHandler(
@@ -30,6 +34,9 @@ typedef GglError GglIpcOperationHandler(
 typedef struct {
     GglBuffer name;
     GglIpcOperationHandler *handler;
+    /// Whether the handler reads `binary_payload`. Requests with a raw
+    /// payload section are rejected for other operations.
+    bool accepts_binary_payload;
 } GglIpcOperation;
 
 typedef struct {
@@ -5,11 +5,13 @@
 #include "authorization_agent.h"
 #include "../../ipc_service.h"
 #include <ggl/buffer.h>
+#include <stdbool.h>
 
 static GglIpcOperation operations[] = {
     {
         GGL_STR("aws.greengrass#ValidateAuthorizationToken"),
         ggl_handle_token_validation,
+        false,
     },
 };
 
@@ -5,15 +5,18 @@
 #include "cli.h"
 #include "../../ipc_service.h"
 #include <ggl/buffer.h>
+#include <stdbool.h>
 
 static GglIpcOperation operations[] = {
     {
         GGL_STR("aws.greengrass#CreateLocalDeployment"),
         ggl_handle_create_local_deployment,
+        false,
     },
     {
         GGL_STR("aws.greengrass#RestartComponent"),
         ggl_handle_restart_component,
+        false,
     },
 };
 
@@ -5,19 +5,23 @@
 #include "config.h"
 #include "../../ipc_service.h"
 #include <ggl/buffer.h>
+#include <stdbool.h>
 
 static GglIpcOperation operations[] = {
     {
         GGL_STR("aws.greengrass#GetConfiguration"),
         ggl_handle_get_configuration,
+        false,
     },
     {
         GGL_STR("aws.greengrass#UpdateConfiguration"),
         ggl_handle_update_configuration,
+        false,
     },
     {
         GGL_STR("aws.greengrass#SubscribeToConfigurationUpdate"),
         ggl_handle_subscribe_to_configuration_update,
+        false,
     },
 };
 
@@ -5,10 +5,12 @@
 #include "lifecycle.h"
 #include "../../ipc_service.h"
 #include <ggl/buffer.h>
+#include <stdbool.h>
 
 static GglIpcOperation operations[] = { {
     GGL_STR("aws.greengrass#UpdateState"),
     ggl_handle_update_state,
+    false,
 } };
 
 GglIpcService ggl_ipc_service_lifecycle = {
@@ -13,10 +13,12 @@ static GglIpcOperation operations[] = {
     {
         GGL_STR("aws.greengrass#PublishToIoTCore"),
         ggl_handle_publish_to_iot_core,
+        true,
     },
     {
         GGL_STR("aws.greengrass#SubscribeToIoTCore"),
         ggl_handle_subscribe_to_iot_core,
+        false,
     },
 };
 
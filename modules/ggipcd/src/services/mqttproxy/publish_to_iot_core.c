@@ -98,8 +98,10 @@ GglError ggl_handle_publish_to_iot_core(
         }
     }
 
-    bool decoded = ggl_base64_decode_in_place(&payload);
-    if (!decoded) {
+    if (info->binary_payload != NULL) {
+        // Raw bytes sent alongside the JSON args; no decoding needed
+        payload = *info->binary_payload;
+    } else if (!ggl_base64_decode_in_place(&payload)) {
         GGL_LOGE("'payload' is not valid base64.");
         *ipc_error = (GglIpcError
         ) { .error_code = GGL_IPC_ERR_SERVICE_ERROR,
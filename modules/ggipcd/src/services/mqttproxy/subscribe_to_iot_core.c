@@ -32,6 +32,28 @@ static GglError subscribe_to_iot_core_callback(
         return ret;
     }
 
+    if (ggl_ipc_binary_payload_enabled(resp_handle)) {
+        ret = ggl_ipc_response_send_binary(
+            resp_handle,
+            stream_id,
+            GGL_STR("aws.greengrass#IoTCoreMessage"),
+            GGL_MAP(ggl_kv(
+                GGL_STR("message"),
+                ggl_obj_map(GGL_MAP(
+                    ggl_kv(GGL_STR("topicName"), ggl_obj_buf(topic))
+                ))
+            )),
+            payload
+        );
+        if (ret != GGL_ERR_OK) {
+            GGL_LOGE(
+                "Failed to send subscription response with error %s; skipping.",
+                ggl_strerror(ret)
+            );
+        }
+        return GGL_ERR_OK;
+    }
+
     GglBuffer base64_payload;
     ret = ggl_base64_encode(payload, alloc, &base64_payload);
     if (ret != GGL_ERR_OK) {
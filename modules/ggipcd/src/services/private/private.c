@@ -13,14 +13,23 @@
 #include <ggl/log.h>
 #include <ggl/map.h>
 #include <ggl/object.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 static GglIpcOperationHandler handle_get_system_config;
+static GglIpcOperationHandler handle_get_runner_context;
 
 static GglIpcOperation operations[] = {
     {
         GGL_STR("aws.greengrass.private#GetSystemConfig"),
         handle_get_system_config,
+        false,
+    },
+    {
+        GGL_STR("aws.greengrass.private#GetRunnerContext"),
+        handle_get_runner_context,
+        false,
     },
 };
 
@@ -73,3 +82,127 @@ GglError handle_get_system_config(
         GGL_MAP(ggl_kv(GGL_STR("value"), read_value))
     );
 }
+
+static GglError read_system_value(
+    GglBuffer key, GglArena *alloc, GglObject *value
+) {
+    GglError ret = ggl_gg_config_read(
+        GGL_BUF_LIST(GGL_STR("system"), key), alloc, value
+    );
+    if (ret != GGL_ERR_OK) {
+        GGL_LOGE(
+            "Failed to read system configuration %.*s.", (int) key.len, key.data
+        );
+    }
+    return ret;
+}
+
+// Reads an optional value; only a missing key leaves it absent.
+static GglError read_optional(
+    GglBufList key_path, GglArena *alloc, GglObject *value, bool *found
+) {
+    GglError ret = ggl_gg_config_read(key_path, alloc, value);
+    if (ret == GGL_ERR_NOENTRY) {
+        *found = false;
+        return GGL_ERR_OK;
+    }
+    *found = (ret == GGL_ERR_OK);
+    return ret;
+}
+
+// Returns what recipe-runner needs to start a phase in one response, instead
+// of one IPC call per value. The component's configuration is not included,
+// as it may not fit in a response; recipe-runner reads it when substituting.
+GglError handle_get_runner_context(
+    const GglIpcOperationInfo *info,
+    GglMap args,
+    uint32_t handle,
+    int32_t stream_id,
+    GglIpcError *ipc_error,
+    GglArena *alloc
+) {
+    (void) info;
+    (void) args;
+
+    GglKV pairs[6];
+    size_t len = 0;
+
+    GglObject thing_name;
+    GglObject root_path;
+    GglObject root_ca_path;
+    GglObject aws_region;
+    GglError ret = read_system_value(GGL_STR("thingName"), alloc, &thing_name);
+    if (ret == GGL_ERR_OK) {
+        ret = read_system_value(GGL_STR("rootPath"), alloc, &root_path);
+    }
+    if (ret == GGL_ERR_OK) {
+        ret = read_system_value(GGL_STR("rootCaPath"), alloc, &root_ca_path);
+    }
+    if (ret == GGL_ERR_OK) {
+        ret = ggl_gg_config_read(
+            GGL_BUF_LIST(
+                GGL_STR("services"),
+                GGL_STR("aws.greengrass.NucleusLite"),
+                GGL_STR("configuration"),
+                GGL_STR("awsRegion")
+            ),
+            alloc,
+            &aws_region
+        );
+    }
+    if (ret == GGL_ERR_OK) {
+        pairs[len++] = ggl_kv(GGL_STR("thingName"), thing_name);
+        pairs[len++] = ggl_kv(GGL_STR("rootPath"), root_path);
+        pairs[len++] = ggl_kv(GGL_STR("rootCaPath"), root_ca_path);
+        pairs[len++] = ggl_kv(GGL_STR("awsRegion"), aws_region);
+    }
+
+    // Optional values are omitted if not configured
+    GglObject network_proxy;
+    bool found = false;
+    if (ret == GGL_ERR_OK) {
+        ret = read_optional(
+            GGL_BUF_LIST(
+                GGL_STR("services"),
+                GGL_STR("aws.greengrass.NucleusLite"),
+                GGL_STR("configuration"),
+                GGL_STR("networkProxy")
+            ),
+            alloc,
+            &network_proxy,
+            &found
+        );
+    }
+    if ((ret == GGL_ERR_OK) && found) {
+        pairs[len++] = ggl_kv(GGL_STR("networkProxy"), network_proxy);
+    }
+
+    GglObject tes_port;
+    if (ret == GGL_ERR_OK) {
+        ret = read_optional(
+            GGL_BUF_LIST(
+                GGL_STR("services"),
+                GGL_STR("aws.greengrass.TokenExchangeService"),
+                GGL_STR("configuration"),
+                GGL_STR("port")
+            ),
+            alloc,
+            &tes_port,
+            &found
+        );
+    }
+    if ((ret == GGL_ERR_OK) && found) {
+        pairs[len++] = ggl_kv(GGL_STR("tesPort"), tes_port);
+    }
+
+    if (ret != GGL_ERR_OK) {
+        *ipc_error = (GglIpcError
+        ) { .error_code = GGL_IPC_ERR_SERVICE_ERROR,
+            .message = GGL_STR("Failed to read the system configuration.") };
+        return ret;
+    }
+
+    return ggl_ipc_response_send(
+        handle, stream_id, GGL_STR(""), (GglMap) { .pairs = pairs, .len = len }
+    );
+}
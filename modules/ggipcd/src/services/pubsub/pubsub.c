@@ -5,15 +5,18 @@
 #include "pubsub.h"
 #include "../../ipc_service.h"
 #include <ggl/buffer.h>
+#include <stdbool.h>
 
 static GglIpcOperation operations[] = {
     {
         GGL_STR("aws.greengrass#PublishToTopic"),
         ggl_handle_publish_to_topic,
+        false,
     },
     {
         GGL_STR("aws.greengrass#SubscribeToTopic"),
         ggl_handle_subscribe_to_topic,
+        false,
     },
 };
 
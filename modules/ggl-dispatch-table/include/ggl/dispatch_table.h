@@ -0,0 +1,63 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef GGL_DISPATCH_TABLE_H
+#define GGL_DISPATCH_TABLE_H
+
+//! Name-keyed dispatch table
+//!
+//! Open-addressing hash table mapping method or operation names to a
+//! caller-defined value, built once at startup. Each entry counts its
+//! successful lookups.
+
+#include <ggl/buffer.h>
+#include <ggl/error.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    /// Key; data is NULL for an empty slot.
+    GglBuffer name;
+    /// Caller-defined value, e.g. an index into a handler array.
+    uint32_t value;
+    /// Number of successful lookups.
+    _Atomic(uint64_t) calls;
+} GglDispatchEntry;
+
+typedef struct {
+    GglDispatchEntry *slots;
+    /// Power of two.
+    size_t slots_len;
+    size_t count;
+} GglDispatchTable;
+
+/// Hash a name as the table does.
+/// Also used by other name-keyed tables, which need removal and so do not use
+/// GglDispatchTable itself.
+uint32_t ggl_dispatch_hash(GglBuffer name);
+
+/// Initialize an empty table using `slots` for storage.
+/// `slots_len` must be a power of two; at most half the slots can be used.
+/// Names are not copied and must outlive the table.
+GglError ggl_dispatch_table_init(
+    GglDispatchTable *table, GglDispatchEntry *slots, size_t slots_len
+);
+
+/// Add a name to the table.
+/// Returns GGL_ERR_INVALID if the name is already present, or GGL_ERR_NOMEM
+/// if the table is full.
+GglError ggl_dispatch_table_insert(
+    GglDispatchTable *table, GglBuffer name, uint32_t value
+);
+
+/// Look up a name, incrementing its call count.
+/// Returns NULL if not present.
+/// Lookups on a table must not run concurrently; call counts may be read from
+/// other threads.
+GglDispatchEntry *ggl_dispatch_table_lookup(
+    GglDispatchTable *table, GglBuffer name
+);
+
+#endif
@@ -0,0 +1,115 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "ggl/dispatch_table.h"
+#include <ggl/buffer.h>
+#include <ggl/error.h>
+#include <ggl/log.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// Maximum trailing bytes of a name that are hashed.
+/// Method and operation names share long prefixes, so the end of the name and
+/// its length are what distinguish them; the full name is compared on lookup.
+#define HASHED_SUFFIX_LEN 16
+
+// 32-bit FNV-1a over the length and name suffix
+uint32_t ggl_dispatch_hash(GglBuffer name) {
+    uint32_t hash = 2166136261U;
+    hash ^= (uint32_t) name.len;
+    hash *= 16777619U;
+    size_t start
+        = (name.len > HASHED_SUFFIX_LEN) ? name.len - HASHED_SUFFIX_LEN : 0;
+    for (size_t i = start; i < name.len; i++) {
+        hash ^= name.data[i];
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+/// Find the slot holding `name`, or the empty slot where it would go.
+/// Table must have at least one empty slot.
+static GglDispatchEntry *find_slot(GglDispatchTable *table, GglBuffer name) {
+    size_t mask = table->slots_len - 1;
+    size_t i = ggl_dispatch_hash(name) & mask;
+    while (true) {
+        GglDispatchEntry *slot = &table->slots[i];
+        if ((slot->name.data == NULL) || ggl_buffer_eq(slot->name, name)) {
+            return slot;
+        }
+        i = (i + 1) & mask;
+    }
+}
+
+GglError ggl_dispatch_table_init(
+    GglDispatchTable *table, GglDispatchEntry *slots, size_t slots_len
+) {
+    if ((slots_len < 2) || ((slots_len & (slots_len - 1)) != 0)) {
+        GGL_LOGE("Dispatch table size must be a power of two.");
+        return GGL_ERR_INVALID;
+    }
+
+    for (size_t i = 0; i < slots_len; i++) {
+        slots[i].name = (GglBuffer) { 0 };
+        slots[i].value = 0;
+        atomic_init(&slots[i].calls, 0);
+    }
+
+    *table = (GglDispatchTable) {
+        .slots = slots,
+        .slots_len = slots_len,
+        .count = 0,
+    };
+    return GGL_ERR_OK;
+}
+
+GglError ggl_dispatch_table_insert(
+    GglDispatchTable *table, GglBuffer name, uint32_t value
+) {
+    // Keep load at most half so probe sequences stay short
+    if ((table->count + 1) * 2 > table->slots_len) {
+        GGL_LOGE("Dispatch table is full.");
+        return GGL_ERR_NOMEM;
+    }
+
+    GglDispatchEntry *slot = find_slot(table, name);
+    if (slot->name.data != NULL) {
+        GGL_LOGE(
+            "Duplicate dispatch table entry %.*s.", (int) name.len, name.data
+        );
+        return GGL_ERR_INVALID;
+    }
+
+    // Empty names are valid keys
+    static uint8_t empty_name[1];
+    slot->name = (name.data == NULL)
+        ? (GglBuffer) { .data = empty_name, .len = 0 }
+        : name;
+    slot->value = value;
+    table->count += 1;
+    return GGL_ERR_OK;
+}
+
+GglDispatchEntry *ggl_dispatch_table_lookup(
+    GglDispatchTable *table, GglBuffer name
+) {
+    if (table->count == 0) {
+        return NULL;
+    }
+
+    GglDispatchEntry *slot = find_slot(table, name);
+    if (slot->name.data == NULL) {
+        return NULL;
+    }
+
+    // Single writer; avoids a locked increment on the dispatch path
+    atomic_store_explicit(
+        &slot->calls,
+        atomic_load_explicit(&slot->calls, memory_order_relaxed) + 1,
+        memory_order_relaxed
+    );
+    return slot;
+}
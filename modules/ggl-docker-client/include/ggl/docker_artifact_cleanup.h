@@ -7,7 +7,27 @@
 #define GGL_DOCKER_ARTIFACT_CLEANUP_H
 
 #include <ggl/buffer.h>
+#include <ggl/error.h>
 
+/// The docker images used by stored recipes are tracked in a persistent index
+/// under the root path, so that cleanup does not need to parse every recipe.
+
+/// Load the index. Returns GGL_ERR_NOENTRY if it does not exist or is out of
+/// date; it must then be rebuilt by calling ggl_docker_references_update for
+/// every stored recipe, followed by ggl_docker_references_rebuilt.
+GglError ggl_docker_references_load(int root_path_fd);
+
+/// Record the docker images used by a stored recipe, replacing any previously
+/// recorded for that component version.
+void ggl_docker_references_update(
+    int root_path_fd, GglBuffer component_name, GglBuffer component_version
+);
+
+/// Mark the index as complete after a rebuild and save it.
+void ggl_docker_references_rebuilt(int root_path_fd);
+
+/// Remove the docker images used by a component version that no other
+/// configured component version uses, and drop its references from the index.
 void ggl_docker_artifact_cleanup(
     int root_path_fd, GglBuffer component_name, GglBuffer component_version
 );
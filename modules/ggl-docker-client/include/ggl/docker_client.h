@@ -14,13 +14,17 @@
 
 GglError ggl_docker_check_server(void);
 GglError ggl_docker_pull(GglBuffer image_name);
+/// Pull several images concurrently. The daemon downloads layers shared
+/// between the images only once.
+GglError ggl_docker_pull_many(GglBufList image_names);
 GglError ggl_docker_remove(GglBuffer image_name);
 GglError ggl_docker_check_image(GglBuffer image_name);
+/// Verify registry credentials and keep them for subsequent pulls
 GglError ggl_docker_credentials_store(
     GglBuffer registry, GglBuffer username, GglBuffer secret
 );
 
-/// Request credentials from ECR and pipe them to `docker login`
+/// Request credentials from ECR and store them for subsequent pulls
 GglError ggl_docker_credentials_ecr_retrieve(
     GglDockerUriInfo ecr_registry, SigV4Details sigv4_details
 );
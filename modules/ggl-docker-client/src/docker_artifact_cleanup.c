@@ -6,24 +6,54 @@
 #include "ggl/docker_artifact_cleanup.h"
 #include "ggl/core_bus/gg_config.h"
 #include "ggl/docker_client.h"
+#include <fcntl.h>
 #include <ggl/arena.h>
 #include <ggl/buffer.h>
 #include <ggl/cleanup.h>
 #include <ggl/error.h>
+#include <ggl/file.h>
 #include <ggl/list.h>
 #include <ggl/log.h>
 #include <ggl/map.h>
+#include <ggl/nucleus/constants.h>
 #include <ggl/object.h>
 #include <ggl/recipe.h>
 #include <ggl/uri.h>
+#include <ggl/vector.h>
 #include <pthread.h>
 #include <string.h>
 #include <sys/types.h>
+#include <unistd.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
+
+/// Max size of the docker image reference index.
+/// Can be configured with `-DGGL_DOCKER_REFERENCES_MAX_LEN=<N>`.
+#ifndef GGL_DOCKER_REFERENCES_MAX_LEN
+#define GGL_DOCKER_REFERENCES_MAX_LEN (64 * 1024)
+#endif
+
+/// Index location relative to the root path
+#define REFERENCES_PATH "packages/docker-references"
+#define REFERENCES_TMP_PATH "packages/docker-references.tmp"
+
+/// One line of the index: `<component>\t<version>\t<image>\n`
+typedef struct {
+    GglBuffer component_name;
+    GglBuffer component_version;
+    GglBuffer image_name;
+    /// The whole line including its newline
+    GglBuffer line;
+} DockerReference;
 
-static uint8_t recipe_buf[8192];
-static pthread_mutex_t recipe_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t references_mtx = PTHREAD_MUTEX_INITIALIZER;
+static uint8_t references_mem[GGL_DOCKER_REFERENCES_MAX_LEN];
+static GglByteVec references = { .buf = { .data = references_mem, .len = 0 },
+                                 .capacity = sizeof(references_mem) };
+/// Whether the index covers every stored recipe
+static bool references_valid = false;
 
 /// Assumes info does not contain a digest
 static bool is_tag_latest(GglDockerUriInfo info) {
@@ -78,242 +108,303 @@ static bool docker_uri_equals(GglDockerUriInfo lhs, GglDockerUriInfo rhs) {
     return false;
 }
 
-static GglError docker_artifact_exists(
-    int root_path_fd,
-    GglDockerUriInfo image_uri,
+static bool next_reference(GglBuffer *remaining, DockerReference *ref) {
+    while (remaining->len > 0) {
+        uint8_t *newline = memchr(remaining->data, '\n', remaining->len);
+        size_t line_len = (newline == NULL)
+            ? remaining->len
+            : (size_t) (newline - remaining->data) + 1U;
+        GglBuffer line = ggl_buffer_substr(*remaining, 0, line_len);
+        *remaining = ggl_buffer_substr(*remaining, line_len, SIZE_MAX);
+
+        GglBuffer fields = line;
+        (void) ggl_buffer_remove_suffix(&fields, GGL_STR("\n"));
+        size_t name_end;
+        if (!ggl_buffer_contains(fields, GGL_STR("\t"), &name_end)) {
+            continue;
+        }
+        GglBuffer rest = ggl_buffer_substr(fields, name_end + 1U, SIZE_MAX);
+        size_t version_end;
+        if (!ggl_buffer_contains(rest, GGL_STR("\t"), &version_end)) {
+            continue;
+        }
+        *ref = (DockerReference) {
+            .component_name = ggl_buffer_substr(fields, 0, name_end),
+            .component_version = ggl_buffer_substr(rest, 0, version_end),
+            .image_name = ggl_buffer_substr(rest, version_end + 1U, SIZE_MAX),
+            .line = line,
+        };
+        return true;
+    }
+    return false;
+}
+
+static bool is_reference_of(
+    const DockerReference *ref,
     GglBuffer component_name,
-    GglBuffer component_version,
-    bool *exists
+    GglBuffer component_version
 ) {
-    GGL_LOGT(
-        "Checking if %.*s-%.*s contains image",
-        (int) component_name.len,
-        component_name.data,
-        (int) component_version.len,
-        component_version.data
-    );
-    GGL_MTX_SCOPE_GUARD(&recipe_mtx);
-    GglArena recipe_arena = ggl_arena_init(GGL_BUF(recipe_buf));
-    GglObject recipe_obj;
+    return ggl_buffer_eq(ref->component_name, component_name)
+        && ggl_buffer_eq(ref->component_version, component_version);
+}
 
-    GglError ret = ggl_recipe_get_from_file(
-        root_path_fd,
-        component_name,
-        component_version,
-        &recipe_arena,
-        &recipe_obj
-    );
-    if (ret != GGL_ERR_OK) {
-        return ret;
+/// Assumes references_mtx is held
+static void remove_references(
+    GglBuffer component_name, GglBuffer component_version
+) {
+    size_t len = 0;
+    GglBuffer remaining = references.buf;
+    DockerReference ref;
+    while (next_reference(&remaining, &ref)) {
+        if (is_reference_of(&ref, component_name, component_version)) {
+            continue;
+        }
+        memmove(&references_mem[len], ref.line.data, ref.line.len);
+        len += ref.line.len;
     }
+    references.buf.len = len;
+}
 
-    if (ggl_obj_type(recipe_obj) != GGL_TYPE_MAP) {
-        return GGL_ERR_PARSE;
+/// Assumes references_mtx is held
+static void save_references(int root_path_fd) {
+    if (!references_valid) {
+        // Rebuilt on next start
+        (void) unlinkat(root_path_fd, REFERENCES_PATH, 0);
+        return;
     }
 
-    GglList artifacts;
-    ret = ggl_get_recipe_artifacts_for_platform(
-        ggl_obj_into_map(recipe_obj), &artifacts
+    int fd = -1;
+    GglError ret = ggl_file_openat(
+        root_path_fd,
+        GGL_STR(REFERENCES_TMP_PATH),
+        O_CREAT | O_WRONLY | O_TRUNC,
+        (mode_t) 0644,
+        &fd
     );
     if (ret != GGL_ERR_OK) {
-        return ret;
+        GGL_LOGW("Failed to save docker image references.");
+        return;
     }
-
-    GGL_LIST_FOREACH (artifact, artifacts) {
-        if (ggl_obj_type(*artifact) != GGL_TYPE_MAP) {
-            continue;
-        }
-        GglMap artifact_map = ggl_obj_into_map(*artifact);
-
-        GglObject *uri_obj = NULL;
-        if (!ggl_map_get(artifact_map, GGL_STR("Uri"), &uri_obj)) {
-            continue;
-        }
-        if (ggl_obj_type(*uri_obj) != GGL_TYPE_BUF) {
-            continue;
-        }
-        GglBuffer uri = ggl_obj_into_buf(*uri_obj);
-
-        if (!ggl_buffer_remove_prefix(&uri, GGL_STR("docker:"))) {
-            continue;
-        }
-
-        GglDockerUriInfo artifact_uri;
-        ret = gg_docker_uri_parse(uri, &artifact_uri);
-        if (ret != GGL_ERR_OK) {
-            continue;
-        }
-        if (docker_uri_equals(image_uri, artifact_uri)) {
-            *exists = true;
-            return GGL_ERR_OK;
-        }
+    GGL_CLEANUP(cleanup_close, fd);
+
+    ret = ggl_file_write(fd, references.buf);
+    if ((ret != GGL_ERR_OK)
+        || (renameat(
+                root_path_fd, REFERENCES_TMP_PATH, root_path_fd, REFERENCES_PATH
+            )
+            != 0)) {
+        GGL_LOGW("Failed to save docker image references.");
     }
-
-    *exists = false;
-    return GGL_ERR_OK;
 }
 
-static GglError ggl_docker_remove_if_unused(
-    int root_path_fd,
-    GglBuffer image_name,
-    GglBuffer component_name,
-    GglBuffer component_version
-) {
-    GGL_LOGT("Remove if unused");
-    if (component_name.len == 0) {
-        return GGL_ERR_INVALID;
+static bool artifact_docker_image(GglObject artifact, GglBuffer *image_name) {
+    if (ggl_obj_type(artifact) != GGL_TYPE_MAP) {
+        return false;
+    }
+    GglObject *uri_obj = NULL;
+    if (!ggl_map_get(ggl_obj_into_map(artifact), GGL_STR("Uri"), &uri_obj)) {
+        return false;
+    }
+    if (ggl_obj_type(*uri_obj) != GGL_TYPE_BUF) {
+        return false;
     }
+    GglBuffer uri = ggl_obj_into_buf(*uri_obj);
+    if (!ggl_buffer_remove_prefix(&uri, GGL_STR("docker:"))) {
+        return false;
+    }
+    // Would break the index format; not a valid image name either
+    if ((uri.len == 0) || (memchr(uri.data, '\t', uri.len) != NULL)
+        || (memchr(uri.data, '\n', uri.len) != NULL)) {
+        return false;
+    }
+    *image_name = uri;
+    return true;
+}
 
-    GglBuffer component_list_memory = GGL_BUF((uint8_t[4096]) { 0 });
-    GglArena component_list_alloc = ggl_arena_init(component_list_memory);
+GglError ggl_docker_references_load(int root_path_fd) {
+    GGL_MTX_SCOPE_GUARD(&references_mtx);
+    references.buf.len = 0;
+    references_valid = false;
 
-    GglList components;
-    GglError ret = ggl_gg_config_list(
-        GGL_BUF_LIST(GGL_STR("services")), &component_list_alloc, &components
+    int fd = -1;
+    GglError ret = ggl_file_openat(
+        root_path_fd, GGL_STR(REFERENCES_PATH), O_RDONLY, 0, &fd
     );
     if (ret != GGL_ERR_OK) {
-        return GGL_ERR_FAILURE;
-    }
-    ret = ggl_list_type_check(components, GGL_TYPE_BUF);
-    if (ret != GGL_ERR_OK) {
-        return GGL_ERR_FAILURE;
+        GGL_LOGD("No docker image reference index found.");
+        return GGL_ERR_NOENTRY;
     }
+    GGL_CLEANUP(cleanup_close, fd);
 
-    GglDockerUriInfo image_uri;
-    ret = gg_docker_uri_parse(image_name, &image_uri);
+    GglBuffer content = GGL_BUF(references_mem);
+    ret = ggl_file_read(fd, &content);
     if (ret != GGL_ERR_OK) {
-        return GGL_ERR_FAILURE;
+        GGL_LOGW("Failed to read docker image reference index.");
+        return GGL_ERR_NOENTRY;
     }
+    references.buf.len = content.len;
+    references_valid = true;
+    return GGL_ERR_OK;
+}
 
-    GGL_LIST_FOREACH (component, components) {
-        GglBuffer other_component_name = ggl_obj_into_buf(*component);
-        GGL_LOGT(
-            "Checking %.*s for docker images",
-            (int) other_component_name.len,
-            other_component_name.data
+void ggl_docker_references_update(
+    int root_path_fd, GglBuffer component_name, GglBuffer component_version
+) {
+    static uint8_t recipe_mem[GGL_COMPONENT_RECIPE_MAX_LEN];
+    GGL_MTX_SCOPE_GUARD(&references_mtx);
+
+    remove_references(component_name, component_version);
+
+    GglArena recipe_arena = ggl_arena_init(GGL_BUF(recipe_mem));
+    GglObject recipe;
+    GglError ret = ggl_recipe_get_from_file(
+        root_path_fd,
+        component_name,
+        component_version,
+        &recipe_arena,
+        &recipe
+    );
+    GglList artifacts = { 0 };
+    if ((ret == GGL_ERR_OK) && (ggl_obj_type(recipe) == GGL_TYPE_MAP)) {
+        ret = ggl_get_recipe_artifacts_for_platform(
+            ggl_obj_into_map(recipe), &artifacts
         );
-        GglArena version_alloc = ggl_arena_init(GGL_BUF((uint8_t[256]) { 0 }));
-        GglBuffer other_component_version;
-        ret = ggl_gg_config_read_str(
-            GGL_BUF_LIST(
-                GGL_STR("services"), component_name, GGL_STR("version")
-            ),
-            &version_alloc,
-            &other_component_version
+    }
+    if (ret != GGL_ERR_OK) {
+        GGL_LOGD(
+            "No docker image references recorded for %.*s-%.*s.",
+            (int) component_name.len,
+            component_name.data,
+            (int) component_version.len,
+            component_version.data
         );
-        if (ret != GGL_ERR_OK) {
-            continue;
-        }
+    }
 
-        if (ggl_buffer_eq(other_component_name, component_name)
-            && ggl_buffer_eq(other_component_version, component_version)) {
+    GGL_LIST_FOREACH (artifact, artifacts) {
+        GglBuffer image_name;
+        if (!artifact_docker_image(*artifact, &image_name)) {
             continue;
         }
-
-        bool exists = false;
-
-        ret = docker_artifact_exists(
-            root_path_fd,
-            image_uri,
-            other_component_name,
-            other_component_version,
-            &exists
-        );
+        size_t prev_len = references.buf.len;
+        ret = ggl_byte_vec_append(&references, component_name);
+        ggl_byte_vec_chain_push(&ret, &references, '\t');
+        ggl_byte_vec_chain_append(&ret, &references, component_version);
+        ggl_byte_vec_chain_push(&ret, &references, '\t');
+        ggl_byte_vec_chain_append(&ret, &references, image_name);
+        ggl_byte_vec_chain_push(&ret, &references, '\n');
         if (ret != GGL_ERR_OK) {
-            return GGL_ERR_FAILURE;
-        }
-        if (exists) {
-            return GGL_ERR_OK;
+            GGL_LOGE(
+                "Docker image reference index full; unused images will not "
+                "be removed."
+            );
+            references.buf.len = prev_len;
+            references_valid = false;
+            break;
         }
+        GGL_LOGT(
+            "%.*s-%.*s references %.*s",
+            (int) component_name.len,
+            component_name.data,
+            (int) component_version.len,
+            component_version.data,
+            (int) image_name.len,
+            image_name.data
+        );
     }
 
-    return ggl_docker_remove(image_name);
+    save_references(root_path_fd);
 }
 
-/// Process the i'th artifact of the component
-/// Keeps at most one component's recipe in memory.
-static bool ggl_docker_artifact_cleanup_step(
-    int root_path_fd,
-    GglBuffer component_name,
-    GglBuffer component_version,
-    size_t i
+void ggl_docker_references_rebuilt(int root_path_fd) {
+    GGL_MTX_SCOPE_GUARD(&references_mtx);
+    references_valid = true;
+    save_references(root_path_fd);
+}
+
+static bool is_configured_version(
+    GglBuffer component_name, GglBuffer component_version
 ) {
-    static uint8_t image_name_buf[4096];
-    GglArena image_arena = ggl_arena_init(GGL_BUF(image_name_buf));
-    GglBuffer image_name;
+    GglArena version_alloc = ggl_arena_init(GGL_BUF((uint8_t[256]) { 0 }));
+    GglBuffer version;
+    GglError ret = ggl_gg_config_read_str(
+        GGL_BUF_LIST(GGL_STR("services"), component_name, GGL_STR("version")),
+        &version_alloc,
+        &version
+    );
+    return (ret == GGL_ERR_OK) && ggl_buffer_eq(version, component_version);
+}
 
-    {
-        GGL_MTX_SCOPE_GUARD(&recipe_mtx);
-
-        GglArena recipe_arena = ggl_arena_init(GGL_BUF(recipe_buf));
-        GglObject recipe;
-        GglError ret = ggl_recipe_get_from_file(
-            root_path_fd,
-            component_name,
-            component_version,
-            &recipe_arena,
-            &recipe
-        );
-        if ((ret != GGL_ERR_OK) || (ggl_obj_type(recipe) != GGL_TYPE_MAP)) {
-            return false;
+/// Whether a configured component version other than the given one uses the
+/// image. Assumes references_mtx is held.
+static bool image_in_use(
+    GglDockerUriInfo image_uri,
+    GglBuffer component_name,
+    GglBuffer component_version
+) {
+    GglBuffer remaining = references.buf;
+    DockerReference ref;
+    while (next_reference(&remaining, &ref)) {
+        if (is_reference_of(&ref, component_name, component_version)) {
+            continue;
         }
-        GglList artifacts;
-        ret = ggl_get_recipe_artifacts_for_platform(
-            ggl_obj_into_map(recipe), &artifacts
-        );
-        if (ret != GGL_ERR_OK) {
-            GGL_LOGT("Couldn't get recipe artifacts");
-            return false;
+        GglDockerUriInfo other_uri;
+        if (gg_docker_uri_parse(ref.image_name, &other_uri) != GGL_ERR_OK) {
+            continue;
         }
-
-        if (artifacts.len <= i) {
-            GGL_LOGT("Reached end of artifacts (%zu <= %zu)", artifacts.len, i);
-            return false;
+        if (!docker_uri_equals(image_uri, other_uri)) {
+            continue;
         }
-
-        GglObject *uri_obj = NULL;
-        if (!ggl_map_get(
-                ggl_obj_into_map(artifacts.items[i]), GGL_STR("Uri"), &uri_obj
+        if (is_configured_version(
+                ref.component_name, ref.component_version
             )) {
-            GGL_LOGT("No URI");
-            return true;
-        }
-        if (ggl_obj_type(*uri_obj) != GGL_TYPE_BUF) {
-            GGL_LOGT("URI not a buffer");
-            return true;
-        }
-
-        image_name = ggl_obj_into_buf(*uri_obj);
-        if (!ggl_buffer_remove_prefix(&image_name, GGL_STR("docker:"))) {
-            GGL_LOGT("URI not docker");
-            return true;
-        }
-        GGL_LOGT(
-            "Preparing to remove %.*s if it's unused",
-            (int) image_name.len,
-            image_name.data
-        );
-
-        ret = ggl_arena_claim_buf(&image_name, &image_arena);
-        if (ret != GGL_ERR_OK) {
+            GGL_LOGT(
+                "Image still used by %.*s-%.*s",
+                (int) ref.component_name.len,
+                ref.component_name.data,
+                (int) ref.component_version.len,
+                ref.component_version.data
+            );
             return true;
         }
     }
-
-    (void) ggl_docker_remove_if_unused(
-        root_path_fd, image_name, component_name, component_version
-    );
-    return true;
+    return false;
 }
 
 void ggl_docker_artifact_cleanup(
     int root_path_fd, GglBuffer component_name, GglBuffer component_version
 ) {
-    size_t i = 0;
-    while (ggl_docker_artifact_cleanup_step(
-        root_path_fd, component_name, component_version, i
-    )) {
-        GGL_LOGT("Finished step %zu", i);
-        ++i;
+    if (component_name.len == 0) {
+        return;
     }
+
+    GGL_MTX_SCOPE_GUARD(&references_mtx);
+
+    if (!references_valid) {
+        GGL_LOGW("Docker image references unknown; not removing images.");
+        return;
+    }
+
+    GglBuffer remaining = references.buf;
+    DockerReference ref;
+    while (next_reference(&remaining, &ref)) {
+        if (!is_reference_of(&ref, component_name, component_version)) {
+            continue;
+        }
+        GglDockerUriInfo image_uri;
+        if (gg_docker_uri_parse(ref.image_name, &image_uri) != GGL_ERR_OK) {
+            continue;
+        }
+        if (image_in_use(image_uri, component_name, component_version)) {
+            continue;
+        }
+        GGL_LOGD(
+            "Removing unused image %.*s",
+            (int) ref.image_name.len,
+            ref.image_name.data
+        );
+        (void) ggl_docker_remove(ref.image_name);
+    }
+
+    remove_references(component_name, component_version);
+    save_references(root_path_fd);
 }
@@ -4,15 +4,18 @@
  */
 
 #include "ggl/docker_client.h"
+#include "docker_engine.h"
 #include <ggl/api_ecr.h>
 #include <ggl/arena.h>
 #include <ggl/base64.h>
+#include <ggl/buffer.h>
+#include <ggl/cleanup.h>
 #include <ggl/error.h>
-#include <ggl/exec.h>
 #include <ggl/flags.h>
 #include <ggl/http.h>
 #include <ggl/io.h>
 #include <ggl/json_decode.h>
+#include <ggl/json_encode.h>
 #include <ggl/list.h>
 #include <ggl/log.h>
 #include <ggl/map.h>
@@ -20,8 +23,10 @@
 #include <ggl/uri.h>
 #include <ggl/vector.h>
 #include <inttypes.h>
+#include <pthread.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 static GglError head_buf_write(void *context, GglBuffer buf) {
@@ -40,66 +45,373 @@ static GglWriter head_buf_writer(GglByteVec *vec) {
 /// The max length of a docker image name including its repository and digest
 #define DOCKER_MAX_IMAGE_LEN (4096U)
 
-GglError ggl_docker_check_server(void) {
-    const char *args[] = { "docker", "-v", NULL };
-    uint8_t output_bytes[512U] = { 0 };
-    GglByteVec output = GGL_BYTE_VEC(output_bytes);
-    GglError err = ggl_exec_command_with_output(args, head_buf_writer(&output));
-    if (err != GGL_ERR_OK) {
-        if (output.buf.len == 0) {
-            GGL_LOGE("Docker does not appear to be installed.");
-        } else {
-            GGL_LOGE(
-                "docker -v failed with '%.*s'",
-                (int) output.buf.len,
-                output.buf.data
-            );
+/// The max length of a request path for an image
+#define DOCKER_MAX_IMAGE_PATH_LEN (DOCKER_MAX_IMAGE_LEN + 64U)
+
+/// The max length of a single pull progress message
+#define DOCKER_MAX_PROGRESS_LEN (2048U)
+
+/// Number of registries whose credentials are kept for pulls.
+/// Can be configured with `-DGGL_DOCKER_MAX_REGISTRY_CREDENTIALS=<N>`.
+#ifndef GGL_DOCKER_MAX_REGISTRY_CREDENTIALS
+#define GGL_DOCKER_MAX_REGISTRY_CREDENTIALS 4
+#endif
+
+typedef struct {
+    uint8_t registry[256];
+    size_t registry_len;
+    /// Encoded X-Registry-Auth value
+    uint8_t auth[GGL_DOCKER_MAX_REGISTRY_AUTH_LEN];
+    size_t auth_len;
+} RegistryCredentials;
+
+typedef struct {
+    GglBuffer image_name;
+    uint8_t line_mem[DOCKER_MAX_PROGRESS_LEN];
+    GglByteVec line;
+    bool line_truncated;
+    bool failed;
+    size_t layers_downloaded;
+    size_t layers_present;
+} PullProgress;
+
+// Protects the registry credentials and pull state
+static pthread_mutex_t client_mtx = PTHREAD_MUTEX_INITIALIZER;
+static RegistryCredentials credentials[GGL_DOCKER_MAX_REGISTRY_CREDENTIALS];
+static size_t credentials_count = 0;
+
+/// Only allows characters valid in docker image references, so that names can
+/// be used in request paths and queries without escaping.
+static bool image_name_valid(GglBuffer image_name) {
+    if ((image_name.len == 0) || (image_name.len > DOCKER_MAX_IMAGE_LEN)) {
+        GGL_LOGE("Invalid docker image name length.");
+        return false;
+    }
+    for (size_t i = 0; i < image_name.len; i++) {
+        uint8_t c = image_name.data[i];
+        if (((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z'))
+            || ((c >= '0') && (c <= '9'))) {
+            continue;
+        }
+        if ((c == '.') || (c == '_') || (c == '-') || (c == ':') || (c == '/')
+            || (c == '@')) {
+            continue;
+        }
+        GGL_LOGE(
+            "Invalid character in docker image name '%.*s'.",
+            (int) image_name.len,
+            image_name.data
+        );
+        return false;
+    }
+    return true;
+}
+
+static GglBuffer registry_host(GglBuffer registry) {
+    if (!ggl_buffer_remove_prefix(&registry, GGL_STR("https://"))) {
+        (void) ggl_buffer_remove_prefix(&registry, GGL_STR("http://"));
+    }
+    (void) ggl_buffer_remove_suffix(&registry, GGL_STR("/"));
+    return registry;
+}
+
+/// Assumes client_mtx is held
+static RegistryCredentials *find_credentials(GglBuffer registry) {
+    GglBuffer host = registry_host(registry);
+    for (size_t i = 0; i < credentials_count; i++) {
+        GglBuffer stored = { .data = credentials[i].registry,
+                             .len = credentials[i].registry_len };
+        if (ggl_buffer_eq(stored, host)) {
+            return &credentials[i];
         }
     }
+    return NULL;
+}
 
+/// Perform a single request, capturing the start of the response body.
+static GglError docker_request(
+    const char *method,
+    GglBuffer path,
+    GglBuffer body,
+    GglByteVec *output,
+    uint16_t *status
+) {
+    DockerEngineRequest request = {
+        .method = method,
+        .path = path,
+        .body = body,
+        .response = head_buf_writer(output),
+    };
+    GglError err = docker_engine_call(&request, status, 1);
+    if (err == GGL_ERR_NOCONN) {
+        GGL_LOGE("Could not connect to the docker daemon.");
+    }
     return err;
 }
 
-GglError ggl_docker_pull(GglBuffer image_name) {
-    char image_null_term[DOCKER_MAX_IMAGE_LEN + 1U] = { 0 };
-    if (image_name.len > DOCKER_MAX_IMAGE_LEN) {
-        GGL_LOGE("Docker image name too long.");
+static GglError image_path(
+    GglByteVec *path, GglBuffer image_name, GglBuffer suffix
+) {
+    if (!image_name_valid(image_name)) {
         return GGL_ERR_INVALID;
     }
-    memcpy(image_null_term, image_name.data, image_name.len);
+    GglError ret = ggl_byte_vec_append(path, GGL_STR("/images/"));
+    ggl_byte_vec_chain_append(&ret, path, image_name);
+    ggl_byte_vec_chain_append(&ret, path, suffix);
+    return ret;
+}
 
-    GGL_LOGD("Pulling %.*s", (int) image_name.len, image_name.data);
-    const char *args[] = { "docker", "pull", "-q", image_null_term, NULL };
-    GglError err = ggl_exec_command(args);
+GglError ggl_docker_check_server(void) {
+    uint8_t output_bytes[512U] = { 0 };
+    GglByteVec output = GGL_BYTE_VEC(output_bytes);
+    uint16_t status = 0;
+    GglError err = docker_request(
+        "GET", GGL_STR("/_ping"), GGL_STR(""), &output, &status
+    );
     if (err != GGL_ERR_OK) {
-        GGL_LOGE("docker image pull failed.");
+        GGL_LOGE("Docker does not appear to be installed or running.");
+        return err;
+    }
+    if (status != 200U) {
+        GGL_LOGE(
+            "Docker ping failed (HTTP %" PRIu16 "): '%.*s'",
+            status,
+            (int) output.buf.len,
+            output.buf.data
+        );
         return GGL_ERR_FAILURE;
     }
     return GGL_ERR_OK;
 }
 
+static void handle_pull_progress(PullProgress *progress, GglBuffer line) {
+    GglArena arena = ggl_arena_init(GGL_BUF((uint8_t[1024]) { 0 }));
+    GglObject message;
+    GglError ret = ggl_json_decode_destructive(line, &arena, &message);
+    if ((ret != GGL_ERR_OK) || (ggl_obj_type(message) != GGL_TYPE_MAP)) {
+        GGL_LOGT("Skipping unrecognized pull progress message.");
+        return;
+    }
+
+    GglObject *error_obj = NULL;
+    GglObject *message_obj = NULL;
+    GglObject *status_obj = NULL;
+    GglObject *id_obj = NULL;
+    ret = ggl_map_validate(
+        ggl_obj_into_map(message),
+        GGL_MAP_SCHEMA(
+            { GGL_STR("error"), GGL_OPTIONAL, GGL_TYPE_BUF, &error_obj },
+            { GGL_STR("message"), GGL_OPTIONAL, GGL_TYPE_BUF, &message_obj },
+            { GGL_STR("status"), GGL_OPTIONAL, GGL_TYPE_BUF, &status_obj },
+            { GGL_STR("id"), GGL_OPTIONAL, GGL_TYPE_BUF, &id_obj }
+        )
+    );
+    if (ret != GGL_ERR_OK) {
+        GGL_LOGT("Skipping unrecognized pull progress message.");
+        return;
+    }
+
+    // Errors during a pull are reported in the stream; the status is 200
+    if (error_obj == NULL) {
+        error_obj = message_obj;
+    }
+    if (error_obj != NULL) {
+        GglBuffer error = ggl_obj_into_buf(*error_obj);
+        GGL_LOGE(
+            "Pulling %.*s failed: %.*s",
+            (int) progress->image_name.len,
+            progress->image_name.data,
+            (int) error.len,
+            error.data
+        );
+        progress->failed = true;
+        return;
+    }
+    if (status_obj == NULL) {
+        return;
+    }
+
+    GglBuffer status = ggl_obj_into_buf(*status_obj);
+    if (id_obj == NULL) {
+        GGL_LOGD(
+            "%.*s: %.*s",
+            (int) progress->image_name.len,
+            progress->image_name.data,
+            (int) status.len,
+            status.data
+        );
+        return;
+    }
+
+    GglBuffer layer = ggl_obj_into_buf(*id_obj);
+    if (ggl_buffer_eq(status, GGL_STR("Pull complete"))) {
+        progress->layers_downloaded++;
+    } else if (ggl_buffer_eq(status, GGL_STR("Already exists"))) {
+        progress->layers_present++;
+    }
+    GGL_LOGT(
+        "%.*s: layer %.*s: %.*s",
+        (int) progress->image_name.len,
+        progress->image_name.data,
+        (int) layer.len,
+        layer.data,
+        (int) status.len,
+        status.data
+    );
+}
+
+static void flush_pull_progress(PullProgress *progress) {
+    if (progress->line_truncated) {
+        GGL_LOGT("Skipping oversized pull progress message.");
+    } else if (progress->line.buf.len > 0) {
+        handle_pull_progress(progress, progress->line.buf);
+    }
+    progress->line.buf.len = 0;
+    progress->line_truncated = false;
+}
+
+/// Splits the streamed pull response into its newline-delimited JSON messages.
+static GglError pull_progress_write(void *ctx, GglBuffer buf) {
+    PullProgress *progress = ctx;
+    while (buf.len > 0) {
+        uint8_t *newline = memchr(buf.data, '\n', buf.len);
+        size_t len = (newline == NULL) ? buf.len
+                                       : (size_t) (newline - buf.data);
+        GglError ret = ggl_byte_vec_append(
+            &progress->line, ggl_buffer_substr(buf, 0, len)
+        );
+        if (ret != GGL_ERR_OK) {
+            progress->line_truncated = true;
+        }
+        if (newline == NULL) {
+            break;
+        }
+        flush_pull_progress(progress);
+        buf = ggl_buffer_substr(buf, len + 1U, SIZE_MAX);
+    }
+    return GGL_ERR_OK;
+}
+
+static GglError pull_images(const GglBuffer *image_names, size_t count) {
+    static PullProgress progress[GGL_DOCKER_MAX_PARALLEL_REQUESTS];
+    static uint8_t path_mem[GGL_DOCKER_MAX_PARALLEL_REQUESTS]
+                           [DOCKER_MAX_IMAGE_PATH_LEN];
+    DockerEngineRequest requests[GGL_DOCKER_MAX_PARALLEL_REQUESTS];
+
+    GGL_MTX_SCOPE_GUARD(&client_mtx);
+
+    for (size_t i = 0; i < count; i++) {
+        GglBuffer image_name = image_names[i];
+        GglDockerUriInfo info = { 0 };
+        if (!image_name_valid(image_name)
+            || (gg_docker_uri_parse(image_name, &info) != GGL_ERR_OK)) {
+            return GGL_ERR_INVALID;
+        }
+
+        GglByteVec path = GGL_BYTE_VEC(path_mem[i]);
+        GglError ret
+            = ggl_byte_vec_append(&path, GGL_STR("/images/create?fromImage="));
+        ggl_byte_vec_chain_append(&ret, &path, image_name);
+        // Without a tag, the daemon pulls every tag of the repository
+        if ((info.tag.len == 0) && (info.digest.len == 0)) {
+            ggl_byte_vec_chain_append(&ret, &path, GGL_STR("&tag=latest"));
+        }
+        if (ret != GGL_ERR_OK) {
+            GGL_LOGE("Docker image name too long.");
+            return GGL_ERR_INVALID;
+        }
+
+        progress[i] = (PullProgress) { .image_name = image_name };
+        progress[i].line = GGL_BYTE_VEC(progress[i].line_mem);
+
+        RegistryCredentials *creds = find_credentials(info.registry);
+        requests[i] = (DockerEngineRequest) {
+            .method = "POST",
+            .path = path.buf,
+            .registry_auth = (creds == NULL)
+                ? GGL_STR("")
+                : (GglBuffer) { .data = creds->auth, .len = creds->auth_len },
+            .response = { .ctx = &progress[i], .write = pull_progress_write },
+        };
+        GGL_LOGD("Pulling %.*s", (int) image_name.len, image_name.data);
+    }
+
+    uint16_t status[GGL_DOCKER_MAX_PARALLEL_REQUESTS] = { 0 };
+    GglError err = docker_engine_call(requests, status, count);
+    if (err == GGL_ERR_NOCONN) {
+        GGL_LOGE("Could not connect to the docker daemon.");
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        flush_pull_progress(&progress[i]);
+        if ((status[i] != 200U) || progress[i].failed) {
+            GGL_LOGE(
+                "docker image pull of %.*s failed (HTTP %" PRIu16 ").",
+                (int) image_names[i].len,
+                image_names[i].data,
+                status[i]
+            );
+            err = GGL_ERR_FAILURE;
+            continue;
+        }
+        GGL_LOGD(
+            "Pulled %.*s (%zu layers downloaded, %zu already present).",
+            (int) image_names[i].len,
+            image_names[i].data,
+            progress[i].layers_downloaded,
+            progress[i].layers_present
+        );
+    }
+    return err;
+}
+
+GglError ggl_docker_pull_many(GglBufList image_names) {
+    for (size_t start = 0; start < image_names.len;
+         start += GGL_DOCKER_MAX_PARALLEL_REQUESTS) {
+        size_t count = image_names.len - start;
+        if (count > GGL_DOCKER_MAX_PARALLEL_REQUESTS) {
+            count = GGL_DOCKER_MAX_PARALLEL_REQUESTS;
+        }
+        GglError err = pull_images(&image_names.bufs[start], count);
+        if (err != GGL_ERR_OK) {
+            return GGL_ERR_FAILURE;
+        }
+    }
+    return GGL_ERR_OK;
+}
+
+GglError ggl_docker_pull(GglBuffer image_name) {
+    return ggl_docker_pull_many((GglBufList) { .bufs = &image_name, .len = 1 });
+}
+
 GglError ggl_docker_remove(GglBuffer image_name) {
-    char image_null_term[DOCKER_MAX_IMAGE_LEN + 1U] = { 0 };
-    if (image_name.len > DOCKER_MAX_IMAGE_LEN) {
-        GGL_LOGE("Docker image name too long.");
+    uint8_t path_mem[DOCKER_MAX_IMAGE_PATH_LEN];
+    GglByteVec path = GGL_BYTE_VEC(path_mem);
+    GglError err = image_path(&path, image_name, GGL_STR(""));
+    if (err != GGL_ERR_OK) {
         return GGL_ERR_INVALID;
     }
-    GGL_LOGD("Removing docker image '%s'", image_null_term);
-
-    memcpy(image_null_term, image_name.data, image_name.len);
-    const char *args[] = { "docker", "rmi", image_null_term, NULL };
+    GGL_LOGD(
+        "Removing docker image '%.*s'", (int) image_name.len, image_name.data
+    );
 
     uint8_t output_bytes[512U] = { 0 };
     GglByteVec output = GGL_BYTE_VEC(output_bytes);
-    GglError err = ggl_exec_command_with_output(args, head_buf_writer(&output));
+    uint16_t status = 0;
+    err = docker_request("DELETE", path.buf, GGL_STR(""), &output, &status);
     if (err != GGL_ERR_OK) {
-        size_t start = 0;
-        if (ggl_buffer_contains(output.buf, GGL_STR("No such image"), &start)) {
-            GGL_LOGD("Image was not found to delete.");
-            return GGL_ERR_OK;
-        }
+        return GGL_ERR_FAILURE;
+    }
+    if (status == 404U) {
+        GGL_LOGD("Image was not found to delete.");
+        return GGL_ERR_OK;
+    }
+    if (status != 200U) {
         GGL_LOGE(
-            "docker rmi failed: '%.*s'", (int) output.buf.len, output.buf.data
+            "docker image remove failed (HTTP %" PRIu16 "): '%.*s'",
+            status,
+            (int) output.buf.len,
+            output.buf.data
         );
         return GGL_ERR_FAILURE;
     }
@@ -107,55 +419,118 @@ GglError ggl_docker_remove(GglBuffer image_name) {
 }
 
 GglError ggl_docker_check_image(GglBuffer image_name) {
-    char image_null_term[DOCKER_MAX_IMAGE_LEN + 1U] = { 0 };
-    if (image_name.len > DOCKER_MAX_IMAGE_LEN) {
-        GGL_LOGE("Docker image name too long.");
+    uint8_t path_mem[DOCKER_MAX_IMAGE_PATH_LEN];
+    GglByteVec path = GGL_BYTE_VEC(path_mem);
+    GglError err = image_path(&path, image_name, GGL_STR("/json"));
+    if (err != GGL_ERR_OK) {
         return GGL_ERR_INVALID;
     }
-    memcpy(image_null_term, image_name.data, image_name.len);
-
-    GGL_LOGD("Finding docker image '%s'", image_null_term);
-
-    const char *args[]
-        = { "docker", "image", "ls", "-q", image_null_term, NULL };
+    GGL_LOGD(
+        "Finding docker image '%.*s'", (int) image_name.len, image_name.data
+    );
 
     uint8_t output_bytes[256] = { 0 };
     GglByteVec output = GGL_BYTE_VEC(output_bytes);
-    GglError err = ggl_exec_command_with_output(args, head_buf_writer(&output));
+    uint16_t status = 0;
+    err = docker_request("GET", path.buf, GGL_STR(""), &output, &status);
     if (err != GGL_ERR_OK) {
+        return GGL_ERR_FAILURE;
+    }
+    if (status == 404U) {
+        return GGL_ERR_NOENTRY;
+    }
+    if (status != 200U) {
         GGL_LOGE(
-            "docker image ls -q failed: '%.*s'",
+            "docker image inspect failed (HTTP %" PRIu16 "): '%.*s'",
+            status,
             (int) output.buf.len,
             output.buf.data
         );
         return GGL_ERR_FAILURE;
     }
-    if (output.buf.len == 0) {
-        return GGL_ERR_NOENTRY;
-    }
     return GGL_ERR_OK;
 }
 
 GglError ggl_docker_credentials_store(
     GglBuffer registry, GglBuffer username, GglBuffer secret
 ) {
-    char registry_buf[4096 + 1] = { 0 };
-    if (registry.len >= sizeof(registry_buf)) {
+    GglBuffer host = registry_host(registry);
+    if (host.len > sizeof(credentials[0].registry)) {
         GGL_LOGE("Registry name too long.");
         return GGL_ERR_INVALID;
     }
-    char username_buf[4096 + 1] = { 0 };
-    if (username.len >= sizeof(username_buf)) {
-        GGL_LOGE("Docker username too long");
-        return GGL_ERR_INVALID;
+
+    // Base64 encoding expands the JSON by 4/3. On the stack, as concurrent
+    // logins are verified outside client_mtx.
+    uint8_t auth_json_mem[GGL_DOCKER_MAX_REGISTRY_AUTH_LEN / 4U * 3U];
+    GglBuffer auth_json = GGL_BUF(auth_json_mem);
+    GglBuffer auth_json_remaining = auth_json;
+    GglError err = ggl_json_encode(
+        ggl_obj_map(GGL_MAP(
+            ggl_kv(GGL_STR("username"), ggl_obj_buf(username)),
+            ggl_kv(GGL_STR("password"), ggl_obj_buf(secret)),
+            ggl_kv(GGL_STR("serveraddress"), ggl_obj_buf(registry))
+        )),
+        ggl_buf_writer(&auth_json_remaining)
+    );
+    if (err != GGL_ERR_OK) {
+        GGL_LOGE("Docker credentials too long.");
+        return GGL_ERR_NOMEM;
     }
-    memcpy(registry_buf, registry.data, registry.len);
-    memcpy(username_buf, username.data, username.len);
+    auth_json.len = (size_t) (auth_json_remaining.data - auth_json.data);
 
-    const char *const ARGS[] = { "docker",     "login",      registry_buf,
-                                 "--username", username_buf, "--password-stdin",
-                                 NULL };
-    return ggl_exec_command_with_input(ARGS, ggl_obj_buf(secret));
+    // Verify the credentials with the registry, as `docker login` does
+    uint8_t output_bytes[512U] = { 0 };
+    GglByteVec output = GGL_BYTE_VEC(output_bytes);
+    uint16_t status = 0;
+    err = docker_request("POST", GGL_STR("/auth"), auth_json, &output, &status);
+    if (err != GGL_ERR_OK) {
+        return GGL_ERR_FAILURE;
+    }
+    if (status != 200U) {
+        GGL_LOGE(
+            "docker login to %.*s failed (HTTP %" PRIu16 "): '%.*s'",
+            (int) host.len,
+            host.data,
+            status,
+            (int) output.buf.len,
+            output.buf.data
+        );
+        return GGL_ERR_FAILURE;
+    }
+
+    GGL_MTX_SCOPE_GUARD(&client_mtx);
+
+    RegistryCredentials *creds = find_credentials(host);
+    if (creds == NULL) {
+        if (credentials_count >= GGL_DOCKER_MAX_REGISTRY_CREDENTIALS) {
+            GGL_LOGE("Too many docker registries to store credentials for.");
+            return GGL_ERR_NOMEM;
+        }
+        creds = &credentials[credentials_count];
+        credentials_count++;
+        memcpy(creds->registry, host.data, host.len);
+        creds->registry_len = host.len;
+    }
+
+    GglArena auth_arena = ggl_arena_init(GGL_BUF(creds->auth));
+    GglBuffer auth;
+    err = ggl_base64_encode(auth_json, &auth_arena, &auth);
+    if (err != GGL_ERR_OK) {
+        GGL_LOGE("Docker credentials too long.");
+        creds->auth_len = 0;
+        return GGL_ERR_NOMEM;
+    }
+    // X-Registry-Auth is base64url encoded
+    for (size_t i = 0; i < auth.len; i++) {
+        if (auth.data[i] == '+') {
+            auth.data[i] = '-';
+        } else if (auth.data[i] == '/') {
+            auth.data[i] = '_';
+        }
+    }
+    creds->auth_len = auth.len;
+    return GGL_ERR_OK;
 }
 
 GglError ggl_docker_credentials_ecr_retrieve(
@@ -0,0 +1,265 @@
+/* aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "docker_engine.h"
+#include <assert.h>
+#include <curl/curl.h>
+#include <ggl/buffer.h>
+#include <ggl/cleanup.h>
+#include <ggl/error.h>
+#include <ggl/io.h>
+#include <ggl/log.h>
+#include <ggl/vector.h>
+#include <pthread.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/// Path of the Docker Engine API socket, used unless DOCKER_HOST names a unix
+/// socket.
+/// Can be configured with `-DGGL_DOCKER_SOCKET_PATH=<path>`.
+#ifndef GGL_DOCKER_SOCKET_PATH
+#define GGL_DOCKER_SOCKET_PATH "/var/run/docker.sock"
+#endif
+
+/// The max length of a request path, including its query string
+#define DOCKER_MAX_URL_LEN (4096U + 256U)
+
+/// The max length of the X-Registry-Auth header value
+#define DOCKER_MAX_HEADER_LEN (GGL_DOCKER_MAX_REGISTRY_AUTH_LEN + 32U)
+
+typedef struct {
+    GglWriter writer;
+    GglError err;
+} ResponseCtx;
+
+static pthread_mutex_t engine_mtx = PTHREAD_MUTEX_INITIALIZER;
+// Kept between calls so that connections to the daemon are reused
+static CURLM *multi = NULL;
+static CURL *handles[GGL_DOCKER_MAX_PARALLEL_REQUESTS];
+static struct curl_slist *headers[GGL_DOCKER_MAX_PARALLEL_REQUESTS];
+
+static const char *socket_path(void) {
+    // NOLINTNEXTLINE(concurrency-mt-unsafe) safe on glibc; not calling setenv
+    const char *host = getenv("DOCKER_HOST");
+    if ((host != NULL) && (strncmp(host, "unix://", 7) == 0)) {
+        return &host[7];
+    }
+    return GGL_DOCKER_SOCKET_PATH;
+}
+
+static size_t write_response(
+    void *response_data, size_t size, size_t nmemb, void *ctx
+) {
+    ResponseCtx *response_ctx = ctx;
+    size_t len = size * nmemb;
+    if (response_ctx->writer.write == NULL) {
+        return len;
+    }
+    GglError ret = ggl_writer_call(
+        response_ctx->writer,
+        (GglBuffer) { .data = response_data, .len = len }
+    );
+    if (ret != GGL_ERR_OK) {
+        response_ctx->err = ret;
+        return 0;
+    }
+    return len;
+}
+
+static GglError append_header(size_t i, GglBuffer key, GglBuffer value) {
+    static uint8_t header_mem[DOCKER_MAX_HEADER_LEN + 1];
+    GglByteVec header = GGL_BYTE_VEC(header_mem);
+    GglError ret = ggl_byte_vec_append(&header, key);
+    ggl_byte_vec_chain_append(&ret, &header, GGL_STR(": "));
+    ggl_byte_vec_chain_append(&ret, &header, value);
+    ggl_byte_vec_chain_push(&ret, &header, '\0');
+    if (ret != GGL_ERR_OK) {
+        GGL_LOGE("Docker API request header too long.");
+        return GGL_ERR_NOMEM;
+    }
+
+    // Copied by curl
+    struct curl_slist *new_list
+        = curl_slist_append(headers[i], (char *) header.buf.data);
+    if (new_list == NULL) {
+        return GGL_ERR_NOMEM;
+    }
+    headers[i] = new_list;
+    return GGL_ERR_OK;
+}
+
+static GglError prepare_handle(
+    size_t i, const DockerEngineRequest *request, ResponseCtx *ctx
+) {
+    if (handles[i] == NULL) {
+        handles[i] = curl_easy_init();
+        if (handles[i] == NULL) {
+            GGL_LOGE("Failed to create curl handle.");
+            return GGL_ERR_NOMEM;
+        }
+    } else {
+        curl_easy_reset(handles[i]);
+    }
+    CURL *curl = handles[i];
+
+    static uint8_t url_mem[DOCKER_MAX_URL_LEN + 1];
+    GglByteVec url = GGL_BYTE_VEC(url_mem);
+    GglError ret = ggl_byte_vec_append(&url, GGL_STR("http://localhost"));
+    ggl_byte_vec_chain_append(&ret, &url, request->path);
+    ggl_byte_vec_chain_push(&ret, &url, '\0');
+    if (ret != GGL_ERR_OK) {
+        GGL_LOGE("Docker API request path too long.");
+        return GGL_ERR_NOMEM;
+    }
+
+    if (request->registry_auth.len > 0) {
+        ret = append_header(
+            i, GGL_STR("X-Registry-Auth"), request->registry_auth
+        );
+        if (ret != GGL_ERR_OK) {
+            return ret;
+        }
+    }
+    if (request->body.len > 0) {
+        ret = append_header(
+            i, GGL_STR("Content-Type"), GGL_STR("application/json")
+        );
+        if (ret != GGL_ERR_OK) {
+            return ret;
+        }
+    }
+
+    curl_easy_setopt(curl, CURLOPT_UNIX_SOCKET_PATH, socket_path());
+    curl_easy_setopt(curl, CURLOPT_URL, (char *) url.buf.data);
+    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, request->method);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers[i]);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_response);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, ctx);
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, ctx);
+    if ((request->body.len > 0) || (strcmp(request->method, "POST") == 0)) {
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long) request->body.len);
+        curl_easy_setopt(
+            curl,
+            CURLOPT_POSTFIELDS,
+            (request->body.len > 0) ? (char *) request->body.data : ""
+        );
+    }
+    return GGL_ERR_OK;
+}
+
+static GglError translate_curl_code(CURLcode code) {
+    switch (code) {
+    case CURLE_OK:
+        return GGL_ERR_OK;
+    case CURLE_COULDNT_CONNECT:
+        return GGL_ERR_NOCONN;
+    case CURLE_URL_MALFORMAT:
+        return GGL_ERR_PARSE;
+    case CURLE_ABORTED_BY_CALLBACK:
+    case CURLE_WRITE_ERROR:
+        return GGL_ERR_FAILURE;
+    default:
+        return GGL_ERR_REMOTE;
+    }
+}
+
+static GglError run_requests(uint16_t *status, size_t count) {
+    int running = 1;
+    while (running > 0) {
+        CURLMcode mc = curl_multi_perform(multi, &running);
+        if ((mc == CURLM_OK) && (running > 0)) {
+            mc = curl_multi_poll(multi, NULL, 0, 1000, NULL);
+        }
+        if (mc != CURLM_OK) {
+            GGL_LOGE(
+                "Docker API requests failed: %s", curl_multi_strerror(mc)
+            );
+            return GGL_ERR_FAILURE;
+        }
+    }
+
+    GglError ret = GGL_ERR_OK;
+    CURLMsg *msg;
+    int queued;
+    while ((msg = curl_multi_info_read(multi, &queued)) != NULL) {
+        if (msg->msg != CURLMSG_DONE) {
+            continue;
+        }
+        size_t i = 0;
+        while ((i < count) && (handles[i] != msg->easy_handle)) {
+            i++;
+        }
+        assert(i < count);
+
+        if (msg->data.result != CURLE_OK) {
+            ResponseCtx *ctx = NULL;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &ctx);
+            GGL_LOGE(
+                "Docker API request failed: %s",
+                curl_easy_strerror(msg->data.result)
+            );
+            ret = ((ctx != NULL) && (ctx->err != GGL_ERR_OK))
+                ? ctx->err
+                : translate_curl_code(msg->data.result);
+            continue;
+        }
+
+        long response_code = 0;
+        curl_easy_getinfo(
+            msg->easy_handle, CURLINFO_RESPONSE_CODE, &response_code
+        );
+        status[i] = (uint16_t) response_code;
+    }
+    return ret;
+}
+
+GglError docker_engine_call(
+    const DockerEngineRequest *requests, uint16_t *status, size_t count
+) {
+    assert(count <= GGL_DOCKER_MAX_PARALLEL_REQUESTS);
+    GGL_MTX_SCOPE_GUARD(&engine_mtx);
+
+    if (multi == NULL) {
+        multi = curl_multi_init();
+        if (multi == NULL) {
+            GGL_LOGE("Failed to create curl multi handle.");
+            return GGL_ERR_NOMEM;
+        }
+    }
+
+    ResponseCtx ctx[GGL_DOCKER_MAX_PARALLEL_REQUESTS] = { 0 };
+    GglError ret = GGL_ERR_OK;
+    size_t added = 0;
+    for (size_t i = 0; i < count; i++) {
+        status[i] = 0;
+        ctx[i] = (ResponseCtx) { .writer = requests[i].response,
+                                 .err = GGL_ERR_OK };
+        ret = prepare_handle(i, &requests[i], &ctx[i]);
+        if (ret != GGL_ERR_OK) {
+            break;
+        }
+        if (curl_multi_add_handle(multi, handles[i]) != CURLM_OK) {
+            ret = GGL_ERR_FAILURE;
+            break;
+        }
+        added++;
+    }
+
+    if (ret == GGL_ERR_OK) {
+        ret = run_requests(status, count);
+    }
+
+    for (size_t i = 0; i < added; i++) {
+        (void) curl_multi_remove_handle(multi, handles[i]);
+    }
+    for (size_t i = 0; i < count; i++) {
+        curl_slist_free_all(headers[i]);
+        headers[i] = NULL;
+    }
+    return ret;
+}
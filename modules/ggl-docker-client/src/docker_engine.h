@@ -0,0 +1,49 @@
+/* aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef GGL_DOCKER_ENGINE_H
+#define GGL_DOCKER_ENGINE_H
+
+#include <ggl/buffer.h>
+#include <ggl/error.h>
+#include <ggl/io.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// Maximum number of Docker Engine API requests performed concurrently.
+/// Can be configured with `-DGGL_DOCKER_MAX_PARALLEL_REQUESTS=<N>`.
+#ifndef GGL_DOCKER_MAX_PARALLEL_REQUESTS
+#define GGL_DOCKER_MAX_PARALLEL_REQUESTS 4
+#endif
+
+/// Maximum length of an encoded registry credential (X-Registry-Auth).
+/// Can be configured with `-DGGL_DOCKER_MAX_REGISTRY_AUTH_LEN=<N>`.
+#ifndef GGL_DOCKER_MAX_REGISTRY_AUTH_LEN
+#define GGL_DOCKER_MAX_REGISTRY_AUTH_LEN 8192
+#endif
+
+/// A request to the Docker Engine HTTP API.
+typedef struct {
+    /// HTTP method, e.g. "GET"
+    const char *method;
+    /// Request path and query string, e.g. "/images/create?fromImage=x"
+    GglBuffer path;
+    /// Value of the X-Registry-Auth header; omitted if empty
+    GglBuffer registry_auth;
+    /// JSON request body; omitted if empty
+    GglBuffer body;
+    /// Receives the response body as it is streamed
+    GglWriter response;
+} DockerEngineRequest;
+
+/// Perform requests against the Docker Engine API socket concurrently.
+/// status[i] is set to the HTTP status of requests[i], or 0 if it failed.
+/// Connections to the daemon are kept open between calls.
+/// Returns an error if any request could not be completed.
+GglError docker_engine_call(
+    const DockerEngineRequest *requests, uint16_t *status, size_t count
+);
+
+#endif
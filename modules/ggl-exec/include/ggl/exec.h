@@ -7,10 +7,17 @@
 #define GGL_EXEC_H
 
 #include "ggl/io.h"
+#include <ggl/buffer.h>
 #include <ggl/error.h>
 #include <ggl/object.h>
 #include <sys/types.h>
 
+/// Seconds ggl_exec_kill_process waits after SIGTERM before sending SIGKILL.
+/// Can be configured with `-DGGL_EXEC_TERM_TIMEOUT=<N>`.
+#ifndef GGL_EXEC_TERM_TIMEOUT
+#define GGL_EXEC_TERM_TIMEOUT 10
+#endif
+
 GglError ggl_exec_command(const char *const args[static 1]);
 GglError ggl_exec_command_async(
     const char *const args[static 1], pid_t child_pid[static 1]
@@ -21,6 +28,28 @@ GglError ggl_exec_command_with_output(
     const char *const args[static 1], GglWriter writer
 );
 
+/// Run a command, capturing stdout and stderr into `output`.
+/// `output->len` is set to the length captured. Returns GGL_ERR_NOMEM if the
+/// output did not fit.
+GglError ggl_exec_command_with_output_buf(
+    const char *const args[static 1], GglBuffer *output
+);
+
+/// Run a command in a cgroup v2 directory and wait for it to exit.
+/// The child is created in the cgroup (clone3 with CLONE_INTO_CGROUP), so no
+/// wrapper such as cgexec is needed. `cgroup_fd` is an open fd for the cgroup
+/// directory. Returns GGL_ERR_UNSUPPORTED if the kernel lacks clone3.
+GglError ggl_exec_command_in_cgroup(
+    const char *const args[static 1], int cgroup_fd
+);
+
+/// Fork directly into a cgroup v2 directory, for work that does not exec.
+/// Like fork, returns in both processes; `pid` is set to the child's pid in
+/// the parent and to 0 in the child, which may then only call
+/// async-signal-safe functions. Returns GGL_ERR_UNSUPPORTED if the kernel
+/// lacks clone3 or CLONE_INTO_CGROUP.
+GglError ggl_exec_fork_in_cgroup(int cgroup_fd, pid_t *pid);
+
 GglError ggl_exec_command_with_input(
     const char *const args[static 1], GglObject payload
 );
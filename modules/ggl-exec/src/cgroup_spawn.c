@@ -0,0 +1,88 @@
+/* aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "cgroup_spawn.h"
+#include "ggl/exec.h"
+#include <errno.h>
+#include <ggl/error.h>
+#include <ggl/log.h>
+#include <linux/sched.h>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <stdlib.h>
+
+static pid_t sys_clone3(struct clone_args *args) {
+    return (pid_t) syscall(SYS_clone3, args, sizeof(*args));
+}
+
+static GglError clone3_error(void) {
+    GGL_LOGE("Err %d when calling clone3.", errno);
+    // E2BIG/EINVAL: kernel predates CLONE_INTO_CGROUP
+    return ((errno == ENOSYS) || (errno == E2BIG) || (errno == EINVAL))
+        ? GGL_ERR_UNSUPPORTED
+        : GGL_ERR_FAILURE;
+}
+
+GglError ggl_exec_fork_in_cgroup(int cgroup_fd, pid_t *pid) {
+    if (cgroup_fd < 0) {
+        return GGL_ERR_INVALID;
+    }
+
+    struct clone_args clone_args = {
+        .flags = CLONE_INTO_CGROUP,
+        .exit_signal = SIGCHLD,
+        .cgroup = (unsigned) cgroup_fd,
+    };
+
+    pid_t child = sys_clone3(&clone_args);
+    if (child < 0) {
+        return clone3_error();
+    }
+
+    *pid = child;
+    return GGL_ERR_OK;
+}
+
+GglError ggl_exec_spawn_in_cgroup(
+    const char *const args[static 1], int cgroup_fd, int out_fd, pid_t *pid
+) {
+    if (cgroup_fd < 0) {
+        return GGL_ERR_INVALID;
+    }
+
+    // Without CLONE_VM the child gets a copy of the address space, so it can
+    // safely return from the syscall wrapper. CLONE_VFORK keeps the parent
+    // suspended until the child has exec'd, as posix_spawn does.
+    struct clone_args clone_args = {
+        .flags = CLONE_VFORK | CLONE_INTO_CGROUP,
+        .exit_signal = SIGCHLD,
+        .cgroup = (unsigned) cgroup_fd,
+    };
+
+    pid_t child = sys_clone3(&clone_args);
+
+    if (child == 0) {
+        // Only async-signal-safe calls until exec
+        if (out_fd >= 0) {
+            if ((dup2(out_fd, STDOUT_FILENO) < 0)
+                || (dup2(out_fd, STDERR_FILENO) < 0)) {
+                _Exit(127);
+            }
+        }
+
+        execvp(args[0], (char **) args);
+
+        _Exit(127);
+    }
+
+    if (child < 0) {
+        return clone3_error();
+    }
+
+    *pid = child;
+    return GGL_ERR_OK;
+}
@@ -0,0 +1,18 @@
+/* aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef GGL_EXEC_CGROUP_SPAWN_H
+#define GGL_EXEC_CGROUP_SPAWN_H
+
+#include <ggl/error.h>
+#include <sys/types.h>
+
+/// Spawn a child directly into a cgroup v2 directory using clone3.
+/// If out_fd >= 0, the child's stdout and stderr are redirected to it.
+GglError ggl_exec_spawn_in_cgroup(
+    const char *const args[static 1], int cgroup_fd, int out_fd, pid_t *pid
+);
+
+#endif
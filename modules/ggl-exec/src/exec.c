@@ -4,9 +4,11 @@
  */
 
 #include "ggl/exec.h"
+#include "cgroup_spawn.h"
 #include "ggl/json_encode.h"
 #include "priv_io.h"
 #include <errno.h>
+#include <fcntl.h>
 #include <ggl/buffer.h>
 #include <ggl/cleanup.h>
 #include <ggl/error.h>
@@ -14,9 +16,8 @@
 #include <ggl/io.h>
 #include <ggl/log.h>
 #include <ggl/object.h>
-#include <signal.h>
+#include <ggl/process.h>
 #include <spawn.h>
-#include <string.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
@@ -71,59 +72,8 @@ GglError ggl_exec_command_async(
 }
 
 GglError ggl_exec_kill_process(pid_t process_id) {
-    // Send the SIGTERM signal to the process
-
-    // NOLINTBEGIN(concurrency-mt-unsafe, readability-else-after-return)
-    if (kill(process_id, SIGTERM) == -1) {
-        GGL_LOGE(
-            "Failed to kill the process id %d : %s errno:%d.",
-            process_id,
-            strerror(errno),
-            errno
-        );
-        return GGL_ERR_FAILURE;
-    }
-
-    int status;
-    pid_t wait_pid;
-
-    // Wait for the process to terminate
-    do {
-        wait_pid = waitpid(process_id, &status, 0);
-        if (wait_pid == -1) {
-            if (errno == ECHILD) {
-                GGL_LOGE("Process %d has already terminated.\n", process_id);
-                break;
-            } else {
-                GGL_LOGE(
-                    "Error waiting for process %d: %s (errno: %d)\n",
-                    process_id,
-                    strerror(errno),
-                    errno
-                );
-                break;
-            }
-        }
-
-        if (WIFEXITED(status)) {
-            GGL_LOGE(
-                "Process %d exited with status %d.\n",
-                process_id,
-                WEXITSTATUS(status)
-            );
-        } else if (WIFSIGNALED(status)) {
-            GGL_LOGD(
-                "Process %d was terminated by signal %d.\n",
-                process_id,
-                WTERMSIG(status)
-            );
-        }
-    } while (!WIFEXITED(status) && !WIFSIGNALED(status));
-
-    GGL_LOGD("Process %d has terminated.\n", process_id);
-
-    // NOLINTEND(concurrency-mt-unsafe, readability-else-after-return)
-    return GGL_ERR_OK;
+    GGL_LOGD("Terminating process %d.", process_id);
+    return ggl_process_kill(process_id, GGL_EXEC_TERM_TIMEOUT);
 }
 
 static void cleanup_posix_destroy_file_actions(
@@ -188,13 +138,17 @@ static GglError create_input_pipe_file_actions(
     return GGL_ERR_OK;
 }
 
+/// Size of reads from a child's output pipe.
+/// Matches the default pipe capacity so a full pipe is drained per read.
+#define PIPE_READ_CHUNK_LEN 4096
+
 // Read from pipe until EOF is found.
 // Writer is called until its first error is returned.
 // Pipe is flushed to allow child to exit cleanly.
 static GglError pipe_flush(int pipe_read_fd, GglWriter writer) {
     GglError writer_error = GGL_ERR_OK;
     while (true) {
-        uint8_t partial_buf[256];
+        uint8_t partial_buf[PIPE_READ_CHUNK_LEN];
         GglBuffer partial = GGL_BUF(partial_buf);
         GglError read_err = ggl_file_read(pipe_read_fd, &partial);
         if (read_err == GGL_ERR_RETRY) {
@@ -213,25 +167,52 @@ static GglError pipe_flush(int pipe_read_fd, GglWriter writer) {
     }
 }
 
-GglError ggl_exec_command_with_output(
-    const char *const args[static 1], GglWriter writer
+// Read from pipe into buf until EOF is found.
+// Output that does not fit is discarded to allow child to exit cleanly.
+static GglError pipe_read_all(int pipe_read_fd, GglBuffer *buf) {
+    GglBuffer remaining = *buf;
+    GglError ret = ggl_file_read(pipe_read_fd, &remaining);
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+    bool full = remaining.len == buf->len;
+    buf->len = remaining.len;
+    if (!full) {
+        return GGL_ERR_OK;
+    }
+
+    // Buffer is full; check for more output
+    uint8_t extra;
+    GglBuffer extra_buf = { .data = &extra, .len = 1 };
+    ret = ggl_file_read(pipe_read_fd, &extra_buf);
+    if ((ret != GGL_ERR_OK) || (extra_buf.len == 0)) {
+        return ret;
+    }
+
+    GGL_LOGE("Process output does not fit in buffer.");
+    (void) pipe_flush(pipe_read_fd, GGL_NULL_WRITER);
+    return GGL_ERR_NOMEM;
+}
+
+// Spawn a process with stdout and stderr redirected to a new pipe.
+// Returns the read end of the pipe in pipe_read_fd.
+static GglError spawn_with_output_pipe(
+    const char *const args[static 1], pid_t *pid, int *pipe_read_fd
 ) {
     int out_pipe[2] = { -1, -1 };
-    int ret = pipe(out_pipe);
+    int ret = pipe2(out_pipe, O_CLOEXEC);
     if (ret != 0) {
         GGL_LOGE("Failed to create pipe (errno=%d).", errno);
         return GGL_ERR_FAILURE;
     }
-    GGL_CLEANUP(cleanup_close, out_pipe[0]);
-    GGL_CLEANUP_ID(pipe_write_cleanup, cleanup_close, out_pipe[1]);
+    GGL_CLEANUP_ID(pipe_read_cleanup, cleanup_close, out_pipe[0]);
+    GGL_CLEANUP(cleanup_close, out_pipe[1]);
 
     posix_spawn_file_actions_t actions = { 0 };
     if (posix_spawn_file_actions_init(&actions) != 0) {
         return GGL_ERR_NOMEM;
     }
-    GGL_CLEANUP_ID(
-        actions_cleanup, cleanup_posix_destroy_file_actions, &actions
-    );
+    GGL_CLEANUP(cleanup_posix_destroy_file_actions, &actions);
     GglError err
         = create_output_pipe_file_actions(&actions, out_pipe[0], out_pipe[1]);
     if (err != GGL_ERR_OK) {
@@ -239,21 +220,52 @@ GglError ggl_exec_command_with_output(
         return GGL_ERR_FAILURE;
     }
 
-    pid_t pid = -1;
     ret = posix_spawnp(
-        &pid, args[0], &actions, NULL, (char *const *) args, environ
+        pid, args[0], &actions, NULL, (char *const *) args, environ
     );
     if (ret != 0) {
         GGL_LOGE("Error, unable to spawn (%d)", ret);
         return GGL_ERR_FAILURE;
     }
 
-    (void) posix_spawn_file_actions_destroy(&actions);
-    actions_cleanup = NULL;
-    (void) ggl_close(pipe_write_cleanup);
-    pipe_write_cleanup = -1;
+    // NOLINTNEXTLINE(clang-analyzer-deadcode.DeadStores) false positive
+    pipe_read_cleanup = -1;
+    *pipe_read_fd = out_pipe[0];
+    return GGL_ERR_OK;
+}
+
+GglError ggl_exec_command_with_output(
+    const char *const args[static 1], GglWriter writer
+) {
+    pid_t pid = -1;
+    int pipe_read_fd = -1;
+    GglError err = spawn_with_output_pipe(args, &pid, &pipe_read_fd);
+    if (err != GGL_ERR_OK) {
+        return err;
+    }
+    GGL_CLEANUP(cleanup_close, pipe_read_fd);
+
+    GglError read_err = pipe_flush(pipe_read_fd, writer);
+    GglError process_err = wait_for_process(pid);
+
+    if (process_err != GGL_ERR_OK) {
+        return process_err;
+    }
+    return read_err;
+}
+
+GglError ggl_exec_command_with_output_buf(
+    const char *const args[static 1], GglBuffer *output
+) {
+    pid_t pid = -1;
+    int pipe_read_fd = -1;
+    GglError err = spawn_with_output_pipe(args, &pid, &pipe_read_fd);
+    if (err != GGL_ERR_OK) {
+        return err;
+    }
+    GGL_CLEANUP(cleanup_close, pipe_read_fd);
 
-    GglError read_err = pipe_flush(out_pipe[0], writer);
+    GglError read_err = pipe_read_all(pipe_read_fd, output);
     GglError process_err = wait_for_process(pid);
 
     if (process_err != GGL_ERR_OK) {
@@ -262,6 +274,18 @@ GglError ggl_exec_command_with_output(
     return read_err;
 }
 
+GglError ggl_exec_command_in_cgroup(
+    const char *const args[static 1], int cgroup_fd
+) {
+    pid_t pid = -1;
+    GglError err = ggl_exec_spawn_in_cgroup(args, cgroup_fd, -1, &pid);
+    if (err != GGL_ERR_OK) {
+        return err;
+    }
+
+    return wait_for_process(pid);
+}
+
 GglError ggl_exec_command_with_input(
     const char *const args[static 1], GglObject payload
 ) {
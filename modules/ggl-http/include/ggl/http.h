@@ -7,6 +7,7 @@
 
 #include <ggl/buffer.h>
 #include <ggl/error.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 typedef struct CertificateDetails {
@@ -15,6 +16,20 @@ typedef struct CertificateDetails {
     const char *gghttplib_root_ca_path;
 } CertificateDetails;
 
+/// Connection reuse settings for HTTP requests made by this process
+typedef struct GglHttpPoolConfig {
+    /// Keep CURL handles and their connections alive between requests
+    bool reuse_connections;
+    /// Negotiate HTTP/2 over TLS when the server supports it
+    bool allow_http2;
+} GglHttpPoolConfig;
+
+/// @brief Configures connection reuse for subsequent requests.
+///
+/// By default, connections are reused and HTTP/1.1 is used.
+/// Handles already held by in-flight requests are not affected.
+void gghttplib_pool_configure(GglHttpPoolConfig config);
+
 /// AWS Service information and temporary credentials
 ///
 /// Use fetch_token() to retrieve id, key, and token
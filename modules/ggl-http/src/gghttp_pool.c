@@ -0,0 +1,268 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "gghttp_pool.h"
+#include "gghttp_util.h"
+#include "ggl/http.h"
+#include <assert.h>
+#include <curl/curl.h>
+#include <ggl/cleanup.h>
+#include <ggl/error.h>
+#include <ggl/log.h>
+#include <pthread.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// Number of CURL handles kept alive for reuse by this process.
+/// Can be configured with `-DGGL_HTTP_POOL_SIZE=<N>`.
+#ifndef GGL_HTTP_POOL_SIZE
+#define GGL_HTTP_POOL_SIZE 4
+#endif
+
+#define MAX_ORIGIN_LENGTH 256
+#define MAX_CERT_PATH_LENGTH 256
+
+typedef struct {
+    CURL *curl;
+    bool in_use;
+    uint64_t last_used;
+    /// scheme://host:port of the last request made with this handle.
+    char origin[MAX_ORIGIN_LENGTH];
+    /// Client certificate used by the handle's cached connections.
+    char cert_path[MAX_CERT_PATH_LENGTH];
+} PoolSlot;
+
+static pthread_mutex_t pool_mtx = PTHREAD_MUTEX_INITIALIZER;
+static PoolSlot pool[GGL_HTTP_POOL_SIZE];
+static uint64_t pool_clock = 0;
+static GglHttpPoolConfig pool_config
+    = { .reuse_connections = true, .allow_http2 = false };
+
+static pthread_once_t share_once = PTHREAD_ONCE_INIT;
+static CURLSH *share = NULL;
+static pthread_mutex_t share_mtx[CURL_LOCK_DATA_LAST];
+
+static void share_lock(
+    CURL *handle, curl_lock_data data, curl_lock_access access, void *userptr
+) {
+    (void) handle;
+    (void) access;
+    (void) userptr;
+    pthread_mutex_lock(&share_mtx[data]);
+}
+
+static void share_unlock(CURL *handle, curl_lock_data data, void *userptr) {
+    (void) handle;
+    (void) userptr;
+    pthread_mutex_unlock(&share_mtx[data]);
+}
+
+// DNS results and TLS sessions are shared between all handles so that new
+// connections can skip lookups and resume sessions. Connections themselves
+// stay owned by a single pooled handle, as libcurl does not support sharing
+// a connection cache between concurrent threads.
+static void init_share(void) {
+    for (size_t i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+        pthread_mutex_init(&share_mtx[i], NULL);
+    }
+
+    share = curl_share_init();
+    if (share == NULL) {
+        GGL_LOGW("Failed to create curl share handle.");
+        return;
+    }
+
+    CURLSHcode err = curl_share_setopt(share, CURLSHOPT_LOCKFUNC, share_lock);
+    if (err == CURLSHE_OK) {
+        err = curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, share_unlock);
+    }
+    if (err == CURLSHE_OK) {
+        err = curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    }
+    if (err == CURLSHE_OK) {
+        err = curl_share_setopt(
+            share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION
+        );
+    }
+    if (err != CURLSHE_OK) {
+        GGL_LOGW(
+            "Failed to configure curl share handle: %s.",
+            curl_share_strerror(err)
+        );
+        curl_share_cleanup(share);
+        share = NULL;
+    }
+}
+
+void gghttplib_pool_configure(GglHttpPoolConfig config) {
+    GGL_MTX_SCOPE_GUARD(&pool_mtx);
+    pool_config = config;
+}
+
+static void get_origin(const char *url, char *origin) {
+    // Copy up to the first '/' after "scheme://"
+    const char *start = strstr(url, "://");
+    size_t skip = (start == NULL) ? 0 : (size_t) (start - url) + 3;
+    const char *end = strchr(&url[skip], '/');
+    size_t len = (end == NULL) ? strlen(url) : (size_t) (end - url);
+    if (len >= MAX_ORIGIN_LENGTH) {
+        len = MAX_ORIGIN_LENGTH - 1;
+    }
+    memcpy(origin, url, len);
+    origin[len] = '\0';
+}
+
+static GglError configure_handle(CURL *curl, bool allow_http2) {
+    CURLcode err = curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    if ((err == CURLE_OK) && (share != NULL)) {
+        err = curl_easy_setopt(curl, CURLOPT_SHARE, share);
+    }
+    if (err == CURLE_OK) {
+        err = curl_easy_setopt(
+            curl,
+            CURLOPT_HTTP_VERSION,
+            allow_http2 ? (long) CURL_HTTP_VERSION_2TLS
+                        : (long) CURL_HTTP_VERSION_1_1
+        );
+    }
+    if (err != CURLE_OK) {
+        GGL_LOGE(
+            "Failed to configure curl handle: %s.", curl_easy_strerror(err)
+        );
+        return GGL_ERR_FAILURE;
+    }
+    return GGL_ERR_OK;
+}
+
+static PoolSlot *find_slot(const char *origin) {
+    PoolSlot *same_origin = NULL;
+    PoolSlot *empty = NULL;
+    PoolSlot *oldest_idle = NULL;
+
+    for (size_t i = 0; i < GGL_HTTP_POOL_SIZE; i++) {
+        PoolSlot *slot = &pool[i];
+        if (slot->in_use) {
+            continue;
+        }
+        if (slot->curl == NULL) {
+            if (empty == NULL) {
+                empty = slot;
+            }
+            continue;
+        }
+        if ((strcmp(slot->origin, origin) == 0)
+            && ((same_origin == NULL)
+                || (slot->last_used > same_origin->last_used))) {
+            same_origin = slot;
+        }
+        if ((oldest_idle == NULL)
+            || (slot->last_used < oldest_idle->last_used)) {
+            oldest_idle = slot;
+        }
+    }
+
+    if (same_origin != NULL) {
+        return same_origin;
+    }
+    if (empty != NULL) {
+        return empty;
+    }
+    return oldest_idle;
+}
+
+GglError gghttplib_pool_acquire(CurlData *curl_data, const char *url) {
+    pthread_once(&share_once, init_share);
+
+    curl_data->curl = NULL;
+    curl_data->pool_slot = -1;
+    curl_data->cert_path = NULL;
+
+    GGL_MTX_SCOPE_GUARD(&pool_mtx);
+
+    PoolSlot *slot = NULL;
+    char origin[MAX_ORIGIN_LENGTH];
+    if (pool_config.reuse_connections) {
+        get_origin(url, origin);
+        slot = find_slot(origin);
+    }
+
+    if (slot == NULL) {
+        curl_data->curl = curl_easy_init();
+        if (curl_data->curl == NULL) {
+            return GGL_ERR_FAILURE;
+        }
+        return configure_handle(curl_data->curl, pool_config.allow_http2);
+    }
+
+    if (slot->curl == NULL) {
+        slot->curl = curl_easy_init();
+        if (slot->curl == NULL) {
+            return GGL_ERR_FAILURE;
+        }
+        slot->cert_path[0] = '\0';
+    } else {
+        // Keeps open connections and caches, but clears all request options.
+        curl_easy_reset(slot->curl);
+    }
+
+    GglError ret = configure_handle(slot->curl, pool_config.allow_http2);
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
+    slot->in_use = true;
+    memcpy(slot->origin, origin, sizeof(origin));
+    curl_data->curl = slot->curl;
+    curl_data->pool_slot = (int) (slot - pool);
+    return GGL_ERR_OK;
+}
+
+GglError gghttplib_pool_prepare(CurlData *curl_data) {
+    if (curl_data->pool_slot < 0) {
+        return GGL_ERR_OK;
+    }
+
+    GGL_MTX_SCOPE_GUARD(&pool_mtx);
+    PoolSlot *slot = &pool[curl_data->pool_slot];
+
+    const char *cert_path
+        = (curl_data->cert_path == NULL) ? "" : curl_data->cert_path;
+    if (strcmp(slot->cert_path, cert_path) == 0) {
+        return GGL_ERR_OK;
+    }
+
+    // Cached connections were authenticated with other credentials.
+    CURLcode err = curl_easy_setopt(slot->curl, CURLOPT_FRESH_CONNECT, 1L);
+    if (err != CURLE_OK) {
+        return GGL_ERR_FAILURE;
+    }
+
+    size_t len = strlen(cert_path);
+    if (len >= MAX_CERT_PATH_LENGTH) {
+        // Too long to track; never let another request reuse the connection.
+        err = curl_easy_setopt(slot->curl, CURLOPT_FORBID_REUSE, 1L);
+        slot->cert_path[0] = '\0';
+        return (err == CURLE_OK) ? GGL_ERR_OK : GGL_ERR_FAILURE;
+    }
+    memcpy(slot->cert_path, cert_path, len + 1);
+    return GGL_ERR_OK;
+}
+
+void gghttplib_pool_release(CurlData *curl_data) {
+    if (curl_data->pool_slot < 0) {
+        curl_easy_cleanup(curl_data->curl);
+        curl_data->curl = NULL;
+        return;
+    }
+
+    GGL_MTX_SCOPE_GUARD(&pool_mtx);
+    PoolSlot *slot = &pool[curl_data->pool_slot];
+    assert(slot->curl == curl_data->curl);
+    slot->in_use = false;
+    slot->last_used = ++pool_clock;
+    curl_data->curl = NULL;
+    curl_data->pool_slot = -1;
+}
@@ -0,0 +1,30 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef GGHTTPLIB_POOL_H
+#define GGHTTPLIB_POOL_H
+
+#include "gghttp_util.h"
+#include <ggl/error.h>
+
+/// @brief Takes a CURL handle for a request to url from the process pool.
+///
+/// Idle handles previously used for the same origin are preferred, so that
+/// their open connections can be reused. If pooling is disabled or every
+/// pooled handle is busy, a standalone handle is created instead.
+///
+/// @param[out] curl_data CurlData to hold the handle.
+/// @param[in] url The URL for the HTTP request.
+GglError gghttplib_pool_acquire(CurlData *curl_data, const char *url);
+
+/// @brief Prepares a pooled handle right before the request is performed.
+///
+/// Forces a new connection if the handle's cached connections were
+/// authenticated with different client credentials.
+GglError gghttplib_pool_prepare(CurlData *curl_data);
+
+/// @brief Returns a handle to the pool, or frees it if it is not pooled.
+void gghttplib_pool_release(CurlData *curl_data);
+
+#endif
@@ -3,6 +3,7 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "gghttp_util.h"
+#include "gghttp_pool.h"
 #include "ggl/http.h"
 #include <assert.h>
 #include <curl/curl.h>
@@ -431,17 +432,20 @@ void gghttplib_destroy_curl(CurlData *curl_data) {
         curl_slist_free_all(curl_data->headers_list);
         curl_data->headers_list = NULL;
     }
-    curl_easy_cleanup(curl_data->curl);
+    gghttplib_pool_release(curl_data);
 }
 
 GglError gghttplib_init_curl(CurlData *curl_data, const char *url) {
     curl_data->headers_list = NULL;
-    curl_data->curl = curl_easy_init();
+    GglError ret = gghttplib_pool_acquire(curl_data, url);
 
     if (curl_data->curl == NULL) {
         GGL_LOGE("Cannot create instance of curl for the url=%s", url);
         return GGL_ERR_FAILURE;
     }
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
 
     CURLcode err = curl_easy_setopt(curl_data->curl, CURLOPT_URL, url);
 
@@ -479,6 +483,7 @@ GglError gghttplib_add_certificate_data(
     CurlData *curl_data, CertificateDetails request_data
 ) {
     assert(curl_data != NULL);
+    curl_data->cert_path = request_data.gghttplib_cert_path;
     CURLcode err = curl_easy_setopt(
         curl_data->curl, CURLOPT_SSLCERT, request_data.gghttplib_cert_path
     );
@@ -523,6 +528,11 @@ GglError gghttplib_process_request(
         return ret;
     }
 
+    ret = gghttplib_pool_prepare(curl_data);
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
     if (response_buffer != NULL) {
         curl_error = curl_easy_setopt(
             curl_data->curl, CURLOPT_WRITEFUNCTION, write_response_to_buffer
@@ -560,6 +570,11 @@ GglError gghttplib_process_request_with_fd(CurlData *curl_data, int fd) {
         return ret;
     }
 
+    ret = gghttplib_pool_prepare(curl_data);
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
     curl_error = curl_easy_setopt(
         curl_data->curl, CURLOPT_WRITEFUNCTION, write_response_to_fd
     );
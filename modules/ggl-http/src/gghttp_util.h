@@ -13,11 +13,18 @@
 typedef struct CurlData {
     CURL *curl;
     struct curl_slist *headers_list;
+    /// Index of the handle in the process pool, or -1 if not pooled.
+    int pool_slot;
+    /// Client certificate set for this request, if any.
+    const char *cert_path;
 } CurlData;
 
 /**
  * @brief Initializes a CURL handle and sets the URL for the HTTP request.
  *
+ * The handle is taken from the process-wide pool when possible, so that
+ * connections opened by earlier requests to the same origin are reused.
+ *
  * @param[in] curl_data A pointer to a CurlData structure that will hold the
  * CURL handle and headers.
  * @param[in] url The URL for the HTTP request.
@@ -34,6 +41,7 @@ typedef struct CurlData {
  */
 GglError gghttplib_init_curl(CurlData *curl_data, const char *url);
 
+/// @brief Releases request state and returns the CURL handle to the pool.
 void gghttplib_destroy_curl(CurlData *curl_data);
 
 /**
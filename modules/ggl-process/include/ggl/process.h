@@ -28,6 +28,32 @@ GglError ggl_process_wait(int handle, bool *exit_status);
 /// Cleans up handle and child zombie.
 GglError ggl_process_kill(int handle, uint32_t term_timeout);
 
+/// Maximum number of children watched by the shared reaper.
+/// Can be configured with `-DGGL_PROCESS_MAX_WATCHED=<N>`.
+#ifndef GGL_PROCESS_MAX_WATCHED
+#define GGL_PROCESS_MAX_WATCHED 128
+#endif
+
+/// Callback for when a watched child process has exited and been reaped.
+/// exit_status is true if the child exited successfully.
+/// Called from the reaper thread.
+typedef void (*GglProcessExitCallback)(void *ctx, int handle, bool exit_status);
+
+/// Hand a spawned child to the shared reaper.
+/// on_exit is called once the child exits. The handle is cleaned up by the
+/// reaper, and must not be passed to wait or kill afterwards.
+/// Returns GGL_ERR_UNSUPPORTED if the kernel lacks pidfds; the child is then
+/// still owned by the caller.
+GglError ggl_process_watch(
+    int handle, GglProcessExitCallback on_exit, void *ctx
+);
+
+/// Terminate a watched child without blocking.
+/// If term_timeout > 0, first sends SIGTERM and sends SIGKILL if the child is
+/// still running after the timeout. If term_timeout == 0, sends SIGKILL.
+/// The child's on_exit callback is called once it exits.
+GglError ggl_process_terminate(int handle, uint32_t term_timeout);
+
 /// Run a process with given arguments, and return if successful.
 /// argv must be null-terminated.
 GglError ggl_process_call(const char *const argv[]);
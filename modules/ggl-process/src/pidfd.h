@@ -0,0 +1,43 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef GGL_PROCESS_PIDFD_H
+#define GGL_PROCESS_PIDFD_H
+
+#include <errno.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <stddef.h>
+
+// Not all supported libcs have wrappers for these yet. Where the headers
+// predate pidfds, the calls fail with ENOSYS as on kernels older than 5.3.
+
+#ifdef SYS_pidfd_open
+static inline int sys_pidfd_open(pid_t pid, unsigned flags) {
+    return (int) syscall(SYS_pidfd_open, pid, flags);
+}
+#else
+static inline int sys_pidfd_open(pid_t pid, unsigned flags) {
+    (void) pid;
+    (void) flags;
+    errno = ENOSYS;
+    return -1;
+}
+#endif
+
+#ifdef SYS_pidfd_send_signal
+static inline int sys_pidfd_send_signal(int pidfd, int sig) {
+    return (int) syscall(SYS_pidfd_send_signal, pidfd, sig, NULL, 0);
+}
+#else
+static inline int sys_pidfd_send_signal(int pidfd, int sig) {
+    (void) pidfd;
+    (void) sig;
+    errno = ENOSYS;
+    return -1;
+}
+#endif
+
+#endif
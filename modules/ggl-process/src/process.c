@@ -2,18 +2,21 @@
 // Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
 // SPDX-License-Identifier: Apache-2.0
 
+#include "pidfd.h"
 #include <assert.h>
 #include <errno.h>
 #include <ggl/cleanup.h>
 #include <ggl/error.h>
+#include <ggl/file.h>
 #include <ggl/log.h>
 #include <ggl/process.h>
 #include <limits.h>
-#include <pthread.h>
+#include <poll.h>
 #include <signal.h>
 #include <sys/syscall.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -23,25 +26,6 @@
 #include <linux/close_range.h>
 #endif
 
-static void sigalrm_handler(int s) {
-    (void) s;
-}
-
-// Lowest allowed priority in order to run before threads are created.
-__attribute__((constructor(101))) static void setup_sigalrm(void) {
-    sigset_t set;
-    sigemptyset(&set);
-    sigaddset(&set, SIGALRM);
-    int sys_ret = pthread_sigmask(SIG_BLOCK, &set, NULL);
-    if (sys_ret != 0) {
-        GGL_LOGE("pthread_sigmask failed: %d", sys_ret);
-        _Exit(1);
-    }
-
-    struct sigaction act = { .sa_handler = sigalrm_handler };
-    sigaction(SIGALRM, &act, NULL);
-}
-
 #ifdef SYS_close_range
 static int sys_close_range(unsigned first, unsigned last, unsigned flags) {
     return (int) syscall(SYS_close_range, first, last, flags);
@@ -112,52 +96,108 @@ GglError ggl_process_wait(int handle, bool *exit_status) {
     }
 }
 
-GglError ggl_process_kill(int handle, uint32_t term_timeout) {
-    if (term_timeout == 0) {
-        kill(handle, SIGKILL);
-        return ggl_process_wait(handle, NULL);
-    }
-
-    sigset_t set;
-    sigfillset(&set);
-    sigdelset(&set, SIGALRM);
-
-    sigset_t old_set;
+/// Interval at which children are polled when pidfds are unavailable.
+#define KILL_POLL_INTERVAL_MS 10
 
-    kill(handle, SIGTERM);
-
-    // Prevent multiple threads from unblocking SIGALRM
-    static pthread_mutex_t sigalrm_mtx = PTHREAD_MUTEX_INITIALIZER;
+static int64_t monotonic_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((int64_t) now.tv_sec * 1000) + (now.tv_nsec / 1000000);
+}
 
-    int waitid_ret;
-    int waitid_err;
+/// Wait up to timeout seconds for the process referred to by pidfd to exit.
+static GglError wait_pidfd(int pidfd, uint32_t timeout) {
+    int64_t deadline_ms = monotonic_ms() + ((int64_t) timeout * 1000);
 
-    {
-        GGL_MTX_SCOPE_GUARD(&sigalrm_mtx);
+    while (true) {
+        int64_t remaining_ms = deadline_ms - monotonic_ms();
+        if (remaining_ms <= 0) {
+            return GGL_ERR_TIMEOUT;
+        }
 
-        pthread_sigmask(SIG_SETMASK, &set, &old_set);
+        struct pollfd fds[] = { { .fd = pidfd, .events = POLLIN } };
+        int ret = poll(
+            fds, 1, (remaining_ms > INT_MAX) ? INT_MAX : (int) remaining_ms
+        );
+        if (ret > 0) {
+            return GGL_ERR_OK;
+        }
+        if ((ret < 0) && (errno != EINTR)) {
+            GGL_LOGE("Err %d when polling pidfd.", errno);
+            return GGL_ERR_FAILURE;
+        }
+    }
+}
 
-        alarm(term_timeout);
+/// Wait up to timeout seconds for the child to exit, without reaping it.
+/// Used on kernels without pidfd support.
+static GglError wait_polling(int handle, uint32_t timeout) {
+    int64_t deadline_ms = monotonic_ms() + ((int64_t) timeout * 1000);
 
+    while (true) {
         siginfo_t info = { 0 };
-        waitid_ret = waitid(P_PID, (id_t) handle, &info, WEXITED);
-        waitid_err = errno;
+        int ret = waitid(
+            P_PID, (id_t) handle, &info, WEXITED | WNOHANG | WNOWAIT
+        );
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            GGL_LOGE("Err %d when calling waitid.", errno);
+            return GGL_ERR_FAILURE;
+        }
+        if (info.si_pid != 0) {
+            return GGL_ERR_OK;
+        }
+        if (monotonic_ms() >= deadline_ms) {
+            return GGL_ERR_TIMEOUT;
+        }
+
+        struct timespec interval
+            = { .tv_nsec = (long) KILL_POLL_INTERVAL_MS * 1000000 };
+        nanosleep(&interval, NULL);
+    }
+}
 
-        alarm(0);
+static GglError kill_polling(int handle, uint32_t term_timeout) {
+    kill(handle, SIGTERM);
 
-        pthread_sigmask(SIG_SETMASK, &old_set, NULL);
+    GglError ret = wait_polling(handle, term_timeout);
+    if (ret == GGL_ERR_TIMEOUT) {
+        kill(handle, SIGKILL);
+    } else if (ret != GGL_ERR_OK) {
+        return ret;
     }
 
-    if (waitid_ret == 0) {
-        return GGL_ERR_OK;
+    return ggl_process_wait(handle, NULL);
+}
+
+GglError ggl_process_kill(int handle, uint32_t term_timeout) {
+    if (term_timeout == 0) {
+        kill(handle, SIGKILL);
+        return ggl_process_wait(handle, NULL);
     }
 
-    if (waitid_err != EINTR) {
-        GGL_LOGE("Err %d when calling waitid.", waitid_err);
+    // The pidfd stays valid until the child is reaped, so it is not subject
+    // to pid reuse, and waiting on it needs no signals.
+    int pidfd = sys_pidfd_open(handle, 0);
+    if (pidfd < 0) {
+        if (errno == ENOSYS) {
+            return kill_polling(handle, term_timeout);
+        }
+        GGL_LOGE("Err %d when calling pidfd_open.", errno);
         return GGL_ERR_FAILURE;
     }
+    GGL_CLEANUP(cleanup_close, pidfd);
 
-    kill(handle, SIGKILL);
+    (void) sys_pidfd_send_signal(pidfd, SIGTERM);
+
+    GglError ret = wait_pidfd(pidfd, term_timeout);
+    if (ret == GGL_ERR_TIMEOUT) {
+        (void) sys_pidfd_send_signal(pidfd, SIGKILL);
+    } else if (ret != GGL_ERR_OK) {
+        return ret;
+    }
 
     return ggl_process_wait(handle, NULL);
 }
@@ -0,0 +1,263 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "pidfd.h"
+#include <assert.h>
+#include <errno.h>
+#include <ggl/cleanup.h>
+#include <ggl/error.h>
+#include <ggl/file.h>
+#include <ggl/log.h>
+#include <ggl/process.h>
+#include <ggl/socket_epoll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/timerfd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// This is a separate C file from the rest of ggl-process as it creates a
+// thread on startup using a constructor function. It is only linked into
+// binaries using ggl_process_watch.
+
+typedef struct {
+    /// 0 if slot is unused
+    pid_t pid;
+    int pidfd;
+    /// Set once a terminate timeout is armed
+    int timerfd;
+    /// Distinguishes epoll events for a previous user of the slot
+    uint32_t generation;
+    GglProcessExitCallback on_exit;
+    void *ctx;
+} WatchedProcess;
+
+static WatchedProcess watched[GGL_PROCESS_MAX_WATCHED];
+static pthread_mutex_t watched_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+static int epoll_fd = -1;
+
+static void *reaper_thread(void *args);
+
+/// Initializes reaper epoll and starts reaper thread.
+/// Runs at startup (before main).
+__attribute__((constructor)) static void start_reaper_thread(void) {
+    GglError ret = ggl_socket_epoll_create(&epoll_fd);
+    if (ret != GGL_ERR_OK) {
+        GGL_LOGE("Failed to create epoll for process reaper.");
+        _Exit(1);
+    }
+
+    pthread_t thread = { 0 };
+    int sys_ret = pthread_create(&thread, NULL, reaper_thread, NULL);
+    if (sys_ret != 0) {
+        GGL_LOGE("Failed to create process reaper thread: %d.", sys_ret);
+        _Exit(1);
+    }
+    pthread_detach(thread);
+}
+
+static uint64_t event_data(size_t index, bool is_timer) {
+    return ((uint64_t) watched[index].generation << 32) | (index << 1)
+        | (is_timer ? 1U : 0U);
+}
+
+static WatchedProcess *find_watched(pid_t pid) {
+    for (size_t i = 0; i < GGL_PROCESS_MAX_WATCHED; i++) {
+        if (watched[i].pid == pid) {
+            return &watched[i];
+        }
+    }
+    return NULL;
+}
+
+GglError ggl_process_watch(
+    int handle, GglProcessExitCallback on_exit, void *ctx
+) {
+    if (epoll_fd < 0) {
+        GGL_LOGE("Process reaper epoll not initialized.");
+        return GGL_ERR_FATAL;
+    }
+    if (handle <= 0) {
+        return GGL_ERR_INVALID;
+    }
+
+    int pidfd = sys_pidfd_open(handle, 0);
+    if (pidfd < 0) {
+        GGL_LOGE("Err %d when calling pidfd_open.", errno);
+        return (errno == ENOSYS) ? GGL_ERR_UNSUPPORTED : GGL_ERR_FAILURE;
+    }
+    GGL_CLEANUP_ID(pidfd_cleanup, cleanup_close, pidfd);
+
+    GGL_MTX_SCOPE_GUARD(&watched_mtx);
+
+    WatchedProcess *slot = find_watched(0);
+    if (slot == NULL) {
+        GGL_LOGE("Max watched processes exceeded.");
+        return GGL_ERR_NOMEM;
+    }
+    size_t index = (size_t) (slot - watched);
+
+    slot->generation += 1;
+    GglError ret
+        = ggl_socket_epoll_add(epoll_fd, pidfd, event_data(index, false));
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
+    *slot = (WatchedProcess) {
+        .pid = handle,
+        .pidfd = pidfd,
+        .timerfd = -1,
+        .generation = slot->generation,
+        .on_exit = on_exit,
+        .ctx = ctx,
+    };
+    // NOLINTNEXTLINE(clang-analyzer-deadcode.DeadStores) false positive
+    pidfd_cleanup = -1;
+    return GGL_ERR_OK;
+}
+
+static GglError arm_kill_timer(size_t index, uint32_t term_timeout) {
+    int timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (timerfd < 0) {
+        GGL_LOGE("Err %d when calling timerfd_create.", errno);
+        return GGL_ERR_FAILURE;
+    }
+    GGL_CLEANUP_ID(timerfd_cleanup, cleanup_close, timerfd);
+
+    struct itimerspec spec = { .it_value = { .tv_sec = term_timeout } };
+    if (timerfd_settime(timerfd, 0, &spec, NULL) != 0) {
+        GGL_LOGE("Err %d when calling timerfd_settime.", errno);
+        return GGL_ERR_FAILURE;
+    }
+
+    GglError ret
+        = ggl_socket_epoll_add(epoll_fd, timerfd, event_data(index, true));
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
+    watched[index].timerfd = timerfd;
+    // NOLINTNEXTLINE(clang-analyzer-deadcode.DeadStores) false positive
+    timerfd_cleanup = -1;
+    return GGL_ERR_OK;
+}
+
+GglError ggl_process_terminate(int handle, uint32_t term_timeout) {
+    if (handle <= 0) {
+        return GGL_ERR_INVALID;
+    }
+
+    GGL_MTX_SCOPE_GUARD(&watched_mtx);
+
+    WatchedProcess *slot = find_watched(handle);
+    if (slot == NULL) {
+        GGL_LOGE("Process %d is not watched.", handle);
+        return GGL_ERR_NOENTRY;
+    }
+
+    if (term_timeout == 0) {
+        (void) sys_pidfd_send_signal(slot->pidfd, SIGKILL);
+        return GGL_ERR_OK;
+    }
+
+    (void) sys_pidfd_send_signal(slot->pidfd, SIGTERM);
+
+    // Keep the earliest deadline if already terminating
+    if (slot->timerfd >= 0) {
+        return GGL_ERR_OK;
+    }
+
+    GglError ret = arm_kill_timer((size_t) (slot - watched), term_timeout);
+    if (ret != GGL_ERR_OK) {
+        (void) sys_pidfd_send_signal(slot->pidfd, SIGKILL);
+    }
+    return ret;
+}
+
+static void release_slot(WatchedProcess *slot) {
+    (void) ggl_close(slot->pidfd);
+    if (slot->timerfd >= 0) {
+        (void) ggl_close(slot->timerfd);
+    }
+    slot->pid = 0;
+    slot->pidfd = -1;
+    slot->timerfd = -1;
+    slot->on_exit = NULL;
+    slot->ctx = NULL;
+}
+
+static GglError process_event(void *ctx, uint64_t data) {
+    (void) ctx;
+
+    size_t index = (size_t) ((data & UINT32_MAX) >> 1);
+    bool is_timer = (data & 1U) != 0;
+    uint32_t generation = (uint32_t) (data >> 32);
+    if (index >= GGL_PROCESS_MAX_WATCHED) {
+        return GGL_ERR_FATAL;
+    }
+
+    GglProcessExitCallback on_exit = NULL;
+    void *on_exit_ctx = NULL;
+    pid_t pid = 0;
+    bool exit_status = false;
+
+    {
+        GGL_MTX_SCOPE_GUARD(&watched_mtx);
+
+        WatchedProcess *slot = &watched[index];
+        if ((slot->pid == 0) || (slot->generation != generation)) {
+            // Stale event for a released slot
+            return GGL_ERR_OK;
+        }
+
+        if (is_timer) {
+            uint64_t expirations;
+            (void) read(slot->timerfd, &expirations, sizeof(expirations));
+            GGL_LOGW(
+                "Process %d did not exit after SIGTERM; sending SIGKILL.",
+                slot->pid
+            );
+            (void) sys_pidfd_send_signal(slot->pidfd, SIGKILL);
+            return GGL_ERR_OK;
+        }
+
+        siginfo_t info = { 0 };
+        int ret = waitid(P_PID, (id_t) slot->pid, &info, WEXITED | WNOHANG);
+        if (ret < 0) {
+            GGL_LOGE("Err %d when calling waitid.", errno);
+        } else if (info.si_pid == 0) {
+            // Not yet exited
+            return GGL_ERR_OK;
+        } else {
+            exit_status = (info.si_code == CLD_EXITED) && (info.si_status == 0);
+        }
+
+        on_exit = slot->on_exit;
+        on_exit_ctx = slot->ctx;
+        pid = slot->pid;
+        release_slot(slot);
+    }
+
+    if (on_exit != NULL) {
+        on_exit(on_exit_ctx, pid, exit_status);
+    }
+    return GGL_ERR_OK;
+}
+
+static void *reaper_thread(void *args) {
+    assert(epoll_fd >= 0);
+
+    GGL_LOGD("Started process reaper thread.");
+    (void) ggl_socket_epoll_run(epoll_fd, process_event, args);
+    GGL_LOGE("Process reaper thread exited.");
+    return NULL;
+}
@@ -0,0 +1,39 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef GGL_RATE_LIMIT_H
+#define GGL_RATE_LIMIT_H
+
+//! Token bucket rate limiting
+//!
+//! Buckets are tracked as the time at which they will next be full (generic
+//! cell rate algorithm), so each bucket is a single timestamp and refilling
+//! needs no periodic work. A zero-initialized bucket is full.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+    /// Tokens added per second; 0 disables the limit.
+    uint32_t rate;
+    /// Maximum tokens held, i.e. the largest allowed burst.
+    /// Treated as 1 if 0.
+    uint32_t burst;
+} GglRateLimit;
+
+typedef struct {
+    /// Monotonic time in ns at which the bucket will be full.
+    uint64_t full_at;
+} GglTokenBucket;
+
+/// Take a token from the bucket at monotonic time `now_ns`.
+/// Returns false if the bucket is empty, in which case it is not modified.
+bool ggl_token_bucket_take(
+    GglTokenBucket *bucket, GglRateLimit limit, uint64_t now_ns
+);
+
+/// Get the current CLOCK_MONOTONIC time in ns.
+uint64_t ggl_rate_limit_now_ns(void);
+
+#endif
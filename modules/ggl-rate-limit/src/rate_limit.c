@@ -0,0 +1,42 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "ggl/rate_limit.h"
+#include <time.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define NS_PER_S 1000000000U
+
+bool ggl_token_bucket_take(
+    GglTokenBucket *bucket, GglRateLimit limit, uint64_t now_ns
+) {
+    if (limit.rate == 0) {
+        return true;
+    }
+
+    // Time to refill a single token
+    uint64_t interval = NS_PER_S / limit.rate;
+    if (interval == 0) {
+        interval = 1;
+    }
+    uint64_t burst = (limit.burst == 0) ? 1 : limit.burst;
+
+    uint64_t full_at = (bucket->full_at > now_ns) ? bucket->full_at : now_ns;
+    uint64_t taken = full_at + interval - now_ns;
+
+    // Each held token is one interval of headroom before now
+    if (taken > burst * interval) {
+        return false;
+    }
+
+    bucket->full_at = full_at + interval;
+    return true;
+}
+
+uint64_t ggl_rate_limit_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec * NS_PER_S) + (uint64_t) ts.tv_nsec;
+}
@@ -10,4 +10,9 @@
 
 bool is_in_range(GglBuffer version, GglBuffer requirements_range);
 
+/// Compare two version strings using the same ordering as `is_in_range`.
+/// Returns a negative value, zero, or a positive value if `lhs` is ordered
+/// before, equal to, or after `rhs` respectively.
+int ggl_semver_compare(GglBuffer lhs, GglBuffer rhs);
+
 #endif
@@ -132,3 +132,17 @@ bool is_in_range(GglBuffer version, GglBuffer requirements_range) {
 
     return true;
 }
+
+int ggl_semver_compare(GglBuffer lhs, GglBuffer rhs) {
+    char lhs_str[NAME_MAX + 1];
+    char rhs_str[NAME_MAX + 1];
+
+    size_t lhs_len = (lhs.len < NAME_MAX) ? lhs.len : NAME_MAX;
+    size_t rhs_len = (rhs.len < NAME_MAX) ? rhs.len : NAME_MAX;
+    memcpy(lhs_str, lhs.data, lhs_len);
+    lhs_str[lhs_len] = '\0';
+    memcpy(rhs_str, rhs.data, rhs_len);
+    rhs_str[rhs_len] = '\0';
+
+    return strverscmp(lhs_str, rhs_str);
+}
@@ -0,0 +1,36 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef GGL_SOCKET_FD_H
+#define GGL_SOCKET_FD_H
+
+//! Passing fds over unix stream sockets
+
+#include <ggl/buffer.h>
+#include <ggl/error.h>
+
+/// Read some data from a socket, receiving a fd if the peer passed one.
+/// Behaves like `ggl_file_read_partial`. If a fd is received and `fd` is -1,
+/// `fd` is set to it (with close-on-exec set); additional fds are closed.
+GglError ggl_socket_read_partial_with_fd(int sock, GglBuffer *buf, int *fd);
+
+/// Write some data to a socket, passing `fd` with it if not -1.
+/// Behaves like `ggl_file_write_partial`. `fd` is only sent with the first
+/// write; it is set to -1 once sent.
+GglError ggl_socket_write_partial_with_fd(int sock, GglBuffer *buf, int *fd);
+
+/// Write as much data to a socket as possible without blocking.
+/// `buf` is advanced past the data written and `fd` is handled as in
+/// `ggl_socket_write_partial_with_fd`. Not writing anything is not an error.
+GglError ggl_socket_try_write_with_fd(int sock, GglBuffer *buf, int *fd);
+
+/// Read exact amount of data from a socket, receiving a passed fd.
+/// `fd` should be initialized to -1; it is set as in
+/// `ggl_socket_read_partial_with_fd` and is owned by the caller.
+GglError ggl_socket_read_with_fd(int sock, GglBuffer buf, int *fd);
+
+/// Write exact amount of data to a socket, passing `fd` with it.
+GglError ggl_socket_write_with_fd(int sock, GglBuffer buf, int fd);
+
+#endif
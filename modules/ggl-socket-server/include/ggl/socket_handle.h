@@ -26,6 +26,11 @@ typedef struct {
     uint16_t *generations;
     GglError (*on_register)(uint32_t handle, size_t index);
     GglError (*on_release)(uint32_t handle, size_t index);
+    /// Optional; called by the socket server on events for a socket whose
+    /// writability is watched. Returning an error closes the socket.
+    GglError (*on_writable)(uint32_t handle);
+    /// Set by the socket server serving this pool; -1 otherwise.
+    int epoll_fd;
     pthread_mutex_t mtx;
 } GglSocketPool;
 
@@ -55,6 +60,17 @@ GglError ggl_socket_handle_write(
     GglSocketPool *pool, uint32_t handle, GglBuffer buf
 );
 
+/// Read exact amount of data from a socket, receiving a passed fd.
+/// See `ggl_socket_read_with_fd`.
+GglError ggl_socket_handle_read_with_fd(
+    GglSocketPool *pool, uint32_t handle, GglBuffer buf, int *fd
+);
+
+/// Write exact amount of data to a socket, passing `fd` with it.
+GglError ggl_socket_handle_write_with_fd(
+    GglSocketPool *pool, uint32_t handle, GglBuffer buf, int fd
+);
+
 /// Close a socket.
 GglError ggl_socket_handle_close(GglSocketPool *pool, uint32_t handle);
 
@@ -63,6 +79,13 @@ GglError ggl_socket_handle_get_peer_pid(
     GglSocketPool *pool, uint32_t handle, pid_t *pid
 );
 
+/// Get a pidfd for the socket peer.
+/// The caller owns the returned fd. Returns GGL_ERR_UNSUPPORTED if the
+/// kernel does not support pidfds.
+GglError ggl_socket_handle_get_peer_pidfd(
+    GglSocketPool *pool, uint32_t handle, int *pidfd
+);
+
 /// Run action with handle protected and access to the state index.
 /// This can be used for managing additional state arrays kept in sync with the
 /// socket pool state or to protect the action from concurrent cleanup.
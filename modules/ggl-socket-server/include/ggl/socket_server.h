@@ -11,6 +11,7 @@
 #include <ggl/error.h>
 #include <ggl/socket_handle.h>
 #include <sys/types.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /// Run a server listening on `path`.
@@ -27,6 +28,14 @@ GglError ggl_socket_server_listen(
     void *ctx
 );
 
+/// Start or stop watching a client socket for becoming writable.
+/// While watched, the pool's `on_writable` callback is called from the server
+/// thread when the socket is writable, and `client_ready` is only called when
+/// data is available.
+GglError ggl_socket_server_watch_writable(
+    GglSocketPool *pool, uint32_t handle, bool watch
+);
+
 extern void (*ggl_socket_server_ext_handler)(void);
 extern int ggl_socket_server_ext_fd;
 
@@ -0,0 +1,168 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <errno.h>
+#include <ggl/buffer.h>
+#include <ggl/error.h>
+#include <ggl/file.h>
+#include <ggl/log.h>
+#include <ggl/socket_fd.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// Space for a few fds, so that unexpected extra fds are not silently leaked
+#define MAX_RECV_FDS 4
+
+static void take_fds(struct msghdr *hdr, int *fd) {
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(hdr); cmsg != NULL;
+         cmsg = CMSG_NXTHDR(hdr, cmsg)) {
+        if ((cmsg->cmsg_level != SOL_SOCKET)
+            || (cmsg->cmsg_type != SCM_RIGHTS)) {
+            continue;
+        }
+        size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (size_t i = 0; i < count; i++) {
+            int received;
+            memcpy(
+                &received, &CMSG_DATA(cmsg)[i * sizeof(int)], sizeof(int)
+            );
+            if (*fd < 0) {
+                *fd = received;
+            } else {
+                GGL_LOGW("Closing unexpected fd passed by socket peer.");
+                (void) ggl_close(received);
+            }
+        }
+    }
+}
+
+GglError ggl_socket_read_partial_with_fd(int sock, GglBuffer *buf, int *fd) {
+    struct iovec iov = { .iov_base = buf->data, .iov_len = buf->len };
+    union {
+        struct cmsghdr align;
+        uint8_t buf[CMSG_SPACE(MAX_RECV_FDS * sizeof(int))];
+    } control;
+    struct msghdr hdr = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control.buf,
+        .msg_controllen = sizeof(control.buf),
+    };
+
+    ssize_t ret = recvmsg(sock, &hdr, MSG_CMSG_CLOEXEC);
+    if (ret < 0) {
+        if (errno == EINTR) {
+            return GGL_ERR_RETRY;
+        }
+        GGL_LOGE("Failed to read from socket %d: %d.", sock, errno);
+        return GGL_ERR_FAILURE;
+    }
+
+    take_fds(&hdr, fd);
+    if ((hdr.msg_flags & MSG_CTRUNC) != 0) {
+        GGL_LOGE("Socket peer passed too many fds.");
+        return GGL_ERR_FAILURE;
+    }
+    if (ret == 0) {
+        return GGL_ERR_NODATA;
+    }
+
+    *buf = ggl_buffer_substr(*buf, (size_t) ret, SIZE_MAX);
+    return GGL_ERR_OK;
+}
+
+static GglError send_with_fd(int sock, GglBuffer *buf, int *fd, int flags) {
+    struct iovec iov = { .iov_base = buf->data, .iov_len = buf->len };
+    union {
+        struct cmsghdr align;
+        uint8_t buf[CMSG_SPACE(sizeof(int))];
+    } control;
+    memset(&control, 0, sizeof(control));
+    struct msghdr hdr = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+    };
+    if (*fd >= 0) {
+        hdr.msg_control = control.buf;
+        hdr.msg_controllen = sizeof(control.buf);
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), fd, sizeof(int));
+    }
+
+    ssize_t ret = sendmsg(sock, &hdr, MSG_NOSIGNAL | flags);
+    if (ret < 0) {
+        if (errno == EINTR) {
+            return GGL_ERR_RETRY;
+        }
+        if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+            return GGL_ERR_NODATA;
+        }
+        GGL_LOGE("Failed to write to socket %d: %d.", sock, errno);
+        return GGL_ERR_FAILURE;
+    }
+
+    *fd = -1;
+    *buf = ggl_buffer_substr(*buf, (size_t) ret, SIZE_MAX);
+    return GGL_ERR_OK;
+}
+
+GglError ggl_socket_write_partial_with_fd(int sock, GglBuffer *buf, int *fd) {
+    if (*fd < 0) {
+        return ggl_file_write_partial(sock, buf);
+    }
+    return send_with_fd(sock, buf, fd, 0);
+}
+
+GglError ggl_socket_try_write_with_fd(int sock, GglBuffer *buf, int *fd) {
+    while (buf->len > 0) {
+        GglError ret = send_with_fd(sock, buf, fd, MSG_DONTWAIT);
+        if (ret == GGL_ERR_RETRY) {
+            continue;
+        }
+        if (ret == GGL_ERR_NODATA) {
+            return GGL_ERR_OK;
+        }
+        if (ret != GGL_ERR_OK) {
+            return ret;
+        }
+    }
+    return GGL_ERR_OK;
+}
+
+GglError ggl_socket_read_with_fd(int sock, GglBuffer buf, int *fd) {
+    GglBuffer rest = buf;
+    while (rest.len > 0) {
+        GglError ret = ggl_socket_read_partial_with_fd(sock, &rest, fd);
+        if (ret == GGL_ERR_RETRY) {
+            continue;
+        }
+        if (ret != GGL_ERR_OK) {
+            return ret;
+        }
+    }
+    return GGL_ERR_OK;
+}
+
+GglError ggl_socket_write_with_fd(int sock, GglBuffer buf, int fd) {
+    int pending_fd = fd;
+    GglBuffer rest = buf;
+    while (rest.len > 0) {
+        GglError ret
+            = ggl_socket_write_partial_with_fd(sock, &rest, &pending_fd);
+        if (ret == GGL_ERR_RETRY) {
+            continue;
+        }
+        if (ret != GGL_ERR_OK) {
+            return ret;
+        }
+    }
+    return GGL_ERR_OK;
+}
@@ -3,19 +3,27 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include <assert.h>
+#include <errno.h>
 #include <ggl/buffer.h>
 #include <ggl/cleanup.h>
 #include <ggl/error.h>
 #include <ggl/file.h>
 #include <ggl/io.h>
 #include <ggl/log.h>
+#include <ggl/socket_fd.h>
 #include <ggl/socket_handle.h>
 #include <pthread.h>
 #include <sys/socket.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
+#include <unistd.h>
 #include <stddef.h>
 #include <stdint.h>
 
+#ifndef SO_PEERPIDFD
+#define SO_PEERPIDFD 77
+#endif
+
 // Handles are 32 bits, with the high 16 bits being a generation counter, and
 // the low 16 bits being an offset index. The generation counter is incremented
 // on close, to prevent reuse.
@@ -62,6 +70,7 @@ void ggl_socket_pool_init(GglSocketPool *pool) {
     for (size_t i = 0; i < pool->max_fds; i++) {
         pool->fds[i] = FD_FREE;
     }
+    pool->epoll_fd = -1;
 
     // TODO: handle mutex init failure?
     pthread_mutexattr_t attr;
@@ -224,6 +233,71 @@ GglError ggl_socket_handle_write(
     return GGL_ERR_OK;
 }
 
+GglError ggl_socket_handle_read_with_fd(
+    GglSocketPool *pool, uint32_t handle, GglBuffer buf, int *fd
+) {
+    GGL_LOGT(
+        "Reading %zu bytes from handle %u in pool %p.", buf.len, handle, pool
+    );
+
+    GglBuffer rest = buf;
+
+    while (rest.len > 0) {
+        GGL_MTX_SCOPE_GUARD(&pool->mtx);
+
+        uint16_t index = 0;
+        GglError ret = validate_handle(pool, handle, &index, __func__);
+        if (ret != GGL_ERR_OK) {
+            return ret;
+        }
+
+        ret = ggl_socket_read_partial_with_fd(pool->fds[index], &rest, fd);
+        if (ret == GGL_ERR_RETRY) {
+            continue;
+        }
+        if (ret != GGL_ERR_OK) {
+            return ret;
+        }
+    }
+
+    GGL_LOGT("Read from %u successful.", handle);
+    return GGL_ERR_OK;
+}
+
+GglError ggl_socket_handle_write_with_fd(
+    GglSocketPool *pool, uint32_t handle, GglBuffer buf, int fd
+) {
+    GGL_LOGT(
+        "Writing %zu bytes to handle %u in pool %p.", buf.len, handle, pool
+    );
+
+    GglBuffer rest = buf;
+    int pending_fd = fd;
+
+    while (rest.len > 0) {
+        GGL_MTX_SCOPE_GUARD(&pool->mtx);
+
+        uint16_t index = 0;
+        GglError ret = validate_handle(pool, handle, &index, __func__);
+        if (ret != GGL_ERR_OK) {
+            return ret;
+        }
+
+        ret = ggl_socket_write_partial_with_fd(
+            pool->fds[index], &rest, &pending_fd
+        );
+        if (ret == GGL_ERR_RETRY) {
+            continue;
+        }
+        if (ret != GGL_ERR_OK) {
+            return ret;
+        }
+    }
+
+    GGL_LOGT("Write to %u successful.", handle);
+    return GGL_ERR_OK;
+}
+
 GglError ggl_socket_handle_close(GglSocketPool *pool, uint32_t handle) {
     GGL_LOGT("Closing handle %u in pool %p.", handle, pool);
 
@@ -267,6 +341,52 @@ GglError ggl_socket_handle_get_peer_pid(
     return GGL_ERR_OK;
 }
 
+GglError ggl_socket_handle_get_peer_pidfd(
+    GglSocketPool *pool, uint32_t handle, int *pidfd
+) {
+    GGL_LOGT("Getting peer pidfd for handle %u in pool %p.", handle, pool);
+
+    GGL_MTX_SCOPE_GUARD(&pool->mtx);
+
+    uint16_t index = 0;
+    GglError ret = validate_handle(pool, handle, &index, __func__);
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
+    int fd = -1;
+    socklen_t fd_len = sizeof(fd);
+    if (getsockopt(pool->fds[index], SOL_SOCKET, SO_PEERPIDFD, &fd, &fd_len)
+        == 0) {
+        *pidfd = fd;
+        return GGL_ERR_OK;
+    }
+    if (errno != ENOPROTOOPT) {
+        GGL_LOGE("Failed to get peer pidfd for fd %d.", pool->fds[index]);
+        return GGL_ERR_FAILURE;
+    }
+
+    // Kernels before 6.5; the pid could be reused between the connect and
+    // opening the pidfd, as with SO_PEERCRED alone.
+    struct ucred ucred;
+    socklen_t ucred_len = sizeof(ucred);
+    if ((getsockopt(
+             pool->fds[index], SOL_SOCKET, SO_PEERCRED, &ucred, &ucred_len
+         )
+         != 0)
+        || (ucred_len != sizeof(ucred))) {
+        GGL_LOGE("Failed to get peer cred for fd %d.", pool->fds[index]);
+        return GGL_ERR_FAILURE;
+    }
+    fd = (int) syscall(SYS_pidfd_open, ucred.pid, 0);
+    if (fd < 0) {
+        return (errno == ENOSYS) ? GGL_ERR_UNSUPPORTED : GGL_ERR_FAILURE;
+    }
+
+    *pidfd = fd;
+    return GGL_ERR_OK;
+}
+
 GglError ggl_socket_handle_protected(
     void (*action)(void *ctx, size_t index),
     void *ctx,
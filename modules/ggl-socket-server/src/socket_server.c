@@ -14,7 +14,9 @@
 #include <ggl/socket_handle.h>
 #include <ggl/socket_server.h>
 #include <limits.h>
+#include <poll.h>
 #include <string.h>
+#include <sys/epoll.h>
 #include <sys/resource.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
@@ -80,6 +82,54 @@ static void new_client_available(
     }
 }
 
+typedef struct {
+    GglSocketPool *pool;
+    uint32_t handle;
+    bool watch;
+    GglError ret;
+} WatchWritableCtx;
+
+static void watch_writable(void *ctx, size_t index) {
+    WatchWritableCtx *args = ctx;
+    int fd = args->pool->fds[index];
+    struct epoll_event event = {
+        .events = args->watch ? (EPOLLIN | EPOLLOUT) : EPOLLIN,
+        .data.u64 = args->handle,
+    };
+    if (epoll_ctl(args->pool->epoll_fd, EPOLL_CTL_MOD, fd, &event) != 0) {
+        GGL_LOGE("Failed to modify epoll events for fd %d: %d.", fd, errno);
+        args->ret = GGL_ERR_FAILURE;
+    }
+}
+
+GglError ggl_socket_server_watch_writable(
+    GglSocketPool *pool, uint32_t handle, bool watch
+) {
+    if (pool->epoll_fd < 0) {
+        return GGL_ERR_INVALID;
+    }
+    WatchWritableCtx ctx
+        = { .pool = pool, .handle = handle, .watch = watch, .ret = GGL_ERR_OK };
+    GglError ret
+        = ggl_socket_handle_protected(watch_writable, &ctx, pool, handle);
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+    return ctx.ret;
+}
+
+typedef struct {
+    GglSocketPool *pool;
+    bool readable;
+} CheckReadableCtx;
+
+static void check_readable(void *ctx, size_t index) {
+    CheckReadableCtx *args = ctx;
+    struct pollfd pfd = { .fd = args->pool->fds[index], .events = POLLIN };
+    // Hangup and errors also count, so that the socket gets cleaned up
+    args->readable = (poll(&pfd, 1, 0) != 0);
+}
+
 static void client_data_ready(
     GglSocketPool *pool,
     uint32_t handle,
@@ -88,6 +138,23 @@ static void client_data_ready(
 ) {
     assert(client_ready != NULL);
 
+    if (pool->on_writable != NULL) {
+        GglError ret = pool->on_writable(handle);
+        if (ret != GGL_ERR_OK) {
+            (void) ggl_socket_handle_close(pool, handle);
+            return;
+        }
+
+        // Event may have only been for writability
+        CheckReadableCtx check_ctx = { .pool = pool, .readable = false };
+        ret = ggl_socket_handle_protected(
+            check_readable, &check_ctx, pool, handle
+        );
+        if ((ret != GGL_ERR_OK) || !check_ctx.readable) {
+            return;
+        }
+    }
+
     GglError ret = client_ready(ctx, handle);
     if (ret != GGL_ERR_OK) {
         (void) ggl_socket_handle_close(pool, handle);
@@ -364,6 +431,8 @@ GglError ggl_socket_server_listen(
         }
     }
 
+    pool->epoll_fd = epoll_fd;
+
     SocketServerCtx server_ctx = {
         .pool = pool,
         .epoll_fd = epoll_fd,
@@ -65,6 +65,10 @@ GglError run_ggpubsubd(void) {
     GglRpcMethodDesc handlers[] = {
         { GGL_STR("publish"), false, rpc_publish, NULL },
         { GGL_STR("subscribe"), true, rpc_subscribe, NULL },
+        { GGL_STR("get_sub_queue_stats"),
+          false,
+          ggl_sub_queue_stats_handler,
+          NULL },
     };
     size_t handlers_len = sizeof(handlers) / sizeof(handlers[0]);
 
@@ -96,6 +100,8 @@ static GglError rpc_publish(void *ctx, GglMap params, uint32_t handle) {
         return GGL_ERR_RANGE;
     }
 
+    static uint32_t matched_handles[GGL_PUBSUB_MAX_SUBSCRIPTIONS];
+    size_t matched_len = 0;
     for (size_t i = 0; i < GGL_PUBSUB_MAX_SUBSCRIPTIONS; i++) {
         if (sub_handle[i] != 0) {
             bool matches = false;
@@ -107,11 +113,16 @@ static GglError rpc_publish(void *ctx, GglMap params, uint32_t handle) {
                 &matches
             );
             if (matches) {
-                ggl_sub_respond(sub_handle[i], ggl_obj_map(params));
+                matched_handles[matched_len] = sub_handle[i];
+                matched_len += 1;
             }
         }
     }
 
+    ggl_sub_respond_multicast(
+        matched_handles, matched_len, ggl_obj_map(params)
+    );
+
     ggl_respond(handle, GGL_OBJ_NULL);
     return GGL_ERR_OK;
 }
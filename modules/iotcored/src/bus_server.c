@@ -26,6 +26,10 @@ void iotcored_start_server(IotcoredArgs *args) {
         { GGL_STR("publish"), false, rpc_publish, NULL },
         { GGL_STR("subscribe"), true, rpc_subscribe, NULL },
         { GGL_STR("connection_status"), true, rpc_get_status, NULL },
+        { GGL_STR("get_sub_queue_stats"),
+          false,
+          ggl_sub_queue_stats_handler,
+          NULL },
     };
     size_t handlers_len = sizeof(handlers) / sizeof(handlers[0]);
 
@@ -200,6 +204,8 @@ static GglError rpc_get_status(void *ctx, GglMap params, uint32_t handle) {
     }
 
     ggl_sub_accept(handle, mqtt_status_sub_close_callback, NULL);
+    // Only the latest status matters to a subscriber that has fallen behind
+    ggl_sub_set_overflow_policy(handle, GGL_SUB_OVERFLOW_DROP_OLDEST);
 
     // Send a status update as soon as a subscription is accepted.
     iotcored_mqtt_status_update_send(
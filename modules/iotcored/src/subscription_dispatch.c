@@ -137,20 +137,26 @@ void iotcored_unregister_subscriptions(uint32_t handle, bool unsubscribe) {
 void iotcored_mqtt_receive(const IotcoredMsg *msg) {
     GGL_MTX_SCOPE_GUARD(&mtx);
 
+    static uint32_t matched_handles[IOTCORED_MAX_SUBSCRIPTIONS];
+    size_t matched_len = 0;
     for (size_t i = 0; i < IOTCORED_MAX_SUBSCRIPTIONS; i++) {
         if ((topic_filter_len[i] != 0)
             && iotcored_mqtt_topic_filter_match(
                 topic_filter_buf(i), msg->topic
             )) {
-            ggl_sub_respond(
-                handles[i],
-                ggl_obj_map(GGL_MAP(
-                    ggl_kv(GGL_STR("topic"), ggl_obj_buf(msg->topic)),
-                    ggl_kv(GGL_STR("payload"), ggl_obj_buf(msg->payload))
-                ))
-            );
+            matched_handles[matched_len] = handles[i];
+            matched_len += 1;
         }
     }
+
+    ggl_sub_respond_multicast(
+        matched_handles,
+        matched_len,
+        ggl_obj_map(GGL_MAP(
+            ggl_kv(GGL_STR("topic"), ggl_obj_buf(msg->topic)),
+            ggl_kv(GGL_STR("payload"), ggl_obj_buf(msg->payload))
+        ))
+    );
 }
 
 GglError iotcored_mqtt_status_update_register(uint32_t handle) {
@@ -177,11 +183,16 @@ void iotcored_mqtt_status_update_unregister(uint32_t handle) {
 void iotcored_mqtt_status_update_send(GglObject status) {
     GGL_MTX_SCOPE_GUARD(&mqtt_status_mtx);
 
+    static uint32_t status_handles[IOTCORED_MAX_SUBSCRIPTIONS];
+    size_t status_len = 0;
     for (size_t i = 0; i < IOTCORED_MAX_SUBSCRIPTIONS; i++) {
         if (mqtt_status_handles[i] != 0) {
-            ggl_sub_respond(mqtt_status_handles[i], status);
+            status_handles[status_len] = mqtt_status_handles[i];
+            status_len += 1;
         }
     }
+
+    ggl_sub_respond_multicast(status_handles, status_len, status);
 }
 
 void iotcored_re_register_all_subs(void) {
@@ -25,6 +25,7 @@
 #include <ggl/object.h>
 #include <ggl/recipe.h>
 #include <ggl/vector.h>
+#include <inttypes.h>
 #include <limits.h>
 #include <string.h>
 #include <sys/mman.h>
@@ -32,35 +33,107 @@
 #include <unistd.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 
-#define MAX_SCRIPT_LENGTH 10000
 #define MAX_THING_NAME_LEN 128
 
+/// Size of the buffer phase scripts are rendered into before being written.
+#define SCRIPT_WRITE_BUFFER_LEN 8192
+
+/// Memory for the component's configuration, read once for substitutions.
+/// Can be configured with `-DGGL_RECIPE_RUNNER_CONFIG_MEM_LEN=<N>`.
+#ifndef GGL_RECIPE_RUNNER_CONFIG_MEM_LEN
+#define GGL_RECIPE_RUNNER_CONFIG_MEM_LEN 16384
+#endif
+
 pid_t child_pid = -1; // To store child process ID
 
-static GglError write_escaped_char(int out_fd, uint8_t c) {
-    if (c == '"' || c == '\\' || c == '$' || c == '`') {
-        GglError ret = ggl_file_write(out_fd, GGL_STR("\\"));
+/// Buffered writer for the phase script, so that rendering a script costs a
+/// few write calls instead of one per character.
+typedef struct {
+    int fd;
+    GglByteVec buf;
+} ScriptWriter;
+
+static GglError script_flush(ScriptWriter *out) {
+    if (out->buf.buf.len == 0) {
+        return GGL_ERR_OK;
+    }
+    GglError ret = ggl_file_write(out->fd, out->buf.buf);
+    out->buf.buf.len = 0;
+    return ret;
+}
+
+static GglError script_write(ScriptWriter *out, GglBuffer data) {
+    if (data.len > out->buf.capacity - out->buf.buf.len) {
+        GglError ret = script_flush(out);
         if (ret != GGL_ERR_OK) {
             return ret;
         }
+        if (data.len > out->buf.capacity) {
+            return ggl_file_write(out->fd, data);
+        }
     }
-    return ggl_file_write(out_fd, (GglBuffer) { &c, 1 });
+    return ggl_byte_vec_append(&out->buf, data);
 }
 
-static GglError write_escaped_value(int out_fd, GglBuffer value) {
+static bool needs_escape(uint8_t c) {
+    return (c == '"') || (c == '\\') || (c == '$') || (c == '`');
+}
+
+static GglError write_escaped_value(ScriptWriter *out, GglBuffer value) {
+    size_t start = 0;
     for (size_t i = 0; i < value.len; i++) {
-        GglError ret = write_escaped_char(out_fd, value.data[i]);
+        if (!needs_escape(value.data[i])) {
+            continue;
+        }
+        GglError ret = script_write(out, ggl_buffer_substr(value, start, i));
+        if (ret != GGL_ERR_OK) {
+            return ret;
+        }
+        ret = script_write(out, GGL_STR("\\"));
         if (ret != GGL_ERR_OK) {
             return ret;
         }
+        start = i;
     }
+    return script_write(out, ggl_buffer_substr(value, start, SIZE_MAX));
+}
 
+static uint8_t component_config_mem[GGL_RECIPE_RUNNER_CONFIG_MEM_LEN];
+static GglObject component_config;
+static bool component_config_loaded = false;
+static GglError component_config_err = GGL_ERR_OK;
+
+// Substitutions are resolved from one read of the component's configuration
+// instead of an IPC round trip per substitution.
+static GglError load_component_config(void) {
+    if (!component_config_loaded) {
+        GglArena alloc = ggl_arena_init(GGL_BUF(component_config_mem));
+        component_config_err = ggipc_get_config(
+            (GglBufList) { 0 }, NULL, &alloc, &component_config
+        );
+        component_config_loaded = true;
+    }
+    return component_config_err;
+}
+
+static GglError lookup_config_value(GglBufList key_path, GglObject *result) {
+    GglObject value = component_config;
+    GGL_BUF_LIST_FOREACH (key, key_path) {
+        GglObject *child;
+        if ((ggl_obj_type(value) != GGL_TYPE_MAP)
+            || !ggl_map_get(ggl_obj_into_map(value), *key, &child)) {
+            return GGL_ERR_NOENTRY;
+        }
+        value = *child;
+    }
+    *result = value;
     return GGL_ERR_OK;
 }
 
-static GglError insert_config_value(int out_fd, GglBuffer json_ptr) {
+static GglError insert_config_value(ScriptWriter *out, GglBuffer json_ptr) {
     static GglBuffer key_path_mem[GGL_MAX_OBJECT_DEPTH];
     GglBufVec key_path = GGL_BUF_VEC(key_path_mem);
 
@@ -72,9 +145,15 @@ static GglError insert_config_value(int out_fd, GglBuffer json_ptr) {
 
     static uint8_t config_value[10000];
     static uint8_t copy_config_value[10000];
-    GglArena alloc = ggl_arena_init(GGL_BUF(config_value));
     GglObject result = { 0 };
-    ret = ggipc_get_config(key_path.buf_list, NULL, &alloc, &result);
+    ret = load_component_config();
+    if (ret == GGL_ERR_OK) {
+        ret = lookup_config_value(key_path.buf_list, &result);
+    } else {
+        // e.g. configuration too large to hold; read only the needed value
+        GglArena alloc = ggl_arena_init(GGL_BUF(config_value));
+        ret = ggipc_get_config(key_path.buf_list, NULL, &alloc, &result);
+    }
     if (ret != GGL_ERR_OK) {
         GGL_LOGE("Failed to get config value for substitution.");
         return ret;
@@ -93,7 +172,7 @@ static GglError insert_config_value(int out_fd, GglBuffer json_ptr) {
         final_result = ggl_obj_into_buf(result);
     }
 
-    return write_escaped_value(out_fd, final_result);
+    return write_escaped_value(out, final_result);
 }
 
 static GglError split_escape_seq(
@@ -114,7 +193,7 @@ static GglError split_escape_seq(
 // TODO: Simplify this code
 // NOLINTNEXTLINE(readability-function-cognitive-complexity)
 static GglError substitute_escape(
-    int out_fd,
+    ScriptWriter *out,
     GglBuffer escape_seq,
     GglBuffer root_path,
     GglBuffer component_name,
@@ -140,85 +219,85 @@ static GglError substitute_escape(
 
     if (ggl_buffer_eq(type, GGL_STR("kernel"))) {
         if (ggl_buffer_eq(arg, GGL_STR("rootPath"))) {
-            return ggl_file_write(out_fd, root_path);
+            return script_write(out, root_path);
         }
     } else if (ggl_buffer_eq(type, GGL_STR("iot"))) {
         if (ggl_buffer_eq(arg, GGL_STR("thingName"))) {
-            return ggl_file_write(out_fd, thing_name);
+            return script_write(out, thing_name);
         }
     } else if (ggl_buffer_eq(type, GGL_STR("work"))) {
         if (ggl_buffer_eq(arg, GGL_STR("path"))) {
-            ret = ggl_file_write(out_fd, root_path);
+            ret = script_write(out, root_path);
             if (ret != GGL_ERR_OK) {
                 return ret;
             }
-            ret = ggl_file_write(out_fd, GGL_STR("/work/"));
+            ret = script_write(out, GGL_STR("/work/"));
             if (ret != GGL_ERR_OK) {
                 return ret;
             }
-            ret = ggl_file_write(out_fd, component_name);
+            ret = script_write(out, component_name);
             if (ret != GGL_ERR_OK) {
                 return ret;
             }
-            return ggl_file_write(out_fd, GGL_STR("/"));
+            return script_write(out, GGL_STR("/"));
         }
     } else if (ggl_buffer_eq(type, GGL_STR("artifacts"))) {
         if (ggl_buffer_eq(arg, GGL_STR("path"))) {
-            ret = ggl_file_write(out_fd, root_path);
+            ret = script_write(out, root_path);
             if (ret != GGL_ERR_OK) {
                 return ret;
             }
-            ret = ggl_file_write(out_fd, GGL_STR("/packages/"));
+            ret = script_write(out, GGL_STR("/packages/"));
             if (ret != GGL_ERR_OK) {
                 return ret;
             }
-            ret = ggl_file_write(out_fd, GGL_STR("artifacts/"));
+            ret = script_write(out, GGL_STR("artifacts/"));
             if (ret != GGL_ERR_OK) {
                 return ret;
             }
-            ret = ggl_file_write(out_fd, component_name);
+            ret = script_write(out, component_name);
             if (ret != GGL_ERR_OK) {
                 return ret;
             }
-            ret = ggl_file_write(out_fd, GGL_STR("/"));
+            ret = script_write(out, GGL_STR("/"));
             if (ret != GGL_ERR_OK) {
                 return ret;
             }
-            ret = ggl_file_write(out_fd, component_version);
+            ret = script_write(out, component_version);
             if (ret != GGL_ERR_OK) {
                 return ret;
             }
-            return ggl_file_write(out_fd, GGL_STR("/"));
+            return script_write(out, GGL_STR("/"));
         }
         if (ggl_buffer_eq(arg, GGL_STR("decompressedPath"))) {
-            ret = ggl_file_write(out_fd, root_path);
+            ret = script_write(out, root_path);
             if (ret != GGL_ERR_OK) {
                 return ret;
             }
-            ret = ggl_file_write(out_fd, GGL_STR("/packages/"));
+            ret = script_write(out, GGL_STR("/packages/"));
             if (ret != GGL_ERR_OK) {
                 return ret;
             }
-            ret = ggl_file_write(out_fd, GGL_STR("artifacts-unarchived/"));
+            ret = script_write(out, GGL_STR("artifacts-unarchived/"));
             if (ret != GGL_ERR_OK) {
                 return ret;
             }
-            ret = ggl_file_write(out_fd, component_name);
+            ret = script_write(out, component_name);
             if (ret != GGL_ERR_OK) {
                 return ret;
             }
-            ret = ggl_file_write(out_fd, GGL_STR("/"));
+            ret = script_write(out, GGL_STR("/"));
             if (ret != GGL_ERR_OK) {
                 return ret;
             }
-            ret = ggl_file_write(out_fd, component_version);
+            ret = script_write(out, component_version);
             if (ret != GGL_ERR_OK) {
                 return ret;
             }
-            return ggl_file_write(out_fd, GGL_STR("/"));
+            return script_write(out, GGL_STR("/"));
         }
     } else if (ggl_buffer_eq(type, GGL_STR("configuration"))) {
-        return insert_config_value(out_fd, arg);
+        return insert_config_value(out, arg);
     }
 
     GGL_LOGE(
@@ -229,8 +308,16 @@ static GglError substitute_escape(
     return GGL_ERR_FAILURE;
 }
 
+// Returns the start of the next recipe escape, or end if there is none.
+static uint8_t *next_escape(uint8_t *current_pointer, uint8_t *end_pointer) {
+    uint8_t *found = memchr(
+        current_pointer, '{', (size_t) (end_pointer - current_pointer)
+    );
+    return (found == NULL) ? end_pointer : found;
+}
+
 static GglError handle_escape(
-    int out_fd,
+    ScriptWriter *out,
     uint8_t **current_pointer,
     const uint8_t *end_pointer,
     GglBuffer root_path,
@@ -256,7 +343,7 @@ static GglError handle_escape(
         } else {
             (*current_pointer)++;
             return substitute_escape(
-                out_fd,
+                out,
                 vec.buf,
                 root_path,
                 component_name,
@@ -268,7 +355,7 @@ static GglError handle_escape(
 }
 
 static GglError process_set_env(
-    int out_fd,
+    ScriptWriter *out,
     GglMap env_values_as_map,
     GglBuffer root_path,
     GglBuffer component_name,
@@ -277,11 +364,11 @@ static GglError process_set_env(
 ) {
     GGL_LOGT("Lifecycle Setenv, is a map");
     GGL_MAP_FOREACH (pair, env_values_as_map) {
-        GglError ret = ggl_file_write(out_fd, GGL_STR("export "));
+        GglError ret = script_write(out, GGL_STR("export "));
         if (ret != GGL_ERR_OK) {
             return ret;
         }
-        ret = ggl_file_write(out_fd, ggl_kv_key(*pair));
+        ret = script_write(out, ggl_kv_key(*pair));
         if (ret != GGL_ERR_OK) {
             return ret;
         }
@@ -290,7 +377,7 @@ static GglError process_set_env(
             (int) ggl_kv_key(*pair).len,
             ggl_kv_key(*pair).data
         );
-        ret = ggl_file_write(out_fd, GGL_STR("="));
+        ret = script_write(out, GGL_STR("="));
         if (ret != GGL_ERR_OK) {
             return ret;
         }
@@ -305,7 +392,7 @@ static GglError process_set_env(
         uint8_t *end_pointer = &val.data[val.len];
         if (val.len == 0) {
             // Add in a new line if no value is provided
-            ret = ggl_file_write(out_fd, GGL_STR("\n"));
+            ret = script_write(out, GGL_STR("\n"));
             if (ret != GGL_ERR_OK) {
                 return ret;
             }
@@ -315,14 +402,19 @@ static GglError process_set_env(
                 break;
             }
             if (*current_pointer != '{') {
-                ret = write_escaped_char(out_fd, *current_pointer);
+                uint8_t *run_end = next_escape(current_pointer, end_pointer);
+                ret = write_escaped_value(
+                    out,
+                    (GglBuffer) { .data = current_pointer,
+                                  .len = (size_t) (run_end - current_pointer) }
+                );
                 if (ret != GGL_ERR_OK) {
                     return ret;
                 }
-                current_pointer++;
+                current_pointer = run_end;
             } else {
                 ret = handle_escape(
-                    out_fd,
+                    out,
                     &current_pointer,
                     end_pointer,
                     root_path,
@@ -335,7 +427,7 @@ static GglError process_set_env(
                 }
             }
         }
-        ret = ggl_file_write(out_fd, GGL_STR("\n"));
+        ret = script_write(out, GGL_STR("\n"));
         if (ret != GGL_ERR_OK) {
             return ret;
         }
@@ -344,7 +436,7 @@ static GglError process_set_env(
 }
 
 static GglError find_and_process_set_env(
-    int out_fd,
+    ScriptWriter *out,
     GglMap map_containing_setenv,
     GglBuffer root_path,
     GglBuffer component_name,
@@ -361,7 +453,7 @@ static GglError find_and_process_set_env(
         }
 
         ret = process_set_env(
-            out_fd,
+            out,
             ggl_obj_into_map(*env_values),
             root_path,
             component_name,
@@ -379,7 +471,7 @@ static GglError find_and_process_set_env(
 }
 
 static GglError process_lifecycle_phase(
-    int out_fd,
+    ScriptWriter *out,
     GglMap selected_lifecycle,
     GglBuffer phase,
     GglBuffer root_path,
@@ -410,7 +502,7 @@ static GglError process_lifecycle_phase(
             phase.data
         );
         ret = process_set_env(
-            out_fd,
+            out,
             set_env_as_map,
             root_path,
             component_name,
@@ -425,7 +517,7 @@ static GglError process_lifecycle_phase(
 
     if (selected_script_as_buf.len == 0) {
         // Add in a new line if no value is provided
-        ret = ggl_file_write(out_fd, GGL_STR("\n"));
+        ret = script_write(out, GGL_STR("\n"));
         if (ret != GGL_ERR_OK) {
             return ret;
         }
@@ -443,14 +535,19 @@ static GglError process_lifecycle_phase(
             break;
         }
         if (*current_pointer != '{') {
-            ret = ggl_file_write(out_fd, (GglBuffer) { current_pointer, 1 });
+            uint8_t *run_end = next_escape(current_pointer, end_pointer);
+            ret = script_write(
+                out,
+                (GglBuffer) { .data = current_pointer,
+                              .len = (size_t) (run_end - current_pointer) }
+            );
             if (ret != GGL_ERR_OK) {
                 return ret;
             }
-            current_pointer++;
+            current_pointer = run_end;
         } else {
             ret = handle_escape(
-                out_fd,
+                out,
                 &current_pointer,
                 end_pointer,
                 root_path,
@@ -467,7 +564,7 @@ static GglError process_lifecycle_phase(
 }
 
 static GglError write_script_with_replacement(
-    int out_fd,
+    ScriptWriter *out,
     GglMap recipe_as_map,
     GglBuffer root_path,
     GglBuffer component_name,
@@ -485,7 +582,7 @@ static GglError write_script_with_replacement(
 
     GGL_LOGT("Processing Global Setenv");
     ret = find_and_process_set_env(
-        out_fd,
+        out,
         selected_lifecycle_map,
         root_path,
         component_name,
@@ -501,7 +598,7 @@ static GglError write_script_with_replacement(
         "Processing other Lifecycle phase: %.*s", (int) phase.len, phase.data
     );
     ret = process_lifecycle_phase(
-        out_fd,
+        out,
         selected_lifecycle_map,
         phase,
         root_path,
@@ -521,15 +618,15 @@ static GglError write_script_with_replacement(
     // if startup, send a ready notification before exiting
     // otherwise, simple startup scripts will fail with 'protocol' by systemd
     if (ggl_buffer_eq(GGL_STR("startup"), phase)) {
-        ret = ggl_file_write(out_fd, GGL_STR("\n"));
+        ret = script_write(out, GGL_STR("\n"));
         if (ret != GGL_ERR_OK) {
             return ret;
         }
-        ret = ggl_file_write(out_fd, GGL_STR("systemd-notify --ready\n"));
+        ret = script_write(out, GGL_STR("systemd-notify --ready\n"));
         if (ret != GGL_ERR_OK) {
             return ret;
         }
-        ret = ggl_file_write(out_fd, GGL_STR("systemd-notify --stopping\n"));
+        ret = script_write(out, GGL_STR("systemd-notify --stopping\n"));
         if (ret != GGL_ERR_OK) {
             return ret;
         }
@@ -538,13 +635,23 @@ static GglError write_script_with_replacement(
     return GGL_ERR_OK;
 }
 
-static GglError get_system_config_error_cb(
+typedef struct {
+    GglBuffer thing_name;
+    GglBuffer root_path;
+    GglBuffer root_ca_path;
+    GglBuffer aws_region;
+    GglBuffer proxy_url;
+    GglBuffer no_proxy_addresses;
+    GglBuffer tes_port;
+} RunnerContext;
+
+static GglError get_runner_context_error_cb(
     void *ctx, GglBuffer error_code, GglBuffer message
 ) {
     (void) ctx;
 
     GGL_LOGE(
-        "Received PrivateGetSystemConfig error %.*s: %.*s.",
+        "Received GetRunnerContext error %.*s: %.*s.",
         (int) error_code.len,
         error_code.data,
         (int) message.len,
@@ -554,13 +661,105 @@ static GglError get_system_config_error_cb(
     return GGL_ERR_FAILURE;
 }
 
-static GglError get_system_config_result_cb(void *ctx, GglMap result) {
-    GglBuffer *resp_buf = ctx;
+// Copies a string value into vec with a null terminator, for use with setenv.
+static GglError copy_context_str(
+    GglByteVec *vec, GglObject *value, GglBuffer *out
+) {
+    if (value == NULL) {
+        *out = (GglBuffer) { 0 };
+        return GGL_ERR_OK;
+    }
+    if (ggl_obj_type(*value) != GGL_TYPE_BUF) {
+        GGL_LOGE("Runner context value is not a string.");
+        return GGL_ERR_INVALID;
+    }
+    GglBuffer str = ggl_obj_into_buf(*value);
+    size_t start = vec->buf.len;
+    GglError ret = ggl_byte_vec_append(vec, str);
+    ggl_byte_vec_chain_push(&ret, vec, '\0');
+    if (ret != GGL_ERR_OK) {
+        GGL_LOGE("Insufficent memory provided for runner context.");
+        return ret;
+    }
+    *out = (GglBuffer) { .data = &vec->buf.data[start], .len = str.len };
+    return GGL_ERR_OK;
+}
+
+static GglError copy_tes_port(
+    GglByteVec *vec, GglObject *value, GglBuffer *out
+) {
+    if ((value == NULL) || (ggl_obj_type(*value) != GGL_TYPE_I64)) {
+        return copy_context_str(vec, value, out);
+    }
+    uint8_t port_mem[24];
+    int len = snprintf(
+        (char *) port_mem,
+        sizeof(port_mem),
+        "%" PRIi64,
+        ggl_obj_into_i64(*value)
+    );
+    if ((len < 0) || ((size_t) len >= sizeof(port_mem))) {
+        return GGL_ERR_RANGE;
+    }
+    GglObject port_obj
+        = ggl_obj_buf((GglBuffer) { .data = port_mem, .len = (size_t) len });
+    return copy_context_str(vec, &port_obj, out);
+}
 
-    GglObject *value;
+static GglError get_network_proxy(
+    GglByteVec *vec, GglObject *network_proxy, RunnerContext *context
+) {
+    if (network_proxy == NULL) {
+        return GGL_ERR_OK;
+    }
+    if (ggl_obj_type(*network_proxy) != GGL_TYPE_MAP) {
+        GGL_LOGE("networkProxy configuration is not a map.");
+        return GGL_ERR_INVALID;
+    }
+    GglMap network_proxy_map = ggl_obj_into_map(*network_proxy);
+
+    GglObject *proxy;
+    if (ggl_map_get(network_proxy_map, GGL_STR("proxy"), &proxy)
+        && (ggl_obj_type(*proxy) == GGL_TYPE_MAP)) {
+        GglObject *url = NULL;
+        (void) ggl_map_get(ggl_obj_into_map(*proxy), GGL_STR("url"), &url);
+        GglError ret = copy_context_str(vec, url, &context->proxy_url);
+        if (ret != GGL_ERR_OK) {
+            return ret;
+        }
+    }
+
+    GglObject *no_proxy = NULL;
+    (void) ggl_map_get(
+        network_proxy_map, GGL_STR("noProxyAddresses"), &no_proxy
+    );
+    return copy_context_str(vec, no_proxy, &context->no_proxy_addresses);
+}
+
+static GglError get_runner_context_result_cb(void *ctx, GglMap result) {
+    RunnerContext *context = ctx;
+
+    GglObject *thing_name;
+    GglObject *root_path;
+    GglObject *root_ca_path;
+    GglObject *aws_region;
+    GglObject *network_proxy;
+    GglObject *tes_port;
     GglError ret = ggl_map_validate(
         result,
-        GGL_MAP_SCHEMA({ GGL_STR("value"), GGL_REQUIRED, GGL_TYPE_NULL, &value }
+        GGL_MAP_SCHEMA(
+            { GGL_STR("thingName"), GGL_REQUIRED, GGL_TYPE_BUF, &thing_name },
+            { GGL_STR("rootPath"), GGL_REQUIRED, GGL_TYPE_BUF, &root_path },
+            { GGL_STR("rootCaPath"),
+              GGL_REQUIRED,
+              GGL_TYPE_BUF,
+              &root_ca_path },
+            { GGL_STR("awsRegion"), GGL_REQUIRED, GGL_TYPE_BUF, &aws_region },
+            { GGL_STR("networkProxy"),
+              GGL_OPTIONAL,
+              GGL_TYPE_NULL,
+              &network_proxy },
+            { GGL_STR("tesPort"), GGL_OPTIONAL, GGL_TYPE_NULL, &tes_port },
         )
     );
     if (ret != GGL_ERR_OK) {
@@ -568,35 +767,36 @@ static GglError get_system_config_result_cb(void *ctx, GglMap result) {
         return GGL_ERR_INVALID;
     }
 
-    if (ggl_obj_type(*value) != GGL_TYPE_BUF) {
-        GGL_LOGE("Config value is not a string.");
-        return GGL_ERR_FAILURE;
+    static uint8_t context_mem[4 * PATH_MAX];
+    GglByteVec vec = GGL_BYTE_VEC(context_mem);
+    ret = copy_context_str(&vec, thing_name, &context->thing_name);
+    if (ret == GGL_ERR_OK) {
+        ret = copy_context_str(&vec, root_path, &context->root_path);
     }
-
-    if (resp_buf != NULL) {
-        GglBuffer val_buf = ggl_obj_into_buf(*value);
-
-        GglArena alloc = ggl_arena_init(*resp_buf);
-        ret = ggl_arena_claim_buf(&val_buf, &alloc);
-        if (ret != GGL_ERR_OK) {
-            GGL_LOGE("Insufficent memory provided for response.");
-            return ret;
-        }
-
-        *resp_buf = val_buf;
+    if (ret == GGL_ERR_OK) {
+        ret = copy_context_str(&vec, root_ca_path, &context->root_ca_path);
     }
-
-    return GGL_ERR_OK;
+    if (ret == GGL_ERR_OK) {
+        ret = copy_context_str(&vec, aws_region, &context->aws_region);
+    }
+    if (ret == GGL_ERR_OK) {
+        ret = get_network_proxy(&vec, network_proxy, context);
+    }
+    if (ret == GGL_ERR_OK) {
+        ret = copy_tes_port(&vec, tes_port, &context->tes_port);
+    }
+    return ret;
 }
 
-static GglError get_system_config(GglBuffer key, GglBuffer *value) {
+// Fetches all configuration needed to start a phase in one IPC call.
+static GglError get_runner_context(RunnerContext *context) {
     return ggipc_call(
-        GGL_STR("aws.greengrass.private#GetSystemConfig"),
-        GGL_STR("aws.greengrass.private#GetSystemConfigRequest"),
-        GGL_MAP(ggl_kv(GGL_STR("key"), ggl_obj_buf(key))),
-        &get_system_config_result_cb,
-        &get_system_config_error_cb,
-        value
+        GGL_STR("aws.greengrass.private#GetRunnerContext"),
+        GGL_STR("aws.greengrass.private#GetRunnerContextRequest"),
+        (GglMap) { 0 },
+        &get_runner_context_result_cb,
+        &get_runner_context_error_cb,
+        context
     );
 }
 
@@ -663,42 +863,28 @@ GglError runner(const RecipeRunnerArgs *args) {
         GGL_LOGE("setenv failed: %d.", errno);
     }
 
-    static uint8_t resp_mem[PATH_MAX];
-
-    GglBuffer resp = GGL_BUF(resp_mem);
-    resp.len -= 1;
-    ret = get_system_config(GGL_STR("rootCaPath"), &resp);
+    RunnerContext context = { 0 };
+    ret = get_runner_context(&context);
     if (ret != GGL_ERR_OK) {
-        GGL_LOGE("Failed to get root CA path from config.");
+        GGL_LOGE("Failed to get runner context from nucleus.");
         return ret;
     }
-    resp.data[resp.len] = '\0';
-    // NOLINTNEXTLINE(concurrency-mt-unsafe)
-    sys_ret = setenv("GG_ROOT_CA_PATH", (char *) resp.data, true);
+
+    sys_ret =
+        // NOLINTNEXTLINE(concurrency-mt-unsafe)
+        setenv("GG_ROOT_CA_PATH", (char *) context.root_ca_path.data, true);
     if (sys_ret != 0) {
         GGL_LOGE("setenv failed: %d.", errno);
     }
 
-    resp = GGL_BUF(resp_mem);
-    resp.len -= 1;
-    ret = ggipc_get_config_str(
-        GGL_BUF_LIST(GGL_STR("awsRegion")),
-        &GGL_STR("aws.greengrass.NucleusLite"),
-        &resp
-    );
-
-    if (ret != GGL_ERR_OK) {
-        GGL_LOGE("Failed to get region from config.");
-        return ret;
-    }
-    resp.data[resp.len] = '\0';
     // NOLINTNEXTLINE(concurrency-mt-unsafe)
-    sys_ret = setenv("AWS_REGION", (char *) resp.data, true);
+    sys_ret = setenv("AWS_REGION", (char *) context.aws_region.data, true);
     if (sys_ret != 0) {
         GGL_LOGE("setenv failed: %d.", errno);
     }
-    // NOLINTNEXTLINE(concurrency-mt-unsafe)
-    sys_ret = setenv("AWS_DEFAULT_REGION", (char *) resp.data, true);
+    sys_ret =
+        // NOLINTNEXTLINE(concurrency-mt-unsafe)
+        setenv("AWS_DEFAULT_REGION", (char *) context.aws_region.data, true);
     if (sys_ret != 0) {
         GGL_LOGE("setenv failed: %d.", errno);
     }
@@ -709,87 +895,37 @@ GglError runner(const RecipeRunnerArgs *args) {
         GGL_LOGE("setenv failed: %d.", errno);
     }
 
-    resp = GGL_BUF(resp_mem);
-    resp.len -= 1;
-    ret = ggipc_get_config_str(
-        GGL_BUF_LIST(GGL_STR("networkProxy"), GGL_STR("proxy"), GGL_STR("url")),
-        &GGL_STR("aws.greengrass.NucleusLite"),
-        &resp
-    );
-    switch (ret) {
-    case GGL_ERR_NOMEM:
-        GGL_LOGE("Failed to get network proxy url from config - value longer "
-                 "than supported.");
-        return ret;
-    case GGL_ERR_NOENTRY:
-        GGL_LOGD("No network proxy set.");
-        break;
-    case GGL_ERR_OK: {
-        resp.data[resp.len] = '\0';
+    if (context.proxy_url.data != NULL) {
+        const char *proxy_url = (char *) context.proxy_url.data;
         // NOLINTBEGIN(concurrency-mt-unsafe)
-        setenv("all_proxy", (char *) resp.data, true);
-        setenv("ALL_PROXY", (char *) resp.data, true);
-        setenv("http_proxy", (char *) resp.data, true);
-        setenv("HTTP_PROXY", (char *) resp.data, true);
-        setenv("https_proxy", (char *) resp.data, true);
-        setenv("HTTPS_PROXY", (char *) resp.data, true);
+        setenv("all_proxy", proxy_url, true);
+        setenv("ALL_PROXY", proxy_url, true);
+        setenv("http_proxy", proxy_url, true);
+        setenv("HTTP_PROXY", proxy_url, true);
+        setenv("https_proxy", proxy_url, true);
+        setenv("HTTPS_PROXY", proxy_url, true);
         // NOLINTEND(concurrency-mt-unsafe)
-        break;
-    }
-    default:
-        GGL_LOGE("Failed to get proxy url from config. Error: %d.", ret);
-        return ret;
+    } else {
+        GGL_LOGD("No network proxy set.");
     }
 
-    resp = GGL_BUF(resp_mem);
-    resp.len -= 1;
-    ret = ggipc_get_config_str(
-        GGL_BUF_LIST(GGL_STR("networkProxy"), GGL_STR("noProxyAddresses")),
-        &GGL_STR("aws.greengrass.NucleusLite"),
-        &resp
-    );
-    switch (ret) {
-    case GGL_ERR_NOMEM:
-        GGL_LOGE("Failed to get network proxy url from config - value longer "
-                 "than supported.");
-        return ret;
-    case GGL_ERR_NOENTRY:
-        GGL_LOGD("No network proxy set.");
-        break;
-    case GGL_ERR_OK: {
-        resp.data[resp.len] = '\0';
+    if (context.no_proxy_addresses.data != NULL) {
+        const char *no_proxy = (char *) context.no_proxy_addresses.data;
         // NOLINTNEXTLINE(concurrency-mt-unsafe)
-        setenv("no_proxy", (char *) resp.data, true);
+        setenv("no_proxy", no_proxy, true);
         // NOLINTNEXTLINE(concurrency-mt-unsafe)
-        setenv("NO_PROXY", (char *) resp.data, true);
-        break;
-    }
-    default:
-        GGL_LOGE("Failed to get proxy url from config. Error: %d.", ret);
-        return ret;
+        setenv("NO_PROXY", no_proxy, true);
     }
 
-    static uint8_t thing_name_mem[MAX_THING_NAME_LEN + 1];
-    GglBuffer thing_name = GGL_BUF(thing_name_mem);
-    thing_name.len -= 1;
-    ret = get_system_config(GGL_STR("thingName"), &thing_name);
-    if (ret != GGL_ERR_OK) {
-        GGL_LOGE("Failed to get thing name from config.");
-        return ret;
-    }
-    thing_name.data[thing_name.len] = '\0';
-    // NOLINTNEXTLINE(concurrency-mt-unsafe)
-    sys_ret = setenv("AWS_IOT_THING_NAME", (char *) thing_name.data, true);
+    GglBuffer thing_name = context.thing_name;
+    sys_ret =
+        // NOLINTNEXTLINE(concurrency-mt-unsafe)
+        setenv("AWS_IOT_THING_NAME", (char *) thing_name.data, true);
     if (sys_ret != 0) {
         GGL_LOGE("setenv failed: %d.", errno);
     }
 
-    GglBuffer root_path = GGL_BUF(resp_mem);
-    ret = get_system_config(GGL_STR("rootPath"), &root_path);
-    if (ret != GGL_ERR_OK) {
-        GGL_LOGE("Failed to get root path from config.");
-        return ret;
-    }
+    GglBuffer root_path = context.root_path;
 
     int root_path_fd;
     ret = ggl_dir_open(root_path, O_PATH, false, &root_path_fd);
@@ -830,33 +966,22 @@ GglError runner(const RecipeRunnerArgs *args) {
                 GGL_STR("aws.greengrass.TokenExchangeService"),
                 &inner_val
             )) {
-            static uint8_t resp_mem2[PATH_MAX];
-            GglByteVec resp_vec = GGL_BYTE_VEC(resp_mem2);
-            ret = ggl_byte_vec_append(&resp_vec, GGL_STR("http://localhost:"));
-            if (ret != GGL_ERR_OK) {
-                GGL_LOGE("Failed to append http://localhost:");
-                return ret;
-            }
-            GglBuffer rest = ggl_byte_vec_remaining_capacity(resp_vec);
-
-            ret = ggipc_get_config_str(
-                GGL_BUF_LIST(GGL_STR("port")),
-                &GGL_STR("aws.greengrass.TokenExchangeService"),
-                &rest
-            );
-            if (ret != GGL_ERR_OK) {
+            if (context.tes_port.data == NULL) {
                 GGL_LOGE(
                     "Failed to get port for TES server from config. Possible "
                     "reason, TES server might not have started yet."
                 );
-                return ret;
+                return GGL_ERR_NOENTRY;
             }
-            resp_vec.buf.len += rest.len;
-            ret = ggl_byte_vec_append(
-                &resp_vec, GGL_STR("/2016-11-01/credentialprovider/\0")
+            static uint8_t resp_mem2[PATH_MAX];
+            GglByteVec resp_vec = GGL_BYTE_VEC(resp_mem2);
+            ret = ggl_byte_vec_append(&resp_vec, GGL_STR("http://localhost:"));
+            ggl_byte_vec_chain_append(&ret, &resp_vec, context.tes_port);
+            ggl_byte_vec_chain_append(
+                &ret, &resp_vec, GGL_STR("/2016-11-01/credentialprovider/\0")
             );
             if (ret != GGL_ERR_OK) {
-                GGL_LOGE("Failed to append /2016-11-01/credentialprovider/");
+                GGL_LOGE("Failed to build TES credential provider URI.");
                 return ret;
             }
 
@@ -918,14 +1043,18 @@ GglError runner(const RecipeRunnerArgs *args) {
         return GGL_ERR_FAILURE;
     }
 
-    ret = ggl_file_write(script_fd, GGL_STR("#!/bin/sh\n"));
+    static uint8_t script_buf_mem[SCRIPT_WRITE_BUFFER_LEN];
+    ScriptWriter script
+        = { .fd = script_fd, .buf = GGL_BYTE_VEC(script_buf_mem) };
+
+    ret = script_write(&script, GGL_STR("#!/bin/sh\n"));
     if (ret != GGL_ERR_OK) {
         GGL_LOGE("Failed to write shebang to component phase script.");
         return ret;
     }
 
     ret = write_script_with_replacement(
-        script_fd,
+        &script,
         ggl_obj_into_map(recipe),
         root_path,
         component_name,
@@ -933,6 +1062,13 @@ GglError runner(const RecipeRunnerArgs *args) {
         thing_name,
         phase
     );
+    if (ret == GGL_ERR_OK) {
+        ret = script_flush(&script);
+    }
+    if (ret != GGL_ERR_OK) {
+        GGL_LOGE("Failed to write component phase script.");
+        return ret;
+    }
 
     const char *argv[] = { "/bin/sh", NULL };
     sys_ret = fexecve(script_fd, (char **) argv, environ);
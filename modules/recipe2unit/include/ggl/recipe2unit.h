@@ -16,6 +16,12 @@ typedef struct {
     bool has_install;
     bool has_run_startup;
     bool has_bootstrap;
+    /// Set if systemd must reload units, either because a unit file was
+    /// created or changed, or an earlier change has not been reloaded yet.
+    bool units_changed;
+    /// Set if the run or startup unit changed, so a running instance of the
+    /// component must be restarted to pick it up.
+    bool restart_needed;
 } HasPhase;
 
 typedef struct {
@@ -45,4 +51,11 @@ GglError convert_to_unit(
     HasPhase *existing_phases
 );
 
+/// @brief Record that systemd has reloaded all unit files written so far.
+/// Must be called after a successful `systemctl daemon-reload`; until then,
+/// convert_to_unit reports units_changed even for unchanged unit files.
+/// @param[in] root_path_fd Directory the unit files are written to
+/// @return GGL_ERR_OK on success. Failure otherwise.
+GglError clear_unit_reload_pending(int root_path_fd);
+
 #endif
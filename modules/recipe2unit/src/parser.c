@@ -6,6 +6,7 @@
 #include "unit_file_generator.h"
 #include "validate_args.h"
 #include <assert.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <ggl/arena.h>
 #include <ggl/buffer.h>
@@ -17,17 +18,60 @@
 #include <ggl/recipe.h>
 #include <ggl/vector.h>
 #include <string.h>
+#include <unistd.h>
 #include <stdbool.h>
 #include <stdint.h>
 
 #define MAX_UNIT_FILE_BUF_SIZE 2048
 #define MAX_COMPONENT_FILE_NAME 1024
 
+// Exists from before a unit file is written until systemd reloads it, so a
+// crash in between does not leave systemd running a stale unit.
+#define RELOAD_PENDING_FILE "ggl.daemon-reload-pending"
+
+static bool unit_file_matches(GglBuffer file_path, GglBuffer content) {
+    static uint8_t existing_mem[MAX_UNIT_FILE_BUF_SIZE + 1];
+    GglBuffer existing = GGL_BUF(existing_mem);
+    GglError ret = ggl_file_read_path(file_path, &existing);
+    return (ret == GGL_ERR_OK) && ggl_buffer_eq(existing, content);
+}
+
+static GglError mark_reload_pending(int root_path_fd) {
+    int fd = -1;
+    GglError ret = ggl_file_openat(
+        root_path_fd,
+        GGL_STR(RELOAD_PENDING_FILE),
+        O_WRONLY | O_CREAT | O_CLOEXEC,
+        0644,
+        &fd
+    );
+    if (ret != GGL_ERR_OK) {
+        GGL_LOGE("Failed to create daemon-reload marker.");
+        return ret;
+    }
+    (void) ggl_close(fd);
+    return GGL_ERR_OK;
+}
+
+static bool reload_pending(int root_path_fd) {
+    return faccessat(root_path_fd, RELOAD_PENDING_FILE, F_OK, 0) == 0;
+}
+
+GglError clear_unit_reload_pending(int root_path_fd) {
+    if ((unlinkat(root_path_fd, RELOAD_PENDING_FILE, 0) != 0)
+        && (errno != ENOENT)) {
+        GGL_LOGE("Failed to remove daemon-reload marker: %d.", errno);
+        return GGL_ERR_FAILURE;
+    }
+    return GGL_ERR_OK;
+}
+
 static GglError create_unit_file(
     Recipe2UnitArgs *args,
     GglObject **component_name,
     PhaseSelection phase,
-    GglBuffer *response_buffer
+    GglBuffer *response_buffer,
+    HasPhase *existing_phases
 ) {
     static uint8_t file_name_array[MAX_COMPONENT_FILE_NAME];
     GglBuffer file_name_buffer = (GglBuffer
@@ -61,6 +105,25 @@ static GglError create_unit_file(
         return ret;
     }
 
+    // Leave unchanged units untouched so systemd need not reload them
+    if (unit_file_matches(file_name_vector.buf, *response_buffer)) {
+        GGL_LOGD(
+            "Unit file %.*s is up to date.",
+            (int) file_name_vector.buf.len,
+            file_name_vector.buf.data
+        );
+        return GGL_ERR_OK;
+    }
+
+    ret = mark_reload_pending(args->root_path_fd);
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+    existing_phases->units_changed = true;
+    if (phase == RUN_STARTUP) {
+        existing_phases->restart_needed = true;
+    }
+
     int fd = -1;
     ret = ggl_file_open(
         file_name_vector.buf, O_WRONLY | O_CREAT | O_TRUNC, 0644, &fd
@@ -95,6 +158,11 @@ GglError convert_to_unit(
         return ret;
     }
 
+    if (reload_pending(args->root_path_fd)) {
+        GGL_LOGD("Unit files from an earlier run have not been reloaded.");
+        existing_phases->units_changed = true;
+    }
+
     ret = ggl_recipe_get_from_file(
         args->root_path_fd,
         args->component_name,
@@ -134,7 +202,11 @@ GglError convert_to_unit(
         return ret;
     } else {
         ret = create_unit_file(
-            args, component_name, BOOTSTRAP, &bootstrap_response_buffer
+            args,
+            component_name,
+            BOOTSTRAP,
+            &bootstrap_response_buffer,
+            existing_phases
         );
         if (ret != GGL_ERR_OK) {
             GGL_LOGE("Failed to create the bootstrap unit file.");
@@ -164,7 +236,11 @@ GglError convert_to_unit(
         return ret;
     } else {
         ret = create_unit_file(
-            args, component_name, INSTALL, &install_response_buffer
+            args,
+            component_name,
+            INSTALL,
+            &install_response_buffer,
+            existing_phases
         );
         if (ret != GGL_ERR_OK) {
             GGL_LOGE("Failed to create the install unit file.");
@@ -186,7 +262,11 @@ GglError convert_to_unit(
         return ret;
     } else {
         ret = create_unit_file(
-            args, component_name, RUN_STARTUP, &run_startup_response_buffer
+            args,
+            component_name,
+            RUN_STARTUP,
+            &run_startup_response_buffer,
+            existing_phases
         );
         if (ret != GGL_ERR_OK) {
             GGL_LOGE("Failed to create the run or startup unit file.");
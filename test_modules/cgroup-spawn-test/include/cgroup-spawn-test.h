@@ -0,0 +1,12 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CGROUP_SPAWN_TEST_H
+#define CGROUP_SPAWN_TEST_H
+
+#include <ggl/error.h>
+
+GglError run_cgroup_spawn_test(void);
+
+#endif
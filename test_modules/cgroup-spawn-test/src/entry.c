@@ -0,0 +1,109 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+//! Spawns commands and forks directly into a new cgroup v2 directory, and
+//! checks that the children start in it. Must run on a cgroup v2 host (a
+//! unified hierarchy or the unified part of a hybrid one) with permission to
+//! create cgroups.
+
+#include "cgroup-spawn-test.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <ggl/error.h>
+#include <ggl/exec.h>
+#include <ggl/log.h>
+#include <ggl/test_check.h>
+#include <limits.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+static char cgroup[64];
+static char cgroup_dir[PATH_MAX];
+
+static GglError make_cgroup(void) {
+    static const char *const MOUNTS[] = { "/sys/fs/cgroup",
+                                          "/sys/fs/cgroup/unified" };
+    snprintf(cgroup, sizeof(cgroup), "/ggl-cgroup-spawn-test-%d", getpid());
+    for (size_t i = 0; i < sizeof(MOUNTS) / sizeof(MOUNTS[0]); i++) {
+        char controllers[PATH_MAX];
+        snprintf(
+            controllers, sizeof(controllers), "%s/cgroup.controllers", MOUNTS[i]
+        );
+        if (access(controllers, F_OK) != 0) {
+            continue;
+        }
+        snprintf(cgroup_dir, sizeof(cgroup_dir), "%s%s", MOUNTS[i], cgroup);
+        if (mkdir(cgroup_dir, 0755) == 0) {
+            return GGL_ERR_OK;
+        }
+        GGL_LOGE("Failed to create %s: %d.", cgroup_dir, errno);
+        return GGL_ERR_FAILURE;
+    }
+    GGL_LOGE("No cgroup v2 hierarchy mounted.");
+    return GGL_ERR_UNSUPPORTED;
+}
+
+static void test_command(int cgroup_fd) {
+    char expected[128];
+    snprintf(expected, sizeof(expected), "0::%s", cgroup);
+    const char *args[]
+        = { "grep", "-qx", expected, "/proc/self/cgroup", NULL };
+    GGL_CHECK(ggl_exec_command_in_cgroup(args, cgroup_fd) == GGL_ERR_OK);
+
+    // A failing command is reported
+    const char *fail_args[] = { "false", NULL };
+    GGL_CHECK(ggl_exec_command_in_cgroup(fail_args, cgroup_fd) != GGL_ERR_OK);
+
+    GGL_CHECK(ggl_exec_command_in_cgroup(args, -1) == GGL_ERR_INVALID);
+}
+
+static void test_fork(int cgroup_fd) {
+    pid_t pid = -1;
+    GglError ret = ggl_exec_fork_in_cgroup(cgroup_fd, &pid);
+    GGL_CHECK(ret == GGL_ERR_OK);
+    if (ret != GGL_ERR_OK) {
+        return;
+    }
+    if (pid == 0) {
+        static char cgroups[4096];
+        int fd = open("/proc/self/cgroup", O_RDONLY | O_CLOEXEC);
+        ssize_t len = (fd < 0) ? -1 : read(fd, cgroups, sizeof(cgroups) - 1);
+        char expected[128];
+        snprintf(expected, sizeof(expected), "0::%s\n", cgroup);
+        // Only the last line is the v2 hierarchy on hybrid hosts
+        _exit(((len > 0) && (strstr(cgroups, expected) != NULL)) ? 0 : 1);
+    }
+
+    int status = 0;
+    GGL_CHECK(waitpid(pid, &status, 0) == pid);
+    GGL_CHECK(WIFEXITED(status) && (WEXITSTATUS(status) == 0));
+}
+
+GglError run_cgroup_spawn_test(void) {
+    GglError ret = make_cgroup();
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+    int cgroup_fd = open(cgroup_dir, O_PATH | O_DIRECTORY | O_CLOEXEC);
+    GGL_CHECK(cgroup_fd >= 0);
+    if (cgroup_fd >= 0) {
+        test_command(cgroup_fd);
+        test_fork(cgroup_fd);
+        (void) close(cgroup_fd);
+    }
+    // Fails if any child was left in the cgroup
+    GGL_CHECK(rmdir(cgroup_dir) == 0);
+
+    if (!ggl_check_passed()) {
+        return GGL_ERR_FAILURE;
+    }
+    GGL_LOGI("All cgroup spawn checks passed.");
+    return GGL_ERR_OK;
+}
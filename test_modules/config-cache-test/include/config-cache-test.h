@@ -0,0 +1,12 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CONFIG_CACHE_TEST_H
+#define CONFIG_CACHE_TEST_H
+
+#include <ggl/error.h>
+
+GglError run_config_cache_test(void);
+
+#endif
@@ -0,0 +1,201 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+//! Checks gg_config read cache consistency against a running ggconfigd.
+//! Changes made through this library must be visible to the next read.
+//! Changes made by other processes, simulated by calling ggconfigd directly,
+//! must become visible once ggconfigd's notification arrives.
+
+#include "config-cache-test.h"
+#include <ggl/arena.h>
+#include <ggl/buffer.h>
+#include <ggl/core_bus/client.h>
+#include <ggl/core_bus/gg_config.h>
+#include <ggl/error.h>
+#include <ggl/log.h>
+#include <ggl/object.h>
+#include <time.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// Time allowed for a ggconfigd notification to invalidate the cache.
+#define NOTIFY_DEADLINE_MS 2000
+
+static GglBuffer test_key[] = {
+    GGL_STR("services"),
+    GGL_STR("configCacheTest"),
+    GGL_STR("accessControl"),
+};
+
+static const GglBufList PREFIX_PATH = { .bufs = test_key, .len = 2 };
+static const GglBufList KEY_PATH = { .bufs = test_key, .len = 3 };
+
+static GglError remote_call(GglBuffer method, GglMap args) {
+    GglError remote_err = GGL_ERR_OK;
+    GglError ret
+        = ggl_call(GGL_STR("gg_config"), method, args, &remote_err, NULL, NULL);
+    if ((ret == GGL_ERR_REMOTE) && (remote_err != GGL_ERR_OK)) {
+        ret = remote_err;
+    }
+    return ret;
+}
+
+static GglList key_path_list(GglBufList key_path, GglObject *items) {
+    for (size_t i = 0; i < key_path.len; i++) {
+        items[i] = ggl_obj_buf(key_path.bufs[i]);
+    }
+    return (GglList) { .items = items, .len = key_path.len };
+}
+
+// Write without going through the cache, as another process would
+static GglError remote_write(GglBufList key_path, GglBuffer value) {
+    GglObject items[GGL_MAX_OBJECT_DEPTH];
+    return remote_call(
+        GGL_STR("write"),
+        GGL_MAP(
+            ggl_kv(
+                GGL_STR("key_path"),
+                ggl_obj_list(key_path_list(key_path, items))
+            ),
+            ggl_kv(GGL_STR("value"), ggl_obj_buf(value))
+        )
+    );
+}
+
+// Delete without going through the cache, as another process would
+static GglError remote_delete(GglBufList key_path) {
+    GglObject items[GGL_MAX_OBJECT_DEPTH];
+    return remote_call(
+        GGL_STR("delete"),
+        GGL_MAP(ggl_kv(
+            GGL_STR("key_path"), ggl_obj_list(key_path_list(key_path, items))
+        ))
+    );
+}
+
+// Read the test key; value is empty if the key does not exist
+static GglError read_key(GglBuffer *value) {
+    static uint8_t mem[256];
+    GglArena alloc = ggl_arena_init(GGL_BUF(mem));
+    GglError ret = ggl_gg_config_read_str(KEY_PATH, &alloc, value);
+    if (ret == GGL_ERR_NOENTRY) {
+        *value = GGL_STR("");
+        return GGL_ERR_OK;
+    }
+    return ret;
+}
+
+static GglError expect_now(GglBuffer expected, const char *step) {
+    GglBuffer value;
+    GglError ret = read_key(&value);
+    if (ret != GGL_ERR_OK) {
+        GGL_LOGE("%s: read failed: %s.", step, ggl_strerror(ret));
+        return ret;
+    }
+    if (!ggl_buffer_eq(value, expected)) {
+        GGL_LOGE(
+            "%s: read \"%.*s\", expected \"%.*s\".",
+            step,
+            (int) value.len,
+            value.data,
+            (int) expected.len,
+            expected.data
+        );
+        return GGL_ERR_FAILURE;
+    }
+    GGL_LOGI("%s: ok.", step);
+    return GGL_ERR_OK;
+}
+
+static GglError expect_eventually(GglBuffer expected, const char *step) {
+    for (int waited_ms = 0; waited_ms < NOTIFY_DEADLINE_MS; waited_ms += 10) {
+        GglBuffer value;
+        GglError ret = read_key(&value);
+        if (ret != GGL_ERR_OK) {
+            return ret;
+        }
+        if (ggl_buffer_eq(value, expected)) {
+            GGL_LOGI("%s: ok after %d ms.", step, waited_ms);
+            return GGL_ERR_OK;
+        }
+        nanosleep(&(struct timespec) { .tv_nsec = 10000000 }, NULL);
+    }
+    return expect_now(expected, step);
+}
+
+GglError run_config_cache_test(void) {
+    GglError ret = remote_write(KEY_PATH, GGL_STR("v1"));
+    if (ret != GGL_ERR_OK) {
+        GGL_LOGE("Failed to write initial value: %s.", ggl_strerror(ret));
+        return ret;
+    }
+
+    ret = ggl_gg_config_cache_enable(PREFIX_PATH);
+    if (ret != GGL_ERR_OK) {
+        GGL_LOGE("Failed to enable cache: %s.", ggl_strerror(ret));
+        return ret;
+    }
+
+    GglGgConfigCacheStats before;
+    ggl_gg_config_cache_stats(&before);
+    ret = expect_now(GGL_STR("v1"), "Initial read");
+    if (ret == GGL_ERR_OK) {
+        ret = expect_now(GGL_STR("v1"), "Cached read");
+    }
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+    GglGgConfigCacheStats after;
+    ggl_gg_config_cache_stats(&after);
+    if (after.hits == before.hits) {
+        GGL_LOGE("Repeated read was not served from the cache.");
+        return GGL_ERR_FAILURE;
+    }
+
+    ret = ggl_gg_config_write(KEY_PATH, ggl_obj_buf(GGL_STR("v2")), NULL);
+    if (ret == GGL_ERR_OK) {
+        ret = expect_now(GGL_STR("v2"), "Read after local write");
+    }
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
+    ret = remote_write(KEY_PATH, GGL_STR("v3"));
+    if (ret == GGL_ERR_OK) {
+        ret = expect_eventually(GGL_STR("v3"), "Read after remote write");
+    }
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
+    // Deleting the parent must invalidate cached reads of its children
+    ret = remote_delete(PREFIX_PATH);
+    if (ret == GGL_ERR_OK) {
+        ret = expect_eventually(GGL_STR(""), "Read after remote delete");
+    }
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
+    ret = remote_write(KEY_PATH, GGL_STR("v4"));
+    if (ret == GGL_ERR_OK) {
+        ret = expect_eventually(GGL_STR("v4"), "Read after re-create");
+    }
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
+    ret = ggl_gg_config_delete(KEY_PATH);
+    if (ret == GGL_ERR_OK) {
+        ret = expect_now(GGL_STR(""), "Read after local delete");
+    }
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
+    (void) remote_delete(PREFIX_PATH);
+    GGL_LOGI("Config cache reads stayed consistent.");
+    return GGL_ERR_OK;
+}
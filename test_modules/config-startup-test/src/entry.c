@@ -0,0 +1,261 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+//! Imports a directory of config files into a fresh ggconfigd database, then
+//! imports it again as on a later startup. Reports the time of each import,
+//! and checks that unchanged files are skipped while changed files are
+//! merged again. One file has far more values than the others, and a file
+//! that fails to parse must not stop the rest from being imported.
+
+#include "config-startup-test.h"
+#include "ggconfigd.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <ggl/buffer.h>
+#include <ggl/error.h>
+#include <ggl/log.h>
+#include <ggl/object.h>
+#include <ggl/test_check.h>
+#include <limits.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CONFIG_FILES 50
+#define KEYS_PER_FILE 20
+// Written as an extra file; well above the 500 objects ggconfigd could once
+// decode from one file
+#define LARGE_FILE CONFIG_FILES
+#define LARGE_FILE_KEYS 5000
+
+static char config_dir[PATH_MAX];
+
+static void file_path(size_t file, char *path, size_t len) {
+    snprintf(path, len, "%s/component%02zu.yaml", config_dir, file);
+}
+
+static void broken_file_path(char *path, size_t len) {
+    snprintf(path, len, "%s/broken.yaml", config_dir);
+}
+
+static size_t file_keys(size_t file) {
+    return (file == LARGE_FILE) ? LARGE_FILE_KEYS : KEYS_PER_FILE;
+}
+
+static bool set_mtime(const char *path, time_t mtime_s) {
+    struct timespec times[2] = { { .tv_nsec = UTIME_OMIT },
+                                 { .tv_sec = mtime_s } };
+    return utimensat(AT_FDCWD, path, times, 0) == 0;
+}
+
+/// Writes a config file and sets its mtime to `mtime_s`.
+static bool write_config_file(size_t file, const char *prefix, time_t mtime_s) {
+    char path[PATH_MAX];
+    file_path(file, path, sizeof(path));
+    FILE *out = fopen(path, "we");
+    if (out == NULL) {
+        GGL_LOGE("Failed to create config file: %d.", errno);
+        return false;
+    }
+    fprintf(
+        out,
+        "services:\n  com.example.Component%02zu:\n    configuration:\n",
+        file
+    );
+    for (size_t key = 0; key < file_keys(file); key++) {
+        fprintf(
+            out, "      key%02zu: %s-%02zu-%02zu\n", key, prefix, file, key
+        );
+    }
+    if (fclose(out) != 0) {
+        return false;
+    }
+    return set_mtime(path, mtime_s);
+}
+
+/// Key path of a key written by write_config_file.
+/// Valid until the next call.
+static GglList config_key_path(size_t file, size_t key) {
+    static char component[64];
+    static char key_name[16];
+    static GglObject items[4];
+    snprintf(component, sizeof(component), "com.example.Component%02zu", file);
+    snprintf(key_name, sizeof(key_name), "key%02zu", key);
+
+    items[0] = ggl_obj_buf(GGL_STR("services"));
+    items[1] = ggl_obj_buf(ggl_buffer_from_null_term(component));
+    items[2] = ggl_obj_buf(GGL_STR("configuration"));
+    items[3] = ggl_obj_buf(ggl_buffer_from_null_term(key_name));
+    return (GglList) { .items = items, .len = 4 };
+}
+
+static GglError read_key(size_t file, size_t key, GglBuffer *value) {
+    GglList key_path = config_key_path(file, key);
+    GglObject result;
+    GglError ret = ggconfig_get_value_from_key(&key_path, &result);
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+    if (ggl_obj_type(result) != GGL_TYPE_BUF) {
+        return GGL_ERR_PARSE;
+    }
+    *value = ggl_obj_into_buf(result);
+    return GGL_ERR_OK;
+}
+
+static bool key_is(size_t file, size_t key, const char *expected) {
+    GglBuffer value;
+    return (read_key(file, key, &value) == GGL_ERR_OK)
+        && ggl_buffer_eq(value, ggl_buffer_from_null_term((char *) expected));
+}
+
+/// Overwrites a key in the database, as a config update at runtime would.
+static void edit_key(size_t file, size_t key) {
+    GglList key_path = config_key_path(file, key);
+    // Values are stored as JSON; same timestamp as file imports
+    GglBuffer value = GGL_STR("\"edited\"");
+    GGL_CHECK(ggconfig_write_value_at_key(&key_path, &value, 2) == GGL_ERR_OK);
+}
+
+static int64_t timed_load_dir(void) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    GGL_CHECK(
+        ggconfig_load_dir(ggl_buffer_from_null_term(config_dir)) == GGL_ERR_OK
+    );
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return ((int64_t) (end.tv_sec - start.tv_sec) * 1000000000)
+        + (end.tv_nsec - start.tv_nsec);
+}
+
+static void test_startup_import(void) {
+    time_t mtime = 1000000000;
+    for (size_t file = 0; file < CONFIG_FILES; file++) {
+        GGL_CHECK(write_config_file(file, "value", mtime));
+    }
+
+    int64_t first_ns = timed_load_dir();
+    GGL_CHECK(key_is(0, 0, "value-00-00"));
+    GGL_CHECK(key_is(CONFIG_FILES - 1, KEYS_PER_FILE - 1, "value-49-19"));
+
+    GGL_CHECK(write_config_file(LARGE_FILE, "value", mtime));
+    int64_t large_ns = timed_load_dir();
+    GGL_CHECK(key_is(LARGE_FILE, 0, "value-50-00"));
+    GGL_CHECK(key_is(LARGE_FILE, LARGE_FILE_KEYS - 1, "value-50-4999"));
+
+    // Runtime edits survive a restart with unchanged config files
+    edit_key(0, 0);
+    edit_key(1, 0);
+    edit_key(2, 0);
+    int64_t second_ns = timed_load_dir();
+    GGL_CHECK(key_is(0, 0, "edited"));
+    GGL_CHECK(key_is(1, 0, "edited"));
+    GGL_CHECK(key_is(2, 0, "edited"));
+
+    GGL_LOGI(
+        "Importing %d config files took %ld us; unchanged files took %ld us.",
+        CONFIG_FILES,
+        (long) (first_ns / 1000),
+        (long) (second_ns / 1000)
+    );
+    GGL_LOGI(
+        "Importing a file with %d values took %ld us.",
+        LARGE_FILE_KEYS,
+        (long) (large_ns / 1000)
+    );
+
+    // A touched file with the same content is not merged again, but its
+    // new mtime is recorded
+    char path[PATH_MAX];
+    file_path(1, path, sizeof(path));
+    GGL_CHECK(set_mtime(path, mtime + 10));
+    // A changed file is merged, even at the same size
+    GGL_CHECK(write_config_file(2, "VALUE", mtime + 10));
+    (void) timed_load_dir();
+
+    GGL_CHECK(key_is(1, 0, "edited"));
+    GgconfigImportState state;
+    GGL_CHECK(
+        ggconfig_get_import_state(ggl_buffer_from_null_term(path), &state)
+        == GGL_ERR_OK
+    );
+    GGL_CHECK(state.mtime == (int64_t) (mtime + 10) * 1000000000);
+    GGL_CHECK(key_is(2, 0, "VALUE-02-00"));
+    GGL_CHECK(key_is(2, 1, "VALUE-02-01"));
+}
+
+/// A file that fails to parse is reported, and the other files are still
+/// imported.
+static void test_broken_file(void) {
+    char path[PATH_MAX];
+    broken_file_path(path, sizeof(path));
+    FILE *out = fopen(path, "we");
+    GGL_CHECK(out != NULL);
+    if (out == NULL) {
+        return;
+    }
+    fprintf(out, "services: [unterminated\n");
+    GGL_CHECK(fclose(out) == 0);
+
+    GGL_CHECK(write_config_file(3, "AFTER", 1000000100));
+    GGL_CHECK(
+        ggconfig_load_dir(ggl_buffer_from_null_term(config_dir)) != GGL_ERR_OK
+    );
+    GGL_CHECK(key_is(3, 0, "AFTER-03-00"));
+
+    (void) unlink(path);
+}
+
+static void remove_config_dir(void) {
+    char path[PATH_MAX];
+    for (size_t file = 0; file <= LARGE_FILE; file++) {
+        file_path(file, path, sizeof(path));
+        (void) unlink(path);
+    }
+    broken_file_path(path, sizeof(path));
+    (void) unlink(path);
+    (void) rmdir(config_dir);
+}
+
+GglError run_config_startup_test(void) {
+    char dir[] = "/tmp/ggl-config-startup-test-XXXXXX";
+    if (mkdtemp(dir) == NULL) {
+        GGL_LOGE("Failed to create test directory: %d.", errno);
+        return GGL_ERR_FAILURE;
+    }
+    // ggconfigd opens its database in the working directory
+    if (chdir(dir) != 0) {
+        GGL_LOGE("Failed to enter test directory: %d.", errno);
+        return GGL_ERR_FAILURE;
+    }
+    snprintf(config_dir, sizeof(config_dir), "%s/config", dir);
+    if (mkdir(config_dir, 0700) != 0) {
+        GGL_LOGE("Failed to create config directory: %d.", errno);
+        return GGL_ERR_FAILURE;
+    }
+
+    GglError ret = ggconfig_open();
+    if (ret == GGL_ERR_OK) {
+        test_startup_import();
+        test_broken_file();
+        (void) ggconfig_close();
+    }
+
+    remove_config_dir();
+    (void) unlink("config.db");
+    (void) rmdir(dir);
+
+    if ((ret != GGL_ERR_OK) || !ggl_check_passed()) {
+        return GGL_ERR_FAILURE;
+    }
+    GGL_LOGI("All config startup checks passed.");
+    return GGL_ERR_OK;
+}
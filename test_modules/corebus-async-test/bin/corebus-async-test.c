@@ -0,0 +1,16 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "corebus-async-test.h"
+#include <ggl/error.h>
+#include <ggl/nucleus/init.h>
+
+int main(void) {
+    ggl_nucleus_init();
+
+    GglError ret = run_corebus_async_test();
+    if (ret != GGL_ERR_OK) {
+        return 1;
+    }
+}
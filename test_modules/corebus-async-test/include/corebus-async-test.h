@@ -0,0 +1,12 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef COREBUS_ASYNC_TEST_H
+#define COREBUS_ASYNC_TEST_H
+
+#include <ggl/error.h>
+
+GglError run_corebus_async_test(void);
+
+#endif
@@ -0,0 +1,256 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+//! Runs a core-bus server on a thread and checks ggl_call_async against it:
+//! many calls in flight at once, server errors, and results too large for
+//! the client's decode buffer.
+
+#include "corebus-async-test.h"
+#include <ggl/buffer.h>
+#include <ggl/cleanup.h>
+#include <ggl/core_bus/client.h>
+#include <ggl/core_bus/server.h>
+#include <ggl/error.h>
+#include <ggl/log.h>
+#include <ggl/map.h>
+#include <ggl/object.h>
+#include <ggl/test_check.h>
+#include <pthread.h>
+#include <time.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define INTERFACE "corebus_async_test"
+/// Calls in flight at once; below GGL_COREBUS_CLIENT_MAX_SUBSCRIPTIONS
+#define PARALLEL_CALLS 64
+#define MAX_LIST_LEN 200
+#define RESULT_TIMEOUT_S 5
+
+static GglError echo_handler(void *ctx, GglMap params, uint32_t handle) {
+    (void) ctx;
+    ggl_respond(handle, ggl_obj_map(params));
+    return GGL_ERR_OK;
+}
+
+/// Responds with a list of `count` integers.
+static GglError list_handler(void *ctx, GglMap params, uint32_t handle) {
+    (void) ctx;
+    GglObject *count_obj = NULL;
+    if (!ggl_map_get(params, GGL_STR("count"), &count_obj)
+        || (ggl_obj_type(*count_obj) != GGL_TYPE_I64)) {
+        return GGL_ERR_INVALID;
+    }
+    int64_t count = ggl_obj_into_i64(*count_obj);
+    if ((count < 0) || (count > MAX_LIST_LEN)) {
+        return GGL_ERR_RANGE;
+    }
+
+    static GglObject items[MAX_LIST_LEN];
+    for (int64_t i = 0; i < count; i++) {
+        items[i] = ggl_obj_i64(i);
+    }
+    ggl_respond(
+        handle,
+        ggl_obj_list((GglList) { .items = items, .len = (size_t) count })
+    );
+    return GGL_ERR_OK;
+}
+
+static GglError fail_handler(void *ctx, GglMap params, uint32_t handle) {
+    (void) ctx;
+    (void) params;
+    (void) handle;
+    return GGL_ERR_NOENTRY;
+}
+
+static void *server_thread(void *arg) {
+    (void) arg;
+    static GglRpcMethodDesc handlers[] = {
+        { GGL_STR("echo"), false, echo_handler, NULL },
+        { GGL_STR("list"), false, list_handler, NULL },
+        { GGL_STR("fail"), false, fail_handler, NULL },
+    };
+    GglError ret = ggl_listen(
+        GGL_STR(INTERFACE), handlers, sizeof(handlers) / sizeof(handlers[0])
+    );
+    GGL_LOGE("Test server exited: %d.", (int) ret);
+    return NULL;
+}
+
+static pthread_mutex_t result_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t result_cond = PTHREAD_COND_INITIALIZER;
+
+typedef struct {
+    int64_t id;
+    size_t calls;
+    GglError err;
+    /// Echoed id or list length
+    int64_t value;
+} CallResult;
+
+static size_t results_pending = 0;
+
+static void on_result(void *ctx, uint32_t handle, GglError err, GglObject obj) {
+    (void) handle;
+    CallResult *result = ctx;
+
+    int64_t value = -1;
+    if ((err == GGL_ERR_OK) && (ggl_obj_type(obj) == GGL_TYPE_MAP)) {
+        GglObject *id = NULL;
+        if (ggl_map_get(ggl_obj_into_map(obj), GGL_STR("id"), &id)
+            && (ggl_obj_type(*id) == GGL_TYPE_I64)) {
+            value = ggl_obj_into_i64(*id);
+        }
+    } else if ((err == GGL_ERR_OK) && (ggl_obj_type(obj) == GGL_TYPE_LIST)) {
+        value = (int64_t) ggl_obj_into_list(obj).len;
+    }
+
+    GGL_MTX_SCOPE_GUARD(&result_mtx);
+    result->calls += 1;
+    result->err = err;
+    result->value = value;
+    results_pending -= 1;
+    pthread_cond_broadcast(&result_cond);
+}
+
+/// Wait until every started call has reported its result.
+static bool wait_for_results(void) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += RESULT_TIMEOUT_S;
+
+    GGL_MTX_SCOPE_GUARD(&result_mtx);
+    while (results_pending > 0) {
+        if (pthread_cond_timedwait(&result_cond, &result_mtx, &deadline)
+            != 0) {
+            GGL_LOGE("%zu async calls did not complete.", results_pending);
+            return false;
+        }
+    }
+    return true;
+}
+
+static GglError start_call(
+    const char *method, GglMap params, CallResult *result
+) {
+    {
+        GGL_MTX_SCOPE_GUARD(&result_mtx);
+        results_pending += 1;
+    }
+    GglError ret = ggl_call_async(
+        GGL_STR(INTERFACE),
+        ggl_buffer_from_null_term((char *) method),
+        params,
+        on_result,
+        result,
+        NULL
+    );
+    if (ret != GGL_ERR_OK) {
+        GGL_MTX_SCOPE_GUARD(&result_mtx);
+        results_pending -= 1;
+    }
+    return ret;
+}
+
+static GglError wait_for_server(void) {
+    for (int i = 0; i < 200; i++) {
+        GglError err = GGL_ERR_OK;
+        GglError ret = ggl_call(
+            GGL_STR(INTERFACE), GGL_STR("echo"), GGL_MAP(), &err, NULL, NULL
+        );
+        if (ret == GGL_ERR_OK) {
+            return GGL_ERR_OK;
+        }
+        struct timespec delay = { .tv_nsec = 10000000 };
+        nanosleep(&delay, NULL);
+    }
+    GGL_LOGE("Test server did not start.");
+    return GGL_ERR_NOCONN;
+}
+
+static void test_parallel_calls(void) {
+    static CallResult results[PARALLEL_CALLS];
+    for (size_t i = 0; i < PARALLEL_CALLS; i++) {
+        results[i] = (CallResult) { .id = (int64_t) i };
+        GglError ret = start_call(
+            "echo",
+            GGL_MAP(ggl_kv(GGL_STR("id"), ggl_obj_i64(results[i].id))),
+            &results[i]
+        );
+        GGL_CHECK(ret == GGL_ERR_OK);
+    }
+    GGL_CHECK(wait_for_results());
+
+    GGL_MTX_SCOPE_GUARD(&result_mtx);
+    for (size_t i = 0; i < PARALLEL_CALLS; i++) {
+        GGL_CHECK(results[i].calls == 1);
+        GGL_CHECK(results[i].err == GGL_ERR_OK);
+        GGL_CHECK(results[i].value == results[i].id);
+    }
+}
+
+static void test_errors(void) {
+    static CallResult fits;
+    static CallResult too_large;
+    static CallResult failed;
+    static CallResult missing;
+
+    GGL_CHECK(
+        start_call(
+            "list",
+            GGL_MAP(ggl_kv(GGL_STR("count"), ggl_obj_i64(10))),
+            &fits
+        )
+        == GGL_ERR_OK
+    );
+    GGL_CHECK(
+        start_call(
+            "list",
+            GGL_MAP(ggl_kv(GGL_STR("count"), ggl_obj_i64(MAX_LIST_LEN))),
+            &too_large
+        )
+        == GGL_ERR_OK
+    );
+    GGL_CHECK(start_call("fail", GGL_MAP(), &failed) == GGL_ERR_OK);
+    GGL_CHECK(start_call("missing", GGL_MAP(), &missing) == GGL_ERR_OK);
+    GGL_CHECK(wait_for_results());
+
+    GGL_MTX_SCOPE_GUARD(&result_mtx);
+    GGL_CHECK((fits.calls == 1) && (fits.err == GGL_ERR_OK));
+    GGL_CHECK(fits.value == 10);
+    // Exceeds GGL_COREBUS_CLIENT_MAX_RESPONSE_OBJECTS
+    GGL_CHECK((too_large.calls == 1) && (too_large.err == GGL_ERR_NOMEM));
+    GGL_CHECK((failed.calls == 1) && (failed.err == GGL_ERR_NOENTRY));
+    GGL_CHECK((missing.calls == 1) && (missing.err != GGL_ERR_OK));
+}
+
+GglError run_corebus_async_test(void) {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, server_thread, NULL) != 0) {
+        return GGL_ERR_FAILURE;
+    }
+    pthread_detach(thread);
+
+    GglError ret = wait_for_server();
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
+    GGL_CHECK(
+        ggl_call_async(
+            GGL_STR(INTERFACE), GGL_STR("echo"), GGL_MAP(), NULL, NULL, NULL
+        )
+        == GGL_ERR_INVALID
+    );
+
+    test_parallel_calls();
+    test_errors();
+
+    if (!ggl_check_passed()) {
+        return GGL_ERR_FAILURE;
+    }
+    GGL_LOGI("All async call checks passed.");
+    return GGL_ERR_OK;
+}
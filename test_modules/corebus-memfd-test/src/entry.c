@@ -0,0 +1,190 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+//! Runs a core-bus server on a thread and echoes payloads from 1 KiB up to
+//! the memfd limit. Checks that each payload arrives intact, that payloads
+//! over the limit are rejected, and that no memfds are leaked. Reports the
+//! round trip time for each size.
+
+#include "corebus-memfd-test.h"
+#include <dirent.h>
+#include <ggl/arena.h>
+#include <ggl/buffer.h>
+#include <ggl/core_bus/client.h>
+#include <ggl/core_bus/constants.h>
+#include <ggl/core_bus/server.h>
+#include <ggl/error.h>
+#include <ggl/log.h>
+#include <ggl/map.h>
+#include <ggl/object.h>
+#include <ggl/test_check.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define INTERFACE "corebus_memfd_test"
+/// Room left in the memfd for the encoding of the map around the data
+#define PAYLOAD_OVERHEAD 1024
+#define MAX_DATA_LEN (GGL_COREBUS_MAX_MEMFD_LEN - PAYLOAD_OVERHEAD)
+#define ROUNDS 5
+
+static GglError echo_handler(void *ctx, GglMap params, uint32_t handle) {
+    (void) ctx;
+    ggl_respond(handle, ggl_obj_map(params));
+    return GGL_ERR_OK;
+}
+
+static void *server_thread(void *arg) {
+    (void) arg;
+    static GglRpcMethodDesc handlers[] = {
+        { GGL_STR("echo"), false, echo_handler, NULL },
+    };
+    GglError ret = ggl_listen(
+        GGL_STR(INTERFACE), handlers, sizeof(handlers) / sizeof(handlers[0])
+    );
+    GGL_LOGE("Test server exited: %d.", (int) ret);
+    return NULL;
+}
+
+static GglError wait_for_server(void) {
+    for (int i = 0; i < 200; i++) {
+        GglError ret = ggl_call(
+            GGL_STR(INTERFACE), GGL_STR("echo"), GGL_MAP(), NULL, NULL, NULL
+        );
+        if (ret == GGL_ERR_OK) {
+            return GGL_ERR_OK;
+        }
+        struct timespec delay = { .tv_nsec = 10000000 };
+        nanosleep(&delay, NULL);
+    }
+    GGL_LOGE("Test server did not start.");
+    return GGL_ERR_NOCONN;
+}
+
+static size_t count_open_fds(void) {
+    DIR *dir = opendir("/proc/self/fd");
+    if (dir == NULL) {
+        return 0;
+    }
+    size_t count = 0;
+    while (readdir(dir) != NULL) {
+        count += 1;
+    }
+    (void) closedir(dir);
+    return count;
+}
+
+static uint8_t send_data[GGL_COREBUS_MAX_MEMFD_LEN + 1];
+static uint8_t result_mem[GGL_COREBUS_MAX_MEMFD_LEN];
+
+static GglError echo(size_t len) {
+    GglArena alloc = ggl_arena_init(GGL_BUF(result_mem));
+    GglObject result;
+    GglError ret = ggl_call(
+        GGL_STR(INTERFACE),
+        GGL_STR("echo"),
+        GGL_MAP(ggl_kv(
+            GGL_STR("data"),
+            ggl_obj_buf((GglBuffer) { .data = send_data, .len = len })
+        )),
+        NULL,
+        &alloc,
+        &result
+    );
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
+    GglObject *data = NULL;
+    bool intact = (ggl_obj_type(result) == GGL_TYPE_MAP)
+        && ggl_map_get(ggl_obj_into_map(result), GGL_STR("data"), &data)
+        && (ggl_obj_type(*data) == GGL_TYPE_BUF)
+        && ggl_buffer_eq(
+            ggl_obj_into_buf(*data),
+            (GglBuffer) { .data = send_data, .len = len }
+        );
+    GGL_CHECK(intact);
+    return GGL_ERR_OK;
+}
+
+static void test_sizes(void) {
+    static const size_t SIZES[] = {
+        1024,
+        4096,
+        // Just below and above GGL_COREBUS_MAX_MSG_LEN
+        GGL_COREBUS_MAX_MSG_LEN - 256,
+        GGL_COREBUS_MAX_MSG_LEN + 256,
+        64 * 1024,
+        1024 * 1024,
+        4 * 1024 * 1024,
+        MAX_DATA_LEN,
+    };
+
+    for (size_t i = 0; i < sizeof(SIZES) / sizeof(SIZES[0]); i++) {
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (size_t round = 0; round < ROUNDS; round++) {
+            GGL_CHECK(echo(SIZES[i]) == GGL_ERR_OK);
+        }
+        struct timespec end;
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        int64_t elapsed_ns
+            = ((int64_t) (end.tv_sec - start.tv_sec) * 1000000000)
+            + (end.tv_nsec - start.tv_nsec);
+        GGL_LOGI(
+            "%zu byte payload: %ld us per round trip.",
+            SIZES[i],
+            (long) (elapsed_ns / ROUNDS / 1000)
+        );
+    }
+}
+
+static void test_too_large(void) {
+    GGL_CHECK(echo(GGL_COREBUS_MAX_MEMFD_LEN + 1) == GGL_ERR_NOMEM);
+    // Later calls are unaffected
+    GGL_CHECK(echo(1024) == GGL_ERR_OK);
+}
+
+/// Server connections are released asynchronously, so allow some time.
+static void check_no_leaked_fds(size_t baseline) {
+    size_t count = count_open_fds();
+    for (int i = 0; (i < 100) && (count > baseline); i++) {
+        struct timespec delay = { .tv_nsec = 10000000 };
+        nanosleep(&delay, NULL);
+        count = count_open_fds();
+    }
+    GGL_CHECK(count <= baseline);
+}
+
+GglError run_corebus_memfd_test(void) {
+    for (size_t i = 0; i < sizeof(send_data); i++) {
+        send_data[i] = (uint8_t) ((i * 31U) ^ (i >> 12));
+    }
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, server_thread, NULL) != 0) {
+        return GGL_ERR_FAILURE;
+    }
+    pthread_detach(thread);
+
+    GglError ret = wait_for_server();
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+    size_t baseline = count_open_fds();
+
+    test_sizes();
+    test_too_large();
+    check_no_leaked_fds(baseline);
+
+    if (!ggl_check_passed()) {
+        return GGL_ERR_FAILURE;
+    }
+    GGL_LOGI("All memfd payload checks passed.");
+    return GGL_ERR_OK;
+}
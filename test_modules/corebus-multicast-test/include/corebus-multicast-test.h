@@ -0,0 +1,12 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef COREBUS_MULTICAST_TEST_H
+#define COREBUS_MULTICAST_TEST_H
+
+#include <ggl/error.h>
+
+GglError run_corebus_multicast_test(void);
+
+#endif
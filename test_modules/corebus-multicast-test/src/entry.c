@@ -0,0 +1,331 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+//! Runs a core-bus server on a thread and fans responses out to many
+//! subscriptions, with ggl_sub_respond_multicast and with one
+//! ggl_sub_respond per subscription. Reports the time per delivered
+//! response for each, and checks every subscriber receives intact responses
+//! in order, including a subscriber listed more than once.
+
+#include "corebus-multicast-test.h"
+#include <ggl/buffer.h>
+#include <ggl/cleanup.h>
+#include <ggl/core_bus/client.h>
+#include <ggl/core_bus/server.h>
+#include <ggl/error.h>
+#include <ggl/log.h>
+#include <ggl/map.h>
+#include <ggl/object.h>
+#include <ggl/test_check.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define INTERFACE "corebus_multicast_test"
+#define SUBSCRIBERS 32
+/// Largest response; above GGL_COREBUS_MAX_MSG_LEN so sent in a memfd
+#define MAX_DATA_LEN 65536
+#define RESULT_TIMEOUT_S 10
+
+// Server state; only used from the server thread
+static uint32_t sub_handles[SUBSCRIBERS + 1];
+static size_t sub_count = 0;
+
+static GglError subscribe_handler(void *ctx, GglMap params, uint32_t handle) {
+    (void) ctx;
+    (void) params;
+    if (sub_count >= SUBSCRIBERS) {
+        return GGL_ERR_NOMEM;
+    }
+    sub_handles[sub_count] = handle;
+    sub_count += 1;
+    ggl_sub_accept(handle, NULL, NULL);
+    return GGL_ERR_OK;
+}
+
+static int64_t get_i64(GglMap params, GglBuffer key) {
+    GglObject *value = NULL;
+    if (!ggl_map_get(params, key, &value)
+        || (ggl_obj_type(*value) != GGL_TYPE_I64)) {
+        return -1;
+    }
+    return ggl_obj_into_i64(*value);
+}
+
+static bool get_bool(GglMap params, GglBuffer key) {
+    GglObject *value = NULL;
+    return ggl_map_get(params, key, &value)
+        && (ggl_obj_type(*value) == GGL_TYPE_BOOLEAN)
+        && ggl_obj_into_bool(*value);
+}
+
+/// Sends `count` responses of `size` bytes to every subscription.
+/// With `duplicate`, the first subscription is listed twice.
+static GglError send_handler(void *ctx, GglMap params, uint32_t handle) {
+    (void) ctx;
+    static uint8_t data[MAX_DATA_LEN];
+
+    int64_t count = get_i64(params, GGL_STR("count"));
+    int64_t size = get_i64(params, GGL_STR("size"));
+    if ((count < 0) || (size < 0) || (size > MAX_DATA_LEN)) {
+        return GGL_ERR_RANGE;
+    }
+    bool multicast = get_bool(params, GGL_STR("multicast"));
+
+    size_t handles_len = sub_count;
+    if (get_bool(params, GGL_STR("duplicate")) && (sub_count > 0)) {
+        sub_handles[handles_len] = sub_handles[0];
+        handles_len += 1;
+    }
+
+    for (int64_t seq = 0; seq < count; seq++) {
+        memset(data, (int) (seq & 0xFF), (size_t) size);
+        GglObject response = ggl_obj_map(GGL_MAP(
+            ggl_kv(GGL_STR("seq"), ggl_obj_i64(seq)),
+            ggl_kv(
+                GGL_STR("data"),
+                ggl_obj_buf((GglBuffer) { .data = data, .len = (size_t) size })
+            )
+        ));
+        if (multicast) {
+            ggl_sub_respond_multicast(sub_handles, handles_len, response);
+        } else {
+            for (size_t i = 0; i < handles_len; i++) {
+                ggl_sub_respond(sub_handles[i], response);
+            }
+        }
+    }
+
+    ggl_respond(handle, GGL_OBJ_NULL);
+    return GGL_ERR_OK;
+}
+
+static void *server_thread(void *arg) {
+    (void) arg;
+    static GglRpcMethodDesc handlers[] = {
+        { GGL_STR("subscribe"), true, subscribe_handler, NULL },
+        { GGL_STR("send"), false, send_handler, NULL },
+    };
+    GglError ret = ggl_listen(
+        GGL_STR(INTERFACE), handlers, sizeof(handlers) / sizeof(handlers[0])
+    );
+    GGL_LOGE("Test server exited: %d.", (int) ret);
+    return NULL;
+}
+
+static pthread_mutex_t client_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t client_cond = PTHREAD_COND_INITIALIZER;
+
+typedef struct {
+    /// Copies of each response expected
+    size_t copies;
+    size_t received;
+    bool closed;
+} Subscriber;
+
+static Subscriber subscribers[SUBSCRIBERS];
+static size_t deliveries_pending = 0;
+
+static GglError on_response(void *ctx, uint32_t handle, GglObject data) {
+    (void) handle;
+    Subscriber *sub = ctx;
+
+    int64_t seq = -1;
+    GglBuffer buf = { 0 };
+    if (ggl_obj_type(data) == GGL_TYPE_MAP) {
+        GglMap map = ggl_obj_into_map(data);
+        seq = get_i64(map, GGL_STR("seq"));
+        GglObject *buf_obj = NULL;
+        if (ggl_map_get(map, GGL_STR("data"), &buf_obj)
+            && (ggl_obj_type(*buf_obj) == GGL_TYPE_BUF)) {
+            buf = ggl_obj_into_buf(*buf_obj);
+        }
+    }
+    bool intact = true;
+    for (size_t i = 0; i < buf.len; i++) {
+        intact = intact && (buf.data[i] == (uint8_t) (seq & 0xFF));
+    }
+
+    GGL_MTX_SCOPE_GUARD(&client_mtx);
+    // Copies of one response arrive together, and responses in order
+    GGL_CHECK(seq == (int64_t) (sub->received / sub->copies));
+    GGL_CHECK(intact);
+    sub->received += 1;
+    deliveries_pending -= 1;
+    pthread_cond_broadcast(&client_cond);
+    return GGL_ERR_OK;
+}
+
+static void on_close(void *ctx, uint32_t handle) {
+    (void) handle;
+    Subscriber *sub = ctx;
+
+    GGL_MTX_SCOPE_GUARD(&client_mtx);
+    sub->closed = true;
+    pthread_cond_broadcast(&client_cond);
+}
+
+static bool wait_for_deliveries(void) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += RESULT_TIMEOUT_S;
+
+    GGL_MTX_SCOPE_GUARD(&client_mtx);
+    while (deliveries_pending > 0) {
+        if (pthread_cond_timedwait(&client_cond, &client_mtx, &deadline)
+            != 0) {
+            GGL_LOGE("%zu responses were not delivered.", deliveries_pending);
+            return false;
+        }
+    }
+    return true;
+}
+
+static GglError subscribe_all(void) {
+    for (size_t i = 0; i < SUBSCRIBERS; i++) {
+        subscribers[i] = (Subscriber) { .copies = 1 };
+        GglError ret = GGL_ERR_FAILURE;
+        // Retry until the server thread is listening
+        for (int attempt = 0; attempt < 200; attempt++) {
+            ret = ggl_subscribe(
+                GGL_STR(INTERFACE),
+                GGL_STR("subscribe"),
+                GGL_MAP(),
+                on_response,
+                on_close,
+                &subscribers[i],
+                NULL,
+                NULL
+            );
+            if (ret == GGL_ERR_OK) {
+                break;
+            }
+            struct timespec delay = { .tv_nsec = 10000000 };
+            nanosleep(&delay, NULL);
+        }
+        if (ret != GGL_ERR_OK) {
+            GGL_LOGE("Failed to subscribe to test server.");
+            return ret;
+        }
+    }
+    return GGL_ERR_OK;
+}
+
+/// Sends one round of responses and returns the time per delivery in ns,
+/// or -1 on failure.
+static int64_t run_round(
+    bool multicast, int64_t count, int64_t size, bool duplicate
+) {
+    {
+        GGL_MTX_SCOPE_GUARD(&client_mtx);
+        for (size_t i = 0; i < SUBSCRIBERS; i++) {
+            subscribers[i].received = 0;
+            subscribers[i].copies = 1;
+        }
+        if (duplicate) {
+            subscribers[0].copies = 2;
+        }
+        deliveries_pending
+            = (size_t) count * (SUBSCRIBERS + (duplicate ? 1U : 0U));
+    }
+    size_t deliveries = deliveries_pending;
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    GglError ret = ggl_call(
+        GGL_STR(INTERFACE),
+        GGL_STR("send"),
+        GGL_MAP(
+            ggl_kv(GGL_STR("multicast"), ggl_obj_bool(multicast)),
+            ggl_kv(GGL_STR("count"), ggl_obj_i64(count)),
+            ggl_kv(GGL_STR("size"), ggl_obj_i64(size)),
+            ggl_kv(GGL_STR("duplicate"), ggl_obj_bool(duplicate))
+        ),
+        NULL,
+        NULL,
+        NULL
+    );
+    GGL_CHECK(ret == GGL_ERR_OK);
+    bool delivered = (ret == GGL_ERR_OK) && wait_for_deliveries();
+    GGL_CHECK(delivered);
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (!delivered) {
+        return -1;
+    }
+
+    GGL_MTX_SCOPE_GUARD(&client_mtx);
+    for (size_t i = 0; i < SUBSCRIBERS; i++) {
+        GGL_CHECK(!subscribers[i].closed);
+        GGL_CHECK(
+            subscribers[i].received
+            == (size_t) count * subscribers[i].copies
+        );
+    }
+
+    int64_t elapsed_ns = ((int64_t) (end.tv_sec - start.tv_sec) * 1000000000)
+        + (end.tv_nsec - start.tv_nsec);
+    return elapsed_ns / (int64_t) deliveries;
+}
+
+typedef struct {
+    int64_t size;
+    /// Kept small enough that a subscriber's backlog fits in its socket
+    /// buffer and queue
+    int64_t count;
+} RoundSize;
+
+static void test_fan_out(void) {
+    static const RoundSize SIZES[] = {
+        { .size = 64, .count = 200 },
+        { .size = 4096, .count = 20 },
+        { .size = MAX_DATA_LEN, .count = 10 },
+    };
+    for (size_t i = 0; i < sizeof(SIZES) / sizeof(SIZES[0]); i++) {
+        int64_t unicast_ns
+            = run_round(false, SIZES[i].count, SIZES[i].size, false);
+        int64_t multicast_ns
+            = run_round(true, SIZES[i].count, SIZES[i].size, false);
+        GGL_LOGI(
+            "%ld byte responses to %d subscribers: %ld ns per delivery with "
+            "ggl_sub_respond, %ld ns with ggl_sub_respond_multicast.",
+            (long) SIZES[i].size,
+            SUBSCRIBERS,
+            (long) unicast_ns,
+            (long) multicast_ns
+        );
+    }
+}
+
+/// A subscription listed twice gets two whole copies of each response.
+static void test_duplicate_handles(void) {
+    GGL_CHECK(run_round(true, 200, 64, true) >= 0);
+    GGL_CHECK(run_round(true, 10, 4096, true) >= 0);
+    GGL_CHECK(run_round(true, 10, MAX_DATA_LEN, true) >= 0);
+}
+
+GglError run_corebus_multicast_test(void) {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, server_thread, NULL) != 0) {
+        return GGL_ERR_FAILURE;
+    }
+    pthread_detach(thread);
+
+    GglError ret = subscribe_all();
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
+    test_fan_out();
+    test_duplicate_handles();
+
+    if (!ggl_check_passed()) {
+        return GGL_ERR_FAILURE;
+    }
+    GGL_LOGI("All multicast checks passed.");
+    return GGL_ERR_OK;
+}
@@ -0,0 +1,316 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+//! Runs a core-bus server on a thread and floods a stalled subscriber with
+//! responses. The server must keep serving calls, and each subscription's
+//! overflow policy must be applied once its queue is full.
+
+#include "corebus-overflow-test.h"
+#include <ggl/arena.h>
+#include <ggl/buffer.h>
+#include <ggl/cleanup.h>
+#include <ggl/core_bus/client.h>
+#include <ggl/core_bus/server.h>
+#include <ggl/error.h>
+#include <ggl/log.h>
+#include <ggl/map.h>
+#include <ggl/object.h>
+#include <ggl/test_check.h>
+#include <pthread.h>
+#include <time.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define INTERFACE "corebus_overflow_test"
+/// Responses sent by one flood call; enough to fill the socket buffer and
+/// the subscription queue many times over
+#define FLOOD_COUNT 1000
+#define FLOOD_PAD_LEN 4000
+#define FLOOD_TIMEOUT_S 2
+#define RESULT_TIMEOUT_S 5
+
+enum {
+    SUB_DISCONNECT,
+    SUB_DROP_OLDEST,
+    SUB_COUNT,
+};
+
+// Server state; only used from the server thread
+static uint32_t sub_handles[SUB_COUNT];
+
+static void server_sub_close(void *ctx, uint32_t handle) {
+    (void) handle;
+    *(uint32_t *) ctx = 0;
+}
+
+static GglError subscribe_disconnect(
+    void *ctx, GglMap params, uint32_t handle
+) {
+    (void) ctx;
+    (void) params;
+    sub_handles[SUB_DISCONNECT] = handle;
+    ggl_sub_accept(handle, server_sub_close, &sub_handles[SUB_DISCONNECT]);
+    return GGL_ERR_OK;
+}
+
+static GglError subscribe_drop_oldest(
+    void *ctx, GglMap params, uint32_t handle
+) {
+    (void) ctx;
+    (void) params;
+    sub_handles[SUB_DROP_OLDEST] = handle;
+    ggl_sub_accept(handle, server_sub_close, &sub_handles[SUB_DROP_OLDEST]);
+    ggl_sub_set_overflow_policy(handle, GGL_SUB_OVERFLOW_DROP_OLDEST);
+    return GGL_ERR_OK;
+}
+
+/// Sends FLOOD_COUNT responses to each open subscription.
+static GglError flood_handler(void *ctx, GglMap params, uint32_t handle) {
+    (void) ctx;
+    (void) params;
+    static uint8_t pad[FLOOD_PAD_LEN];
+
+    for (int64_t seq = 0; seq < FLOOD_COUNT; seq++) {
+        uint32_t handles[SUB_COUNT];
+        size_t handles_len = 0;
+        for (size_t i = 0; i < SUB_COUNT; i++) {
+            if (sub_handles[i] != 0) {
+                handles[handles_len] = sub_handles[i];
+                handles_len += 1;
+            }
+        }
+        ggl_sub_respond_multicast(
+            handles,
+            handles_len,
+            ggl_obj_map(GGL_MAP(
+                ggl_kv(GGL_STR("seq"), ggl_obj_i64(seq)),
+                ggl_kv(GGL_STR("pad"), ggl_obj_buf(GGL_BUF(pad)))
+            ))
+        );
+    }
+
+    ggl_respond(handle, GGL_OBJ_NULL);
+    return GGL_ERR_OK;
+}
+
+static void *server_thread(void *arg) {
+    (void) arg;
+    static GglRpcMethodDesc handlers[] = {
+        { GGL_STR("subscribe_disconnect"), true, subscribe_disconnect, NULL },
+        { GGL_STR("subscribe_drop_oldest"), true, subscribe_drop_oldest, NULL },
+        { GGL_STR("flood"), false, flood_handler, NULL },
+        { GGL_STR("get_sub_queue_stats"),
+          false,
+          ggl_sub_queue_stats_handler,
+          NULL },
+    };
+    GglError ret = ggl_listen(
+        GGL_STR(INTERFACE), handlers, sizeof(handlers) / sizeof(handlers[0])
+    );
+    GGL_LOGE("Test server exited: %d.", (int) ret);
+    return NULL;
+}
+
+static pthread_mutex_t client_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t client_cond = PTHREAD_COND_INITIALIZER;
+
+typedef struct {
+    size_t received;
+    int64_t last_seq;
+    bool closed;
+} Subscriber;
+
+static Subscriber subscribers[SUB_COUNT];
+static bool stalled = true;
+
+/// Blocks the client thread until released, so that responses back up.
+static GglError on_response(void *ctx, uint32_t handle, GglObject data) {
+    (void) handle;
+    Subscriber *sub = ctx;
+
+    int64_t seq = -1;
+    GglObject *seq_obj = NULL;
+    if ((ggl_obj_type(data) == GGL_TYPE_MAP)
+        && ggl_map_get(ggl_obj_into_map(data), GGL_STR("seq"), &seq_obj)
+        && (ggl_obj_type(*seq_obj) == GGL_TYPE_I64)) {
+        seq = ggl_obj_into_i64(*seq_obj);
+    }
+
+    GGL_MTX_SCOPE_GUARD(&client_mtx);
+    while (stalled) {
+        pthread_cond_wait(&client_cond, &client_mtx);
+    }
+    // Responses may be dropped but never reordered
+    GGL_CHECK(seq > sub->last_seq);
+    sub->received += 1;
+    sub->last_seq = seq;
+    pthread_cond_broadcast(&client_cond);
+    return GGL_ERR_OK;
+}
+
+static void on_close(void *ctx, uint32_t handle) {
+    (void) handle;
+    Subscriber *sub = ctx;
+
+    GGL_MTX_SCOPE_GUARD(&client_mtx);
+    sub->closed = true;
+    pthread_cond_broadcast(&client_cond);
+}
+
+static GglError wait_for_server(void) {
+    for (int i = 0; i < 200; i++) {
+        GglError err = GGL_ERR_OK;
+        GglError ret = ggl_call(
+            GGL_STR(INTERFACE),
+            GGL_STR("get_sub_queue_stats"),
+            GGL_MAP(),
+            &err,
+            NULL,
+            NULL
+        );
+        if (ret == GGL_ERR_OK) {
+            return GGL_ERR_OK;
+        }
+        struct timespec delay = { .tv_nsec = 10000000 };
+        nanosleep(&delay, NULL);
+    }
+    GGL_LOGE("Test server did not start.");
+    return GGL_ERR_NOCONN;
+}
+
+static int64_t get_stat(GglMap stats, GglBuffer key) {
+    GglObject *value = NULL;
+    if (!ggl_map_get(stats, key, &value)
+        || (ggl_obj_type(*value) != GGL_TYPE_I64)) {
+        return -1;
+    }
+    return ggl_obj_into_i64(*value);
+}
+
+static void check_stats(void) {
+    static uint8_t mem[256];
+    GglArena alloc = ggl_arena_init(GGL_BUF(mem));
+    GglObject result;
+    GglError ret = ggl_call(
+        GGL_STR(INTERFACE),
+        GGL_STR("get_sub_queue_stats"),
+        GGL_MAP(),
+        NULL,
+        &alloc,
+        &result
+    );
+    GGL_CHECK(ret == GGL_ERR_OK);
+    GGL_CHECK(ggl_obj_type(result) == GGL_TYPE_MAP);
+    if ((ret != GGL_ERR_OK) || (ggl_obj_type(result) != GGL_TYPE_MAP)) {
+        return;
+    }
+    GglMap stats = ggl_obj_into_map(result);
+
+    int64_t queued = get_stat(stats, GGL_STR("queued"));
+    int64_t dropped = get_stat(stats, GGL_STR("dropped"));
+    int64_t disconnected = get_stat(stats, GGL_STR("disconnected"));
+    GGL_LOGI(
+        "Queued %ld, dropped %ld, disconnected %ld.",
+        (long) queued,
+        (long) dropped,
+        (long) disconnected
+    );
+    GGL_CHECK(queued >= 1);
+    GGL_CHECK(dropped >= 1);
+    GGL_CHECK(disconnected == 1);
+}
+
+/// Wait until the drop-oldest subscriber has the last response and the
+/// disconnect subscriber has been closed.
+static bool wait_for_subscribers(void) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += RESULT_TIMEOUT_S;
+
+    GGL_MTX_SCOPE_GUARD(&client_mtx);
+    while ((subscribers[SUB_DROP_OLDEST].last_seq != FLOOD_COUNT - 1)
+           || !subscribers[SUB_DISCONNECT].closed) {
+        if (pthread_cond_timedwait(&client_cond, &client_mtx, &deadline)
+            != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void test_stalled_subscriber(void) {
+    static const char *methods[SUB_COUNT] = {
+        [SUB_DISCONNECT] = "subscribe_disconnect",
+        [SUB_DROP_OLDEST] = "subscribe_drop_oldest",
+    };
+    for (size_t i = 0; i < SUB_COUNT; i++) {
+        subscribers[i] = (Subscriber) { .last_seq = -1 };
+        GglError ret = ggl_subscribe(
+            GGL_STR(INTERFACE),
+            ggl_buffer_from_null_term((char *) methods[i]),
+            GGL_MAP(),
+            on_response,
+            on_close,
+            &subscribers[i],
+            NULL,
+            NULL
+        );
+        GGL_CHECK(ret == GGL_ERR_OK);
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    GglError ret = ggl_call(
+        GGL_STR(INTERFACE), GGL_STR("flood"), GGL_MAP(), NULL, NULL, NULL
+    );
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    // The server must not block on the stalled subscriber
+    GGL_CHECK(ret == GGL_ERR_OK);
+    GGL_CHECK(end.tv_sec - start.tv_sec < FLOOD_TIMEOUT_S);
+    check_stats();
+
+    {
+        GGL_MTX_SCOPE_GUARD(&client_mtx);
+        stalled = false;
+        pthread_cond_broadcast(&client_cond);
+    }
+
+    GGL_CHECK(wait_for_subscribers());
+
+    GGL_MTX_SCOPE_GUARD(&client_mtx);
+    Subscriber *drop_oldest = &subscribers[SUB_DROP_OLDEST];
+    Subscriber *disconnect = &subscribers[SUB_DISCONNECT];
+    GGL_LOGI(
+        "Drop-oldest subscriber received %zu of %d responses.",
+        drop_oldest->received,
+        FLOOD_COUNT
+    );
+    GGL_CHECK(drop_oldest->received < FLOOD_COUNT);
+    GGL_CHECK(!drop_oldest->closed);
+    GGL_CHECK(disconnect->received < FLOOD_COUNT);
+}
+
+GglError run_corebus_overflow_test(void) {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, server_thread, NULL) != 0) {
+        return GGL_ERR_FAILURE;
+    }
+    pthread_detach(thread);
+
+    GglError ret = wait_for_server();
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
+    test_stalled_subscriber();
+
+    if (!ggl_check_passed()) {
+        return GGL_ERR_FAILURE;
+    }
+    GGL_LOGI("All subscription overflow checks passed.");
+    return GGL_ERR_OK;
+}
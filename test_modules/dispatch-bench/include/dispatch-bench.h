@@ -0,0 +1,12 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef DISPATCH_BENCH_H
+#define DISPATCH_BENCH_H
+
+#include <ggl/error.h>
+
+GglError run_dispatch_bench(void);
+
+#endif
@@ -0,0 +1,99 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "dispatch-bench.h"
+#include <ggl/buffer.h>
+#include <ggl/dispatch_table.h>
+#include <ggl/error.h>
+#include <ggl/log.h>
+#include <time.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ITERATIONS 1000000
+
+// Operations registered by ggipcd
+static const GglBuffer OPERATIONS[] = {
+    GGL_STR("aws.greengrass#PublishToTopic"),
+    GGL_STR("aws.greengrass#SubscribeToTopic"),
+    GGL_STR("aws.greengrass#PublishToIoTCore"),
+    GGL_STR("aws.greengrass#SubscribeToIoTCore"),
+    GGL_STR("aws.greengrass#GetConfiguration"),
+    GGL_STR("aws.greengrass#UpdateConfiguration"),
+    GGL_STR("aws.greengrass#SubscribeToConfigurationUpdate"),
+    GGL_STR("aws.greengrass#CreateLocalDeployment"),
+    GGL_STR("aws.greengrass#RestartComponent"),
+    GGL_STR("aws.greengrass.private#GetSystemConfig"),
+    GGL_STR("aws.greengrass.private#GetRunnerContext"),
+    GGL_STR("aws.greengrass#UpdateState"),
+    GGL_STR("aws.greengrass#ValidateAuthorizationToken"),
+};
+
+static const size_t OPERATION_COUNT
+    = sizeof(OPERATIONS) / sizeof(OPERATIONS[0]);
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec * 1000000000U) + (uint64_t) ts.tv_nsec;
+}
+
+static size_t linear_lookup(GglBuffer name) {
+    for (size_t i = 0; i < OPERATION_COUNT; i++) {
+        if (ggl_buffer_eq(name, OPERATIONS[i])) {
+            return i;
+        }
+    }
+    return OPERATION_COUNT;
+}
+
+GglError run_dispatch_bench(void) {
+    static GglDispatchEntry slots[64];
+    GglDispatchTable table;
+    GglError ret = ggl_dispatch_table_init(
+        &table, slots, sizeof(slots) / sizeof(slots[0])
+    );
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+    for (size_t i = 0; i < OPERATION_COUNT; i++) {
+        ret = ggl_dispatch_table_insert(&table, OPERATIONS[i], (uint32_t) i);
+        if (ret != GGL_ERR_OK) {
+            return ret;
+        }
+    }
+
+    // Sum results so the lookups are not optimized out
+    volatile size_t sink = 0;
+
+    uint64_t start = now_ns();
+    for (size_t i = 0; i < ITERATIONS; i++) {
+        sink += linear_lookup(OPERATIONS[i % OPERATION_COUNT]);
+    }
+    uint64_t linear_ns = now_ns() - start;
+
+    start = now_ns();
+    for (size_t i = 0; i < ITERATIONS; i++) {
+        GglBuffer name = OPERATIONS[i % OPERATION_COUNT];
+        GglDispatchEntry *entry = ggl_dispatch_table_lookup(&table, name);
+        if (entry == NULL) {
+            GGL_LOGE("Dispatch table lookup failed.");
+            return GGL_ERR_FAILURE;
+        }
+        sink += entry->value;
+    }
+    uint64_t table_ns = now_ns() - start;
+
+    GGL_LOGI(
+        "%zu operations, %d lookups: linear scan %lu ns/lookup, dispatch "
+        "table %lu ns/lookup.",
+        OPERATION_COUNT,
+        ITERATIONS,
+        (unsigned long) (linear_ns / ITERATIONS),
+        (unsigned long) (table_ns / ITERATIONS)
+    );
+    (void) sink;
+
+    return GGL_ERR_OK;
+}
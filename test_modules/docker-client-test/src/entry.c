@@ -0,0 +1,428 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+//! Runs ggl-docker-client against a fake Docker Engine API server listening
+//! on a unix socket, selected through DOCKER_HOST. The server keeps a small
+//! image table and records what the client sent.
+
+#include "docker-client-test.h"
+#include <errno.h>
+#include <ggl/buffer.h>
+#include <ggl/cleanup.h>
+#include <ggl/docker_client.h>
+#include <ggl/error.h>
+#include <ggl/log.h>
+#include <ggl/test_check.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MAX_IMAGES 8
+#define MAX_IMAGE_NAME_LEN 128
+#define MAX_REQUEST_LEN 16384
+// Time a pull request waits for the rest of a parallel batch to arrive
+#define PULL_BARRIER_TIMEOUT_S 2
+
+static pthread_mutex_t server_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t server_cond = PTHREAD_COND_INITIALIZER;
+
+static char images[MAX_IMAGES][MAX_IMAGE_NAME_LEN];
+static size_t connections_accepted = 0;
+static size_t pull_requests = 0;
+static size_t pulls_in_flight = 0;
+static size_t max_pulls_in_flight = 0;
+// Pull requests to hold until this many are in flight at once
+static size_t pull_barrier = 1;
+static char last_pull_auth[256];
+
+static char *find_image(const char *name) {
+    for (size_t i = 0; i < MAX_IMAGES; i++) {
+        if (strcmp(images[i], name) == 0) {
+            return images[i];
+        }
+    }
+    return NULL;
+}
+
+static void add_image(const char *name) {
+    if (find_image(name) != NULL) {
+        return;
+    }
+    char *slot = find_image("");
+    if (slot != NULL) {
+        snprintf(slot, MAX_IMAGE_NAME_LEN, "%s", name);
+    }
+}
+
+static void send_response(int fd, int status, const char *body) {
+    char head[256];
+    int head_len = snprintf(
+        head,
+        sizeof(head),
+        "HTTP/1.1 %d X\r\nContent-Type: application/json\r\n"
+        "Content-Length: %zu\r\n\r\n",
+        status,
+        strlen(body)
+    );
+    (void) !write(fd, head, (size_t) head_len);
+    (void) !write(fd, body, strlen(body));
+}
+
+/// Copy a header value into out, or set out to "" if absent.
+static void get_header(
+    const char *headers, const char *name, char *out, size_t out_len
+) {
+    out[0] = '\0';
+    const char *start = strcasestr(headers, name);
+    if (start == NULL) {
+        return;
+    }
+    start += strlen(name);
+    while (*start == ' ') {
+        start++;
+    }
+    const char *end = strstr(start, "\r\n");
+    size_t len = (end == NULL) ? strlen(start) : (size_t) (end - start);
+    if (len >= out_len) {
+        len = out_len - 1;
+    }
+    memcpy(out, start, len);
+    out[len] = '\0';
+}
+
+static void handle_pull(int fd, const char *image, const char *auth) {
+    {
+        GGL_MTX_SCOPE_GUARD(&server_mtx);
+        pull_requests++;
+        snprintf(last_pull_auth, sizeof(last_pull_auth), "%s", auth);
+        pulls_in_flight++;
+        if (pulls_in_flight > max_pulls_in_flight) {
+            max_pulls_in_flight = pulls_in_flight;
+        }
+        pthread_cond_broadcast(&server_cond);
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += PULL_BARRIER_TIMEOUT_S;
+        while (max_pulls_in_flight < pull_barrier) {
+            if (pthread_cond_timedwait(&server_cond, &server_mtx, &deadline)
+                == ETIMEDOUT) {
+                break;
+            }
+        }
+        pulls_in_flight--;
+    }
+
+    // Errors during a pull are reported in the stream with a 200 status
+    if (strstr(image, "missing") != NULL) {
+        send_response(
+            fd,
+            200,
+            "{\"status\":\"Pulling repository\"}\n"
+            "{\"error\":\"manifest unknown\"}\n"
+        );
+        return;
+    }
+
+    {
+        GGL_MTX_SCOPE_GUARD(&server_mtx);
+        add_image(image);
+    }
+    send_response(
+        fd,
+        200,
+        "{\"status\":\"Pulling fs layer\",\"id\":\"a1\"}\n"
+        "{\"status\":\"Pull complete\",\"id\":\"a1\"}\n"
+        "{\"status\":\"Already exists\",\"id\":\"b2\"}\n"
+        "{\"status\":\"Status: Downloaded newer image\"}\n"
+    );
+}
+
+static void handle_request(
+    int fd, const char *method, char *path, const char *headers, char *body
+) {
+    char auth[256];
+    get_header(headers, "X-Registry-Auth:", auth, sizeof(auth));
+
+    static const char CREATE_PREFIX[] = "/images/create?fromImage=";
+    static const char IMAGE_PREFIX[] = "/images/";
+
+    if ((strcmp(method, "GET") == 0) && (strcmp(path, "/_ping") == 0)) {
+        send_response(fd, 200, "OK");
+    } else if ((strcmp(method, "POST") == 0) && (strcmp(path, "/auth") == 0)) {
+        if (strstr(body, "\"password\":\"good\"") != NULL) {
+            send_response(fd, 200, "{\"Status\":\"Login Succeeded\"}");
+        } else {
+            send_response(fd, 401, "{\"message\":\"unauthorized\"}");
+        }
+    } else if ((strcmp(method, "POST") == 0)
+               && (strncmp(path, CREATE_PREFIX, strlen(CREATE_PREFIX)) == 0)) {
+        char *image = &path[strlen(CREATE_PREFIX)];
+        char *query = strchr(image, '&');
+        if (query != NULL) {
+            *query = '\0';
+        }
+        handle_pull(fd, image, auth);
+    } else if (strncmp(path, IMAGE_PREFIX, strlen(IMAGE_PREFIX)) == 0) {
+        char *image = &path[strlen(IMAGE_PREFIX)];
+        size_t len = strlen(image);
+        bool inspect = (len > 5) && (strcmp(&image[len - 5], "/json") == 0);
+        if (inspect) {
+            image[len - 5] = '\0';
+        }
+
+        GGL_MTX_SCOPE_GUARD(&server_mtx);
+        char *slot = find_image(image);
+        if (slot == NULL) {
+            send_response(fd, 404, "{\"message\":\"No such image\"}");
+        } else if (inspect && (strcmp(method, "GET") == 0)) {
+            send_response(fd, 200, "{}");
+        } else if (!inspect && (strcmp(method, "DELETE") == 0)) {
+            slot[0] = '\0';
+            send_response(fd, 200, "[]");
+        } else {
+            send_response(fd, 405, "{\"message\":\"bad method\"}");
+        }
+    } else {
+        send_response(fd, 404, "{\"message\":\"page not found\"}");
+    }
+}
+
+/// Serves keep-alive requests on one connection until the client closes it.
+static void *connection_thread(void *arg) {
+    int fd = (int) (intptr_t) arg;
+    static _Thread_local char buf[MAX_REQUEST_LEN + 1];
+    size_t len = 0;
+
+    while (true) {
+        char *header_end = NULL;
+        while ((header_end = strstr(buf, "\r\n\r\n")) == NULL) {
+            if (len == MAX_REQUEST_LEN) {
+                (void) close(fd);
+                return NULL;
+            }
+            ssize_t ret = read(fd, &buf[len], MAX_REQUEST_LEN - len);
+            if (ret <= 0) {
+                (void) close(fd);
+                return NULL;
+            }
+            len += (size_t) ret;
+            buf[len] = '\0';
+        }
+
+        char content_length[32];
+        get_header(
+            buf, "Content-Length:", content_length, sizeof(content_length)
+        );
+        size_t body_len = (size_t) strtoul(content_length, NULL, 10);
+        size_t request_len = (size_t) (header_end - buf) + 4 + body_len;
+        while ((len < request_len) && (len < MAX_REQUEST_LEN)) {
+            ssize_t ret = read(fd, &buf[len], MAX_REQUEST_LEN - len);
+            if (ret <= 0) {
+                (void) close(fd);
+                return NULL;
+            }
+            len += (size_t) ret;
+            buf[len] = '\0';
+        }
+        if (request_len > len) {
+            (void) close(fd);
+            return NULL;
+        }
+
+        static _Thread_local char request[MAX_REQUEST_LEN + 1];
+        memcpy(request, buf, request_len);
+        request[request_len] = '\0';
+        memmove(buf, &buf[request_len], len - request_len);
+        len -= request_len;
+        buf[len] = '\0';
+
+        char method[16];
+        char path[1024];
+        if (sscanf(request, "%15s %1023s", method, path) != 2) {
+            (void) close(fd);
+            return NULL;
+        }
+        char *body = &request[request_len - body_len];
+        handle_request(fd, method, path, request, body);
+    }
+}
+
+static void *accept_thread(void *arg) {
+    int listen_fd = (int) (intptr_t) arg;
+    while (true) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) {
+            continue;
+        }
+        {
+            GGL_MTX_SCOPE_GUARD(&server_mtx);
+            connections_accepted++;
+        }
+        pthread_t thread;
+        if (pthread_create(
+                &thread, NULL, connection_thread, (void *) (intptr_t) fd
+            )
+            != 0) {
+            (void) close(fd);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+    return NULL;
+}
+
+static GglError start_fake_engine(void) {
+    static char dir[] = "/tmp/ggl-docker-test-XXXXXX";
+    if (mkdtemp(dir) == NULL) {
+        GGL_LOGE("Failed to create socket directory: %d.", errno);
+        return GGL_ERR_FAILURE;
+    }
+
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s/docker.sock", dir);
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if ((listen_fd < 0)
+        || (bind(listen_fd, (struct sockaddr *) &addr, sizeof(addr)) != 0)
+        || (listen(listen_fd, 16) != 0)) {
+        GGL_LOGE("Failed to listen on fake docker socket: %d.", errno);
+        return GGL_ERR_FAILURE;
+    }
+
+    static char docker_host[sizeof(addr.sun_path) + 8];
+    snprintf(docker_host, sizeof(docker_host), "unix://%s", addr.sun_path);
+    // NOLINTNEXTLINE(concurrency-mt-unsafe) set before any client call
+    setenv("DOCKER_HOST", docker_host, 1);
+
+    pthread_t thread;
+    if (pthread_create(
+            &thread, NULL, accept_thread, (void *) (intptr_t) listen_fd
+        )
+        != 0) {
+        return GGL_ERR_FAILURE;
+    }
+    pthread_detach(thread);
+    return GGL_ERR_OK;
+}
+
+static void test_images(void) {
+    GGL_CHECK(ggl_docker_check_server() == GGL_ERR_OK);
+
+    GglBuffer image = GGL_STR("busybox:1.36");
+    GGL_CHECK(ggl_docker_check_image(image) == GGL_ERR_NOENTRY);
+    GGL_CHECK(ggl_docker_pull(image) == GGL_ERR_OK);
+    GGL_CHECK(ggl_docker_check_image(image) == GGL_ERR_OK);
+
+    // A failure reported in the progress stream fails the pull
+    GGL_CHECK(ggl_docker_pull(GGL_STR("missing:1")) == GGL_ERR_FAILURE);
+    GGL_CHECK(ggl_docker_check_image(GGL_STR("missing:1")) == GGL_ERR_NOENTRY);
+
+    GGL_CHECK(ggl_docker_remove(image) == GGL_ERR_OK);
+    GGL_CHECK(ggl_docker_check_image(image) == GGL_ERR_NOENTRY);
+    // Removing an image that is not present is not an error
+    GGL_CHECK(ggl_docker_remove(image) == GGL_ERR_OK);
+
+    // Rejected before reaching the daemon
+    GGL_CHECK(ggl_docker_pull(GGL_STR("bad image")) != GGL_ERR_OK);
+}
+
+static void test_credentials(void) {
+    GglBuffer registry = GGL_STR("https://registry.example.com/");
+    GGL_CHECK(
+        ggl_docker_credentials_store(registry, GGL_STR("user"), GGL_STR("bad"))
+        == GGL_ERR_FAILURE
+    );
+    GGL_CHECK(
+        ggl_docker_credentials_store(registry, GGL_STR("user"), GGL_STR("good"))
+        == GGL_ERR_OK
+    );
+
+    // Credentials are sent only to their registry
+    GGL_CHECK(
+        ggl_docker_pull(GGL_STR("registry.example.com/app:1")) == GGL_ERR_OK
+    );
+    {
+        GGL_MTX_SCOPE_GUARD(&server_mtx);
+        GGL_CHECK(last_pull_auth[0] != '\0');
+        // X-Registry-Auth is base64url encoded
+        GGL_CHECK(strpbrk(last_pull_auth, "+/") == NULL);
+    }
+    GGL_CHECK(ggl_docker_pull(GGL_STR("busybox:1.36")) == GGL_ERR_OK);
+    {
+        GGL_MTX_SCOPE_GUARD(&server_mtx);
+        GGL_CHECK(last_pull_auth[0] == '\0');
+    }
+}
+
+static void test_parallel_pull(void) {
+    static GglBuffer names[] = {
+        GGL_STR("alpine:3.19"),
+        GGL_STR("debian:12"),
+        GGL_STR("ubuntu:24.04"),
+    };
+    size_t count = sizeof(names) / sizeof(names[0]);
+
+    size_t requests_before;
+    {
+        GGL_MTX_SCOPE_GUARD(&server_mtx);
+        pull_barrier = count;
+        max_pulls_in_flight = 0;
+        requests_before = pull_requests;
+    }
+
+    GGL_CHECK(
+        ggl_docker_pull_many((GglBufList) { .bufs = names, .len = count })
+        == GGL_ERR_OK
+    );
+
+    GGL_MTX_SCOPE_GUARD(&server_mtx);
+    pull_barrier = 1;
+    GGL_CHECK(pull_requests - requests_before == count);
+    // All pulls were sent before any of them completed
+    GGL_CHECK(max_pulls_in_flight == count);
+    for (size_t i = 0; i < count; i++) {
+        char name[MAX_IMAGE_NAME_LEN];
+        snprintf(
+            name, sizeof(name), "%.*s", (int) names[i].len, names[i].data
+        );
+        GGL_CHECK(find_image(name) != NULL);
+    }
+}
+
+GglError run_docker_client_test(void) {
+    GglError ret = start_fake_engine();
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
+    test_images();
+    test_credentials();
+    test_parallel_pull();
+
+    {
+        GGL_MTX_SCOPE_GUARD(&server_mtx);
+        GGL_LOGI(
+            "Fake engine served %zu pulls over %zu connections.",
+            pull_requests,
+            connections_accepted
+        );
+        // Connections are reused between calls
+        GGL_CHECK(connections_accepted <= 4);
+    }
+
+    if (!ggl_check_passed()) {
+        return GGL_ERR_FAILURE;
+    }
+    GGL_LOGI("All docker client checks passed.");
+    return GGL_ERR_OK;
+}
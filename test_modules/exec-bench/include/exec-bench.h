@@ -0,0 +1,12 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef EXEC_BENCH_H
+#define EXEC_BENCH_H
+
+#include <ggl/error.h>
+
+GglError run_exec_bench(void);
+
+#endif
@@ -0,0 +1,84 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "exec-bench.h"
+#include <ggl/buffer.h>
+#include <ggl/error.h>
+#include <ggl/exec.h>
+#include <ggl/io.h>
+#include <ggl/log.h>
+#include <time.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ITERATIONS 50
+#define OUTPUT_LEN 1048576
+
+static const char *const COMMAND[]
+    = { "head", "-c", "1048576", "/dev/zero", NULL };
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec * 1000000000U) + (uint64_t) ts.tv_nsec;
+}
+
+typedef struct {
+    size_t len;
+    size_t calls;
+} CountingWriterCtx;
+
+static GglError counting_write(void *ctx, GglBuffer buf) {
+    CountingWriterCtx *counter = ctx;
+    counter->len += buf.len;
+    counter->calls += 1;
+    return GGL_ERR_OK;
+}
+
+static void log_result(const char *name, uint64_t elapsed_ns) {
+    uint64_t per_run_us = elapsed_ns / ITERATIONS / 1000U;
+    GGL_LOGI(
+        "%s: %lu us per run, %lu MiB/s.",
+        name,
+        (unsigned long) per_run_us,
+        (unsigned long) (((uint64_t) OUTPUT_LEN * ITERATIONS * 1000000000U)
+                         / elapsed_ns / 1048576U)
+    );
+}
+
+GglError run_exec_bench(void) {
+    CountingWriterCtx counter = { 0 };
+    uint64_t start = now_ns();
+    for (size_t i = 0; i < ITERATIONS; i++) {
+        GglError ret = ggl_exec_command_with_output(
+            COMMAND, (GglWriter) { .write = counting_write, .ctx = &counter }
+        );
+        if (ret != GGL_ERR_OK) {
+            return ret;
+        }
+    }
+    log_result("Writer capture", now_ns() - start);
+    GGL_LOGI(
+        "Writer capture: %zu callbacks per run.", counter.calls / ITERATIONS
+    );
+
+    static uint8_t output_mem[OUTPUT_LEN];
+    start = now_ns();
+    for (size_t i = 0; i < ITERATIONS; i++) {
+        GglBuffer output = GGL_BUF(output_mem);
+        GglError ret = ggl_exec_command_with_output_buf(COMMAND, &output);
+        if (ret != GGL_ERR_OK) {
+            return ret;
+        }
+        if (output.len != OUTPUT_LEN) {
+            GGL_LOGE(
+                "Captured %zu bytes, expected %d.", output.len, OUTPUT_LEN
+            );
+            return GGL_ERR_FAILURE;
+        }
+    }
+    log_result("Buffer capture", now_ns() - start);
+
+    return GGL_ERR_OK;
+}
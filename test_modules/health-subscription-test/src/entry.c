@@ -0,0 +1,237 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+//! Stress test for gghealthd's lifecycle subscription table. Subscriptions
+//! are added and removed at random across many more component names than
+//! fit in the table at once, and checked against a simple model.
+
+#include "health-subscription-test.h"
+#include "subscription_table.h"
+#include <ggl/buffer.h>
+#include <ggl/error.h>
+#include <ggl/log.h>
+#include <ggl/test_check.h>
+#include <time.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/// Upper bound on the table capacity the test can model
+#define MAX_MODEL_SUBSCRIPTIONS 4096
+#define COMPONENT_NAMES 1000
+#define CHURN_OPERATIONS 200000
+#define NAME_LEN 32
+
+typedef struct {
+    void *ctx;
+    uint32_t handle;
+    size_t name;
+} LiveSubscription;
+
+static LiveSubscription live[MAX_MODEL_SUBSCRIPTIONS];
+static size_t live_count = 0;
+static size_t capacity = 0;
+static uint32_t next_handle = 1;
+
+static char names[COMPONENT_NAMES][NAME_LEN];
+static uint64_t rng_state = 0x9E3779B97F4A7C15U;
+
+static uint32_t rng(void) {
+    // xorshift64
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t) (rng_state >> 32);
+}
+
+static GglBuffer name_buf(size_t name) {
+    return ggl_buffer_from_null_term(names[name]);
+}
+
+static bool add(size_t name) {
+    void *ctx = subscription_table_add(name_buf(name), next_handle);
+    if (ctx == NULL) {
+        return false;
+    }
+    live[live_count] = (LiveSubscription) { .ctx = ctx,
+                                            .handle = next_handle,
+                                            .name = name };
+    live_count += 1;
+    next_handle += 1;
+    return true;
+}
+
+static void remove_live(size_t index) {
+    GGL_CHECK(subscription_table_remove(live[index].ctx, live[index].handle));
+    live_count -= 1;
+    live[index] = live[live_count];
+}
+
+typedef struct {
+    uint32_t handles[MAX_MODEL_SUBSCRIPTIONS];
+    size_t count;
+    /// Remove each subscription from within the callback
+    bool remove;
+} Collected;
+
+static void collect(uint32_t handle, void *ctx) {
+    Collected *collected = ctx;
+    GGL_CHECK(collected->count < MAX_MODEL_SUBSCRIPTIONS);
+    if (collected->count >= MAX_MODEL_SUBSCRIPTIONS) {
+        return;
+    }
+    collected->handles[collected->count] = handle;
+    collected->count += 1;
+
+    if (collected->remove) {
+        for (size_t i = 0; i < live_count; i++) {
+            if (live[i].handle == handle) {
+                remove_live(i);
+                break;
+            }
+        }
+    }
+}
+
+/// Check that foreach reaches exactly the model's subscriptions of a name.
+static void check_name(size_t name) {
+    static Collected collected;
+    collected.count = 0;
+    collected.remove = false;
+    subscription_table_foreach(name_buf(name), collect, &collected);
+
+    size_t expected = 0;
+    for (size_t i = 0; i < live_count; i++) {
+        if (live[i].name != name) {
+            continue;
+        }
+        expected += 1;
+        bool found = false;
+        for (size_t j = 0; j < collected.count; j++) {
+            found = found || (collected.handles[j] == live[i].handle);
+        }
+        GGL_CHECK(found);
+    }
+    GGL_CHECK(collected.count == expected);
+}
+
+static size_t distinct_live_names(void) {
+    static bool seen[COMPONENT_NAMES];
+    size_t count = 0;
+    for (size_t i = 0; i < COMPONENT_NAMES; i++) {
+        seen[i] = false;
+    }
+    for (size_t i = 0; i < live_count; i++) {
+        if (!seen[live[i].name]) {
+            seen[live[i].name] = true;
+            count += 1;
+        }
+    }
+    return count;
+}
+
+static void test_capacity(void) {
+    // Many subscribers of one component share a single entry
+    while ((capacity < MAX_MODEL_SUBSCRIPTIONS) && add(0)) {
+        capacity += 1;
+    }
+    GGL_LOGI("Subscription table holds %zu subscriptions.", capacity);
+    GGL_CHECK((capacity > 0) && (capacity < MAX_MODEL_SUBSCRIPTIONS));
+    GGL_CHECK(subscription_table_component_count() == 1);
+    check_name(0);
+
+    // A failed response removes the subscription being notified
+    static Collected collected;
+    collected.count = 0;
+    collected.remove = true;
+    subscription_table_foreach(name_buf(0), collect, &collected);
+    GGL_CHECK(collected.count == capacity);
+    GGL_CHECK(live_count == 0);
+    GGL_CHECK(subscription_table_component_count() == 0);
+
+    // One component per subscription
+    for (size_t i = 0; i < capacity; i++) {
+        GGL_CHECK(add(i % COMPONENT_NAMES));
+    }
+    GGL_CHECK(!add(capacity % COMPONENT_NAMES));
+    GGL_CHECK(subscription_table_component_count() == distinct_live_names());
+    while (live_count > 0) {
+        remove_live(live_count - 1);
+    }
+    GGL_CHECK(subscription_table_component_count() == 0);
+}
+
+static void test_stale_remove(void) {
+    GGL_CHECK(add(1));
+    LiveSubscription sub = live[0];
+    GGL_CHECK(!subscription_table_remove(sub.ctx, sub.handle + 1));
+    remove_live(0);
+    // The slot is reused by the next subscription
+    GGL_CHECK(!subscription_table_remove(sub.ctx, sub.handle));
+    GGL_CHECK(add(2));
+    GGL_CHECK(!subscription_table_remove(sub.ctx, sub.handle));
+    remove_live(0);
+    GGL_CHECK(!subscription_table_remove(NULL, 0));
+}
+
+static void test_churn(void) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (size_t op = 0; op < CHURN_OPERATIONS; op++) {
+        uint32_t choice = rng() % 8;
+        if ((choice < 4) && (live_count < capacity)) {
+            GGL_CHECK(add(rng() % COMPONENT_NAMES));
+        } else if ((choice < 7) && (live_count > 0)) {
+            remove_live(rng() % live_count);
+        } else {
+            check_name(rng() % COMPONENT_NAMES);
+        }
+        if ((op % 1024) == 0) {
+            GGL_CHECK(
+                subscription_table_component_count() == distinct_live_names()
+            );
+        }
+    }
+
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    int64_t elapsed_ns = ((int64_t) (end.tv_sec - start.tv_sec) * 1000000000)
+        + (end.tv_nsec - start.tv_nsec);
+
+    for (size_t name = 0; name < COMPONENT_NAMES; name++) {
+        check_name(name);
+    }
+    while (live_count > 0) {
+        remove_live(rng() % live_count);
+    }
+    GGL_CHECK(subscription_table_component_count() == 0);
+    for (size_t name = 0; name < COMPONENT_NAMES; name++) {
+        check_name(name);
+    }
+
+    GGL_LOGI(
+        "%d random operations on up to %zu subscriptions took %ld ns each.",
+        CHURN_OPERATIONS,
+        capacity,
+        (long) (elapsed_ns / CHURN_OPERATIONS)
+    );
+}
+
+GglError run_health_subscription_test(void) {
+    for (size_t i = 0; i < COMPONENT_NAMES; i++) {
+        snprintf(names[i], NAME_LEN, "com.example.Component%zu", i);
+    }
+
+    test_capacity();
+    test_stale_remove();
+    test_churn();
+
+    if (!ggl_check_passed()) {
+        return GGL_ERR_FAILURE;
+    }
+    GGL_LOGI("All subscription table checks passed.");
+    return GGL_ERR_OK;
+}
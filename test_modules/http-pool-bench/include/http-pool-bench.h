@@ -0,0 +1,12 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef HTTP_POOL_BENCH_H
+#define HTTP_POOL_BENCH_H
+
+#include <ggl/error.h>
+
+GglError run_http_pool_bench(void);
+
+#endif
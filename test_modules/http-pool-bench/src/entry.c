@@ -0,0 +1,423 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+//! Runs a keep-alive HTTPS server on a loopback port, which requires a client
+//! certificate and answers with its common name, and makes dataplane calls to
+//! it with connection reuse enabled and disabled. Reports the time per
+//! request for each, and checks how many connections the server accepted.
+//! Also checks that a pooled handle does not send requests over a connection
+//! authenticated with another client certificate.
+
+#include "http-pool-bench.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <ggl/buffer.h>
+#include <ggl/cleanup.h>
+#include <ggl/error.h>
+#include <ggl/http.h>
+#include <ggl/log.h>
+#include <ggl/test_check.h>
+#include <limits.h>
+#include <netinet/in.h>
+#include <openssl/asn1.h>
+#include <openssl/bio.h>
+#include <openssl/evp.h>
+#include <openssl/obj_mac.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/types.h>
+#include <openssl/x509.h>
+#include <openssl/x509v3.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ITERATIONS 200
+#define CERT_SWITCH_ITERATIONS 10
+
+typedef struct {
+    const char *name;
+    EVP_PKEY *key;
+    X509 *cert;
+    char key_path[PATH_MAX];
+    char cert_path[PATH_MAX];
+} Identity;
+
+static char cert_dir[] = "/tmp/http-pool-bench-XXXXXX";
+static Identity ca = { .name = "bench-ca" };
+static Identity server = { .name = "127.0.0.1" };
+static Identity client_a = { .name = "client-a" };
+static Identity client_b = { .name = "client-b" };
+
+static SSL_CTX *server_ctx = NULL;
+static char server_port[8];
+
+static pthread_mutex_t server_mtx = PTHREAD_MUTEX_INITIALIZER;
+static size_t connections = 0;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec * 1000000000U) + (uint64_t) ts.tv_nsec;
+}
+
+static bool write_pem(Identity *identity) {
+    BIO *out = BIO_new_file(identity->key_path, "w");
+    if (out == NULL) {
+        return false;
+    }
+    int ssl_ret = PEM_write_bio_PrivateKey(
+        out, identity->key, NULL, NULL, 0, NULL, NULL
+    );
+    BIO_free(out);
+    if (ssl_ret == 0) {
+        return false;
+    }
+
+    out = BIO_new_file(identity->cert_path, "w");
+    if (out == NULL) {
+        return false;
+    }
+    ssl_ret = PEM_write_bio_X509(out, identity->cert);
+    BIO_free(out);
+    return ssl_ret != 0;
+}
+
+/// Creates a key and a certificate for identity, signed by issuer, and
+/// writes both to cert_dir. The CA passes itself as issuer.
+static GglError create_identity(
+    Identity *identity, Identity *issuer, int ext_nid, const char *ext_value
+) {
+    static long serial = 1;
+
+    snprintf(
+        identity->key_path,
+        sizeof(identity->key_path),
+        "%s/%s.key",
+        cert_dir,
+        identity->name
+    );
+    snprintf(
+        identity->cert_path,
+        sizeof(identity->cert_path),
+        "%s/%s.pem",
+        cert_dir,
+        identity->name
+    );
+
+    identity->key = EVP_PKEY_Q_keygen(NULL, NULL, "EC", "P-256");
+    identity->cert = X509_new();
+    if ((identity->key == NULL) || (identity->cert == NULL)) {
+        GGL_LOGE("Failed to allocate key for %s.", identity->name);
+        return GGL_ERR_NOMEM;
+    }
+
+    X509 *cert = identity->cert;
+    X509_NAME *subject = X509_get_subject_name(cert);
+    bool ok = (X509_set_version(cert, X509_VERSION_3) == 1)
+        && (ASN1_INTEGER_set(X509_get_serialNumber(cert), serial) == 1)
+        && (X509_gmtime_adj(X509_getm_notBefore(cert), -60) != NULL)
+        && (X509_gmtime_adj(X509_getm_notAfter(cert), 3600) != NULL)
+        && (X509_set_pubkey(cert, identity->key) == 1)
+        && (X509_NAME_add_entry_by_txt(
+                subject,
+                "CN",
+                MBSTRING_ASC,
+                (const unsigned char *) identity->name,
+                -1,
+                -1,
+                0
+            )
+            == 1);
+    serial += 1;
+
+    X509 *issuer_cert = (issuer == identity) ? cert : issuer->cert;
+    ok = ok
+        && (X509_set_issuer_name(cert, X509_get_subject_name(issuer_cert))
+            == 1);
+
+    if (ok) {
+        X509V3_CTX ext_ctx;
+        X509V3_set_ctx(&ext_ctx, issuer_cert, cert, NULL, NULL, 0);
+        X509_EXTENSION *ext
+            = X509V3_EXT_conf_nid(NULL, &ext_ctx, ext_nid, ext_value);
+        ok = (ext != NULL) && (X509_add_ext(cert, ext, -1) == 1);
+        X509_EXTENSION_free(ext);
+    }
+
+    ok = ok && (X509_sign(cert, issuer->key, EVP_sha256()) != 0)
+        && write_pem(identity);
+    if (!ok) {
+        GGL_LOGE("Failed to create certificate for %s.", identity->name);
+        return GGL_ERR_FAILURE;
+    }
+    return GGL_ERR_OK;
+}
+
+static GglError create_identities(void) {
+    if (mkdtemp(cert_dir) == NULL) {
+        GGL_LOGE("Failed to create certificate dir: %d.", errno);
+        return GGL_ERR_FAILURE;
+    }
+
+    GglError ret
+        = create_identity(&ca, &ca, NID_basic_constraints, "critical,CA:TRUE");
+    if (ret == GGL_ERR_OK) {
+        ret = create_identity(
+            &server, &ca, NID_subject_alt_name, "IP:127.0.0.1"
+        );
+    }
+    if (ret == GGL_ERR_OK) {
+        ret = create_identity(
+            &client_a, &ca, NID_basic_constraints, "CA:FALSE"
+        );
+    }
+    if (ret == GGL_ERR_OK) {
+        ret = create_identity(
+            &client_b, &ca, NID_basic_constraints, "CA:FALSE"
+        );
+    }
+    return ret;
+}
+
+static void remove_identities(void) {
+    Identity *identities[] = { &ca, &server, &client_a, &client_b };
+    for (size_t i = 0; i < sizeof(identities) / sizeof(identities[0]); i++) {
+        (void) unlink(identities[i]->key_path);
+        (void) unlink(identities[i]->cert_path);
+    }
+    (void) rmdir(cert_dir);
+}
+
+/// Answers GET requests on one connection with the client certificate's
+/// common name, until the client closes it.
+static void serve_connection(SSL *ssl) {
+    char peer_name[64] = { 0 };
+    X509 *peer = SSL_get0_peer_certificate(ssl);
+    if ((peer == NULL)
+        || (X509_NAME_get_text_by_NID(
+                X509_get_subject_name(peer),
+                NID_commonName,
+                peer_name,
+                sizeof(peer_name)
+            )
+            < 0)) {
+        return;
+    }
+
+    char response[256];
+    int response_len = snprintf(
+        response,
+        sizeof(response),
+        "HTTP/1.1 200 OK\r\nContent-Length: %zu\r\n\r\n%s",
+        strlen(peer_name),
+        peer_name
+    );
+
+    uint8_t request[4096];
+    size_t request_len = 0;
+    while (true) {
+        uint8_t *end = memmem(request, request_len, "\r\n\r\n", 4);
+        if (end != NULL) {
+            if (SSL_write(ssl, response, response_len) <= 0) {
+                return;
+            }
+            size_t consumed = (size_t) (end - request) + 4;
+            memmove(request, &request[consumed], request_len - consumed);
+            request_len -= consumed;
+            continue;
+        }
+        if (request_len == sizeof(request)) {
+            return;
+        }
+        int ret = SSL_read(
+            ssl, &request[request_len], (int) (sizeof(request) - request_len)
+        );
+        if (ret <= 0) {
+            return;
+        }
+        request_len += (size_t) ret;
+    }
+}
+
+static void *connection_thread(void *arg) {
+    int conn = (int) (intptr_t) arg;
+    SSL *ssl = SSL_new(server_ctx);
+    if ((ssl != NULL) && (SSL_set_fd(ssl, conn) == 1)
+        && (SSL_accept(ssl) == 1)) {
+        serve_connection(ssl);
+        (void) SSL_shutdown(ssl);
+    }
+    SSL_free(ssl);
+    (void) close(conn);
+    return NULL;
+}
+
+static void *server_thread(void *arg) {
+    int listener = *(int *) arg;
+    while (true) {
+        int conn = accept(listener, NULL, NULL);
+        if (conn < 0) {
+            GGL_LOGE("Test server failed to accept: %d.", errno);
+            return NULL;
+        }
+        {
+            GGL_MTX_SCOPE_GUARD(&server_mtx);
+            connections += 1;
+        }
+        // Idle pooled connections stay open, so each gets its own thread
+        pthread_t thread;
+        if (pthread_create(
+                &thread, NULL, connection_thread, (void *) (intptr_t) conn
+            )
+            != 0) {
+            (void) close(conn);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+}
+
+static GglError start_server(void) {
+    server_ctx = SSL_CTX_new(TLS_server_method());
+    if (server_ctx == NULL) {
+        return GGL_ERR_NOMEM;
+    }
+    if ((SSL_CTX_use_certificate(server_ctx, server.cert) != 1)
+        || (SSL_CTX_use_PrivateKey(server_ctx, server.key) != 1)
+        || (X509_STORE_add_cert(SSL_CTX_get_cert_store(server_ctx), ca.cert)
+            != 1)) {
+        GGL_LOGE("Failed to configure test server TLS.");
+        return GGL_ERR_FAILURE;
+    }
+    SSL_CTX_set_verify(
+        server_ctx, SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT, NULL
+    );
+    // Every connection authenticates with a full handshake, so the peer
+    // certificate is that of the request's client
+    SSL_CTX_set_session_cache_mode(server_ctx, SSL_SESS_CACHE_OFF);
+    SSL_CTX_set_options(server_ctx, SSL_OP_NO_TICKET);
+
+    static int listener;
+    listener = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listener < 0) {
+        GGL_LOGE("Failed to create socket: %d.", errno);
+        return GGL_ERR_FAILURE;
+    }
+    struct sockaddr_in addr = { .sin_family = AF_INET,
+                                .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t addr_len = sizeof(addr);
+    if ((bind(listener, (struct sockaddr *) &addr, sizeof(addr)) != 0)
+        || (listen(listener, 16) != 0)
+        || (getsockname(listener, (struct sockaddr *) &addr, &addr_len) != 0
+        )) {
+        GGL_LOGE("Failed to listen on loopback: %d.", errno);
+        return GGL_ERR_FAILURE;
+    }
+    snprintf(
+        server_port, sizeof(server_port), "%u", (unsigned) ntohs(addr.sin_port)
+    );
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, server_thread, &listener) != 0) {
+        return GGL_ERR_FAILURE;
+    }
+    pthread_detach(thread);
+    return GGL_ERR_OK;
+}
+
+/// Makes count calls to the server as client and returns the connections
+/// the server accepted. Every response must name client.
+static size_t run_requests(const char *name, Identity *client, size_t count) {
+    size_t start_connections;
+    {
+        GGL_MTX_SCOPE_GUARD(&server_mtx);
+        start_connections = connections;
+    }
+
+    CertificateDetails details
+        = { .gghttplib_cert_path = client->cert_path,
+            .gghttplib_p_key_path = client->key_path,
+            .gghttplib_root_ca_path = ca.cert_path };
+
+    uint64_t start = now_ns();
+    for (size_t i = 0; i < count; i++) {
+        uint8_t response_mem[64];
+        GglBuffer response = GGL_BUF(response_mem);
+        GglError ret = gg_dataplane_call(
+            GGL_STR("127.0.0.1"),
+            ggl_buffer_from_null_term(server_port),
+            GGL_STR("bench"),
+            details,
+            NULL,
+            &response
+        );
+        GGL_CHECK(ret == GGL_ERR_OK);
+        if (ret != GGL_ERR_OK) {
+            return 0;
+        }
+        GGL_CHECK(ggl_buffer_eq(
+            response, ggl_buffer_from_null_term((char *) client->name)
+        ));
+    }
+    uint64_t elapsed_ns = now_ns() - start;
+
+    GGL_MTX_SCOPE_GUARD(&server_mtx);
+    size_t used = connections - start_connections;
+    GGL_LOGI(
+        "%s: %lu us per request, %zu connections for %zu requests.",
+        name,
+        (unsigned long) (elapsed_ns / count / 1000U),
+        used,
+        count
+    );
+    return used;
+}
+
+GglError run_http_pool_bench(void) {
+    GglError ret = create_identities();
+    if (ret == GGL_ERR_OK) {
+        ret = start_server();
+    }
+    if (ret != GGL_ERR_OK) {
+        remove_identities();
+        return ret;
+    }
+
+    gghttplib_pool_configure((GglHttpPoolConfig) { .reuse_connections = false }
+    );
+    GGL_CHECK(run_requests("Unpooled", &client_a, ITERATIONS) == ITERATIONS);
+
+    gghttplib_pool_configure((GglHttpPoolConfig) { .reuse_connections = true }
+    );
+    // Every request reuses the first connection
+    GGL_CHECK(run_requests("Pooled", &client_a, ITERATIONS) == 1);
+
+    // A new certificate needs a new connection, which is then reused. Going
+    // back may open another or reuse the first, but responses must never
+    // come from a connection authenticated as the other client.
+    GGL_CHECK(
+        run_requests("Pooled, new cert", &client_b, CERT_SWITCH_ITERATIONS)
+        == 1
+    );
+    GGL_CHECK(
+        run_requests("Pooled, first cert", &client_a, CERT_SWITCH_ITERATIONS)
+        <= 1
+    );
+
+    remove_identities();
+
+    if (!ggl_check_passed()) {
+        return GGL_ERR_FAILURE;
+    }
+    GGL_LOGI("All HTTP pool checks passed.");
+    return GGL_ERR_OK;
+}
@@ -0,0 +1,12 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef IPC_AUTH_CACHE_TEST_H
+#define IPC_AUTH_CACHE_TEST_H
+
+#include <ggl/error.h>
+
+GglError run_ipc_auth_cache_test(void);
+
+#endif
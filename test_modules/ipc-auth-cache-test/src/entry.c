@@ -0,0 +1,180 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+//! Checks the cgroup identity cache used by IPC authentication: cache hits
+//! skip the systemd unit lookup, misses and failed lookups are not cached,
+//! and a client that has exited is never authenticated from the cache.
+
+#include "identity_cache.h"
+#include "ipc-auth-cache-test.h"
+#include <errno.h>
+#include <ggipc/auth.h>
+#include <ggl/buffer.h>
+#include <ggl/error.h>
+#include <ggl/log.h>
+#include <ggl/nucleus/constants.h>
+#include <ggl/test_check.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define COMPONENT "com.example.Cached"
+#define CACHE_ENTRIES 1000
+// Far above the IDs of real cgroups, which are also cached by the test
+#define FIRST_ENTRY_ID (1ULL << 40)
+
+// Unit reported for every pid; NULL fails the lookup
+static const char *stub_unit = "ggl." COMPONENT ".service";
+static size_t lookups = 0;
+
+int sd_pid_get_unit(pid_t pid, char **unit);
+
+/// Stands in for libsystemd's lookup, so that the test controls which unit
+/// a process belongs to and can count lookups.
+int sd_pid_get_unit(pid_t pid, char **unit) {
+    (void) pid;
+    lookups += 1;
+    if (stub_unit == NULL) {
+        return -ESRCH;
+    }
+    *unit = strdup(stub_unit);
+    return (*unit == NULL) ? -ENOMEM : 0;
+}
+
+static void test_cache_entries(void) {
+    uint8_t name_mem[GGL_COMPONENT_NAME_MAX_LEN];
+    GglBuffer name = GGL_BUF(name_mem);
+    GGL_CHECK(!identity_cache_get(UINT64_MAX, &name));
+
+    // Entries may replace each other, but must never return another name
+    uint64_t last_id = FIRST_ENTRY_ID + CACHE_ENTRIES - 1;
+    for (uint64_t id = FIRST_ENTRY_ID; id <= last_id; id++) {
+        uint64_t value = id * 7919;
+        identity_cache_put(
+            id, (GglBuffer) { .data = (uint8_t *) &value, .len = sizeof(value) }
+        );
+    }
+    size_t hits = 0;
+    for (uint64_t id = FIRST_ENTRY_ID; id <= last_id; id++) {
+        name = GGL_BUF(name_mem);
+        if (!identity_cache_get(id, &name)) {
+            continue;
+        }
+        hits += 1;
+        uint64_t value = id * 7919;
+        GGL_CHECK(name.len == sizeof(value));
+        GGL_CHECK(memcmp(name.data, &value, sizeof(value)) == 0);
+    }
+    GGL_CHECK(hits >= 1);
+    GGL_CHECK(hits <= GGL_IPC_AUTH_CACHE_LEN);
+
+    // The most recent entry is always found
+    name = GGL_BUF(name_mem);
+    GGL_CHECK(identity_cache_get(last_id, &name));
+
+    static uint8_t long_name[GGL_COMPONENT_NAME_MAX_LEN + 1];
+    identity_cache_put(UINT64_MAX, GGL_BUF(long_name));
+    name = GGL_BUF(name_mem);
+    GGL_CHECK(!identity_cache_get(UINT64_MAX, &name));
+}
+
+/// Returns false if the kernel can not report the cgroup of a pidfd, in
+/// which case nothing is cached.
+static bool test_hit_and_miss(int pidfd) {
+    // Failed lookups are not cached
+    stub_unit = NULL;
+    lookups = 0;
+    GGL_CHECK(
+        ggl_ipc_auth_validate_name_pidfd(getpid(), pidfd, GGL_STR(COMPONENT))
+        == GGL_ERR_FAILURE
+    );
+    GGL_CHECK(lookups == 1);
+
+    stub_unit = "ggl." COMPONENT ".service";
+    lookups = 0;
+    for (size_t i = 0; i < 5; i++) {
+        GGL_CHECK(
+            ggl_ipc_auth_validate_name_pidfd(
+                getpid(), pidfd, GGL_STR(COMPONENT)
+            )
+            == GGL_ERR_OK
+        );
+    }
+    if (lookups == 5) {
+        GGL_LOGI("Kernel can not report pidfd cgroups; skipping hit checks.");
+        return false;
+    }
+    GGL_CHECK(lookups == 1);
+
+    // A hit is still checked against the claimed name
+    lookups = 0;
+    GGL_CHECK(
+        ggl_ipc_auth_validate_name_pidfd(
+            getpid(), pidfd, GGL_STR("com.example.Other")
+        )
+        == GGL_ERR_FAILURE
+    );
+    GGL_CHECK(lookups == 0);
+
+    // Without a pidfd, the cache is not used
+    GGL_CHECK(
+        ggl_ipc_auth_validate_name_pidfd(getpid(), -1, GGL_STR(COMPONENT))
+        == GGL_ERR_OK
+    );
+    GGL_CHECK(lookups == 1);
+    return true;
+}
+
+/// The child shares this process's cgroup, which is now cached.
+static void test_dead_pid(void) {
+    pid_t child = fork();
+    if (child == 0) {
+        pause();
+        _exit(0);
+    }
+    GGL_CHECK(child > 0);
+    if (child < 0) {
+        return;
+    }
+    int pidfd = (int) syscall(SYS_pidfd_open, child, 0);
+    GGL_CHECK(pidfd >= 0);
+    (void) kill(child, SIGKILL);
+    (void) waitpid(child, NULL, 0);
+    if (pidfd < 0) {
+        return;
+    }
+
+    GGL_CHECK(
+        ggl_ipc_auth_validate_name_pidfd(child, pidfd, GGL_STR(COMPONENT))
+        == GGL_ERR_FAILURE
+    );
+    (void) close(pidfd);
+}
+
+GglError run_ipc_auth_cache_test(void) {
+    test_cache_entries();
+
+    int pidfd = (int) syscall(SYS_pidfd_open, getpid(), 0);
+    if (pidfd < 0) {
+        GGL_LOGE("Failed to open pidfd: %d.", errno);
+        return GGL_ERR_FAILURE;
+    }
+    if (test_hit_and_miss(pidfd)) {
+        test_dead_pid();
+    }
+    (void) close(pidfd);
+
+    if (!ggl_check_passed()) {
+        return GGL_ERR_FAILURE;
+    }
+    GGL_LOGI("All IPC auth cache checks passed.");
+    return GGL_ERR_OK;
+}
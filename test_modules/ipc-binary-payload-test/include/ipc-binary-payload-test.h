@@ -0,0 +1,12 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef IPC_BINARY_PAYLOAD_TEST_H
+#define IPC_BINARY_PAYLOAD_TEST_H
+
+#include <ggl/error.h>
+
+GglError run_ipc_binary_payload_test(char *component_name);
+
+#endif
@@ -0,0 +1,472 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+//! Connects to ggipcd as the given component and exercises raw binary
+//! payloads: negotiation on CONNECT, a raw PublishToIoTCore received back
+//! through SubscribeToIoTCore, and rejection of raw payloads for operations
+//! that do not support them or from clients that did not negotiate them.
+//! Must run as the given component, with iotcored connected and the
+//! component authorized to publish and subscribe to the test topic.
+
+#include "ipc-binary-payload-test.h"
+#include <ggl/arena.h>
+#include <ggl/buffer.h>
+#include <ggl/cleanup.h>
+#include <ggl/error.h>
+#include <ggl/eventstream/decode.h>
+#include <ggl/eventstream/encode.h>
+#include <ggl/eventstream/rpc.h>
+#include <ggl/eventstream/types.h>
+#include <ggl/io.h>
+#include <ggl/json_decode.h>
+#include <ggl/json_encode.h>
+#include <ggl/log.h>
+#include <ggl/map.h>
+#include <ggl/object.h>
+#include <ggl/socket.h>
+#include <ggl/test_check.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Matches ggipcd's default GGL_IPC_MAX_MSG_LEN
+#define MSG_BUF_LEN 10000
+// Messages read while waiting for the subscription to deliver
+#define MAX_WAIT_MESSAGES 16
+
+#define SUBSCRIBE_STREAM 1
+#define PUBLISH_STREAM 2
+#define REJECTED_STREAM 3
+
+static const GglBuffer BINARY_PAYLOAD_HEADER = GGL_STR("ggl-binary-payload");
+static const GglBuffer BINARY_LENGTH_HEADER = GGL_STR("ggl-binary-length");
+
+// Includes NUL and 0xFF bytes, which are not valid in JSON strings
+static uint8_t raw_payload[]
+    = { 0x00, 0xFF, 'r', 'a', 'w', 0x00, 0x7F, 0x80, 0xC3, 0x28 };
+
+static uint8_t send_mem[MSG_BUF_LEN];
+static uint8_t recv_mem[MSG_BUF_LEN];
+
+typedef struct {
+    GglObject *json;
+    const GglBuffer *binary;
+} PayloadReaderCtx;
+
+// Writes the JSON document followed by the raw binary section, if any
+static GglError payload_read(void *ctx, GglBuffer *buf) {
+    PayloadReaderCtx *args = ctx;
+
+    GglBuffer json_buf = *buf;
+    GglError ret = ggl_reader_call(ggl_json_reader(args->json), &json_buf);
+    if ((ret != GGL_ERR_OK) || (args->binary == NULL)) {
+        *buf = json_buf;
+        return ret;
+    }
+
+    if (buf->len - json_buf.len < args->binary->len) {
+        return GGL_ERR_NOMEM;
+    }
+    memcpy(&buf->data[json_buf.len], args->binary->data, args->binary->len);
+    buf->len = json_buf.len + args->binary->len;
+    return GGL_ERR_OK;
+}
+
+static GglError send_message(
+    int conn,
+    const EventStreamHeader *headers,
+    size_t headers_len,
+    GglMap args,
+    const GglBuffer *binary
+) {
+    GglObject json = ggl_obj_map(args);
+    PayloadReaderCtx reader_ctx = { .json = &json, .binary = binary };
+    GglBuffer send_buffer = GGL_BUF(send_mem);
+    GglError ret = eventstream_encode(
+        &send_buffer,
+        headers,
+        headers_len,
+        (GglReader) { .read = payload_read, .ctx = &reader_ctx }
+    );
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+    return ggl_socket_write(conn, send_buffer);
+}
+
+static GglError recv_message(
+    int conn, EventStreamMessage *msg, EventStreamCommonHeaders *common
+) {
+    GglBuffer prelude_buf = ggl_buffer_substr(GGL_BUF(recv_mem), 0, 12);
+    GglError ret = ggl_socket_read(conn, prelude_buf);
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
+    EventStreamPrelude prelude;
+    ret = eventstream_decode_prelude(prelude_buf, &prelude);
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+    if (prelude.data_len > sizeof(recv_mem)) {
+        return GGL_ERR_NOMEM;
+    }
+
+    GglBuffer data_section
+        = ggl_buffer_substr(GGL_BUF(recv_mem), 0, prelude.data_len);
+    ret = ggl_socket_read(conn, data_section);
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
+    ret = eventstream_decode(&prelude, data_section, msg);
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+    return eventstream_get_common_headers(msg, common);
+}
+
+/// Returns the value of an int32 header, or -1 if absent.
+static int32_t find_int_header(const EventStreamMessage *msg, GglBuffer name) {
+    EventStreamHeaderIter iter = msg->headers;
+    EventStreamHeader header;
+    while (eventstream_header_next(&iter, &header) == GGL_ERR_OK) {
+        if (ggl_buffer_eq(header.name, name)
+            && (header.value.type == EVENTSTREAM_INT32)) {
+            return header.value.int32;
+        }
+    }
+    return -1;
+}
+
+static GglError ipc_connect(
+    GglBuffer socket_path,
+    GglBuffer component_name,
+    bool binary_payload,
+    int *conn,
+    bool *accepted_binary
+) {
+    int fd = -1;
+    GglError ret = ggl_connect(socket_path, &fd);
+    if (ret != GGL_ERR_OK) {
+        GGL_LOGE("Failed to connect to the IPC socket.");
+        return ret;
+    }
+    GGL_CLEANUP_ID(fd_cleanup, cleanup_close, fd);
+
+    EventStreamHeader headers[] = {
+        { GGL_STR(":message-type"),
+          { EVENTSTREAM_INT32, .int32 = EVENTSTREAM_CONNECT } },
+        { GGL_STR(":message-flags"), { EVENTSTREAM_INT32, .int32 = 0 } },
+        { GGL_STR(":stream-id"), { EVENTSTREAM_INT32, .int32 = 0 } },
+        { GGL_STR(":version"),
+          { EVENTSTREAM_STRING, .string = GGL_STR("0.1.0") } },
+        { BINARY_PAYLOAD_HEADER, { EVENTSTREAM_INT32, .int32 = 1 } },
+    };
+    size_t headers_len = sizeof(headers) / sizeof(headers[0]);
+    if (!binary_payload) {
+        headers_len -= 1;
+    }
+
+    ret = send_message(
+        fd,
+        headers,
+        headers_len,
+        GGL_MAP(ggl_kv(GGL_STR("componentName"), ggl_obj_buf(component_name))),
+        NULL
+    );
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
+    EventStreamMessage msg;
+    EventStreamCommonHeaders common;
+    ret = recv_message(fd, &msg, &common);
+    if (ret != GGL_ERR_OK) {
+        GGL_LOGE("Failed to read the connect response.");
+        return ret;
+    }
+    if ((common.message_type != EVENTSTREAM_CONNECT_ACK)
+        || ((common.message_flags & EVENTSTREAM_CONNECTION_ACCEPTED) == 0)) {
+        GGL_LOGE("Connection not accepted.");
+        return GGL_ERR_FAILURE;
+    }
+    *accepted_binary = find_int_header(&msg, BINARY_PAYLOAD_HEADER) == 1;
+
+    // NOLINTNEXTLINE(clang-analyzer-deadcode.DeadStores) false positive
+    fd_cleanup = -1;
+    *conn = fd;
+    return GGL_ERR_OK;
+}
+
+static GglError send_request(
+    int conn,
+    int32_t stream_id,
+    GglBuffer operation,
+    GglMap args,
+    const GglBuffer *binary
+) {
+    EventStreamHeader headers[] = {
+        { GGL_STR(":message-type"),
+          { EVENTSTREAM_INT32, .int32 = EVENTSTREAM_APPLICATION_MESSAGE } },
+        { GGL_STR(":message-flags"), { EVENTSTREAM_INT32, .int32 = 0 } },
+        { GGL_STR(":stream-id"), { EVENTSTREAM_INT32, .int32 = stream_id } },
+        { GGL_STR(":content-type"),
+          { EVENTSTREAM_STRING, .string = GGL_STR("application/json") } },
+        { GGL_STR("operation"), { EVENTSTREAM_STRING, .string = operation } },
+        { BINARY_LENGTH_HEADER, { EVENTSTREAM_INT32, .int32 = 0 } },
+    };
+    size_t headers_len = sizeof(headers) / sizeof(headers[0]);
+    if (binary != NULL) {
+        headers[headers_len - 1].value.int32 = (int32_t) binary->len;
+    } else {
+        headers_len -= 1;
+    }
+    return send_message(conn, headers, headers_len, args, binary);
+}
+
+/// Decodes the JSON section of a message, excluding any raw section.
+static GglError decode_json(const EventStreamMessage *msg, GglMap *out) {
+    static uint8_t decode_mem[sizeof(GglObject[32])];
+    GglArena arena = ggl_arena_init(GGL_BUF(decode_mem));
+
+    GglBuffer json = msg->payload;
+    int32_t binary_len = find_int_header(msg, BINARY_LENGTH_HEADER);
+    if (binary_len > 0) {
+        if ((size_t) binary_len > json.len) {
+            return GGL_ERR_PARSE;
+        }
+        json.len -= (size_t) binary_len;
+    }
+
+    GglObject obj;
+    GglError ret = ggl_json_decode_destructive(json, &arena, &obj);
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+    if (ggl_obj_type(obj) != GGL_TYPE_MAP) {
+        return GGL_ERR_PARSE;
+    }
+    *out = ggl_obj_into_map(obj);
+    return GGL_ERR_OK;
+}
+
+/// Checks a raw message received through the subscription.
+static void check_subscription_message(
+    const EventStreamMessage *msg, GglBuffer topic
+) {
+    int32_t binary_len = find_int_header(msg, BINARY_LENGTH_HEADER);
+    GGL_CHECK(binary_len == (int32_t) sizeof(raw_payload));
+    if (binary_len != (int32_t) sizeof(raw_payload)) {
+        return;
+    }
+    GglBuffer raw = ggl_buffer_substr(
+        msg->payload, msg->payload.len - sizeof(raw_payload), SIZE_MAX
+    );
+    GGL_CHECK(ggl_buffer_eq(raw, GGL_BUF(raw_payload)));
+
+    GglMap response;
+    GglError ret = decode_json(msg, &response);
+    GGL_CHECK(ret == GGL_ERR_OK);
+    if (ret != GGL_ERR_OK) {
+        return;
+    }
+    GglObject *message = NULL;
+    GGL_CHECK(ggl_map_get(response, GGL_STR("message"), &message));
+    if ((message == NULL) || (ggl_obj_type(*message) != GGL_TYPE_MAP)) {
+        ggl_check_fail();
+        return;
+    }
+    GglObject *topic_name = NULL;
+    GGL_CHECK(ggl_map_get(
+        ggl_obj_into_map(*message), GGL_STR("topicName"), &topic_name
+    ));
+    GGL_CHECK(
+        (topic_name != NULL) && (ggl_obj_type(*topic_name) == GGL_TYPE_BUF)
+        && ggl_buffer_eq(ggl_obj_into_buf(*topic_name), topic)
+    );
+    // The payload is only in the raw section
+    GglObject *payload = NULL;
+    GGL_CHECK(
+        !ggl_map_get(ggl_obj_into_map(*message), GGL_STR("payload"), &payload)
+    );
+}
+
+static void check_error_code(const EventStreamMessage *msg, GglBuffer code) {
+    GglMap response;
+    GglError ret = decode_json(msg, &response);
+    GGL_CHECK(ret == GGL_ERR_OK);
+    if (ret != GGL_ERR_OK) {
+        return;
+    }
+    GglObject *error_code = NULL;
+    GGL_CHECK(ggl_map_get(response, GGL_STR("_errorCode"), &error_code));
+    GGL_CHECK(
+        (error_code != NULL) && (ggl_obj_type(*error_code) == GGL_TYPE_BUF)
+        && ggl_buffer_eq(ggl_obj_into_buf(*error_code), code)
+    );
+}
+
+/// Subscribes, publishes raw bytes to the same topic, and waits for them to
+/// come back raw. Also sends a raw payload to PublishToTopic on the same
+/// connection, which must be rejected without closing it.
+static void test_raw_round_trip(int conn, GglBuffer topic) {
+    GglBuffer raw = GGL_BUF(raw_payload);
+
+    GglError ret = send_request(
+        conn,
+        SUBSCRIBE_STREAM,
+        GGL_STR("aws.greengrass#SubscribeToIoTCore"),
+        GGL_MAP(
+            ggl_kv(GGL_STR("topicName"), ggl_obj_buf(topic)),
+            ggl_kv(GGL_STR("qos"), ggl_obj_i64(1))
+        ),
+        NULL
+    );
+    GGL_CHECK(ret == GGL_ERR_OK);
+
+    EventStreamMessage msg;
+    EventStreamCommonHeaders common;
+    ret = recv_message(conn, &msg, &common);
+    GGL_CHECK(ret == GGL_ERR_OK);
+    GGL_CHECK(common.stream_id == SUBSCRIBE_STREAM);
+    GGL_CHECK(common.message_type == EVENTSTREAM_APPLICATION_MESSAGE);
+    if (!ggl_check_passed()) {
+        return;
+    }
+
+    ret = send_request(
+        conn,
+        REJECTED_STREAM,
+        GGL_STR("aws.greengrass#PublishToTopic"),
+        GGL_MAP(
+            ggl_kv(GGL_STR("topic"), ggl_obj_buf(topic)),
+            ggl_kv(
+                GGL_STR("publishMessage"),
+                ggl_obj_map(GGL_MAP(ggl_kv(
+                    GGL_STR("binaryMessage"),
+                    ggl_obj_map(GGL_MAP(
+                        ggl_kv(GGL_STR("message"), ggl_obj_buf(GGL_STR("")))
+                    ))
+                )))
+            )
+        ),
+        &raw
+    );
+    GGL_CHECK(ret == GGL_ERR_OK);
+    ret = recv_message(conn, &msg, &common);
+    GGL_CHECK(ret == GGL_ERR_OK);
+    GGL_CHECK(common.stream_id == REJECTED_STREAM);
+    GGL_CHECK(common.message_type == EVENTSTREAM_APPLICATION_ERROR);
+    check_error_code(&msg, GGL_STR("InvalidArgumentsError"));
+
+    ret = send_request(
+        conn,
+        PUBLISH_STREAM,
+        GGL_STR("aws.greengrass#PublishToIoTCore"),
+        GGL_MAP(
+            ggl_kv(GGL_STR("topicName"), ggl_obj_buf(topic)),
+            ggl_kv(GGL_STR("qos"), ggl_obj_i64(1))
+        ),
+        &raw
+    );
+    GGL_CHECK(ret == GGL_ERR_OK);
+
+    // The publish response and the subscription message may arrive in
+    // either order
+    bool published = false;
+    bool received = false;
+    for (size_t i = 0; (i < MAX_WAIT_MESSAGES) && !(published && received);
+         i++) {
+        ret = recv_message(conn, &msg, &common);
+        GGL_CHECK(ret == GGL_ERR_OK);
+        if (ret != GGL_ERR_OK) {
+            return;
+        }
+        GGL_CHECK(common.message_type == EVENTSTREAM_APPLICATION_MESSAGE);
+        if (common.stream_id == PUBLISH_STREAM) {
+            GGL_CHECK(find_int_header(&msg, BINARY_LENGTH_HEADER) == -1);
+            published = true;
+        } else if (common.stream_id == SUBSCRIBE_STREAM) {
+            check_subscription_message(&msg, topic);
+            received = true;
+        } else {
+            GGL_LOGE("Message on unexpected stream %d.", common.stream_id);
+            ggl_check_fail();
+        }
+    }
+    GGL_CHECK(published);
+    GGL_CHECK(received);
+}
+
+/// A client that did not negotiate raw payloads is dropped for sending one.
+static void test_not_negotiated(GglBuffer socket_path, GglBuffer component) {
+    int conn = -1;
+    bool accepted_binary = true;
+    GglError ret
+        = ipc_connect(socket_path, component, false, &conn, &accepted_binary);
+    GGL_CHECK(ret == GGL_ERR_OK);
+    if (ret != GGL_ERR_OK) {
+        return;
+    }
+    GGL_CLEANUP(cleanup_close, conn);
+    GGL_CHECK(!accepted_binary);
+
+    ret = send_request(
+        conn,
+        PUBLISH_STREAM,
+        GGL_STR("aws.greengrass#PublishToIoTCore"),
+        GGL_MAP(ggl_kv(GGL_STR("topicName"), ggl_obj_buf(GGL_STR("unused")))),
+        &GGL_STR("raw")
+    );
+    GGL_CHECK(ret == GGL_ERR_OK);
+
+    EventStreamMessage msg;
+    EventStreamCommonHeaders common;
+    GGL_CHECK(recv_message(conn, &msg, &common) != GGL_ERR_OK);
+}
+
+GglError run_ipc_binary_payload_test(char *component_name) {
+    char *socket_path_env
+        // NOLINTNEXTLINE(concurrency-mt-unsafe)
+        = getenv("AWS_GG_NUCLEUS_DOMAIN_SOCKET_FILEPATH_FOR_COMPONENT");
+    if (socket_path_env == NULL) {
+        GGL_LOGE("IPC socket path env var not set.");
+        return GGL_ERR_FAILURE;
+    }
+    GglBuffer socket_path = ggl_buffer_from_null_term(socket_path_env);
+    GglBuffer component = ggl_buffer_from_null_term(component_name);
+
+    static char topic_mem[64];
+    int topic_len = snprintf(
+        topic_mem, sizeof(topic_mem), "ggl/ipc-binary-test/%d", getpid()
+    );
+    GglBuffer topic = { .data = (uint8_t *) topic_mem,
+                        .len = (size_t) topic_len };
+
+    int conn = -1;
+    bool accepted_binary = false;
+    GglError ret
+        = ipc_connect(socket_path, component, true, &conn, &accepted_binary);
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+    GGL_CLEANUP(cleanup_close, conn);
+    GGL_CHECK(accepted_binary);
+    if (accepted_binary) {
+        test_raw_round_trip(conn, topic);
+    }
+
+    test_not_negotiated(socket_path, component);
+
+    if (!ggl_check_passed()) {
+        return GGL_ERR_FAILURE;
+    }
+    GGL_LOGI("All IPC binary payload checks passed.");
+    return GGL_ERR_OK;
+}
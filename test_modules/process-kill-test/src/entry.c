@@ -0,0 +1,189 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+//! Terminates children with ggl_process_kill from concurrent threads, and
+//! with ggl_process_terminate through the shared reaper. Some of the
+//! children ignore SIGTERM and must be killed once the timeout elapses.
+
+#include "process-kill-test.h"
+#include <errno.h>
+#include <ggl/cleanup.h>
+#include <ggl/error.h>
+#include <ggl/log.h>
+#include <ggl/process.h>
+#include <pthread.h>
+#include <time.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CHILD_COUNT 100
+// Children that ignore SIGTERM and must be killed after the timeout
+#define STUBBORN_COUNT 5
+#define TERM_TIMEOUT 2
+#define EXIT_DEADLINE 10
+
+typedef struct {
+    int handle;
+    GglError ret;
+} KillJob;
+
+static pthread_mutex_t exited_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t exited_cond = PTHREAD_COND_INITIALIZER;
+static size_t exited_count = 0;
+
+static GglError spawn_children(int handles[CHILD_COUNT]) {
+    static const char *const SLEEP_ARGS[] = { "sleep", "60", NULL };
+    static const char *const STUBBORN_ARGS[]
+        = { "sh", "-c", "trap '' TERM; sleep 60", NULL };
+
+    for (size_t i = 0; i < CHILD_COUNT; i++) {
+        const char *const *argv
+            = (i < STUBBORN_COUNT) ? STUBBORN_ARGS : SLEEP_ARGS;
+        GglError ret = ggl_process_spawn(argv, &handles[i]);
+        if (ret != GGL_ERR_OK) {
+            GGL_LOGE("Failed to spawn child %zu.", i);
+            return ret;
+        }
+    }
+
+    // Give the shells time to install their trap
+    struct timespec delay = { .tv_nsec = 200000000 };
+    nanosleep(&delay, NULL);
+    return GGL_ERR_OK;
+}
+
+static int64_t elapsed_ms(struct timespec start) {
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return ((int64_t) (end.tv_sec - start.tv_sec) * 1000)
+        + ((end.tv_nsec - start.tv_nsec) / 1000000);
+}
+
+static void *kill_thread(void *arg) {
+    KillJob *job = arg;
+    job->ret = ggl_process_kill(job->handle, TERM_TIMEOUT);
+    return NULL;
+}
+
+static GglError test_kill(void) {
+    static int handles[CHILD_COUNT];
+    static KillJob jobs[CHILD_COUNT];
+    static pthread_t threads[CHILD_COUNT];
+
+    GglError ret = spawn_children(handles);
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (size_t i = 0; i < CHILD_COUNT; i++) {
+        jobs[i] = (KillJob) { .handle = handles[i] };
+        int sys_ret = pthread_create(&threads[i], NULL, kill_thread, &jobs[i]);
+        if (sys_ret != 0) {
+            GGL_LOGE("Failed to create kill thread: %d.", sys_ret);
+            return GGL_ERR_FAILURE;
+        }
+    }
+
+    bool passed = true;
+    for (size_t i = 0; i < CHILD_COUNT; i++) {
+        pthread_join(threads[i], NULL);
+        if (jobs[i].ret != GGL_ERR_OK) {
+            GGL_LOGE("Failed to kill child %zu: %d.", i, (int) jobs[i].ret);
+            passed = false;
+        }
+    }
+    if (!passed) {
+        return GGL_ERR_FAILURE;
+    }
+
+    GGL_LOGI(
+        "Killed %d children (%d after SIGKILL) in %ld ms.",
+        CHILD_COUNT,
+        STUBBORN_COUNT,
+        (long) elapsed_ms(start)
+    );
+    return GGL_ERR_OK;
+}
+
+static void child_exited(void *ctx, int handle, bool exit_status) {
+    (void) ctx;
+    (void) exit_status;
+    GGL_LOGT("Process %d exited.", handle);
+
+    GGL_MTX_SCOPE_GUARD(&exited_mtx);
+    exited_count += 1;
+    pthread_cond_signal(&exited_cond);
+}
+
+static GglError test_terminate(void) {
+    static int handles[CHILD_COUNT];
+
+    GglError ret = spawn_children(handles);
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+    for (size_t i = 0; i < CHILD_COUNT; i++) {
+        ret = ggl_process_watch(handles[i], child_exited, NULL);
+        if (ret == GGL_ERR_UNSUPPORTED) {
+            GGL_LOGW("No pidfd support; skipping the reaper checks.");
+            for (size_t j = i; j < CHILD_COUNT; j++) {
+                (void) ggl_process_kill(handles[j], 0);
+            }
+            return (i == 0) ? GGL_ERR_OK : GGL_ERR_FAILURE;
+        }
+        if (ret != GGL_ERR_OK) {
+            GGL_LOGE("Failed to watch child %zu.", i);
+            return ret;
+        }
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (size_t i = 0; i < CHILD_COUNT; i++) {
+        ret = ggl_process_terminate(handles[i], TERM_TIMEOUT);
+        if (ret != GGL_ERR_OK) {
+            GGL_LOGE("Failed to terminate child %zu.", i);
+            return ret;
+        }
+    }
+
+    struct timespec deadline = start;
+    deadline.tv_sec += EXIT_DEADLINE;
+
+    GGL_MTX_SCOPE_GUARD(&exited_mtx);
+    while (exited_count < CHILD_COUNT) {
+        int sys_ret = pthread_cond_clockwait(
+            &exited_cond, &exited_mtx, CLOCK_MONOTONIC, &deadline
+        );
+        if (sys_ret == ETIMEDOUT) {
+            GGL_LOGE(
+                "Only %zu of %d children exited in time.",
+                exited_count,
+                CHILD_COUNT
+            );
+            return GGL_ERR_TIMEOUT;
+        }
+    }
+
+    GGL_LOGI(
+        "Terminated %d watched children (%d after SIGKILL) in %ld ms.",
+        CHILD_COUNT,
+        STUBBORN_COUNT,
+        (long) elapsed_ms(start)
+    );
+    return GGL_ERR_OK;
+}
+
+GglError run_process_kill_test(void) {
+    GglError ret = test_kill();
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+    return test_terminate();
+}
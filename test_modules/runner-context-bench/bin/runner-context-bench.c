@@ -0,0 +1,20 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "runner-context-bench.h"
+#include <ggl/error.h>
+#include <ggl/nucleus/init.h>
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        return 1;
+    }
+
+    ggl_nucleus_init();
+
+    GglError ret = run_runner_context_bench(argv[1]);
+    if (ret != GGL_ERR_OK) {
+        return 1;
+    }
+}
@@ -0,0 +1,12 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef RUNNER_CONTEXT_BENCH_H
+#define RUNNER_CONTEXT_BENCH_H
+
+#include <ggl/error.h>
+
+GglError run_runner_context_bench(char *component_name);
+
+#endif
@@ -0,0 +1,287 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+//! Fetches what recipe-runner needs to start a phase, with one
+//! GetRunnerContext call and with the separate IPC calls it replaced. Must
+//! run as the given component. Reports the time per startup for each, and
+//! checks that both return the same values.
+
+#include "runner-context-bench.h"
+#include <ggl/buffer.h>
+#include <ggl/error.h>
+#include <ggl/eventstream/decode.h>
+#include <ggl/ipc/client.h>
+#include <ggl/ipc/client_priv.h>
+#include <ggl/ipc/client_raw.h>
+#include <ggl/log.h>
+#include <ggl/map.h>
+#include <ggl/object.h>
+#include <ggl/test_check.h>
+#include <ggl/vector.h>
+#include <limits.h>
+#include <time.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define ITERATIONS 100
+
+typedef struct {
+    GglBuffer thing_name;
+    GglBuffer root_path;
+    GglBuffer root_ca_path;
+    GglBuffer aws_region;
+    uint8_t mem[4 * PATH_MAX];
+} Context;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec * 1000000000U) + (uint64_t) ts.tv_nsec;
+}
+
+/// The svcuid is not needed; the bench does not start processes.
+GglError ggipc_connect_extra_header_handler(EventStreamHeaderIter headers) {
+    (void) headers;
+    return GGL_ERR_OK;
+}
+
+static GglError error_cb(void *ctx, GglBuffer error_code, GglBuffer message) {
+    (void) ctx;
+    GGL_LOGE(
+        "Received error %.*s: %.*s.",
+        (int) error_code.len,
+        error_code.data,
+        (int) message.len,
+        message.data
+    );
+    return GGL_ERR_FAILURE;
+}
+
+static GglError copy_str(GglByteVec *vec, GglObject value, GglBuffer *out) {
+    if (ggl_obj_type(value) != GGL_TYPE_BUF) {
+        return GGL_ERR_INVALID;
+    }
+    size_t start = vec->buf.len;
+    GglError ret = ggl_byte_vec_append(vec, ggl_obj_into_buf(value));
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+    *out = ggl_buffer_substr(vec->buf, start, SIZE_MAX);
+    return GGL_ERR_OK;
+}
+
+static GglError runner_context_cb(void *ctx, GglMap result) {
+    Context *context = ctx;
+    GglObject *thing_name;
+    GglObject *root_path;
+    GglObject *root_ca_path;
+    GglObject *aws_region;
+    GglError ret = ggl_map_validate(
+        result,
+        GGL_MAP_SCHEMA(
+            { GGL_STR("thingName"), GGL_REQUIRED, GGL_TYPE_BUF, &thing_name },
+            { GGL_STR("rootPath"), GGL_REQUIRED, GGL_TYPE_BUF, &root_path },
+            { GGL_STR("rootCaPath"),
+              GGL_REQUIRED,
+              GGL_TYPE_BUF,
+              &root_ca_path },
+            { GGL_STR("awsRegion"), GGL_REQUIRED, GGL_TYPE_BUF, &aws_region },
+        )
+    );
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
+    GglByteVec vec = GGL_BYTE_VEC(context->mem);
+    ret = copy_str(&vec, *thing_name, &context->thing_name);
+    if (ret == GGL_ERR_OK) {
+        ret = copy_str(&vec, *root_path, &context->root_path);
+    }
+    if (ret == GGL_ERR_OK) {
+        ret = copy_str(&vec, *root_ca_path, &context->root_ca_path);
+    }
+    if (ret == GGL_ERR_OK) {
+        ret = copy_str(&vec, *aws_region, &context->aws_region);
+    }
+    return ret;
+}
+
+static GglError fetch_combined(Context *context) {
+    return ggipc_call(
+        GGL_STR("aws.greengrass.private#GetRunnerContext"),
+        GGL_STR("aws.greengrass.private#GetRunnerContextRequest"),
+        (GglMap) { 0 },
+        runner_context_cb,
+        error_cb,
+        context
+    );
+}
+
+typedef struct {
+    GglByteVec *vec;
+    GglBuffer *out;
+} SystemConfigCtx;
+
+static GglError system_config_cb(void *ctx, GglMap result) {
+    SystemConfigCtx *config_ctx = ctx;
+    GglObject *value;
+    GglError ret = ggl_map_validate(
+        result,
+        GGL_MAP_SCHEMA({ GGL_STR("value"), GGL_REQUIRED, GGL_TYPE_BUF, &value }
+        )
+    );
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+    return copy_str(config_ctx->vec, *value, config_ctx->out);
+}
+
+static GglError get_system_config(
+    GglBuffer key, GglByteVec *vec, GglBuffer *out
+) {
+    SystemConfigCtx ctx = { .vec = vec, .out = out };
+    return ggipc_call(
+        GGL_STR("aws.greengrass.private#GetSystemConfig"),
+        GGL_STR("aws.greengrass.private#GetSystemConfigRequest"),
+        GGL_MAP(ggl_kv(GGL_STR("key"), ggl_obj_buf(key))),
+        system_config_cb,
+        error_cb,
+        &ctx
+    );
+}
+
+static GglError get_nucleus_config(GglBufList key_path, GglByteVec *vec) {
+    GglBuffer value = ggl_byte_vec_remaining_capacity(*vec);
+    GglError ret = ggipc_get_config_str(
+        key_path, &GGL_STR("aws.greengrass.NucleusLite"), &value
+    );
+    vec->buf.len += value.len;
+    return ret;
+}
+
+/// The calls recipe-runner made before GetRunnerContext. The component's
+/// configuration is read separately either way, so is not included.
+static GglError fetch_separate(Context *context) {
+    GglByteVec vec = GGL_BYTE_VEC(context->mem);
+    GglError ret = get_system_config(
+        GGL_STR("rootCaPath"), &vec, &context->root_ca_path
+    );
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
+    size_t start = vec.buf.len;
+    ret = get_nucleus_config(GGL_BUF_LIST(GGL_STR("awsRegion")), &vec);
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+    context->aws_region = ggl_buffer_substr(vec.buf, start, SIZE_MAX);
+
+    // Optional values; read but not compared
+    static uint8_t optional_mem[PATH_MAX];
+    GglByteVec optional = GGL_BYTE_VEC(optional_mem);
+    ret = get_nucleus_config(
+        GGL_BUF_LIST(GGL_STR("networkProxy"), GGL_STR("proxy"), GGL_STR("url")),
+        &optional
+    );
+    if ((ret != GGL_ERR_OK) && (ret != GGL_ERR_NOENTRY)) {
+        return ret;
+    }
+    optional.buf.len = 0;
+    ret = get_nucleus_config(
+        GGL_BUF_LIST(GGL_STR("networkProxy"), GGL_STR("noProxyAddresses")),
+        &optional
+    );
+    if ((ret != GGL_ERR_OK) && (ret != GGL_ERR_NOENTRY)) {
+        return ret;
+    }
+
+    ret = get_system_config(GGL_STR("thingName"), &vec, &context->thing_name);
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+    ret = get_system_config(GGL_STR("rootPath"), &vec, &context->root_path);
+    if (ret != GGL_ERR_OK) {
+        return ret;
+    }
+
+    GglBuffer port = GGL_BUF(optional_mem);
+    ret = ggipc_get_config_str(
+        GGL_BUF_LIST(GGL_STR("port")),
+        &GGL_STR("aws.greengrass.TokenExchangeService"),
+        &port
+    );
+    if ((ret != GGL_ERR_OK) && (ret != GGL_ERR_NOENTRY)) {
+        return ret;
+    }
+    return GGL_ERR_OK;
+}
+
+static uint64_t time_fetch(
+    const char *name, GglError (*fetch)(Context *), Context *context
+) {
+    uint64_t start = now_ns();
+    for (size_t i = 0; i < ITERATIONS; i++) {
+        GglError ret = fetch(context);
+        if (ret != GGL_ERR_OK) {
+            GGL_LOGE("%s fetch failed: %d.", name, (int) ret);
+            ggl_check_fail();
+            return 0;
+        }
+    }
+    uint64_t per_startup_us = (now_ns() - start) / ITERATIONS / 1000U;
+    GGL_LOGI("%s: %lu us per startup.", name, (unsigned long) per_startup_us);
+    return per_startup_us;
+}
+
+GglError run_runner_context_bench(char *component_name) {
+    char *socket_path
+        // NOLINTNEXTLINE(concurrency-mt-unsafe)
+        = getenv("AWS_GG_NUCLEUS_DOMAIN_SOCKET_FILEPATH_FOR_COMPONENT");
+    if (socket_path == NULL) {
+        GGL_LOGE("IPC socket path env var not set.");
+        return GGL_ERR_FAILURE;
+    }
+    GglError ret = ggipc_connect_with_payload(
+        ggl_buffer_from_null_term(socket_path),
+        ggl_obj_map(GGL_MAP(ggl_kv(
+            GGL_STR("componentName"),
+            ggl_obj_buf(ggl_buffer_from_null_term(component_name))
+        )))
+    );
+    if (ret != GGL_ERR_OK) {
+        GGL_LOGE("Failed to connect to nucleus.");
+        return ret;
+    }
+
+    static Context combined;
+    static Context separate;
+    uint64_t combined_us
+        = time_fetch("GetRunnerContext", fetch_combined, &combined);
+    uint64_t separate_us
+        = time_fetch("Separate calls", fetch_separate, &separate);
+    if (!ggl_check_passed()) {
+        return GGL_ERR_FAILURE;
+    }
+    if (combined_us > 0) {
+        GGL_LOGI(
+            "GetRunnerContext is %lu.%02lux faster.",
+            (unsigned long) (separate_us / combined_us),
+            (unsigned long) (separate_us * 100U / combined_us % 100U)
+        );
+    }
+
+    GGL_CHECK(ggl_buffer_eq(combined.thing_name, separate.thing_name));
+    GGL_CHECK(ggl_buffer_eq(combined.root_path, separate.root_path));
+    GGL_CHECK(ggl_buffer_eq(combined.root_ca_path, separate.root_ca_path));
+    GGL_CHECK(ggl_buffer_eq(combined.aws_region, separate.aws_region));
+
+    if (!ggl_check_passed()) {
+        return GGL_ERR_FAILURE;
+    }
+    GGL_LOGI("Runner context matches the separate calls.");
+    return GGL_ERR_OK;
+}
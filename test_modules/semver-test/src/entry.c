@@ -8,6 +8,53 @@
 #include <ggl/buffer.h>
 #include <ggl/error.h>
 #include <ggl/log.h>
+#include <limits.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    GglBuffer lhs;
+    GglBuffer rhs;
+    int expected; // Sign of the expected result
+} SemverCompareCase;
+
+static const SemverCompareCase COMPARE_CASES[] = {
+    { GGL_STR("1.0.0"), GGL_STR("1.0.0"), 0 },
+    { GGL_STR("1.0.0"), GGL_STR("1.0.1"), -1 },
+    { GGL_STR("1.0.1"), GGL_STR("1.0.0"), 1 },
+    { GGL_STR("1.2.0"), GGL_STR("1.10.0"), -1 },
+    { GGL_STR("2.0.0"), GGL_STR("10.0.0"), -1 },
+    { GGL_STR("1.10.0"), GGL_STR("1.9.9"), 1 },
+    { GGL_STR("0.9.0"), GGL_STR("1.0.0"), -1 },
+    { GGL_STR("1.0"), GGL_STR("1.0.0"), -1 },
+};
+
+static int sign(int value) {
+    if (value < 0) {
+        return -1;
+    }
+    return (value > 0) ? 1 : 0;
+}
+
+// Index ordering relies on compare agreeing with is_in_range
+static bool check_compare_case(const SemverCompareCase *test) {
+    int result = sign(ggl_semver_compare(test->lhs, test->rhs));
+    int reversed = sign(ggl_semver_compare(test->rhs, test->lhs));
+    if ((result != test->expected) || (reversed != -test->expected)) {
+        GGL_LOGE(
+            "ggl_semver_compare(%.*s, %.*s) returned %d, expected %d.",
+            (int) test->lhs.len,
+            test->lhs.data,
+            (int) test->rhs.len,
+            test->rhs.data,
+            result,
+            test->expected
+        );
+        return false;
+    }
+    return true;
+}
 
 GglError run_semver_test(void) {
     bool ret = is_in_range(GGL_STR("1.1.0"), GGL_STR(">=2.1.0"));
@@ -16,5 +63,30 @@ GglError run_semver_test(void) {
     } else {
         GGL_LOGI("Does not satisfy requirement/s");
     }
+
+    bool passed = true;
+    for (size_t i = 0; i < sizeof(COMPARE_CASES) / sizeof(COMPARE_CASES[0]);
+         i++) {
+        if (!check_compare_case(&COMPARE_CASES[i])) {
+            passed = false;
+        }
+    }
+
+    // Versions longer than a directory entry name are compared by prefix
+    static uint8_t long_mem[NAME_MAX + 16];
+    memset(long_mem, '1', sizeof(long_mem));
+    GglBuffer long_version = GGL_BUF(long_mem);
+    if (ggl_semver_compare(long_version, long_version) != 0) {
+        GGL_LOGE(
+            "ggl_semver_compare failed on a version of %zu bytes.",
+            long_version.len
+        );
+        passed = false;
+    }
+
+    if (!passed) {
+        return GGL_ERR_FAILURE;
+    }
+    GGL_LOGI("All ggl_semver_compare cases passed.");
     return GGL_ERR_OK;
 }
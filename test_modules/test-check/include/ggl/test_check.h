@@ -0,0 +1,29 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef GGL_TEST_CHECK_H
+#define GGL_TEST_CHECK_H
+
+//! Checks for test modules that log each failure and keep running, so that
+//! one run reports every failed check.
+
+#include <ggl/log.h>
+#include <stdbool.h>
+
+/// Logs and records a failure if cond is false.
+#define GGL_CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            GGL_LOGE("Check failed at line %d: %s", __LINE__, #cond); \
+            ggl_check_fail(); \
+        } \
+    } while (0)
+
+/// Records a failure reported without GGL_CHECK.
+void ggl_check_fail(void);
+
+/// Returns false if any check in this process has failed.
+bool ggl_check_passed(void);
+
+#endif
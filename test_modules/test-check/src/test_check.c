@@ -0,0 +1,18 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "ggl/test_check.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+
+// Checks may run on server or callback threads
+static atomic_bool failed = false;
+
+void ggl_check_fail(void) {
+    atomic_store_explicit(&failed, true, memory_order_relaxed);
+}
+
+bool ggl_check_passed(void) {
+    return !atomic_load_explicit(&failed, memory_order_relaxed);
+}
@@ -0,0 +1,410 @@
+// aws-greengrass-lite - AWS IoT Greengrass runtime for constrained devices
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+//! Checks the sd_notify datagrams gghealthd sends on behalf of components.
+//! A datagram socket stands in for systemd's notify socket and records the
+//! payload and the credentials the kernel attached to each message.
+
+#include "unit-notify-test.h"
+#include "unit_notify.h"
+#include <errno.h>
+#include <ggl/error.h>
+#include <ggl/log.h>
+#include <ggl/test_check.h>
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MAX_NOTIFY_LEN 256
+// Time the stand-in waits for a datagram before treating it as missing
+#define RECEIVE_TIMEOUT_MS 500
+
+typedef struct {
+    char payload[MAX_NOTIFY_LEN];
+    struct ucred cred;
+    /// File descriptor passed with the message, or -1
+    int fd;
+} NotifyMessage;
+
+static int open_stand_in(const char *address) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    size_t len = strlen(address);
+    memcpy(addr.sun_path, address, len);
+    if (address[0] == '@') {
+        addr.sun_path[0] = '\0';
+    } else {
+        (void) unlink(address);
+        len++;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    int one = 1;
+    struct timeval timeout = { .tv_usec = RECEIVE_TIMEOUT_MS * 1000 };
+    if ((setsockopt(fd, SOL_SOCKET, SO_PASSCRED, &one, sizeof(one)) != 0)
+        || (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout))
+            != 0)
+        || (bind(
+                fd,
+                (struct sockaddr *) &addr,
+                (socklen_t) (offsetof(struct sockaddr_un, sun_path) + len)
+            )
+            != 0)) {
+        GGL_LOGE("Failed to open notify socket stand-in: %d.", errno);
+        (void) close(fd);
+        return -1;
+    }
+
+    // NOLINTNEXTLINE(concurrency-mt-unsafe) set before any notification
+    setenv("NOTIFY_SOCKET", address, 1);
+    return fd;
+}
+
+/// Returns false if no datagram arrives within RECEIVE_TIMEOUT_MS.
+static bool receive_message(int fd, NotifyMessage *msg) {
+    *msg = (NotifyMessage) { .fd = -1 };
+
+    struct iovec iov
+        = { .iov_base = msg->payload, .iov_len = sizeof(msg->payload) - 1 };
+    union {
+        struct cmsghdr align;
+        uint8_t buf[CMSG_SPACE(sizeof(struct ucred)) + CMSG_SPACE(sizeof(int))];
+    } control;
+    struct msghdr hdr = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control.buf,
+        .msg_controllen = sizeof(control.buf),
+    };
+
+    ssize_t len = recvmsg(fd, &hdr, MSG_CMSG_CLOEXEC);
+    if (len < 0) {
+        return false;
+    }
+    msg->payload[len] = '\0';
+
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr); cmsg != NULL;
+         cmsg = CMSG_NXTHDR(&hdr, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET) {
+            continue;
+        }
+        if (cmsg->cmsg_type == SCM_CREDENTIALS) {
+            memcpy(&msg->cred, CMSG_DATA(cmsg), sizeof(msg->cred));
+        } else if (cmsg->cmsg_type == SCM_RIGHTS) {
+            memcpy(&msg->fd, CMSG_DATA(cmsg), sizeof(msg->fd));
+        }
+    }
+    return true;
+}
+
+static void test_own_pid(int fd) {
+    GGL_CHECK(notify_pid_state(getpid(), NULL, "READY=1") == GGL_ERR_OK);
+
+    NotifyMessage msg;
+    GGL_CHECK(receive_message(fd, &msg));
+    GGL_CHECK(strcmp(msg.payload, "READY=1") == 0);
+    GGL_CHECK(msg.cred.pid == getpid());
+    GGL_CHECK(msg.cred.uid == getuid());
+    GGL_CHECK(msg.cred.gid == getgid());
+    GGL_CHECK(msg.fd == -1);
+}
+
+/// Sends as another process's PID, which needs CAP_SYS_ADMIN. Without it,
+/// the cgroup fallback is used, which fails here as no cgroup is given.
+static void test_other_pid(int fd) {
+    pid_t child = fork();
+    if (child == 0) {
+        pause();
+        _exit(0);
+    }
+    GGL_CHECK(child > 0);
+    if (child < 0) {
+        return;
+    }
+
+    GglError ret = notify_pid_state(child, NULL, "STATUS=running");
+
+    NotifyMessage msg;
+    bool received = receive_message(fd, &msg);
+    if (ret == GGL_ERR_OK) {
+        GGL_CHECK(received);
+        GGL_CHECK(strcmp(msg.payload, "STATUS=running") == 0);
+        GGL_CHECK(msg.cred.pid == child);
+    } else {
+        GGL_LOGI("Not permitted to send as another PID; checked fallback.");
+        GGL_CHECK(ret == GGL_ERR_FAILURE);
+        GGL_CHECK(!received);
+    }
+
+    (void) kill(child, SIGKILL);
+    (void) waitpid(child, NULL, 0);
+}
+
+static void test_missing_cgroup(int fd) {
+    GGL_CHECK(
+        notify_pid_state(0, "/ggl-notify-test-missing", "READY=1")
+        == GGL_ERR_FAILURE
+    );
+    // The state must not be sent from outside the unit's cgroup
+    NotifyMessage msg;
+    GGL_CHECK(!receive_message(fd, &msg));
+
+    GGL_CHECK(notify_pid_state(0, NULL, "READY=1") == GGL_ERR_FAILURE);
+    GGL_CHECK(!receive_message(fd, &msg));
+}
+
+/// Finds the cgroup of this process, or returns false if it can not be
+/// joined by a child. The systemd hierarchy is used if mounted, as systemd
+/// does.
+static bool own_cgroup(char *cgroup, size_t len) {
+    FILE *file = fopen("/proc/self/cgroup", "re");
+    if (file == NULL) {
+        return false;
+    }
+    char line[512];
+    bool found = false;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        const char *v1 = strstr(line, ":name=systemd:");
+        const char *path = NULL;
+        if (v1 != NULL) {
+            path = &v1[strlen(":name=systemd:")];
+        } else if (!found && (strncmp(line, "0::", 3) == 0)) {
+            path = &line[3];
+        } else {
+            continue;
+        }
+        snprintf(cgroup, len, "%.*s", (int) strcspn(path, "\n"), path);
+        found = true;
+        if (v1 != NULL) {
+            break;
+        }
+    }
+    (void) fclose(file);
+    if (!found) {
+        return false;
+    }
+
+    char procs[2][1024];
+    snprintf(
+        procs[0], sizeof(procs[0]), "/sys/fs/cgroup%s/cgroup.procs", cgroup
+    );
+    snprintf(
+        procs[1],
+        sizeof(procs[1]),
+        "/sys/fs/cgroup/systemd%s/cgroup.procs",
+        cgroup
+    );
+    return (access(procs[0], W_OK) == 0) || (access(procs[1], W_OK) == 0);
+}
+
+typedef struct {
+    const char *cgroup;
+    GglError ret;
+} FallbackJob;
+
+static void *fallback_thread(void *arg) {
+    FallbackJob *job = arg;
+    job->ret = notify_pid_state(0, job->cgroup, "READY=1");
+    return NULL;
+}
+
+/// Sends from a forked process in the cgroup, which must stay alive until
+/// the stand-in has received the barrier and closed its fd.
+static void test_cgroup_fallback(int fd) {
+    static char cgroup[512];
+    if (!own_cgroup(cgroup, sizeof(cgroup))) {
+        GGL_LOGI("Cgroup is not writable; skipping cgroup fallback test.");
+        return;
+    }
+
+    FallbackJob job = { .cgroup = cgroup };
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, fallback_thread, &job) != 0) {
+        GGL_CHECK(false);
+        return;
+    }
+
+    NotifyMessage state;
+    NotifyMessage barrier;
+    GGL_CHECK(receive_message(fd, &state));
+    GGL_CHECK(receive_message(fd, &barrier));
+
+    GGL_CHECK(strcmp(state.payload, "READY=1") == 0);
+    GGL_CHECK((state.cred.pid != 0) && (state.cred.pid != getpid()));
+    GGL_CHECK(strcmp(barrier.payload, "BARRIER=1") == 0);
+    GGL_CHECK(barrier.cred.pid == state.cred.pid);
+    GGL_CHECK(barrier.fd >= 0);
+
+    // The sender exits as soon as the barrier fd is closed
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (barrier.fd >= 0) {
+        (void) close(barrier.fd);
+    }
+    pthread_join(thread, NULL);
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    GGL_CHECK(job.ret == GGL_ERR_OK);
+    GGL_CHECK(end.tv_sec - start.tv_sec < 2);
+}
+
+/// Creates an empty cgroup in a writable cgroup v2 hierarchy. Sets `dir` to
+/// its directory and `cgroup` to its path within the hierarchy.
+static bool make_v2_cgroup(char *dir, size_t dir_len, char *cgroup) {
+    static const char *const MOUNTS[] = { "/sys/fs/cgroup",
+                                          "/sys/fs/cgroup/unified" };
+    snprintf(cgroup, 64, "/ggl-notify-test-%d", getpid());
+    for (size_t i = 0; i < sizeof(MOUNTS) / sizeof(MOUNTS[0]); i++) {
+        char controllers[128];
+        snprintf(
+            controllers,
+            sizeof(controllers),
+            "%s/cgroup.controllers",
+            MOUNTS[i]
+        );
+        if (access(controllers, F_OK) != 0) {
+            continue;
+        }
+        snprintf(dir, dir_len, "%s%s", MOUNTS[i], cgroup);
+        if (mkdir(dir, 0755) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Reads the cgroup v2 path of a process.
+static bool process_cgroup(pid_t pid, char *cgroup, size_t len) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/cgroup", pid);
+    FILE *file = fopen(path, "re");
+    if (file == NULL) {
+        return false;
+    }
+    char line[512];
+    bool found = false;
+    while (!found && (fgets(line, sizeof(line), file) != NULL)) {
+        if (strncmp(line, "0::", 3) == 0) {
+            snprintf(
+                cgroup, len, "%.*s", (int) strcspn(&line[3], "\n"), &line[3]
+            );
+            found = true;
+        }
+    }
+    (void) fclose(file);
+    return found;
+}
+
+/// The sender is created directly in a cgroup v2 directory, without writing
+/// to cgroup.procs.
+static void test_cgroup_v2_spawn(int fd) {
+    char dir[PATH_MAX];
+    static char cgroup[64];
+    if (!make_v2_cgroup(dir, sizeof(dir), cgroup)) {
+        GGL_LOGI("No writable cgroup v2 hierarchy; skipping spawn test.");
+        return;
+    }
+
+    FallbackJob job = { .cgroup = cgroup };
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, fallback_thread, &job) != 0) {
+        GGL_CHECK(false);
+        (void) rmdir(dir);
+        return;
+    }
+
+    NotifyMessage state;
+    NotifyMessage barrier;
+    GGL_CHECK(receive_message(fd, &state));
+    GGL_CHECK(receive_message(fd, &barrier));
+    GGL_CHECK(strcmp(state.payload, "READY=1") == 0);
+
+    // The sender waits on the barrier, so its cgroup can still be read
+    char sender_cgroup[512] = { 0 };
+    GGL_CHECK(
+        process_cgroup(state.cred.pid, sender_cgroup, sizeof(sender_cgroup))
+    );
+    GGL_CHECK(strcmp(sender_cgroup, cgroup) == 0);
+
+    if (barrier.fd >= 0) {
+        (void) close(barrier.fd);
+    }
+    pthread_join(thread, NULL);
+    GGL_CHECK(job.ret == GGL_ERR_OK);
+    // Fails if the sender was not reaped
+    GGL_CHECK(rmdir(dir) == 0);
+}
+
+static void test_addresses(void) {
+    // Abstract namespace sockets are named with a leading '@'
+    char abstract[64];
+    snprintf(abstract, sizeof(abstract), "@ggl-notify-test-%d", getpid());
+    int fd = open_stand_in(abstract);
+    GGL_CHECK(fd >= 0);
+    if (fd >= 0) {
+        test_own_pid(fd);
+        (void) close(fd);
+    }
+
+    // NOLINTNEXTLINE(concurrency-mt-unsafe)
+    setenv("NOTIFY_SOCKET", "relative/notify", 1);
+    GGL_CHECK(notify_pid_state(getpid(), NULL, "READY=1") == GGL_ERR_CONFIG);
+
+    char long_path[sizeof(((struct sockaddr_un *) NULL)->sun_path) + 1];
+    memset(long_path, 'a', sizeof(long_path) - 1);
+    long_path[0] = '/';
+    long_path[sizeof(long_path) - 1] = '\0';
+    // NOLINTNEXTLINE(concurrency-mt-unsafe)
+    setenv("NOTIFY_SOCKET", long_path, 1);
+    GGL_CHECK(notify_pid_state(getpid(), NULL, "READY=1") == GGL_ERR_CONFIG);
+}
+
+GglError run_unit_notify_test(void) {
+    char dir[] = "/tmp/ggl-notify-test-XXXXXX";
+    if (mkdtemp(dir) == NULL) {
+        GGL_LOGE("Failed to create socket directory: %d.", errno);
+        return GGL_ERR_FAILURE;
+    }
+    char path[sizeof(dir) + 16];
+    snprintf(path, sizeof(path), "%s/notify", dir);
+
+    int fd = open_stand_in(path);
+    if (fd < 0) {
+        return GGL_ERR_FAILURE;
+    }
+
+    test_own_pid(fd);
+    test_other_pid(fd);
+    test_missing_cgroup(fd);
+    test_cgroup_fallback(fd);
+    test_cgroup_v2_spawn(fd);
+    (void) close(fd);
+    (void) unlink(path);
+    (void) rmdir(dir);
+
+    test_addresses();
+
+    if (!ggl_check_passed()) {
+        return GGL_ERR_FAILURE;
+    }
+    GGL_LOGI("All unit notify checks passed.");
+    return GGL_ERR_OK;
+}